@@ -2,21 +2,37 @@
 
 #define PI 3.1415926535897932384626433832795
 
-uniform vec3 Color;
-uniform vec3 LightColor;
-uniform vec3 LightDirection;
-
-uniform float MetallicFactor;
-uniform float RoughnessFactor;
+layout (std140) uniform Frame {
+    mat4 ViewMatrix;
+    mat4 ProjectionMatrix;
+    mat4 ShadowMatrices[4];
+    mat4 LightSpaceMatrices[4];
+    vec4 CascadeSplits;
+    vec4 AmbientSky;
+    vec4 AmbientEquator;
+    vec4 AmbientGround;
+    vec4 LightColor;
+    vec4 LightDirection;
+};
+
+layout (std140) uniform Material {
+    vec4 Color;
+    float MetallicFactor;
+    float RoughnessFactor;
+    // Texcoord offset and scale into the atlas layer, a layer of -1 samples albedo
+    vec4 AtlasRect;
+    int AtlasLayer;
+};
 
 uniform sampler2D albedo;
+uniform sampler2DArray albedoAtlas;
 uniform sampler2D shadowMap;
 
 in vec3 normal;
 in vec3 position;
 in vec2 texcoords;
 in vec3 fragPos;
-in vec4 lightSpacePosition;
+in vec3 worldPosition;
 in vec3 ambient;
 out vec4 fColor;
 
@@ -49,19 +65,41 @@ vec3 schlickFresnel(float dotProduct , vec3 F0) {
     return F0 + (1.0 - F0) * pow(clamp(1.0 - dotProduct , 0.0, 1.0), 5.0);
 }
 
+// The first cascade that reaches this far from the camera, -1 beyond them all
+int cascadeAt(float depth) {
+    for (int i = 0; i < 4; i++) {
+        if (depth <= CascadeSplits[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// AtlasLayer is the same for the whole draw, so the branch is uniform
+vec3 baseColor() {
+    if (AtlasLayer < 0) {
+        return texture(albedo, texcoords).rgb;
+    }
+    return texture(albedoAtlas, vec3(AtlasRect.xy + texcoords * AtlasRect.zw, AtlasLayer)).rgb;
+}
+
 void main() {
     float shadow = 1.0;
-    for (int i=0;i<4;i++){
-        if (texture(shadowMap, lightSpacePosition.xy + poissonDisk[i] / 700.0).r < lightSpacePosition.z) {
-            shadow -= 0.2;
+    int cascade = cascadeAt(-position.z);
+    if (cascade >= 0) {
+        vec4 lightSpacePosition = ShadowMatrices[cascade] * vec4(worldPosition, 1);
+        for (int i=0;i<4;i++){
+            if (texture(shadowMap, lightSpacePosition.xy + poissonDisk[i] / 700.0).r < lightSpacePosition.z) {
+                shadow -= 0.2;
+            }
         }
     }
 
-    vec3 lightVector = LightDirection;
+    vec3 lightVector = LightDirection.xyz;
     vec3 viewVector = normalize(-position);
     vec3 halfVector = normalize(viewVector + lightVector);
 
-    vec3 surfaceColor = Color * texture(albedo, texcoords).rgb;
+    vec3 surfaceColor = Color.rgb * baseColor();
 
     float normDotLight = max(dot(normal, lightVector), 0.0);
     float normDotHalf = max(dot(normal, halfVector), 0.0);
@@ -2,28 +2,35 @@
 layout (location = 0) in vec3 vPosition;
 layout (location = 1) in vec3 vNormal;
 layout (location = 2) in vec2 vTexCoords;
+layout (location = 3) in mat4 vModelMatrix;
 
-uniform mat4 MVPMatrix;
-uniform mat4 ModelMatrix;
-uniform mat4 ModelViewMatrix;
-uniform mat4 LightViewMatrix;
-uniform mat3 NormalMatrix;
-
-uniform vec3 AmbientSky;
-uniform vec3 AmbientEquator;
-uniform vec3 AmbientGround;
+layout (std140) uniform Frame {
+    mat4 ViewMatrix;
+    mat4 ProjectionMatrix;
+    mat4 ShadowMatrices[4];
+    mat4 LightSpaceMatrices[4];
+    vec4 CascadeSplits;
+    vec4 AmbientSky;
+    vec4 AmbientEquator;
+    vec4 AmbientGround;
+    vec4 LightColor;
+    vec4 LightDirection;
+};
 
 out vec3 ambient;
 out vec3 position;
-out vec4 lightSpacePosition;
+out vec3 worldPosition;
 out vec3 normal;
 out vec2 texcoords;
 
 void main() {
-    normal = normalize(NormalMatrix * vNormal);
-    position = (ModelViewMatrix * vec4(vPosition, 1)).xyz;
-    lightSpacePosition = LightViewMatrix * vec4(vPosition, 1);
+    mat4 modelView = ViewMatrix * vModelMatrix;
+    vec4 viewPosition = modelView * vec4(vPosition, 1);
+
+    normal = normalize(mat3(modelView) * vNormal);
+    position = viewPosition.xyz;
+    worldPosition = (vModelMatrix * vec4(vPosition, 1)).xyz;
     texcoords = vTexCoords;
-    gl_Position = MVPMatrix * vec4(vPosition, 1);
-    ambient = normal.y > 0 ? mix(AmbientEquator, AmbientSky, normal.y) : mix(AmbientEquator, AmbientGround, -normal.y);
+    gl_Position = ProjectionMatrix * viewPosition;
+    ambient = normal.y > 0 ? mix(AmbientEquator.rgb, AmbientSky.rgb, normal.y) : mix(AmbientEquator.rgb, AmbientGround.rgb, -normal.y);
 }
\ No newline at end of file
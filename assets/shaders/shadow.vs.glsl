@@ -1,8 +1,22 @@
 #version 330 core
 layout (location = 0) in vec3 vPosition;
+layout (location = 3) in mat4 vModelMatrix;
 
-uniform mat4 MVPMatrix;
+layout (std140) uniform Frame {
+    mat4 ViewMatrix;
+    mat4 ProjectionMatrix;
+    mat4 ShadowMatrices[4];
+    mat4 LightSpaceMatrices[4];
+    vec4 CascadeSplits;
+    vec4 AmbientSky;
+    vec4 AmbientEquator;
+    vec4 AmbientGround;
+    vec4 LightColor;
+    vec4 LightDirection;
+};
+
+uniform int Cascade;
 
 void main() {
-    gl_Position = MVPMatrix * vec4(vPosition, 1);
-}
\ No newline at end of file
+    gl_Position = LightSpaceMatrices[Cascade] * vModelMatrix * vec4(vPosition, 1);
+}
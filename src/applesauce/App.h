@@ -4,9 +4,20 @@
 #include "Buffer.h"
 #include "Shader.h"
 #include "Input.h"
+#include "Profiler.h"
+#include "RenderSnapshot.h"
+#include "RollingStats.h"
+#include "TripleBuffer.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #define WIDTH 640
@@ -14,6 +25,23 @@
 
 class App
 {
+public:
+    // Render timing, measured on the thread that draws
+    struct Timing
+    {
+        // From a tick publishing its snapshot until the first frame that
+        // shows it has been swapped in
+        applesauce::RollingStats latency;
+        // Between swaps, its deviation is the frame jitter
+        applesauce::RollingStats frameInterval;
+        // How late ticks started against the fixed step schedule
+        applesauce::RollingStats tickLateness;
+        // Snapshots replaced before a frame got to show them
+        uint64_t snapshotsSkipped = 0;
+        // Times the simulation fell so far behind that it dropped the backlog
+        uint64_t backlogsDropped = 0;
+    };
+
 public:
     App(int width = 640, int height = 480) : window(width, height)
     {
@@ -23,14 +51,26 @@ public:
     virtual void display() = 0;
     virtual void cleanUp() {}
 
+    // Copies what display() needs out of the simulation, after every update()
+    virtual void capture(applesauce::RenderSnapshot &) {}
+
     void run()
     {
-        _run(false);
+        _run(false, false);
     }
 
     void run_windowless()
     {
-        _run(true);
+        _run(true, false);
+    }
+
+    // update() runs on a thread of its own at the fixed step, this thread
+    // keeps the GL context and the window and draws the latest snapshots as
+    // fast as it can swap. GLFW only takes events on the main thread, so
+    // that is the one that renders.
+    void run_threaded()
+    {
+        _run(false, true);
     }
 
 protected:
@@ -39,49 +79,270 @@ protected:
         window.close();
     }
 
+    // Runs task on the thread that calls update(), just before the next
+    // tick. Window event handlers use it to hand input to the simulation.
+    void post(std::function<void()> task)
+    {
+        std::lock_guard<std::mutex> lock(postedMutex);
+        posted.push_back(std::move(task));
+    }
+
+    bool isThreaded() const
+    {
+        return threaded;
+    }
+
+    // For display(): draw the previous snapshot blended towards the current one
+    const applesauce::RenderSnapshot &previousSnapshot() const
+    {
+        return previous;
+    }
+
+    const applesauce::RenderSnapshot &currentSnapshot() const
+    {
+        return snapshots.front();
+    }
+
+    float snapshotBlend() const
+    {
+        return blend;
+    }
+
+    const Timing &timing() const
+    {
+        return frameTiming;
+    }
+
 private:
-    void _run(bool windowless)
+    static constexpr double step = 1.0 / 60.0;
+
+    // The simulation drops its backlog rather than run this far behind
+    static constexpr double maxBacklog = 0.25;
+
+    void _run(bool windowless, bool withSimulationThread)
     {
+        threaded = withSimulationThread;
         if (!windowless)
         {
             window.show();
         }
         init();
 
+        // The first frames show the world as init() left it
+        publishSnapshot(0);
+
         glfwSwapInterval(1);
 
+        if (threaded)
+        {
+            runThreaded();
+        }
+        else
+        {
+            runSingleThreaded();
+        }
+
+        cleanUp();
+    }
+
+    void runSingleThreaded()
+    {
         double t = 0.0;
-        const double step = 1.0f / 60.0f;
 
         double currentTime = glfwGetTime();
         double accumulator = 0;
 
         while (!window.shouldClose())
         {
+            profiler.beginFrame();
+
             double newTime = glfwGetTime();
             double frameTime = newTime - currentTime;
             currentTime = newTime;
 
-            
+            // After a stall, catching up every tick would only stall the next frame too
+            if (frameTime > maxBacklog)
+            {
+                frameTime = maxBacklog;
+                frameTiming.backlogsDropped++;
+            }
             accumulator += frameTime;
 
-            while (accumulator >= step) {
-                applesauce::Input::beginFrame();
-                window.pollEvents();
+            {
+                applesauce::Profiler::Scope scope(&profiler, "Update");
+                while (accumulator >= step) {
+                    applesauce::Input::beginFrame();
+                    window.pollEvents();
+                    runPosted();
+
+                    update(step);
+                    publishSnapshot(0);
+                    accumulator -= step;
+                    t += step;
+                }
+            }
+
+            acquireSnapshot();
+            blend = static_cast<float>(accumulator / step);
+            present();
+        }
+    }
+
+    void runThreaded()
+    {
+        std::atomic<bool> running{true};
+        std::thread simulation([this, &running]()
+                               { simulate(running); });
+
+        while (!window.shouldClose())
+        {
+            profiler.beginFrame();
+            window.pollEvents();
+
+            // The accumulator remainder, as seen from this thread
+            acquireSnapshot();
+            const std::chrono::duration<double> sinceTick = std::chrono::steady_clock::now() - snapshots.front().published;
+            blend = static_cast<float>(std::clamp(sinceTick.count() / step, 0.0, 1.0));
+            present();
+        }
+
+        running = false;
+        simulation.join();
+    }
 
-                update(step);
-                accumulator -= step;
-                t += step;
+    // Body of the simulation thread in run_threaded()
+    void simulate(const std::atomic<bool> &running)
+    {
+        using clock = std::chrono::steady_clock;
+        const auto tickLength = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(step));
+        const auto backlogLength = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(maxBacklog));
+
+        auto next = clock::now();
+        while (running)
+        {
+            const auto start = clock::now();
+            applesauce::Input::beginFrame();
+            runPosted();
+
+            update(step);
+            publishSnapshot(std::chrono::duration<double>(start - next).count());
+
+            next += tickLength;
+            if (clock::now() - next > backlogLength)
+            {
+                next = clock::now();
+                backlogsDropped++;
             }
-            
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    void runPosted()
+    {
+        {
+            std::lock_guard<std::mutex> lock(postedMutex);
+            std::swap(postedRunning, posted);
+        }
+        for (auto &task : postedRunning)
+            task();
+        postedRunning.clear();
+    }
+
+    void publishSnapshot(double lateness)
+    {
+        auto &snapshot = snapshots.back();
+        capture(snapshot);
+        snapshot.tick = ticks++;
+        snapshot.lateness = lateness;
+        snapshot.published = std::chrono::steady_clock::now();
+        snapshots.publish();
+    }
+
+    // The current snapshot becomes the previous one, if there is a newer one
+    void acquireSnapshot()
+    {
+        if (!snapshots.hasNew())
+            return;
+
+        std::swap(previous, snapshots.front());
+        snapshots.acquire();
+        const auto &current = snapshots.front();
+        if (current.tick > previous.tick + 1)
+        {
+            frameTiming.snapshotsSkipped += current.tick - previous.tick - 1;
+        }
+        frameTiming.tickLateness.add(std::max(current.lateness, 0.0));
+        unpresented = true;
+    }
+
+    void present()
+    {
+        {
+            applesauce::Profiler::Scope scope(&profiler, "Display");
             display();
-            
+        }
+
+        {
+            applesauce::Profiler::Scope scope(&profiler, "Swap");
             window.swapBuffers();
         }
 
-        cleanUp();
+        profiler.endFrame();
+
+        const auto now = std::chrono::steady_clock::now();
+        if (unpresented)
+        {
+            frameTiming.latency.add(std::chrono::duration<double>(now - snapshots.front().published).count());
+            unpresented = false;
+        }
+        if (lastPresent != std::chrono::steady_clock::time_point{})
+        {
+            frameTiming.frameInterval.add(std::chrono::duration<double>(now - lastPresent).count());
+        }
+        lastPresent = now;
+        if (threaded)
+        {
+            frameTiming.backlogsDropped = backlogsDropped;
+        }
+
+        if (startupSeconds == 0)
+        {
+            const std::chrono::duration<double> startup = std::chrono::steady_clock::now() - startTime;
+            startupSeconds = startup.count();
+            std::cout << "Startup: " << startupSeconds * 1000.0 << " ms to first frame" << std::endl;
+        }
     }
 
 protected:
+    // Declared ahead of the window so that window creation is part of startup
+    const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    // From construction until the first frame was presented, 0 until then
+    double startupSeconds = 0;
+
     Window window;
-};
\ No newline at end of file
+
+    // Every pass through the main loop is one profiler frame. Declared after
+    // the window so its queries are deleted while the context is still alive.
+    // Only the drawing thread may use it.
+    applesauce::Profiler profiler;
+
+private:
+    bool threaded = false;
+
+    // Written by update()'s thread, read by the drawing thread
+    applesauce::TripleBuffer<applesauce::RenderSnapshot> snapshots;
+    uint64_t ticks = 0;
+    std::atomic<uint64_t> backlogsDropped{0};
+
+    // Drawing thread only
+    applesauce::RenderSnapshot previous;
+    float blend = 1.0f;
+    bool unpresented = false;
+    std::chrono::steady_clock::time_point lastPresent;
+    Timing frameTiming;
+
+    std::mutex postedMutex;
+    std::vector<std::function<void()>> posted;
+    // update()'s thread only
+    std::vector<std::function<void()>> postedRunning;
+};
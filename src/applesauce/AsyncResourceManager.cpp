@@ -0,0 +1,332 @@
+#include "AsyncResourceManager.h"
+
+#include <util/AssetPack.h>
+#include <util/CompressedImage.h>
+#include <util/Image.h>
+
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+namespace applesauce
+{
+    AsyncResourceManager::AsyncResourceManager(size_t workerCount, size_t maxQueued, size_t uploadRingBytes)
+        : jobs(std::max<size_t>(workerCount, 1) + 1), maxQueued(std::max<size_t>(maxQueued, 1)), uploadRing(uploadRingBytes)
+    {
+    }
+
+    AsyncResourceManager::~AsyncResourceManager()
+    {
+        // Decodes point into loads
+        jobs.wait(decoding);
+    }
+
+    std::shared_ptr<Texture2D> AsyncResourceManager::loadTexture(const std::string &name, const std::string &filename)
+    {
+        if (auto texture = getTexture(name))
+        {
+            return texture;
+        }
+
+        auto texture = addTexture(name, singleColorTexture(0xFFFFFFFF));
+        const auto extension = std::filesystem::path(filename).extension();
+        if (extension == ".dds" || extension == ".ktx2")
+        {
+            // Already block compressed with its mips, GL takes the blocks as they are
+            enqueue(name, [texture, filename]() -> Upload
+                    {
+                        auto image = std::make_shared<CompressedImage>(compressedImageFromFile(filename.c_str()));
+                        return [texture, image]()
+                        {
+                            if (!setTextureCompressed(*texture, *image))
+                            {
+                                throw std::runtime_error("BC7 textures are not supported by this driver");
+                            }
+                        };
+                    });
+            return texture;
+        }
+
+        enqueue(name, [this, texture, filename]() -> Upload
+                {
+                    const auto image = imageFromPNG(filename.c_str());
+                    if (image.empty())
+                    {
+                        throw std::runtime_error("Unable to read \"" + filename + "\"");
+                    }
+                    auto mips = std::make_shared<std::vector<Image>>(generateMipChain(image));
+                    return [this, texture, mips]()
+                    { uploadRing.upload(*texture, *mips); };
+                });
+        return texture;
+    }
+
+    std::shared_ptr<Texture2D> AsyncResourceManager::loadTexture(const std::string &name, std::shared_ptr<const AssetPack> pack)
+    {
+        if (auto texture = getTexture(name))
+        {
+            return texture;
+        }
+
+        // The pack is mapped, there is nothing to decode
+        auto texture = addTexture(name, singleColorTexture(0xFFFFFFFF));
+        enqueue(name, [this, texture, pack, name]() -> Upload
+                {
+                    const auto record = pack->findTexture(name);
+                    if (!record)
+                    {
+                        throw std::runtime_error("No texture \"" + name + "\" in the pack");
+                    }
+                    std::vector<TextureUploadRing::Level> levels;
+                    const auto mips = pack->mips();
+                    for (uint32_t level = 0; level < record->mipCount; level++)
+                    {
+                        const auto &mip = mips[record->firstMip + level];
+                        levels.push_back({mip.width, mip.height, pack->blob(mip.offset)});
+                    }
+                    return [this, texture, pack, levels]()
+                    { uploadRing.upload(*texture, levels.data(), levels.size()); };
+                });
+        return texture;
+    }
+
+    void AsyncResourceManager::loadAtlasTexture(TextureAtlas &atlas, const std::string &name, const std::string &filename,
+                                                bool repeat, AtlasReady ready)
+    {
+        enqueue(name, [&atlas, name, filename, repeat, ready]() -> Upload
+                {
+                    auto image = std::make_shared<Image>(imageFromPNG(filename.c_str()));
+                    if (image->empty())
+                    {
+                        throw std::runtime_error("Unable to read \"" + filename + "\"");
+                    }
+                    return [&atlas, name, image, repeat, ready]()
+                    {
+                        const auto entry = atlas.add(name, *image, repeat);
+                        if (ready)
+                            ready(entry);
+                    };
+                });
+    }
+
+    void AsyncResourceManager::loadAtlasTexture(TextureAtlas &atlas, const std::string &name,
+                                                std::shared_ptr<const AssetPack> pack, bool repeat, AtlasReady ready)
+    {
+        // The atlas makes mips to suit its own borders, only level 0 is taken
+        enqueue(name, [&atlas, name, pack, repeat, ready]() -> Upload
+                {
+                    const auto record = pack->findTexture(name);
+                    if (!record)
+                    {
+                        throw std::runtime_error("No texture \"" + name + "\" in the pack");
+                    }
+                    const auto mips = pack->mips();
+                    const auto &mip = mips[record->firstMip];
+                    const auto pixels = pack->blob(mip.offset);
+                    auto image = std::make_shared<Image>(Image{mip.width, mip.height,
+                                                               std::vector<uint8_t>(pixels, pixels + static_cast<size_t>(mip.width) * mip.height * 4)});
+                    return [&atlas, name, image, repeat, ready]()
+                    {
+                        const auto entry = atlas.add(name, *image, repeat);
+                        if (ready)
+                            ready(entry);
+                    };
+                });
+    }
+
+    void AsyncResourceManager::loadMeshes(const std::string &filename, MeshReady ready)
+    {
+        enqueue(filename, [this, filename, ready]() -> Upload
+                {
+                    auto meshes = decodeMeshes(filename.c_str());
+                    return [this, meshes, ready]()
+                    { placeMeshes(uploadMeshes(*meshes), ready); };
+                });
+    }
+
+    void AsyncResourceManager::loadMeshes(std::shared_ptr<const AssetPack> pack, const std::string &source, MeshReady ready)
+    {
+        enqueue(source, [this, pack, source, ready]() -> Upload
+                {
+                    return [this, pack, source, ready]()
+                    { placeMeshes(applesauce::loadMeshes(*pack, source), ready); };
+                });
+    }
+
+    std::shared_ptr<Mesh> AsyncResourceManager::addMesh(const std::string &name, Mesh mesh)
+    {
+        auto entry = meshEntry(name);
+        *entry = std::move(mesh);
+        meshesPlaced.fetch_add(1, std::memory_order_relaxed);
+        return entry;
+    }
+
+    std::shared_ptr<Texture2D> AsyncResourceManager::addTexture(const std::string &name, std::shared_ptr<Texture2D> texture)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        textures[name] = texture;
+        return texture;
+    }
+
+    std::shared_ptr<Mesh> AsyncResourceManager::getMesh(const std::string &name)
+    {
+        return meshEntry(name);
+    }
+
+    std::shared_ptr<Texture2D> AsyncResourceManager::getTexture(const std::string &name)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto found = textures.find(name);
+        return found != textures.end() ? found->second : nullptr;
+    }
+
+    void AsyncResourceManager::upload(double budgetSeconds)
+    {
+        const auto start = Clock::now();
+        size_t count = 0;
+        std::chrono::duration<double> elapsed{0};
+        while (count == 0 || elapsed.count() < budgetSeconds)
+        {
+            if (!uploadOne())
+                break;
+            count++;
+            elapsed = Clock::now() - start;
+        }
+        if (count == 0)
+            return;
+
+        loaderStats.uploadFrames++;
+        loaderStats.uploadSeconds += elapsed.count();
+        loaderStats.maxFrameUploadSeconds = std::max(loaderStats.maxFrameUploadSeconds, elapsed.count());
+        if (elapsed.count() > budgetSeconds)
+        {
+            loaderStats.stalls++;
+        }
+    }
+
+    void AsyncResourceManager::finish()
+    {
+        while (true)
+        {
+            while (uploadOne())
+            {
+            }
+            if (idle())
+                return;
+            jobs.wait(decoding);
+        }
+    }
+
+    bool AsyncResourceManager::idle() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return inFlight == 0 && waiting.empty();
+    }
+
+    void AsyncResourceManager::enqueue(const std::string &name, Decode decode)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        loads.push_back({this, {}, name, std::move(decode), nullptr, {}, Clock::now()});
+        loads.back().self = std::prev(loads.end());
+        waiting.push_back(loads.back().self);
+        loaderStats.requested++;
+        startLoads();
+    }
+
+    void AsyncResourceManager::startLoads()
+    {
+        while (!waiting.empty() && inFlight < maxQueued)
+        {
+            auto &load = *waiting.front();
+            waiting.pop_front();
+            inFlight++;
+            jobs.run(decodeJob, &load, 0, 0, decoding);
+        }
+    }
+
+    void AsyncResourceManager::decodeJob(void *data, size_t, size_t)
+    {
+        auto &load = *static_cast<Load *>(data);
+        const auto start = Clock::now();
+        try
+        {
+            load.upload = load.decode();
+        }
+        catch (const std::exception &e)
+        {
+            load.error = e.what();
+        }
+        load.decodeSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(load.owner->mutex);
+        load.owner->decoded.push_back(load.self);
+    }
+
+    bool AsyncResourceManager::uploadOne()
+    {
+        std::list<Load>::iterator it;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (decoded.empty())
+                return false;
+            it = decoded.front();
+            decoded.pop_front();
+        }
+
+        auto &load = *it;
+        if (load.error.empty())
+        {
+            try
+            {
+                load.upload();
+            }
+            catch (const std::exception &e)
+            {
+                load.error = e.what();
+            }
+        }
+        if (load.error.empty())
+        {
+            loaderStats.uploaded++;
+        }
+        else
+        {
+            loaderStats.failed++;
+            std::cout << "AsyncResourceManager: Failed to load " << load.name << ": " << load.error << std::endl;
+        }
+        loaderStats.decodeSeconds += load.decodeSeconds;
+        loaderStats.maxLatencySeconds = std::max(loaderStats.maxLatencySeconds,
+                                                 std::chrono::duration<double>(Clock::now() - load.requested).count());
+
+        std::lock_guard<std::mutex> lock(mutex);
+        loads.erase(it);
+        inFlight--;
+        startLoads();
+        return true;
+    }
+
+    std::shared_ptr<Mesh> AsyncResourceManager::meshEntry(const std::string &name)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto &entry = meshes[name];
+        if (!entry)
+        {
+            entry = std::make_shared<Mesh>();
+        }
+        return entry;
+    }
+
+    void AsyncResourceManager::placeMeshes(std::unordered_map<std::string, Mesh> loaded, const MeshReady &ready)
+    {
+        for (auto &[name, mesh] : loaded)
+        {
+            auto entry = addMesh(name, std::move(mesh));
+            if (ready)
+            {
+                ready(name, *entry);
+            }
+        }
+    }
+}
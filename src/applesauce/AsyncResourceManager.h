@@ -0,0 +1,178 @@
+#pragma once
+
+#include "Entity.h"
+#include "JobSystem.h"
+#include "Mesh.h"
+#include "Texture.h"
+#include "TextureAtlas.h"
+#include "TextureUploadRing.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class AssetPack;
+
+namespace applesauce
+{
+    // Loads meshes and textures without holding up the thread that draws.
+    // Reading and decoding runs on worker threads, and whatever is decoded
+    // waits in a queue for upload() to hand it to GL on the drawing thread.
+    // At most maxQueued loads are decoding or waiting at once, so the workers
+    // can't run ahead of the uploads with the whole level in memory.
+    //
+    // Every load returns its handle at once. A texture is a white texel until
+    // its pixels are uploaded and a mesh has no primitives until then, and
+    // the handle stays the same afterwards. getMesh() can be called from any
+    // thread, before or after the mesh is asked for. getTexture() only finds
+    // textures that were asked for, since placeholders need GL.
+    //
+    // Texture mip chains are made by the workers too, and every level goes to
+    // GL through a TextureUploadRing.
+    class AsyncResourceManager : public ResourceManager
+    {
+    public:
+        // Called on the drawing thread as each mesh of a file is uploaded,
+        // with the mesh already in place behind its handle
+        using MeshReady = std::function<void(const std::string &name, Mesh &mesh)>;
+        // Called on the drawing thread once a texture has been copied into
+        // its atlas
+        using AtlasReady = std::function<void(const TextureAtlas::Entry &entry)>;
+
+        struct Stats
+        {
+            size_t requested = 0;
+            size_t uploaded = 0;
+            size_t failed = 0;
+            // Frames that uploaded anything, and of those the ones that went
+            // over the budget
+            size_t uploadFrames = 0;
+            size_t stalls = 0;
+            double uploadSeconds = 0;
+            double maxFrameUploadSeconds = 0;
+            // Worker time spent reading and decoding
+            double decodeSeconds = 0;
+            // From asking for a load until it was uploaded
+            double maxLatencySeconds = 0;
+        };
+
+        static constexpr size_t defaultMaxQueued = 8;
+        // Room for a couple of 1024x1024 textures with their mips
+        static constexpr size_t defaultUploadRingBytes = 16 << 20;
+
+        // workerCount threads do the decoding, the calling thread is the one
+        // that has to call upload(). Needs a current GL context. An upload
+        // ring of 0 bytes has textures read straight from client memory.
+        explicit AsyncResourceManager(size_t workerCount = 2, size_t maxQueued = defaultMaxQueued,
+                                      size_t uploadRingBytes = defaultUploadRingBytes);
+        ~AsyncResourceManager();
+
+        AsyncResourceManager(const AsyncResourceManager &) = delete;
+        AsyncResourceManager &operator=(const AsyncResourceManager &) = delete;
+
+        // PNG, DDS or KTX2 files, or textures baked into a pack
+        std::shared_ptr<Texture2D> loadTexture(const std::string &name, const std::string &filename);
+        std::shared_ptr<Texture2D> loadTexture(const std::string &name, std::shared_ptr<const AssetPack> pack);
+
+        // A PNG file, or the top level of a texture baked into a pack, added
+        // to an atlas instead of a texture of its own. The atlas has to
+        // outlive the load.
+        void loadAtlasTexture(TextureAtlas &atlas, const std::string &name, const std::string &filename, bool repeat,
+                              AtlasReady ready);
+        void loadAtlasTexture(TextureAtlas &atlas, const std::string &name, std::shared_ptr<const AssetPack> pack,
+                              bool repeat, AtlasReady ready);
+
+        // Every mesh of a glTF file, or of one source baked into a pack, each
+        // under its own name
+        void loadMeshes(const std::string &filename, MeshReady ready = nullptr);
+        void loadMeshes(std::shared_ptr<const AssetPack> pack, const std::string &source, MeshReady ready = nullptr);
+
+        // Made on the calling thread, ready at once
+        std::shared_ptr<Mesh> addMesh(const std::string &name, Mesh mesh);
+        std::shared_ptr<Texture2D> addTexture(const std::string &name, std::shared_ptr<Texture2D> texture);
+
+        std::shared_ptr<Mesh> getMesh(const std::string &name) override;
+        std::shared_ptr<Texture2D> getTexture(const std::string &name) override;
+
+        // Uploads decoded loads until budgetSeconds is used up, at least one
+        // per call so that a load larger than the budget still gets through.
+        // Call once a frame from the drawing thread.
+        void upload(double budgetSeconds);
+
+        // Blocks until everything asked for so far is uploaded
+        void finish();
+
+        // Nothing decoding or waiting to upload
+        bool idle() const;
+
+        const Stats &stats() const
+        {
+            return loaderStats;
+        }
+
+        // Goes up whenever a mesh is put behind its handle, so that whatever
+        // was drawn from the placeholder (e.g. a cached shadow map) can tell
+        // it is out of date
+        uint64_t meshGeneration() const
+        {
+            return meshesPlaced.load(std::memory_order_relaxed);
+        }
+
+        const TextureUploadRing &textureUploads() const
+        {
+            return uploadRing;
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+        // Returned by a decode, run on the drawing thread
+        using Upload = std::function<void()>;
+        using Decode = std::function<Upload()>;
+
+        struct Load
+        {
+            AsyncResourceManager *owner;
+            std::list<Load>::iterator self;
+            std::string name;
+            Decode decode;
+            Upload upload;
+            std::string error;
+            Clock::time_point requested;
+            double decodeSeconds = 0;
+        };
+
+        void enqueue(const std::string &name, Decode decode);
+        // Starts decodes while there is room, with the mutex held
+        void startLoads();
+        static void decodeJob(void *data, size_t, size_t);
+        bool uploadOne();
+        std::shared_ptr<Mesh> meshEntry(const std::string &name);
+        void placeMeshes(std::unordered_map<std::string, Mesh> loaded, const MeshReady &ready);
+
+        JobSystem jobs;
+        JobSystem::Counter decoding;
+        size_t maxQueued;
+
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, std::shared_ptr<Mesh>> meshes;
+        std::unordered_map<std::string, std::shared_ptr<Texture2D>> textures;
+        // Loads are kept in a list so that their jobs can point at them
+        std::list<Load> loads;
+        std::deque<std::list<Load>::iterator> waiting;
+        std::deque<std::list<Load>::iterator> decoded;
+        size_t inFlight = 0;
+
+        TextureUploadRing uploadRing;
+
+        Stats loaderStats;
+        std::atomic<uint64_t> meshesPlaced{0};
+    };
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace applesauce
+{
+    struct Sphere
+    {
+        glm::vec3 center;
+        float radius;
+    };
+
+    // Axis aligned box in model space. Culling uses the sphere around it.
+    struct Bounds
+    {
+        glm::vec3 min{0};
+        glm::vec3 max{0};
+
+        glm::vec3 center() const
+        {
+            return (min + max) * 0.5f;
+        }
+
+        float radius() const
+        {
+            return glm::length(max - min) * 0.5f;
+        }
+
+        static Bounds fromPoints(const glm::vec3 *points, size_t count)
+        {
+            if (count == 0)
+            {
+                return {};
+            }
+            Bounds result{points[0], points[0]};
+            for (size_t i = 1; i < count; i++)
+            {
+                result.min = glm::min(result.min, points[i]);
+                result.max = glm::max(result.max, points[i]);
+            }
+            return result;
+        }
+    };
+
+    // Bounding sphere after transform. The radius grows with the largest
+    // scale of the three axes so the sphere stays conservative.
+    inline Sphere worldSphere(const Bounds &bounds, const glm::mat4 &transform)
+    {
+        const float scale = std::max({glm::length(glm::vec3(transform[0])),
+                                      glm::length(glm::vec3(transform[1])),
+                                      glm::length(glm::vec3(transform[2]))});
+        return {glm::vec3(transform * glm::vec4(bounds.center(), 1.0f)), bounds.radius() * scale};
+    }
+}
@@ -15,6 +15,13 @@ namespace applesauce
             none,
             vertex_array,
             element_array,
+            uniform,
+        };
+
+        enum class Usage
+        {
+            staticDraw,
+            streamDraw,
         };
 
     private:
@@ -33,22 +40,35 @@ namespace applesauce
                 return GL_ARRAY_BUFFER;
             case Target::element_array:
                 return GL_ELEMENT_ARRAY_BUFFER;
+            case Target::uniform:
+                return GL_UNIFORM_BUFFER;
             default:
                 return 0;
             }
         }
 
+        static GLenum getGlUsage(Usage usage)
+        {
+            switch (usage)
+            {
+            case Usage::streamDraw:
+                return GL_STREAM_DRAW;
+            default:
+                return GL_STATIC_DRAW;
+            }
+        }
+
     public:
-        Buffer(size_t size, Target target, size_t elementSize = 1)
-            : GLResource(genGlBuffer()), _target(getGlTarget(target)), _size(size), _elementSize(elementSize)
+        Buffer(size_t size, Target target, size_t elementSize = 1, Usage usage = Usage::staticDraw)
+            : GLResource(genGlBuffer()), _target(getGlTarget(target)), _size(size), _elementSize(elementSize), _usage(getGlUsage(usage))
         {
             bind();
-            glBufferData(_target, size, nullptr, GL_STATIC_DRAW);
+            glBufferData(_target, size, nullptr, _usage);
             unbind();
         }
 
         Buffer(const void *data, size_t size, Target target = Target::none)
-            : GLResource(genGlBuffer()), _target(getGlTarget(target)), _size(size), _elementSize(1)
+            : GLResource(genGlBuffer()), _target(getGlTarget(target)), _size(size), _elementSize(1), _usage(GL_STATIC_DRAW)
         {
             glBindBuffer(GL_COPY_WRITE_BUFFER, glId());
             glBufferData(GL_COPY_WRITE_BUFFER, size, data, GL_STATIC_DRAW);
@@ -81,6 +101,19 @@ namespace applesauce
             return glUnmapBuffer(_target);
         }
 
+        // Detaches the current storage so the driver does not have to wait for
+        // draws still reading from it. Expects the buffer to be bound.
+        void orphan()
+        {
+            glBufferData(_target, _size, nullptr, _usage);
+        }
+
+        // Expects the buffer to be bound.
+        void setSubData(size_t offset, size_t size, const void *data)
+        {
+            glBufferSubData(_target, offset, size, data);
+        }
+
         size_t size() const
         {
             return _size;
@@ -95,5 +128,6 @@ namespace applesauce
         const GLenum _target;
         const size_t _size;
         const size_t _elementSize;
+        const GLenum _usage;
     };
 }
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "Culling.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CULLING_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace applesauce
+{
+    Frustum Frustum::fromMatrix(const glm::mat4 &m)
+    {
+        // Gribb and Hartmann: each plane is the last row plus or minus one of
+        // the others. glm is column major, so row i is m[0][i]..m[3][i].
+        const auto row = [&m](int i)
+        { return glm::vec4{m[0][i], m[1][i], m[2][i], m[3][i]}; };
+
+        Frustum result{{
+            row(3) + row(0), // left
+            row(3) - row(0), // right
+            row(3) + row(1), // bottom
+            row(3) - row(1), // top
+            row(3) + row(2), // near
+            row(3) - row(2), // far
+        }};
+        for (auto &plane : result.planes)
+        {
+            plane = plane / glm::length(glm::vec3(plane));
+        }
+        return result;
+    }
+
+    void CullingSet::clear()
+    {
+        x.clear();
+        y.clear();
+        z.clear();
+        radius.clear();
+    }
+
+    void CullingSet::add(const Sphere &sphere)
+    {
+        x.push_back(sphere.center.x);
+        y.push_back(sphere.center.y);
+        z.push_back(sphere.center.z);
+        radius.push_back(sphere.radius);
+    }
+
+    static bool sphereVisible(const Frustum &frustum, float x, float y, float z, float radius)
+    {
+        for (const auto &plane : frustum.planes)
+        {
+            if (plane.x * x + plane.y * y + plane.z * z + plane.w < -radius)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static CullStats countVisible(const std::vector<uint8_t> &visible)
+    {
+        CullStats stats;
+        stats.tested = visible.size();
+        for (const auto v : visible)
+        {
+            stats.drawn += v;
+        }
+        stats.culled = stats.tested - stats.drawn;
+        return stats;
+    }
+
+    CullStats CullingSet::cullScalar(const Frustum &frustum, std::vector<uint8_t> &visible) const
+    {
+        visible.resize(size());
+        for (size_t i = 0; i < size(); i++)
+        {
+            visible[i] = sphereVisible(frustum, x[i], y[i], z[i], radius[i]);
+        }
+        return countVisible(visible);
+    }
+
+    CullStats CullingSet::cull(const Frustum &frustum, std::vector<uint8_t> &visible) const
+    {
+#ifdef CULLING_SSE
+        visible.resize(size());
+
+        __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+        for (int p = 0; p < 6; p++)
+        {
+            planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+            planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+            planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+            planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+        }
+
+        size_t i = 0;
+        for (; i + 4 <= size(); i += 4)
+        {
+            const __m128 sx = _mm_loadu_ps(&x[i]);
+            const __m128 sy = _mm_loadu_ps(&y[i]);
+            const __m128 sz = _mm_loadu_ps(&z[i]);
+            const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&radius[i]));
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int p = 0; p < 6; p++)
+            {
+                const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], sx), _mm_mul_ps(planeY[p], sy)),
+                                                   _mm_add_ps(_mm_mul_ps(planeZ[p], sz), planeW[p]));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+            }
+
+            const int mask = _mm_movemask_ps(inside);
+            visible[i] = mask & 1;
+            visible[i + 1] = (mask >> 1) & 1;
+            visible[i + 2] = (mask >> 2) & 1;
+            visible[i + 3] = (mask >> 3) & 1;
+        }
+        for (; i < size(); i++)
+        {
+            visible[i] = sphereVisible(frustum, x[i], y[i], z[i], radius[i]);
+        }
+        return countVisible(visible);
+#else
+        return cullScalar(frustum, visible);
+#endif
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Bounds.h"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace applesauce
+{
+    // Six planes facing inwards: a point p is inside when
+    // dot(vec3(plane), p) + plane.w >= 0 for every plane.
+    struct Frustum
+    {
+        glm::vec4 planes[6];
+
+        // Works for perspective and orthographic projections alike, the light
+        // box of the shadow pass included.
+        static Frustum fromMatrix(const glm::mat4 &viewProjection);
+    };
+
+    struct CullStats
+    {
+        size_t tested = 0;
+        size_t drawn = 0;
+        size_t culled = 0;
+    };
+
+    // World space bounding spheres stored as separate x, y, z and radius
+    // arrays, so that culling tests four spheres per SSE instruction.
+    class CullingSet
+    {
+    public:
+        void clear();
+        void add(const Sphere &sphere);
+
+        size_t size() const
+        {
+            return radius.size();
+        }
+
+        // visible[i] is 1 when sphere i touches the frustum, 0 otherwise
+        CullStats cull(const Frustum &frustum, std::vector<uint8_t> &visible) const;
+
+        // One sphere at a time, the reference for the SIMD path
+        CullStats cullScalar(const Frustum &frustum, std::vector<uint8_t> &visible) const;
+
+    private:
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        std::vector<float> radius;
+    };
+}
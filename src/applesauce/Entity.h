@@ -1,6 +1,8 @@
 #pragma once
 
+#include "EntityStore.h"
 #include "Mesh.h"
+#include "Pool.h"
 #include "Texture.h"
 
 #define GLM_SWIZZLE
@@ -10,6 +12,7 @@
 #include <glm/gtc/quaternion.hpp>
 
 #include <memory>
+#include <typeindex>
 
 namespace applesauce
 {
@@ -17,7 +20,31 @@ namespace applesauce
     struct Entity;
     struct IWorld
     {
-        virtual std::shared_ptr<Entity> spawn(Entity *, const glm::vec3 &position = glm::vec3{0}, const glm::quat &orientation = glm::quat{glm::vec3{0}}) = 0;
+        virtual std::shared_ptr<Entity> spawn(std::shared_ptr<Entity>, const glm::vec3 &position = glm::vec3{0}, const glm::quat &orientation = glm::quat{glm::vec3{0}}) = 0;
+
+        std::shared_ptr<Entity> spawn(Entity *entity, const glm::vec3 &position = glm::vec3{0}, const glm::quat &orientation = glm::quat{glm::vec3{0}})
+        {
+            return spawn(std::shared_ptr<Entity>(entity), position, orientation);
+        }
+
+        // Pooled spawn for short lived entities such as shells and debris. T
+        // and its control block share one block of a per type slab pool, which
+        // is reused as soon as the last reference goes away.
+        template <typename T>
+        std::shared_ptr<T> spawn(const glm::vec3 &position = glm::vec3{0}, const glm::quat &orientation = glm::quat{glm::vec3{0}})
+        {
+            auto entity = std::allocate_shared<T>(PoolAllocator<T>(entityPool(typeid(T))));
+            spawn(std::shared_ptr<Entity>(entity), position, orientation);
+            return entity;
+        }
+
+        // Called by Entity::destroy(). Worlds that run entity callbacks on
+        // several threads defer it to their next sync point.
+        virtual void destroy(Entity &entity);
+
+    protected:
+        // Pools have to outlive every entity allocated from them
+        virtual SlabPool &entityPool(std::type_index type) = 0;
     };
 
     class ResourceManager
@@ -27,26 +54,69 @@ namespace applesauce
         virtual std::shared_ptr<applesauce::Texture2D> getTexture(const std::string &) = 0;
     };
 
+    // Hands out no resources at all, for running entities without a GL context
+    class NullResourceManager : public ResourceManager
+    {
+    public:
+        std::shared_ptr<applesauce::Mesh> getMesh(const std::string &) override
+        {
+            return nullptr;
+        }
+        std::shared_ptr<applesauce::Texture2D> getTexture(const std::string &) override
+        {
+            return nullptr;
+        }
+    };
+
+    // Gameplay behaviour on top of the components in an EntityStore. The
+    // component accessors are only valid while the entity is spawned.
     struct Entity
     {
-        glm::vec3 position = glm::vec3{0};
-        glm::vec3 velocity = glm::vec3(0);
-        glm::quat orientation = glm::quat{};
-        std::shared_ptr<Mesh> mesh = nullptr;
+        glm::vec3 &position() { return store->positions[slot]; }
+        const glm::vec3 &position() const { return store->positions[slot]; }
+        glm::quat &orientation() { return store->orientations[slot]; }
+        const glm::quat &orientation() const { return store->orientations[slot]; }
+        glm::mat4 &modelMatrix() { return store->modelMatrices[slot]; }
+        const glm::mat4 &modelMatrix() const { return store->modelMatrices[slot]; }
+        glm::vec3 &velocity() { return store->velocities[slot]; }
+        const glm::vec3 &velocity() const { return store->velocities[slot]; }
+        Collider &collider() { return store->colliders[slot]; }
+        const Collider &collider() const { return store->colliders[slot]; }
+        std::shared_ptr<Mesh> &mesh() { return store->meshes[slot]; }
+        const std::shared_ptr<Mesh> &mesh() const { return store->meshes[slot]; }
 
-        glm::mat4 modelMatrix = glm::mat4{1.0f};
+        // Let the world integrate velocity instead of doing it in update()
+        void setKinematic(bool value)
+        {
+            store->kinematic[slot] = value;
+        }
+
+        // Promise never to move, e.g. level geometry
+        void setStationary(bool value)
+        {
+            store->stationary[slot] = value;
+        }
 
         IWorld *world = nullptr;
-        bool collidable = false;
-        float collisionSize = 0;
         Entity *originator = nullptr;
 
         virtual void init(ResourceManager &) {}
         virtual void update(float) {}
         virtual ~Entity() {}
         void destroy()
+        {
+            if (world)
+                world->destroy(*this);
+            else
+                markDestroyed();
+        }
+
+        // Marks the slot for removal at the start of the next update
+        void markDestroyed()
         {
             isPendingDestruction = true;
+            if (store)
+                store->destroyed[slot] = 1;
         }
 
         bool isPendingDestruction = false;
@@ -54,6 +124,16 @@ namespace applesauce
         virtual void onTouch() {}
         virtual void onTouch(const glm::vec3 &) {}
         virtual void onTouch(Entity &) {}
+
+    private:
+        friend class EntityStore;
+
+        EntityStore *store = nullptr;
+        uint32_t slot = 0;
     };
 
-}
\ No newline at end of file
+    inline void IWorld::destroy(Entity &entity)
+    {
+        entity.markDestroyed();
+    }
+}
@@ -0,0 +1,162 @@
+#include "EntityStore.h"
+#include "Entity.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+
+namespace applesauce
+{
+    uint32_t EntityStore::add(std::shared_ptr<Entity> entity)
+    {
+        const auto slot = static_cast<uint32_t>(size());
+        positions.emplace_back(0);
+        orientations.emplace_back(glm::vec3{0});
+        modelMatrices.emplace_back(1.0f);
+        velocities.emplace_back(0);
+        kinematic.push_back(0);
+        colliders.emplace_back();
+        stationary.push_back(0);
+        meshes.emplace_back();
+        destroyed.push_back(0);
+        ids.push_back(nextId++);
+        if (entity)
+        {
+            entity->store = this;
+            entity->slot = slot;
+        }
+        entities.emplace_back(std::move(entity));
+        return slot;
+    }
+
+    uint32_t EntityStore::take(EntityStore &other, uint32_t otherSlot)
+    {
+        const auto slot = add(std::move(other.entities[otherSlot]));
+        positions[slot] = other.positions[otherSlot];
+        orientations[slot] = other.orientations[otherSlot];
+        modelMatrices[slot] = other.modelMatrices[otherSlot];
+        velocities[slot] = other.velocities[otherSlot];
+        kinematic[slot] = other.kinematic[otherSlot];
+        colliders[slot] = other.colliders[otherSlot];
+        stationary[slot] = other.stationary[otherSlot];
+        meshes[slot] = std::move(other.meshes[otherSlot]);
+        destroyed[slot] = other.destroyed[otherSlot];
+        return slot;
+    }
+
+    void EntityStore::removeDestroyed()
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < size(); i++)
+        {
+            if (destroyed[i])
+            {
+                if (entities[i])
+                {
+                    entities[i]->store = nullptr;
+                }
+                continue;
+            }
+
+            if (count != i)
+            {
+                positions[count] = positions[i];
+                orientations[count] = orientations[i];
+                modelMatrices[count] = modelMatrices[i];
+                velocities[count] = velocities[i];
+                kinematic[count] = kinematic[i];
+                colliders[count] = colliders[i];
+                stationary[count] = stationary[i];
+                meshes[count] = std::move(meshes[i]);
+                destroyed[count] = destroyed[i];
+                ids[count] = ids[i];
+                entities[count] = std::move(entities[i]);
+                if (entities[count])
+                {
+                    entities[count]->slot = static_cast<uint32_t>(count);
+                }
+            }
+            count++;
+        }
+
+        positions.resize(count);
+        orientations.resize(count);
+        modelMatrices.resize(count);
+        velocities.resize(count);
+        kinematic.resize(count);
+        colliders.resize(count);
+        stationary.resize(count);
+        meshes.resize(count);
+        destroyed.resize(count);
+        ids.resize(count);
+        entities.resize(count);
+    }
+
+    bool EntityStore::findSlot(uint64_t id, uint32_t &slot) const
+    {
+        const auto found = std::lower_bound(ids.begin(), ids.end(), id);
+        if (found == ids.end() || *found != id)
+        {
+            return false;
+        }
+        slot = static_cast<uint32_t>(found - ids.begin());
+        return true;
+    }
+
+    void EntityStore::clear()
+    {
+        for (auto &entity : entities)
+        {
+            if (entity)
+            {
+                entity->store = nullptr;
+            }
+        }
+        positions.clear();
+        orientations.clear();
+        modelMatrices.clear();
+        velocities.clear();
+        kinematic.clear();
+        colliders.clear();
+        stationary.clear();
+        meshes.clear();
+        destroyed.clear();
+        ids.clear();
+        entities.clear();
+    }
+
+    namespace systems
+    {
+        void integrate(EntityStore &store, float dt)
+        {
+            integrate(store, dt, 0, store.size());
+        }
+
+        void integrate(EntityStore &store, float dt, size_t begin, size_t end)
+        {
+            auto positions = store.positions.data();
+            const auto velocities = store.velocities.data();
+            const auto kinematic = store.kinematic.data();
+            for (size_t i = begin; i < end; i++)
+            {
+                if (kinematic[i])
+                {
+                    positions[i] += velocities[i] * dt;
+                }
+            }
+        }
+
+        void buildModelMatrices(EntityStore &store)
+        {
+            buildModelMatrices(store, 0, store.size());
+        }
+
+        void buildModelMatrices(EntityStore &store, size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                store.modelMatrices[i] = glm::translate(glm::mat4{1.0f}, store.positions[i]) * glm::mat4(store.orientations[i]);
+            }
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace applesauce
+{
+    struct Entity;
+
+    struct Collider
+    {
+        bool enabled = false;
+        float size = 0;
+    };
+
+    // Entity components stored as parallel arrays, indexed by slot, so systems
+    // can sweep over just the data they need. Slots are dense and keep spawn
+    // order; removal compacts the arrays and renumbers the entities that move.
+    //
+    // A slot may have no Entity at all, which is the cheapest kind of entity:
+    // pure data that only the systems below act upon.
+    class EntityStore
+    {
+    public:
+        // Appends a slot with the entity's components at their defaults
+        uint32_t add(std::shared_ptr<Entity> entity);
+
+        // Appends a copy of another store's slot, moving its entity over.
+        // The other slot is left without one, so clear the other store after.
+        uint32_t take(EntityStore &other, uint32_t otherSlot);
+
+        // Drops every slot marked as destroyed
+        void removeDestroyed();
+
+        // Finds the slot with the given id, false once it has been removed.
+        // Ids are in slot order, so this is a binary search.
+        bool findSlot(uint64_t id, uint32_t &slot) const;
+
+        void clear();
+
+        size_t size() const
+        {
+            return positions.size();
+        }
+
+        // Transform
+        std::vector<glm::vec3> positions;
+        std::vector<glm::quat> orientations;
+        std::vector<glm::mat4> modelMatrices;
+
+        // Motion. Kinematic slots have their velocity integrated by
+        // integrate(), the rest move themselves in Entity::update.
+        std::vector<glm::vec3> velocities;
+        std::vector<uint8_t> kinematic;
+
+        std::vector<Collider> colliders;
+
+        // Never moves once spawned, so renderers may cache what they draw of it
+        std::vector<uint8_t> stationary;
+
+        // Render
+        std::vector<std::shared_ptr<Mesh>> meshes;
+
+        // Behaviour, may be null
+        std::vector<std::shared_ptr<Entity>> entities;
+        std::vector<uint8_t> destroyed;
+
+        // Never reused, so ids increase with the slot number. Lets a copy
+        // of the store taken earlier be matched up against this one.
+        std::vector<uint64_t> ids;
+
+    private:
+        uint64_t nextId = 0;
+    };
+
+    // Each system touches slot i only when working on slot i, so ranges of
+    // slots can run on different threads
+    namespace systems
+    {
+        void integrate(EntityStore &store, float dt);
+        void integrate(EntityStore &store, float dt, size_t begin, size_t end);
+        void buildModelMatrices(EntityStore &store);
+        void buildModelMatrices(EntityStore &store, size_t begin, size_t end);
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Input.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace applesauce
+{
+    // A list of key presses and releases keyed by simulation tick. Replaying
+    // the same script against the same world gives the same result, which is
+    // what headless runs and tests need instead of a keyboard.
+    class InputScript
+    {
+    public:
+        struct Event
+        {
+            uint64_t tick;
+            int key;
+            bool pressed;
+        };
+
+    public:
+        InputScript &press(uint64_t tick, int key)
+        {
+            return add({tick, key, true});
+        }
+
+        InputScript &release(uint64_t tick, int key)
+        {
+            return add({tick, key, false});
+        }
+
+        // Holds a key down for duration ticks starting at tick
+        InputScript &hold(uint64_t tick, uint64_t duration, int key)
+        {
+            press(tick, key);
+            return release(tick + duration, key);
+        }
+
+        // Feeds every event for this tick to Input. Call once per tick, after
+        // Input::beginFrame() and before updating the world.
+        void apply(uint64_t tick)
+        {
+            while (cursor < events.size() && events[cursor].tick < tick)
+            {
+                cursor++;
+            }
+            while (cursor < events.size() && events[cursor].tick == tick)
+            {
+                const auto &event = events[cursor++];
+                if (event.pressed)
+                    Input::press(event.key);
+                else
+                    Input::release(event.key);
+            }
+        }
+
+        void rewind()
+        {
+            cursor = 0;
+        }
+
+        const std::vector<Event> &allEvents() const
+        {
+            return events;
+        }
+
+    private:
+        InputScript &add(const Event &event)
+        {
+            // Keep events ordered by tick, preserving insertion order within a tick
+            const auto at = std::upper_bound(events.begin(), events.end(), event, [](const Event &lhs, const Event &rhs)
+                                             { return lhs.tick < rhs.tick; });
+            events.insert(at, event);
+            return *this;
+        }
+
+        std::vector<Event> events;
+        size_t cursor = 0;
+    };
+}
@@ -0,0 +1,115 @@
+#include "InstancedRenderer.h"
+
+#include <algorithm>
+
+namespace applesauce
+{
+    static constexpr size_t minimumInstanceCapacity = 256;
+
+    void InstancedRenderer::begin()
+    {
+        batches.clear();
+        batchLookup.clear();
+        instanceBatches.clear();
+        instanceMatrices.clear();
+        frameStats = Stats{};
+    }
+
+    void InstancedRenderer::add(const Mesh &mesh, const glm::mat4 &modelMatrix)
+    {
+        for (const auto &primitive : mesh.primitives)
+        {
+            add(primitive, modelMatrix);
+        }
+    }
+
+    void InstancedRenderer::add(const Mesh::Primitive &primitive, const glm::mat4 &modelMatrix)
+    {
+        const BatchKey key{primitive.vertexArray.get(), primitive.indexBuffer.get(), primitive.material.get()};
+        const auto [found, inserted] = batchLookup.emplace(key, static_cast<uint32_t>(batches.size()));
+        if (inserted)
+        {
+            batches.push_back({key.vertexArray, key.indexBuffer, key.material, primitive.elementCount, 0, 0});
+        }
+
+        const auto batchIndex = found->second;
+        batches[batchIndex].instanceCount++;
+        instanceBatches.push_back(batchIndex);
+        instanceMatrices.push_back(modelMatrix);
+    }
+
+    void InstancedRenderer::end()
+    {
+        // Counting sort the matrices so that each batch's instances are contiguous
+        batchCursors.resize(batches.size());
+        size_t firstInstance = 0;
+        for (size_t i = 0; i < batches.size(); i++)
+        {
+            batches[i].firstInstance = firstInstance;
+            batchCursors[i] = firstInstance;
+            firstInstance += batches[i].instanceCount;
+        }
+
+        sortedMatrices.resize(instanceMatrices.size());
+        for (size_t i = 0; i < instanceMatrices.size(); i++)
+        {
+            sortedMatrices[batchCursors[instanceBatches[i]]++] = instanceMatrices[i];
+        }
+
+        frameStats.instances = sortedMatrices.size();
+        frameStats.batches = batches.size();
+
+        if (sortedMatrices.empty())
+        {
+            return;
+        }
+
+        const auto byteCount = sortedMatrices.size() * sizeof(glm::mat4);
+        if (!instanceBuffer || instanceBuffer->size() < byteCount)
+        {
+            const auto capacity = std::max(sortedMatrices.size() * 2, minimumInstanceCapacity);
+            instanceBuffer = std::make_unique<Buffer>(capacity * sizeof(glm::mat4),
+                                                      Buffer::Target::vertex_array,
+                                                      sizeof(glm::mat4),
+                                                      Buffer::Usage::streamDraw);
+        }
+
+        instanceBuffer->bind();
+        instanceBuffer->orphan();
+        instanceBuffer->setSubData(0, byteCount, sortedMatrices.data());
+        instanceBuffer->unbind();
+    }
+
+    void InstancedRenderer::submit(RenderQueue &queue, uint32_t pass, const Shader &shader, const glm::mat4 &view,
+                                   float farPlane, bool withMaterials) const
+    {
+        for (const auto &batch : batches)
+        {
+            float nearest = farPlane;
+            for (size_t i = batch.firstInstance; i < batch.firstInstance + batch.instanceCount; i++)
+            {
+                const float z = (view * sortedMatrices[i][3]).z;
+                nearest = std::min(nearest, -z);
+            }
+
+            const Material *material = withMaterials ? batch.material : nullptr;
+            // Materials in an atlas sample the one array texture bound for
+            // the whole pass, so they need no texture of their own
+            const Texture2D *texture = material && material->atlasLayer < 0 ? material->baseTexture.get() : nullptr;
+            queue.add(pass,
+                      {0, &shader, material, texture, batch.vertexArray, batch.indexBuffer, batch.elementCount,
+                       instanceBuffer.get(), batch.firstInstance * sizeof(glm::mat4), batch.instanceCount},
+                      nearest / farPlane);
+        }
+    }
+
+    void InstancedRenderer::drawBatch(const Batch &batch)
+    {
+        batch.vertexArray->bind();
+        batch.vertexArray->setInstanceMatrixBuffer(*instanceBuffer, batch.firstInstance * sizeof(glm::mat4));
+        batch.indexBuffer->bindTo(Buffer::Target::element_array);
+        glDrawElementsInstanced(GL_TRIANGLES, batch.elementCount, GL_UNSIGNED_SHORT, reinterpret_cast<void *>(0),
+                                static_cast<GLsizei>(batch.instanceCount));
+        frameStats.drawCalls++;
+    }
+}
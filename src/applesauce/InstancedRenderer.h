@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Buffer.h"
+#include "Mesh.h"
+#include "RenderQueue.h"
+#include "VertexArray.h"
+
+#include <glm/mat4x4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace applesauce
+{
+    // Groups primitives that share vertex data and material so each group is
+    // drawn with a single glDrawElementsInstanced. The model matrices of every
+    // instance are streamed into one buffer per frame.
+    //
+    // Usage per frame: begin(), add() every visible mesh, end() to upload, then
+    // draw() once per pass.
+    class InstancedRenderer
+    {
+    public:
+        struct Batch
+        {
+            const VertexArray *vertexArray;
+            const Buffer *indexBuffer;
+            const Material *material;
+            int elementCount;
+            size_t firstInstance;
+            size_t instanceCount;
+        };
+
+        struct Stats
+        {
+            size_t instances = 0;
+            size_t batches = 0;
+            size_t drawCalls = 0;
+        };
+
+    public:
+        void begin();
+        void add(const Mesh &mesh, const glm::mat4 &modelMatrix);
+        void add(const Mesh::Primitive &primitive, const glm::mat4 &modelMatrix);
+        void end();
+
+        // setMaterial is called with each batch's material (which may be null)
+        // before the batch is drawn.
+        template <typename SetMaterial>
+        void draw(SetMaterial &&setMaterial)
+        {
+            for (const auto &batch : batches)
+            {
+                setMaterial(batch.material);
+                drawBatch(batch);
+            }
+        }
+
+        // Adds each batch to queue as one instanced draw item. The depth of a
+        // batch is that of its nearest instance in view space, over farPlane.
+        // Without materials the items only differ by vertex data, for depth
+        // only passes.
+        void submit(RenderQueue &queue, uint32_t pass, const Shader &shader, const glm::mat4 &view, float farPlane,
+                    bool withMaterials = true) const;
+
+        const std::vector<Batch> &currentBatches() const
+        {
+            return batches;
+        }
+
+        const Stats &stats() const
+        {
+            return frameStats;
+        }
+
+    private:
+        struct BatchKey
+        {
+            const VertexArray *vertexArray;
+            const Buffer *indexBuffer;
+            const Material *material;
+
+            bool operator==(const BatchKey &rhs) const
+            {
+                return vertexArray == rhs.vertexArray && indexBuffer == rhs.indexBuffer && material == rhs.material;
+            }
+        };
+
+        struct BatchKeyHash
+        {
+            size_t operator()(const BatchKey &key) const
+            {
+                size_t result = std::hash<const void *>()(key.vertexArray);
+                result ^= std::hash<const void *>()(key.indexBuffer) + 0x9e3779b9 + (result << 6) + (result >> 2);
+                result ^= std::hash<const void *>()(key.material) + 0x9e3779b9 + (result << 6) + (result >> 2);
+                return result;
+            }
+        };
+
+        void drawBatch(const Batch &batch);
+
+    private:
+        std::vector<Batch> batches;
+        std::unordered_map<BatchKey, uint32_t, BatchKeyHash> batchLookup;
+
+        // Filled by add() in submission order, then sorted by batch in end()
+        std::vector<uint32_t> instanceBatches;
+        std::vector<glm::mat4> instanceMatrices;
+        std::vector<glm::mat4> sortedMatrices;
+        std::vector<size_t> batchCursors;
+
+        std::unique_ptr<Buffer> instanceBuffer;
+        Stats frameStats;
+    };
+}
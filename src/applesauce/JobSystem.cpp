@@ -0,0 +1,133 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+namespace applesauce
+{
+    // Which system, if any, the current thread is a worker of, and its queue
+    static thread_local const JobSystem *workerOf = nullptr;
+    static thread_local size_t workerIndex = 0;
+
+    JobSystem::JobSystem(size_t threadCount)
+    {
+        if (threadCount == 0)
+        {
+            threadCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        }
+        for (size_t i = 0; i < threadCount; i++)
+        {
+            queues.push_back(std::make_unique<Queue>());
+        }
+        for (size_t i = 1; i < threadCount; i++)
+        {
+            workers.emplace_back([this, i]()
+                                 { workerLoop(i); });
+        }
+    }
+
+    JobSystem::~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    size_t JobSystem::threadIndex() const
+    {
+        return workerOf == this ? workerIndex : 0;
+    }
+
+    void JobSystem::run(Function function, void *data, size_t begin, size_t end, Counter &counter)
+    {
+        counter.pending.fetch_add(1, std::memory_order_relaxed);
+        auto &queue = *queues[threadIndex()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back({function, data, begin, end, &counter});
+        }
+        queued.fetch_add(1, std::memory_order_release);
+        if (!workers.empty())
+        {
+            // Taking the lock orders this against a worker about to sleep
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            wake.notify_one();
+        }
+    }
+
+    bool JobSystem::pop(size_t thread, Job &job)
+    {
+        auto &queue = *queues[thread];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty())
+            return false;
+        job = queue.jobs.back();
+        queue.jobs.pop_back();
+        return true;
+    }
+
+    bool JobSystem::steal(size_t thread, Job &job)
+    {
+        for (size_t i = 1; i < queues.size(); i++)
+        {
+            auto &queue = *queues[(thread + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.jobs.empty())
+            {
+                job = queue.jobs.front();
+                queue.jobs.pop_front();
+                stealCount.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool JobSystem::runOne(size_t thread)
+    {
+        Job job;
+        if (!pop(thread, job) && !steal(thread, job))
+            return false;
+
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        job.function(job.data, job.begin, job.end);
+        jobCount.fetch_add(1, std::memory_order_relaxed);
+        job.counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+        return true;
+    }
+
+    void JobSystem::wait(Counter &counter)
+    {
+        const auto thread = threadIndex();
+        while (!counter.done())
+        {
+            if (!runOne(thread))
+            {
+                // The remaining jobs are running on other threads
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void JobSystem::workerLoop(size_t thread)
+    {
+        workerOf = this;
+        workerIndex = thread;
+        for (;;)
+        {
+            if (runOne(thread))
+                continue;
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this]()
+                      { return stopping || queued.load(std::memory_order_acquire) > 0; });
+            if (stopping)
+                return;
+        }
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace applesauce
+{
+    // Work stealing job scheduler. Every thread, the one that created the
+    // system included, has its own queue: jobs are pushed to and popped from
+    // the back of the owner's queue and idle threads steal from the front of
+    // the others'.
+    //
+    // A Counter tracks a group of jobs. wait() returns once all of them have
+    // run, and runs queued jobs itself in the meantime rather than blocking,
+    // so jobs may start and wait on jobs of their own.
+    class JobSystem
+    {
+    public:
+        using Function = void (*)(void *data, size_t begin, size_t end);
+
+        class Counter
+        {
+        public:
+            bool done() const
+            {
+                return pending.load(std::memory_order_acquire) == 0;
+            }
+
+        private:
+            friend class JobSystem;
+            std::atomic<size_t> pending{0};
+        };
+
+    public:
+        // threadCount includes the calling thread, 0 means one per core
+        explicit JobSystem(size_t threadCount = 0);
+        ~JobSystem();
+
+        JobSystem(const JobSystem &) = delete;
+        JobSystem &operator=(const JobSystem &) = delete;
+
+        size_t threadCount() const
+        {
+            return queues.size();
+        }
+
+        // Index of the calling thread, in [0, threadCount()). The creating
+        // thread is 0, as is any thread that is not one of the workers.
+        size_t threadIndex() const;
+
+        // Queues function(data, begin, end) and counts it against counter.
+        // data must stay alive until the counter is done.
+        void run(Function function, void *data, size_t begin, size_t end, Counter &counter);
+
+        // Runs jobs until every job counted against counter has finished
+        void wait(Counter &counter);
+
+        // Calls fn(begin, end) over [0, count) in chunks of about grain items,
+        // spread over every thread, and returns once all chunks are done
+        template <typename Fn>
+        void parallelFor(size_t count, size_t grain, Fn &&fn)
+        {
+            grain = grain ? grain : 1;
+            if (count <= grain || threadCount() == 1)
+            {
+                if (count > 0)
+                    fn(size_t{0}, count);
+                return;
+            }
+
+            Counter counter;
+            for (size_t begin = 0; begin < count; begin += grain)
+            {
+                const size_t end = begin + grain < count ? begin + grain : count;
+                run([](void *data, size_t b, size_t e)
+                    { (*static_cast<std::remove_reference_t<Fn> *>(data))(b, e); },
+                    &fn, begin, end, counter);
+            }
+            wait(counter);
+        }
+
+        struct Stats
+        {
+            size_t jobs = 0;
+            size_t steals = 0;
+        };
+
+        // Totals since construction
+        Stats stats() const
+        {
+            return {jobCount.load(std::memory_order_relaxed), stealCount.load(std::memory_order_relaxed)};
+        }
+
+    private:
+        struct Job
+        {
+            Function function;
+            void *data;
+            size_t begin;
+            size_t end;
+            Counter *counter;
+        };
+
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<Job> jobs;
+        };
+
+        bool pop(size_t thread, Job &job);
+        bool steal(size_t thread, Job &job);
+        bool runOne(size_t thread);
+        void workerLoop(size_t thread);
+
+    private:
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+
+        // Sleeping workers are woken when work is queued
+        std::mutex sleepMutex;
+        std::condition_variable wake;
+        std::atomic<size_t> queued{0};
+        bool stopping = false;
+
+        std::atomic<size_t> jobCount{0};
+        std::atomic<size_t> stealCount{0};
+    };
+}
@@ -1,13 +1,17 @@
 #include "VertexArray.h"
 #include "Mesh.h"
 
+#include <util/AssetPack.h>
 #include <util/gltf.h>
 
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
 
-#include <fstream>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -53,7 +57,8 @@ static applesauce::Mesh::Primitive primitiveFromComponents(const std::vector<glm
 
     vertexArray->addVertexBuffer(*vertexBuffer, desc);
 
-    return {material, vertexArray, indexBuffer, static_cast<int>(indices.size())};
+    return {material, vertexArray, indexBuffer, static_cast<int>(indices.size()),
+            applesauce::Bounds::fromPoints(vertices.data(), vertices.size())};
 }
 
 applesauce::Mesh makePlaneMesh(float planeSize, std::shared_ptr<applesauce::Material> material = nullptr)
@@ -250,12 +255,6 @@ applesauce::Mesh makeBoxMesh(float boxSize, std::shared_ptr<applesauce::Material
     return {{primitiveFromComponents(vertices, normals, texcoords, indices, material)}};
 }
 
-static std::string readFileText(const char *filename)
-{
-    std::ifstream f{filename};
-    return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
-}
-
 namespace applesauce
 {
     static VertexAttribute vertexAttribFromName(const std::string &name)
@@ -270,20 +269,90 @@ namespace applesauce
             return VertexAttribute::none;
     }
 
-    std::unordered_map<std::string, Mesh> loadMeshes(const char *filename)
+    // From the POSITION accessor's min and max, which glTF requires. Files
+    // without them get bounds from the vertex data instead.
+    static Bounds primitiveBounds(const glTF &gltf, glTFBufferCache &bufferCache, const glTF::Mesh::Primitive &primitive)
     {
-        std::unordered_map<std::string, Mesh> result;
+        const auto found = primitive.attributes.find("POSITION");
+        if (found == primitive.attributes.end())
+        {
+            return {};
+        }
+
+        const auto &accessor = gltf.accessors[found->second];
+        if (accessor.min.size() == 3 && accessor.max.size() == 3)
+        {
+            return {{accessor.min[0], accessor.min[1], accessor.min[2]}, {accessor.max[0], accessor.max[1], accessor.max[2]}};
+        }
+
+        const auto positions = bufferCache.accessor(found->second);
+        const auto stride = gltf.bufferViews[accessor.bufferView].byteStride;
+        const size_t step = stride > 0 ? static_cast<size_t>(stride) : sizeof(glm::vec3);
+        std::vector<glm::vec3> points(accessor.count);
+        for (size_t i = 0; i < points.size() && i * step + sizeof(glm::vec3) <= positions.size; i++)
+        {
+            std::memcpy(&points[i], positions.data + i * step, sizeof(glm::vec3));
+        }
+        return Bounds::fromPoints(points.data(), points.size());
+    }
+
+    class DecodedMeshes
+    {
+    public:
+        explicit DecodedMeshes(const char *filename) : gltf(glTFFromFile(filename)), bufferCache(gltf)
+        {
+            const auto decodeStart = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < gltf.buffers.size(); i++)
+            {
+                bufferCache.buffer(static_cast<int>(i));
+            }
+            for (const auto &mesh : gltf.meshes)
+            {
+                for (const auto &primitive : mesh.primitives)
+                {
+                    // Uploaded as 16 bit indices straight from the view
+                    if (static_cast<size_t>(gltf.accessors[primitive.indices].count) * 2 >
+                        bufferCache.accessor(primitive.indices).size)
+                    {
+                        throw std::runtime_error("glTF: Accessor " + std::to_string(primitive.indices) + " is out of range");
+                    }
+                    bounds.push_back(primitiveBounds(gltf, bufferCache, primitive));
+                }
+            }
+            const std::chrono::duration<double> decodeTime = std::chrono::steady_clock::now() - decodeStart;
+            seconds = decodeTime.count();
+        }
+
+        glTF gltf;
+        // Every buffer decoded up front, vertices and indices are views into it
+        glTFBufferCache bufferCache;
+        // One per primitive of every mesh, in order
+        std::vector<Bounds> bounds;
+        double seconds = 0;
+    };
+
+    std::shared_ptr<DecodedMeshes> decodeMeshes(const char *filename)
+    {
+        return std::make_shared<DecodedMeshes>(filename);
+    }
 
-        std::string gltfText(readFileText(filename));
-        const auto gltf = glTFFromString(gltfText.c_str());
+    std::unordered_map<std::string, Mesh> uploadMeshes(DecodedMeshes &decoded, MeshLoadStats *stats)
+    {
+        const auto uploadStart = std::chrono::steady_clock::now();
+        std::unordered_map<std::string, Mesh> result;
+        const auto &gltf = decoded.gltf;
+        auto &bufferCache = decoded.bufferCache;
 
         std::vector<std::shared_ptr<applesauce::Buffer>> buffers;
-        // Load up buffers, these are going directly into OpenGL, which is arguable
-        for (const auto &gltfBuffer : gltf.buffers)
+        // Load up buffers, these are going directly into OpenGL, which is arguable.
+        // Binary buffers are uploaded straight from the mapped file.
+        for (size_t i = 0; i < gltf.buffers.size(); i++)
         {
-            buffers.emplace_back(std::make_shared<applesauce::Buffer>(&gltfBuffer.getBytes()[0], gltfBuffer.byteLength));
+            const auto bytes = bufferCache.buffer(static_cast<int>(i));
+            buffers.emplace_back(std::make_shared<applesauce::Buffer>(bytes.data, bytes.size));
         }
 
+        auto bounds = decoded.bounds.begin();
         for (const auto &gltfMesh : gltf.meshes)
         {
             std::list<Mesh::Primitive> primitives;
@@ -310,10 +379,8 @@ namespace applesauce
                 }
 
                 const auto &indicesAccessor = gltf.accessors[gltfMeshPrimitive.indices];
-                const auto &indicesBufferView = gltf.bufferViews[indicesAccessor.bufferView];
-
-                auto indexBuffer = std::make_shared<Buffer>(&gltf.buffers[indicesBufferView.buffer].getBytes()[indicesBufferView.byteOffset + indicesAccessor.byteOffset],
-                                                            indicesAccessor.count * 2, Buffer::Target::element_array);
+                const auto indices = bufferCache.accessor(gltfMeshPrimitive.indices);
+                auto indexBuffer = std::make_shared<Buffer>(indices.data, indicesAccessor.count * 2, Buffer::Target::element_array);
 
                 // Snag just the base color from the material
                 auto materialColor = gltf.materials[gltfMeshPrimitive.material].pbrMetallicRoughness.baseColorFactor;
@@ -325,11 +392,73 @@ namespace applesauce
                     vertexArray,
                     indexBuffer,
                     indicesAccessor.count,
+                    *bounds++,
                 });
                 vertexArray->unbind();
             }
             result.emplace(gltfMesh.name, Mesh{primitives});
         }
+
+        if (stats)
+        {
+            const std::chrono::duration<double> uploadTime = std::chrono::steady_clock::now() - uploadStart;
+            const auto &cacheStats = bufferCache.stats();
+            *stats = {cacheStats.decodeCount, cacheStats.decodedBytes, cacheStats.decodeSeconds, decoded.seconds + uploadTime.count()};
+        }
         return result;
     }
-}
\ No newline at end of file
+
+    std::unordered_map<std::string, Mesh> loadMeshes(const char *filename, MeshLoadStats *stats)
+    {
+        return uploadMeshes(*decodeMeshes(filename), stats);
+    }
+
+    std::unordered_map<std::string, Mesh> loadMeshes(const AssetPack &pack, const std::string &source)
+    {
+        std::unordered_map<std::string, Mesh> result;
+        const auto primitives = pack.primitives();
+        const auto materials = pack.materials();
+
+        for (const auto &packMesh : pack.meshes())
+        {
+            if (source != pack.string(packMesh.source))
+            {
+                continue;
+            }
+
+            std::list<Mesh::Primitive> meshPrimitives;
+            for (uint32_t i = 0; i < packMesh.primitiveCount; i++)
+            {
+                const auto &primitive = primitives[packMesh.firstPrimitive + i];
+                const auto &material = materials[primitive.material];
+
+                auto vertexBuffer = std::make_shared<Buffer>(pack.vertices(primitive),
+                                                             primitive.vertexCount * sizeof(AssetPack::Vertex));
+                auto indexBuffer = std::make_shared<Buffer>(pack.indices(primitive),
+                                                            primitive.indexCount * sizeof(uint16_t),
+                                                            Buffer::Target::element_array);
+
+                constexpr int stride = sizeof(AssetPack::Vertex);
+                auto vertexArray = std::make_shared<VertexArray>();
+                vertexArray->addVertexBuffer(*vertexBuffer,
+                                             {
+                                                 {VertexAttribute::position, 3, offsetof(AssetPack::Vertex, position), stride},
+                                                 {VertexAttribute::normal, 3, offsetof(AssetPack::Vertex, normal), stride},
+                                                 {VertexAttribute::texcoord, 2, offsetof(AssetPack::Vertex, texcoord), stride},
+                                             });
+
+                const glm::vec3 baseColor{material.baseColor[0], material.baseColor[1], material.baseColor[2]};
+                meshPrimitives.emplace_back(Mesh::Primitive{
+                    std::make_shared<Material>(Material{baseColor, material.metallicFactor, material.roughnessFactor}),
+                    vertexArray,
+                    indexBuffer,
+                    static_cast<int>(primitive.indexCount),
+                    {{primitive.boundsMin[0], primitive.boundsMin[1], primitive.boundsMin[2]},
+                     {primitive.boundsMax[0], primitive.boundsMax[1], primitive.boundsMax[2]}},
+                });
+            }
+            result.emplace(pack.string(packMesh.name), Mesh{meshPrimitives});
+        }
+        return result;
+    }
+}
@@ -1,13 +1,18 @@
 #pragma once
 
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
 
+#include "Bounds.h"
 #include "Texture.h"
 
 #include <list>
 #include <memory>
+#include <string>
 #include <unordered_map>
 
+class AssetPack;
+
 namespace applesauce
 {
     class VertexArray;
@@ -19,6 +24,10 @@ namespace applesauce
         float metallicFactor;
         float roughnessFactor;
         std::shared_ptr<Texture> baseTexture = nullptr;
+        // Where the base texture's texels are in a TextureAtlas, a layer of -1
+        // for none. The rect is its texcoord offset (xy) and scale (zw).
+        int atlasLayer = -1;
+        glm::vec4 atlasRect{0.0f, 0.0f, 1.0f, 1.0f};
     };
 
     struct Mesh
@@ -29,11 +38,32 @@ namespace applesauce
             std::shared_ptr<VertexArray> vertexArray;
             std::shared_ptr<Buffer> indexBuffer;
             int elementCount;
+            // Model space, filled in by whichever loader made the primitive
+            Bounds bounds{};
         };
         std::list<Primitive> primitives;
     };
 
-    std::unordered_map<std::string, Mesh> loadMeshes(const char *);
+    struct MeshLoadStats
+    {
+        size_t decodeCount = 0;
+        size_t decodedBytes = 0;
+        double decodeSeconds = 0;
+        double totalSeconds = 0;
+    };
+
+    std::unordered_map<std::string, Mesh> loadMeshes(const char *, MeshLoadStats *stats = nullptr);
+
+    // loadMeshes() in two halves. Decoding parses the file and its buffers
+    // and touches no GL state, so it may run on any thread. Uploading makes
+    // the buffers and vertex arrays and has to run on the GL thread.
+    class DecodedMeshes;
+    std::shared_ptr<DecodedMeshes> decodeMeshes(const char *filename);
+    std::unordered_map<std::string, Mesh> uploadMeshes(DecodedMeshes &decoded, MeshLoadStats *stats = nullptr);
+
+    // Meshes baked from source (the glTF file name without extension). Vertex
+    // and index data is uploaded straight from the mapped pack.
+    std::unordered_map<std::string, Mesh> loadMeshes(const AssetPack &pack, const std::string &source);
 
 }
 
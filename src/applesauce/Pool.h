@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace applesauce
+{
+    // Hands out fixed size blocks carved from slabs that are never returned to
+    // the heap while the pool lives. Released blocks go on a free list and are
+    // reused first, so once the pool has grown to its peak there is no more
+    // allocator traffic.
+    //
+    // The block size is fixed by the first allocation, which suits
+    // std::allocate_shared: it only ever allocates one (rebound) type.
+    //
+    // Entities are spawned on workers and their last reference may go on any
+    // thread, so allocate() and deallocate() take a lock.
+    class SlabPool
+    {
+    public:
+        SlabPool(size_t blocksPerSlab = 64) : blocksPerSlab(blocksPerSlab) {}
+        ~SlabPool()
+        {
+            for (auto slab : slabs)
+            {
+                ::operator delete(slab, std::align_val_t{blockAlign});
+            }
+        }
+
+        SlabPool(const SlabPool &) = delete;
+        SlabPool &operator=(const SlabPool &) = delete;
+
+        void *allocate(size_t size, size_t alignment)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (blockSize == 0)
+            {
+                blockAlign = std::max(alignment, alignof(FreeBlock));
+                blockSize = (std::max(size, sizeof(FreeBlock)) + blockAlign - 1) / blockAlign * blockAlign;
+            }
+            else if (size > blockSize || alignment > blockAlign)
+            {
+                throw std::bad_alloc();
+            }
+
+            if (!freeList)
+            {
+                grow();
+            }
+            auto block = freeList;
+            freeList = block->next;
+            used++;
+            return block;
+        }
+
+        void deallocate(void *block)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto freeBlock = static_cast<FreeBlock *>(block);
+            freeBlock->next = freeList;
+            freeList = freeBlock;
+            used--;
+        }
+
+        size_t capacity() const
+        {
+            return slabs.size() * blocksPerSlab;
+        }
+
+        size_t inUse() const
+        {
+            return used;
+        }
+
+        size_t slabCount() const
+        {
+            return slabs.size();
+        }
+
+    private:
+        struct FreeBlock
+        {
+            FreeBlock *next;
+        };
+
+        void grow()
+        {
+            auto slab = static_cast<unsigned char *>(::operator new(blockSize * blocksPerSlab, std::align_val_t{blockAlign}));
+            slabs.push_back(slab);
+            // Thread the new blocks onto the free list in address order
+            for (size_t i = blocksPerSlab; i-- > 0;)
+            {
+                auto block = reinterpret_cast<FreeBlock *>(slab + i * blockSize);
+                block->next = freeList;
+                freeList = block;
+            }
+        }
+
+        size_t blocksPerSlab;
+        size_t blockSize = 0;
+        size_t blockAlign = alignof(FreeBlock);
+        size_t used = 0;
+        FreeBlock *freeList = nullptr;
+        std::vector<unsigned char *> slabs;
+        std::mutex mutex;
+    };
+
+    // Standard allocator over a SlabPool, for std::allocate_shared. The object
+    // and its shared_ptr control block end up in a single pool block.
+    template <typename T>
+    class PoolAllocator
+    {
+    public:
+        using value_type = T;
+
+        explicit PoolAllocator(SlabPool &pool) : pool(&pool) {}
+
+        template <typename U>
+        PoolAllocator(const PoolAllocator<U> &other) : pool(other.pool)
+        {
+        }
+
+        T *allocate(size_t n)
+        {
+            if (n != 1)
+            {
+                throw std::bad_alloc();
+            }
+            return static_cast<T *>(pool->allocate(sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T *p, size_t)
+        {
+            pool->deallocate(p);
+        }
+
+        template <typename U>
+        bool operator==(const PoolAllocator<U> &rhs) const
+        {
+            return pool == rhs.pool;
+        }
+
+        template <typename U>
+        bool operator!=(const PoolAllocator<U> &rhs) const
+        {
+            return pool != rhs.pool;
+        }
+
+    private:
+        template <typename U>
+        friend class PoolAllocator;
+
+        SlabPool *pool;
+    };
+}
@@ -0,0 +1,229 @@
+#include "Profiler.h"
+
+#include <iomanip>
+#include <stdexcept>
+
+namespace applesauce
+{
+    Profiler::Profiler(Mode mode, size_t capacity)
+        : _mode(mode), epoch(std::chrono::steady_clock::now()), frames(capacity + 1)
+    {
+        if (capacity == 0)
+            throw std::runtime_error("Profiler needs room for at least one frame");
+    }
+
+    Profiler::~Profiler()
+    {
+        for (auto &set : querySet)
+        {
+            if (!set.queries.empty())
+                glDeleteQueries(static_cast<GLsizei>(set.queries.size()), set.queries.data());
+        }
+    }
+
+    double Profiler::now() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    void Profiler::beginFrame()
+    {
+        if (current)
+            endFrame();
+
+        current = &frames[completedFrames % frames.size()];
+        current->index = completedFrames;
+        current->cpu.clear();
+        current->gpu.clear();
+        current->gpuDuration = 0;
+        current->gpuReady = false;
+        current->start = now();
+        current->duration = 0;
+
+        if (_mode == Mode::cpuAndGpu)
+        {
+            // The set was last used two frames ago, its results should be in by now
+            currentQueries = &querySet[completedFrames % querySets];
+            collect(*currentQueries);
+            currentQueries->frameIndex = completedFrames;
+            currentQueries->pending = true;
+            currentQueries->used = 0;
+            currentQueries->scopes.clear();
+            // Query 0 marks the start of the frame on the GPU
+            issueQuery(*currentQueries);
+        }
+    }
+
+    void Profiler::endFrame()
+    {
+        if (!current)
+            return;
+
+        while (!gpuStack.empty())
+            endGpuScope();
+        while (!cpuStack.empty())
+            endScope();
+
+        if (currentQueries)
+        {
+            // One more query after all the scopes marks the end of it
+            issueQuery(*currentQueries);
+            currentQueries = nullptr;
+        }
+
+        current->duration = now() - current->start;
+        current = nullptr;
+        completedFrames++;
+        _stats.frames++;
+    }
+
+    void Profiler::beginScope(const char *name)
+    {
+        if (!current)
+            return;
+        cpuStack.push_back(current->cpu.size());
+        current->cpu.push_back({name, static_cast<uint32_t>(cpuStack.size() - 1), now() - current->start, 0});
+    }
+
+    void Profiler::endScope()
+    {
+        if (!current || cpuStack.empty())
+            return;
+        auto &sample = current->cpu[cpuStack.back()];
+        sample.duration = now() - current->start - sample.start;
+        cpuStack.pop_back();
+        _stats.cpuScopes++;
+    }
+
+    size_t Profiler::issueQuery(QuerySet &set)
+    {
+        if (set.used == set.queries.size())
+        {
+            const size_t grow = std::max<size_t>(set.queries.size(), 16);
+            set.queries.resize(set.queries.size() + grow);
+            glGenQueries(static_cast<GLsizei>(grow), set.queries.data() + set.used);
+        }
+        glQueryCounter(set.queries[set.used], GL_TIMESTAMP);
+        return set.used++;
+    }
+
+    void Profiler::beginGpuScope(const char *name)
+    {
+        if (!currentQueries)
+            return;
+        gpuStack.push_back(currentQueries->scopes.size());
+        currentQueries->scopes.push_back({name, static_cast<uint32_t>(gpuStack.size() - 1), issueQuery(*currentQueries), 0});
+    }
+
+    void Profiler::endGpuScope()
+    {
+        if (!currentQueries || gpuStack.empty())
+            return;
+        currentQueries->scopes[gpuStack.back()].end = issueQuery(*currentQueries);
+        gpuStack.pop_back();
+    }
+
+    void Profiler::collect(QuerySet &set)
+    {
+        if (!set.pending)
+            return;
+        set.pending = false;
+
+        // Queries complete in order, so the last one being ready means all are
+        GLint available = 0;
+        glGetQueryObjectiv(set.queries[set.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            _stats.gpuFramesDropped++;
+            return;
+        }
+
+        // The frame may have already left the ring
+        auto &frame = frames[set.frameIndex % frames.size()];
+        if (frame.index != set.frameIndex || &frame == current)
+            return;
+
+        const auto timestamp = [&set](size_t query)
+        {
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(set.queries[query], GL_QUERY_RESULT, &nanoseconds);
+            return nanoseconds;
+        };
+        const auto seconds = [](GLuint64 from, GLuint64 to)
+        {
+            return to > from ? static_cast<double>(to - from) * 1e-9 : 0.0;
+        };
+
+        const auto frameStart = timestamp(0);
+        frame.gpu.clear();
+        for (const auto &scope : set.scopes)
+        {
+            const auto begin = timestamp(scope.begin);
+            frame.gpu.push_back({scope.name, scope.depth, seconds(frameStart, begin), seconds(begin, timestamp(scope.end))});
+        }
+        frame.gpuDuration = seconds(frameStart, timestamp(set.used - 1));
+        frame.gpuReady = true;
+        _stats.gpuScopes += set.scopes.size();
+    }
+
+    const Profiler::Frame *Profiler::latest() const
+    {
+        for (size_t i = frameCount(); i > 0; i--)
+        {
+            const auto &f = frame(i - 1);
+            if (_mode == Mode::cpuOnly || f.gpuReady)
+                return &f;
+        }
+        return nullptr;
+    }
+
+    static void writeJsonString(std::ostream &out, const char *text)
+    {
+        out << '"';
+        for (; *text; text++)
+        {
+            const char c = *text;
+            if (c == '"' || c == '\\')
+                out << '\\' << c;
+            else if (static_cast<unsigned char>(c) < 0x20)
+                out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+            else
+                out << c;
+        }
+        out << '"';
+    }
+
+    void Profiler::writeChromeTrace(std::ostream &out) const
+    {
+        // Timestamps are in microseconds
+        const auto writeEvent = [&out](bool &first, const char *name, int thread, double start, double duration)
+        {
+            out << (first ? "\n" : ",\n") << "{\"name\":";
+            writeJsonString(out, name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread << ",\"ts\":" << start * 1e6 << ",\"dur\":" << duration * 1e6 << "}";
+            first = false;
+        };
+
+        const auto flags = out.flags();
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        out << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}}";
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+        bool first = false;
+        for (size_t i = 0; i < frameCount(); i++)
+        {
+            const auto &f = frame(i);
+            writeEvent(first, "Frame", 1, f.start, f.duration);
+            for (const auto &sample : f.cpu)
+                writeEvent(first, sample.name, 1, f.start + sample.start, sample.duration);
+            if (f.gpuReady)
+            {
+                writeEvent(first, "Frame", 2, f.start, f.gpuDuration);
+                for (const auto &sample : f.gpu)
+                    writeEvent(first, sample.name, 2, f.start + sample.start, sample.duration);
+            }
+        }
+        out << "\n]}\n";
+        out.flags(flags);
+    }
+}
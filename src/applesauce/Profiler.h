@@ -0,0 +1,202 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace applesauce
+{
+    // Frame profiler. CPU scopes are timed with steady_clock, GPU scopes with
+    // GL timestamp queries. Both nest. The last `capacity` frames are kept in
+    // a ring for the debug overlay and for writing out as a Chrome trace
+    // (chrome://tracing or ui.perfetto.dev).
+    //
+    // Queries alternate between two sets and a set is only read back just
+    // before it is reused, two frames later, so the profiler never waits on
+    // the GPU. A frame whose results are still not in by then is dropped from
+    // the GPU track.
+    //
+    // Scope names are not copied and must outlive the profiler, string
+    // literals are the intended use.
+    class Profiler
+    {
+    public:
+        enum class Mode
+        {
+            cpuOnly, // Headless, never touches GL
+            cpuAndGpu,
+        };
+
+        struct Sample
+        {
+            const char *name;
+            uint32_t depth;
+            // Seconds, relative to the start of the frame
+            double start;
+            double duration;
+        };
+
+        struct Frame
+        {
+            uint64_t index = 0;
+            // Seconds since the profiler was created
+            double start = 0;
+            double duration = 0;
+            std::vector<Sample> cpu;
+            // Filled in a frame or two later, once the queries are available
+            std::vector<Sample> gpu;
+            double gpuDuration = 0;
+            bool gpuReady = false;
+        };
+
+        struct Stats
+        {
+            uint64_t frames = 0;
+            uint64_t cpuScopes = 0;
+            uint64_t gpuScopes = 0;
+            // GPU frames whose queries were not ready when their set was reused
+            uint64_t gpuFramesDropped = 0;
+        };
+
+        // Opens a CPU scope for its lifetime. A null profiler is allowed and
+        // does nothing, so instrumented code does not need to check.
+        class Scope
+        {
+        public:
+            Scope(Profiler *profiler, const char *name) : profiler(profiler)
+            {
+                if (profiler)
+                    profiler->beginScope(name);
+            }
+            ~Scope()
+            {
+                if (profiler)
+                    profiler->endScope();
+            }
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+
+        private:
+            Profiler *profiler;
+        };
+
+        // As Scope, but timed on the GPU as well as on the CPU
+        class GpuScope
+        {
+        public:
+            GpuScope(Profiler *profiler, const char *name) : profiler(profiler)
+            {
+                if (profiler)
+                {
+                    profiler->beginScope(name);
+                    profiler->beginGpuScope(name);
+                }
+            }
+            ~GpuScope()
+            {
+                if (profiler)
+                {
+                    profiler->endGpuScope();
+                    profiler->endScope();
+                }
+            }
+            GpuScope(const GpuScope &) = delete;
+            GpuScope &operator=(const GpuScope &) = delete;
+
+        private:
+            Profiler *profiler;
+        };
+
+    public:
+        static constexpr size_t defaultCapacity = 240;
+        static constexpr size_t querySets = 2;
+
+        Profiler(Mode mode = Mode::cpuAndGpu, size_t capacity = defaultCapacity);
+        ~Profiler();
+
+        Profiler(const Profiler &) = delete;
+        Profiler &operator=(const Profiler &) = delete;
+
+        // Frames must not overlap. Any scopes left open at endFrame() are closed.
+        void beginFrame();
+        void endFrame();
+
+        void beginScope(const char *name);
+        void endScope();
+
+        // No-ops in cpuOnly mode
+        void beginGpuScope(const char *name);
+        void endGpuScope();
+
+        Mode mode() const
+        {
+            return _mode;
+        }
+
+        // Completed frames in the ring, 0 is the oldest
+        size_t frameCount() const
+        {
+            return std::min(completedFrames, frames.size() - 1);
+        }
+        const Frame &frame(size_t i) const
+        {
+            return frames[(completedFrames - frameCount() + i) % frames.size()];
+        }
+
+        // Newest completed frame that has its GPU samples (or any newest
+        // frame in cpuOnly mode), null if there is none yet
+        const Frame *latest() const;
+
+        const Stats &stats() const
+        {
+            return _stats;
+        }
+
+        // Chrome trace event format, CPU scopes on one track and GPU scopes
+        // on another, lined up with the start of their frame
+        void writeChromeTrace(std::ostream &out) const;
+
+    private:
+        struct GpuQuery
+        {
+            const char *name;
+            uint32_t depth;
+            size_t begin;
+            size_t end;
+        };
+
+        struct QuerySet
+        {
+            uint64_t frameIndex = 0;
+            bool pending = false;
+            std::vector<GLuint> queries;
+            size_t used = 0;
+            std::vector<GpuQuery> scopes;
+        };
+
+        double now() const;
+        size_t issueQuery(QuerySet &set);
+        void collect(QuerySet &set);
+
+    private:
+        const Mode _mode;
+        const std::chrono::steady_clock::time_point epoch;
+
+        // One more than the capacity, so the frame being recorded never
+        // overwrites one that can still be read
+        std::vector<Frame> frames;
+        size_t completedFrames = 0;
+        Frame *current = nullptr;
+        std::vector<size_t> cpuStack;
+
+        QuerySet querySet[querySets];
+        QuerySet *currentQueries = nullptr;
+        std::vector<size_t> gpuStack;
+
+        Stats _stats;
+    };
+}
@@ -0,0 +1,157 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <array>
+
+namespace applesauce
+{
+    static uint64_t field(uint32_t value, int bits)
+    {
+        return value & ((1u << bits) - 1);
+    }
+
+    uint64_t RenderQueue::makeKey(uint32_t pass, uint32_t shader, uint32_t material, uint32_t texture,
+                                  uint32_t vertexArray, uint32_t depth)
+    {
+        uint64_t key = field(pass, passBits);
+        key = key << shaderBits | field(shader, shaderBits);
+        key = key << materialBits | field(material, materialBits);
+        key = key << textureBits | field(texture, textureBits);
+        key = key << vertexArrayBits | field(vertexArray, vertexArrayBits);
+        key = key << depthBits | field(depth, depthBits);
+        return key;
+    }
+
+    void RenderQueue::radixSort(std::vector<SortEntry> &entries, std::vector<SortEntry> &scratch)
+    {
+        scratch.resize(entries.size());
+        for (int shift = 0; shift < 64; shift += 8)
+        {
+            std::array<size_t, 256> counts{};
+            for (const auto &entry : entries)
+            {
+                counts[(entry.key >> shift) & 0xFF]++;
+            }
+            if (std::find(counts.begin(), counts.end(), entries.size()) != counts.end())
+            {
+                continue;
+            }
+
+            size_t offset = 0;
+            for (auto &count : counts)
+            {
+                const auto bucketSize = count;
+                count = offset;
+                offset += bucketSize;
+            }
+            for (const auto &entry : entries)
+            {
+                scratch[counts[(entry.key >> shift) & 0xFF]++] = entry;
+            }
+            entries.swap(scratch);
+        }
+    }
+
+    void RenderQueue::begin()
+    {
+        drawItems.clear();
+        sorted.clear();
+        frameStats = Stats{};
+    }
+
+    uint32_t RenderQueue::idFor(std::unordered_map<const void *, uint32_t> &ids, const void *object)
+    {
+        if (!object)
+        {
+            return 0;
+        }
+        // 0 is kept for "none"
+        return ids.emplace(object, static_cast<uint32_t>(ids.size() + 1)).first->second;
+    }
+
+    void RenderQueue::add(uint32_t pass, const DrawItem &item, float depth)
+    {
+        constexpr float maxDepth = static_cast<float>((1u << depthBits) - 1);
+        const auto quantizedDepth = static_cast<uint32_t>(std::clamp(depth, 0.0f, 1.0f) * maxDepth);
+
+        drawItems.push_back(item);
+        drawItems.back().key = makeKey(pass,
+                                       idFor(shaderIds, item.shader),
+                                       idFor(materialIds, item.material),
+                                       idFor(textureIds, item.texture),
+                                       idFor(vertexArrayIds, item.vertexArray),
+                                       quantizedDepth);
+        frameStats.items++;
+    }
+
+    void RenderQueue::sort()
+    {
+        sorted.resize(drawItems.size());
+        for (size_t i = 0; i < drawItems.size(); i++)
+        {
+            sorted[i] = {drawItems[i].key, static_cast<uint32_t>(i)};
+        }
+        radixSort(sorted, scratch);
+    }
+
+    bool RenderQueue::bindState(const DrawItem &item)
+    {
+        size_t binds = 0;
+        const bool shaderChanged = !bound.valid || item.shader != bound.shader;
+        if (shaderChanged)
+        {
+            item.shader->use();
+            frameStats.shaderBinds++;
+            binds++;
+        }
+        // Uniforms belong to the program, so a new shader needs them again
+        const bool materialChanged = shaderChanged || item.material != bound.material;
+        if (materialChanged)
+        {
+            frameStats.materialBinds++;
+            binds++;
+        }
+        if (!bound.valid || item.texture != bound.texture)
+        {
+            glActiveTexture(GL_TEXTURE0);
+            if (item.texture)
+                item.texture->bind();
+            else
+                glBindTexture(GL_TEXTURE_2D, 0);
+            frameStats.textureBinds++;
+            binds++;
+        }
+        if (!bound.valid || item.vertexArray != bound.vertexArray)
+        {
+            item.vertexArray->bind();
+            frameStats.vertexArrayBinds++;
+            binds++;
+            // The element array binding belongs to the vertex array
+            bound.indexBuffer = nullptr;
+        }
+        if (!bound.valid || item.indexBuffer != bound.indexBuffer)
+        {
+            item.indexBuffer->bindTo(Buffer::Target::element_array);
+            frameStats.indexBufferBinds++;
+            binds++;
+        }
+        bound = {true, item.shader, item.material, item.texture, item.vertexArray, item.indexBuffer};
+        frameStats.bindsSaved += 5 - binds;
+        return materialChanged;
+    }
+
+    void RenderQueue::drawItem(const DrawItem &item)
+    {
+        if (item.instanceBuffer)
+        {
+            item.vertexArray->setInstanceMatrixBuffer(*item.instanceBuffer, item.instanceOffset);
+            glDrawElementsInstanced(GL_TRIANGLES, item.elementCount, GL_UNSIGNED_SHORT, reinterpret_cast<void *>(0),
+                                    static_cast<GLsizei>(item.instanceCount));
+        }
+        else
+        {
+            glDrawElements(GL_TRIANGLES, item.elementCount, GL_UNSIGNED_SHORT, reinterpret_cast<void *>(0));
+        }
+        frameStats.drawCalls++;
+    }
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "Buffer.h"
+#include "Mesh.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "VertexArray.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace applesauce
+{
+    // Draw items from every pass of a frame, radix sorted by a 64 bit key so
+    // that items sharing GL state end up next to each other, then dispatched
+    // skipping binds of state that is already current.
+    //
+    // Key layout, most significant first:
+    //   pass 4 | shader 8 | material 16 | texture 12 | vertex array 12 | depth 12
+    //
+    // State objects get a small id the first time they are seen. Ids wrap when
+    // a field runs out of bits, which only costs sort quality since elision
+    // compares the objects themselves.
+    //
+    // Usage per frame: begin(), add() from each pass, sort(), then dispatch()
+    // each pass once its framebuffer and per-pass uniforms are set up.
+    class RenderQueue
+    {
+    public:
+        struct DrawItem
+        {
+            uint64_t key;
+            const Shader *shader;
+            const Material *material;
+            const Texture2D *texture;
+            const VertexArray *vertexArray;
+            const Buffer *indexBuffer;
+            int elementCount;
+            // Drawn instanced when set, model matrices start at instanceOffset
+            const Buffer *instanceBuffer;
+            size_t instanceOffset;
+            size_t instanceCount;
+        };
+
+        struct SortEntry
+        {
+            uint64_t key;
+            uint32_t index;
+        };
+
+        struct Stats
+        {
+            size_t items = 0;
+            size_t drawCalls = 0;
+            size_t shaderBinds = 0;
+            size_t materialBinds = 0;
+            size_t textureBinds = 0;
+            size_t vertexArrayBinds = 0;
+            size_t indexBufferBinds = 0;
+            // Against binding all five pieces of state for every item
+            size_t bindsSaved = 0;
+        };
+
+        static constexpr int passBits = 4;
+        static constexpr int shaderBits = 8;
+        static constexpr int materialBits = 16;
+        static constexpr int textureBits = 12;
+        static constexpr int vertexArrayBits = 12;
+        static constexpr int depthBits = 12;
+
+        static uint64_t makeKey(uint32_t pass, uint32_t shader, uint32_t material, uint32_t texture,
+                                uint32_t vertexArray, uint32_t depth);
+
+        // Stable LSD radix sort by key, 8 bits per pass. Passes where every key
+        // has the same digit are skipped.
+        static void radixSort(std::vector<SortEntry> &entries, std::vector<SortEntry> &scratch);
+
+    public:
+        void begin();
+
+        // item.key is filled in. depth is normalized, 0 nearest.
+        void add(uint32_t pass, const DrawItem &item, float depth);
+
+        void sort();
+
+        // Draws the items of one pass in key order. setMaterial is called with
+        // the item's material (which may be null) whenever it or the shader
+        // changes, with the item's shader in use. Textures are bound to unit 0
+        // by the queue.
+        template <typename SetMaterial>
+        void dispatch(uint32_t pass, SetMaterial &&setMaterial)
+        {
+            bound = Bound{};
+            for (const auto &entry : sorted)
+            {
+                if ((entry.key >> (64 - passBits)) != pass)
+                {
+                    continue;
+                }
+                const auto &item = drawItems[entry.index];
+                if (bindState(item))
+                {
+                    setMaterial(item.material);
+                }
+                drawItem(item);
+            }
+        }
+
+        const std::vector<DrawItem> &items() const
+        {
+            return drawItems;
+        }
+
+        // Indices into items() in draw order, valid after sort()
+        const std::vector<SortEntry> &order() const
+        {
+            return sorted;
+        }
+
+        const Stats &stats() const
+        {
+            return frameStats;
+        }
+
+    private:
+        struct Bound
+        {
+            bool valid = false;
+            const Shader *shader = nullptr;
+            const Material *material = nullptr;
+            const Texture2D *texture = nullptr;
+            const VertexArray *vertexArray = nullptr;
+            const Buffer *indexBuffer = nullptr;
+        };
+
+        uint32_t idFor(std::unordered_map<const void *, uint32_t> &ids, const void *object);
+        // Returns true when the material needs setting
+        bool bindState(const DrawItem &item);
+        void drawItem(const DrawItem &item);
+
+    private:
+        std::vector<DrawItem> drawItems;
+        std::vector<SortEntry> sorted;
+        std::vector<SortEntry> scratch;
+
+        // Kept across frames so that the same state sorts the same way
+        std::unordered_map<const void *, uint32_t> shaderIds;
+        std::unordered_map<const void *, uint32_t> materialIds;
+        std::unordered_map<const void *, uint32_t> textureIds;
+        std::unordered_map<const void *, uint32_t> vertexArrayIds;
+
+        Bound bound;
+        Stats frameStats;
+    };
+}
@@ -0,0 +1,42 @@
+#include "RenderSnapshot.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace applesauce
+{
+    void captureInstances(const EntityStore &store, RenderSnapshot &snapshot)
+    {
+        snapshot.instances.clear();
+        for (size_t i = 0; i < store.size(); i++)
+        {
+            if (store.meshes[i])
+            {
+                snapshot.instances.push_back({store.ids[i], store.meshes[i].get(), store.positions[i], store.orientations[i], store.stationary[i] != 0});
+            }
+        }
+    }
+
+    void interpolateInstances(const RenderSnapshot &previous, const RenderSnapshot &current, float alpha, std::vector<glm::mat4> &modelMatrices)
+    {
+        modelMatrices.resize(current.instances.size());
+
+        // Ids increase with the slot in both, so one pass pairs them all up
+        size_t match = 0;
+        for (size_t i = 0; i < current.instances.size(); i++)
+        {
+            const auto &instance = current.instances[i];
+            while (match < previous.instances.size() && previous.instances[match].id < instance.id)
+                match++;
+
+            auto position = instance.position;
+            auto orientation = instance.orientation;
+            if (match < previous.instances.size() && previous.instances[match].id == instance.id)
+            {
+                const auto &before = previous.instances[match];
+                position = glm::mix(before.position, instance.position, alpha);
+                orientation = glm::slerp(before.orientation, instance.orientation, alpha);
+            }
+            modelMatrices[i] = glm::translate(glm::mat4{1.0f}, position) * glm::mat4(orientation);
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "EntityStore.h"
+#include "Mesh.h"
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace applesauce
+{
+    // Everything the renderer needs from one simulation tick, copied out so
+    // the simulation can carry on while it is drawn. Meshes are referred to
+    // by pointer: they belong to the resource manager and outlive any tick.
+    struct RenderSnapshot
+    {
+        struct Instance
+        {
+            // EntityStore id, matches the same entity across snapshots
+            uint64_t id;
+            const Mesh *mesh;
+            glm::vec3 position;
+            glm::quat orientation;
+            bool stationary;
+        };
+
+        std::vector<Instance> instances;
+
+        glm::vec3 cameraTarget{0};
+        float cameraDistance = 0;
+
+        uint64_t tick = 0;
+        // When the tick was done, and how far behind schedule it started
+        std::chrono::steady_clock::time_point published;
+        double lateness = 0;
+    };
+
+    // Replaces the snapshot's instances with every slot of the store that has a mesh
+    void captureInstances(const EntityStore &store, RenderSnapshot &snapshot);
+
+    // Model matrices for current's instances, alpha of the way there from
+    // previous. Instances that previous does not have are drawn where they are.
+    void interpolateInstances(const RenderSnapshot &previous, const RenderSnapshot &current, float alpha, std::vector<glm::mat4> &modelMatrices);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace applesauce
+{
+    // Mean, spread and worst case over the last few samples, e.g. frame
+    // times. The standard deviation is what the timing stats call jitter.
+    class RollingStats
+    {
+    public:
+        explicit RollingStats(size_t capacity = 240) : samples(capacity)
+        {
+        }
+
+        void add(double sample)
+        {
+            samples[next] = sample;
+            next = (next + 1) % samples.size();
+            filled = std::min(filled + 1, samples.size());
+        }
+
+        size_t count() const
+        {
+            return filled;
+        }
+
+        double latest() const
+        {
+            return filled ? samples[(next + samples.size() - 1) % samples.size()] : 0.0;
+        }
+
+        double mean() const
+        {
+            double sum = 0;
+            for (size_t i = 0; i < filled; i++)
+                sum += samples[i];
+            return filled ? sum / static_cast<double>(filled) : 0.0;
+        }
+
+        double deviation() const
+        {
+            const auto average = mean();
+            double sum = 0;
+            for (size_t i = 0; i < filled; i++)
+                sum += (samples[i] - average) * (samples[i] - average);
+            return filled ? std::sqrt(sum / static_cast<double>(filled)) : 0.0;
+        }
+
+        double max() const
+        {
+            return filled ? *std::max_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(filled)) : 0.0;
+        }
+
+    private:
+        std::vector<double> samples;
+        size_t next = 0;
+        size_t filled = 0;
+    };
+}
@@ -1,8 +1,10 @@
 #include "Shader.h"
 
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <system_error>
 
 static std::string readFileText(const char *filename)
 {
@@ -10,27 +12,176 @@ static std::string readFileText(const char *filename)
     return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
 }
 
-std::shared_ptr<Shader> loadShader(const char *name)
+// Leads every cached program, the binary follows
+struct ProgramBinaryHeader
 {
-    static const std::string vertexShaderExt = ".vs.glsl";
-    static const std::string fragmentShaderExt = ".fs.glsl";
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t size;
+};
 
-    std::filesystem::path assetsPath = "assets/shaders";
-    std::filesystem::path vertexShaderPath = assetsPath / (std::string(name) + vertexShaderExt);
-    std::filesystem::path fragmentShaderPath = assetsPath / (std::string(name) + fragmentShaderExt);
+static constexpr char programBinaryMagic[4] = {'G', 'L', 'P', 'B'};
+static constexpr uint32_t programBinaryVersion = 1;
 
-    const auto vertex_shader_text = readFileText(vertexShaderPath.string().c_str());
-    const auto fragment_shader_text = readFileText(fragmentShaderPath.string().c_str());
+static ShaderCacheStats &cacheStats()
+{
+    static ShaderCacheStats stats;
+    return stats;
+}
+
+const ShaderCacheStats &shaderCacheStats()
+{
+    return cacheStats();
+}
+
+// Binaries only link on the driver that made them, so the driver is part of
+// the key along with the sources
+static uint64_t programBinaryKey(const std::string &vertexSource, const std::string &fragmentSource)
+{
+    uint64_t hash = 14695981039346656037ull;
+    const auto mix = [&hash](const char *text)
+    {
+        for (; *text; text++)
+        {
+            hash = (hash ^ static_cast<uint8_t>(*text)) * 1099511628211ull;
+        }
+        // Keeps "ab" + "c" apart from "a" + "bc"
+        hash = (hash ^ 0xFF) * 1099511628211ull;
+    };
+    mix(vertexSource.c_str());
+    mix(fragmentSource.c_str());
+    for (const auto property : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+    {
+        const auto value = glGetString(property);
+        mix(value ? reinterpret_cast<const char *>(value) : "");
+    }
+    return hash;
+}
+
+static bool readProgramBinary(const std::filesystem::path &path, uint64_t key, GLenum &format, std::vector<uint8_t> &binary)
+{
+    std::ifstream file(path, std::ios::binary);
+    ProgramBinaryHeader header{};
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, programBinaryMagic, sizeof(programBinaryMagic)) != 0 ||
+        header.version != programBinaryVersion || header.key != key)
+    {
+        return false;
+    }
+    std::error_code error;
+    const auto fileSize = std::filesystem::file_size(path, error);
+    if (error || header.size > fileSize - sizeof(header))
+    {
+        return false;
+    }
+    binary.resize(header.size);
+    if (!file.read(reinterpret_cast<char *>(binary.data()), static_cast<std::streamsize>(binary.size())))
+    {
+        return false;
+    }
+    format = header.format;
+    return true;
+}
+
+// Written beside the old binary and moved over it, so a run that stops half
+// way never leaves a truncated one behind
+static bool writeProgramBinary(const std::filesystem::path &path, uint64_t key, GLenum format, const std::vector<uint8_t> &binary)
+{
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    auto temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        ProgramBinaryHeader header{};
+        std::memcpy(header.magic, programBinaryMagic, sizeof(programBinaryMagic));
+        header.version = programBinaryVersion;
+        header.key = key;
+        header.format = format;
+        header.size = static_cast<uint32_t>(binary.size());
+        if (!file.write(reinterpret_cast<const char *>(&header), sizeof(header)) ||
+            !file.write(reinterpret_cast<const char *>(binary.data()), static_cast<std::streamsize>(binary.size())))
+        {
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+    return !error;
+}
+
+std::shared_ptr<Shader> buildShader(const char *name, const std::string &vertexSource, const std::string &fragmentSource,
+                                    const std::filesystem::path &cacheDirectory)
+{
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    auto &stats = cacheStats();
+    stats.programs++;
+    const auto finish = [&](std::shared_ptr<Shader> shader)
+    {
+        stats.seconds += std::chrono::duration<double>(Clock::now() - start).count();
+        return shader;
+    };
 
     auto shader = std::make_shared<Shader>();
-    shader->add_vertex_stage(vertex_shader_text);
-    shader->add_fragment_stage(fragment_shader_text);
+    const bool cached = !cacheDirectory.empty() && Shader::binariesSupported();
+    const auto path = cacheDirectory / (std::string(name) + ".bin");
+    uint64_t key = 0;
+    if (cached)
+    {
+        key = programBinaryKey(vertexSource, fragmentSource);
+        GLenum format = 0;
+        std::vector<uint8_t> binary;
+        if (!readProgramBinary(path, key, format, binary))
+        {
+            stats.misses++;
+        }
+        else if (shader->linkBinary(format, binary.data(), binary.size()))
+        {
+            stats.hits++;
+            return finish(shader);
+        }
+        else
+        {
+            std::cout << "Shader cache: driver rejected " << path.string() << ", compiling " << name << std::endl;
+            stats.rejected++;
+        }
+        shader->retainBinary();
+    }
 
+    shader->add_vertex_stage(vertexSource);
+    shader->add_fragment_stage(fragmentSource);
     if (!shader->compile_and_link())
     {
         std::cout << shader->error_log() << std::endl;
-        return nullptr;
+        return finish(nullptr);
+    }
+
+    if (cached)
+    {
+        GLenum format = 0;
+        const auto binary = shader->programBinary(format);
+        if (!binary.empty() && writeProgramBinary(path, key, format, binary))
+        {
+            stats.writes++;
+        }
     }
+    return finish(shader);
+}
+
+std::shared_ptr<Shader> loadShader(const char *name, const std::filesystem::path &cacheDirectory)
+{
+    static const std::string vertexShaderExt = ".vs.glsl";
+    static const std::string fragmentShaderExt = ".fs.glsl";
+
+    std::filesystem::path assetsPath = "assets/shaders";
+    std::filesystem::path vertexShaderPath = assetsPath / (std::string(name) + vertexShaderExt);
+    std::filesystem::path fragmentShaderPath = assetsPath / (std::string(name) + fragmentShaderExt);
+
+    const auto vertex_shader_text = readFileText(vertexShaderPath.string().c_str());
+    const auto fragment_shader_text = readFileText(fragmentShaderPath.string().c_str());
 
-    return shader;
+    return buildShader(name, vertex_shader_text, fragment_shader_text, cacheDirectory);
 }
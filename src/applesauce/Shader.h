@@ -5,6 +5,10 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/mat4x4.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <map>
 #include <memory>
 #include <string>
@@ -103,10 +107,32 @@ public:
         }
     };
 
+    // Index into the uniforms resolved at link time. Resolve once with
+    // uniformHandle() and reuse it for every set() instead of a name.
+    struct UniformHandle
+    {
+        GLint index = -1;
+
+        bool isValid() const
+        {
+            return index >= 0;
+        }
+    };
+
     using Stage = ShaderStage;
     using Attributes = std::map<std::string, Attribute>;
     using Uniforms = std::map<std::string, Uniform>;
 
+private:
+    struct ResolvedUniform
+    {
+        GLint location;
+        // Last value uploaded, so redundant glUniform* calls can be skipped.
+        // Large enough for a mat4; ints are stored by bit pattern.
+        GLfloat value[16];
+        bool hasValue = false;
+    };
+
 public:
     Shader() : id(glCreateProgram())
     {
@@ -146,7 +172,75 @@ public:
         GLint link_status;
         glGetProgramiv(id, GL_LINK_STATUS, &link_status);
 
-        return link_status == GL_TRUE;
+        if (link_status != GL_TRUE)
+        {
+            return false;
+        }
+
+        resolveUniforms();
+        return true;
+    }
+
+    // Whether the driver hands out linked programs and takes them back, GL
+    // 4.1 or ARB_get_program_binary with at least one binary format
+    static bool binariesSupported()
+    {
+        if (!(GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary))
+        {
+            return false;
+        }
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        return formatCount > 0;
+    }
+
+    // Asks the driver to keep the program for programBinary(), call before
+    // compile_and_link()
+    void retainBinary() const
+    {
+        if (binariesSupported())
+            glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // The linked program in the driver's own format, empty if it has none
+    std::vector<uint8_t> programBinary(GLenum &format) const
+    {
+        std::vector<uint8_t> binary(static_cast<size_t>(std::max(gl_parameter(GL_PROGRAM_BINARY_LENGTH), 0)));
+        GLsizei length = 0;
+        if (!binary.empty())
+        {
+            glGetProgramBinary(id, static_cast<GLsizei>(binary.size()), &length, &format, binary.data());
+        }
+        binary.resize(static_cast<size_t>(length));
+        return binary;
+    }
+
+    // Links from a programBinary() of an earlier run instead of the stages.
+    // False when the driver doesn't know the format or rejects the binary,
+    // as it may after an update, and the program can still be given stages
+    // and compiled.
+    bool linkBinary(GLenum format, const void *binary, size_t size)
+    {
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        std::vector<GLint> formats(static_cast<size_t>(std::max(formatCount, 0)));
+        if (formatCount > 0)
+        {
+            glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+        }
+        if (std::find(formats.begin(), formats.end(), static_cast<GLint>(format)) == formats.end())
+        {
+            return false;
+        }
+
+        glProgramBinary(id, format, binary, static_cast<GLsizei>(size));
+        if (gl_parameter(GL_LINK_STATUS) != GL_TRUE)
+        {
+            return false;
+        }
+
+        resolveUniforms();
+        return true;
     }
 
     std::string error_log() const
@@ -202,40 +296,72 @@ public:
         return result;
     }
 
-    void set(const char *name, const glm::mat4 &matrix)
+    UniformHandle uniformHandle(const char *name) const
+    {
+        const auto found = uniformIndices.find(name);
+        if (found == uniformIndices.end())
+        {
+            return {};
+        }
+        return {found->second};
+    }
+
+    void set(UniformHandle handle, const glm::mat4 &matrix)
     {
-        const auto loc = glGetUniformLocation(glId(), name);
-        glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(matrix));
+        if (const auto uniform = changedUniform(handle, glm::value_ptr(matrix), sizeof(matrix)))
+            glUniformMatrix4fv(uniform->location, 1, GL_FALSE, glm::value_ptr(matrix));
     }
 
-    void set(const char *name, const glm::mat3 &matrix)
+    void set(UniformHandle handle, const glm::mat3 &matrix)
     {
-        const auto loc = glGetUniformLocation(glId(), name);
-        glUniformMatrix3fv(loc, 1, GL_FALSE, glm::value_ptr(matrix));
+        if (const auto uniform = changedUniform(handle, glm::value_ptr(matrix), sizeof(matrix)))
+            glUniformMatrix3fv(uniform->location, 1, GL_FALSE, glm::value_ptr(matrix));
     }
 
-    void set(const char *name, const glm::vec3 &vector)
+    void set(UniformHandle handle, const glm::vec3 &vector)
     {
-        const auto loc = glGetUniformLocation(glId(), name);
-        glUniform3fv(loc, 1, glm::value_ptr(vector));
+        if (const auto uniform = changedUniform(handle, glm::value_ptr(vector), sizeof(vector)))
+            glUniform3fv(uniform->location, 1, glm::value_ptr(vector));
     }
 
-    void set(const char *name, const glm::vec4 &vector)
+    void set(UniformHandle handle, const glm::vec4 &vector)
     {
-        const auto loc = glGetUniformLocation(glId(), name);
-        glUniform4fv(loc, 1, glm::value_ptr(vector));
+        if (const auto uniform = changedUniform(handle, glm::value_ptr(vector), sizeof(vector)))
+            glUniform4fv(uniform->location, 1, glm::value_ptr(vector));
     }
 
-    void set(const char *name, const float value)
+    void set(UniformHandle handle, const float value)
     {
-        const auto loc = glGetUniformLocation(glId(), name);
-        glUniform1f(loc, value);
+        if (const auto uniform = changedUniform(handle, &value, sizeof(value)))
+            glUniform1f(uniform->location, value);
     }
 
-    void set(const char *name, const int value)
+    void set(UniformHandle handle, const int value)
     {
-        const auto loc = glGetUniformLocation(glId(), name);
-        glUniform1i(loc, value);
+        if (const auto uniform = changedUniform(handle, &value, sizeof(value)))
+            glUniform1i(uniform->location, value);
+    }
+
+    // Name based setters go through the same cache; prefer handles in hot loops
+    // as these still pay for a lookup in uniformIndices.
+    template <typename T>
+    void set(const char *name, const T &value)
+    {
+        set(uniformHandle(name), value);
+    }
+
+    // Points the named uniform block at a binding point, where a
+    // UniformBuffer or UniformRing puts its data. False if there is no such
+    // block, or the compiler optimised it out.
+    bool bindUniformBlock(const char *name, GLuint binding) const
+    {
+        const GLuint index = glGetUniformBlockIndex(id, name);
+        if (index == GL_INVALID_INDEX)
+        {
+            return false;
+        }
+        glUniformBlockBinding(id, index, binding);
+        return true;
     }
 
     void use() const
@@ -256,11 +382,75 @@ private:
         return result;
     }
 
+    void resolveUniforms()
+    {
+        resolvedUniforms.clear();
+        uniformIndices.clear();
+        for (const auto &[name, uniform] : uniforms())
+        {
+            const auto index = static_cast<GLint>(resolvedUniforms.size());
+            resolvedUniforms.push_back({uniform.location, {}, false});
+            uniformIndices.emplace(name, index);
+
+            // Arrays are reported as "name[0]", but are usually set by their base name
+            const auto arraySuffix = name.rfind("[0]");
+            if (arraySuffix != std::string::npos && arraySuffix + 3 == name.size())
+            {
+                uniformIndices.emplace(name.substr(0, arraySuffix), index);
+            }
+        }
+    }
+
+    // Returns the uniform to upload to, or nullptr when the handle is invalid
+    // or the program already holds this exact value.
+    ResolvedUniform *changedUniform(UniformHandle handle, const void *value, size_t size)
+    {
+        if (!handle.isValid() || static_cast<size_t>(handle.index) >= resolvedUniforms.size())
+        {
+            return nullptr;
+        }
+        auto &uniform = resolvedUniforms[handle.index];
+        if (uniform.hasValue && std::memcmp(uniform.value, value, size) == 0)
+        {
+            return nullptr;
+        }
+        std::memcpy(uniform.value, value, size);
+        uniform.hasValue = true;
+        return &uniform;
+    }
+
 private:
     const GLuint id;
     Stage vertex_stage;
     Stage fragment_stage;
     std::string stage_error_log;
+
+    std::vector<ResolvedUniform> resolvedUniforms;
+    std::map<std::string, GLint, std::less<>> uniformIndices;
 };
 
-std::shared_ptr<Shader> loadShader(const char *name);
\ No newline at end of file
+// Program binary cache totals since startup, over every buildShader()
+struct ShaderCacheStats
+{
+    size_t programs = 0;
+    size_t hits = 0;
+    // No binary yet for these sources on this driver
+    size_t misses = 0;
+    // Binaries the driver wouldn't link, compiled from source instead
+    size_t rejected = 0;
+    size_t writes = 0;
+    // Building every program, from the cache or not
+    double seconds = 0;
+};
+
+const ShaderCacheStats &shaderCacheStats();
+
+// Compiles and links the sources, printing the error log and returning
+// nullptr on failure. With a cache directory the linked program is kept
+// there as <name>.bin, keyed by the sources and the driver's vendor,
+// renderer and version, and linked from that next time instead.
+std::shared_ptr<Shader> buildShader(const char *name, const std::string &vertexSource, const std::string &fragmentSource,
+                                    const std::filesystem::path &cacheDirectory = {});
+
+// assets/shaders/<name>.vs.glsl and <name>.fs.glsl through buildShader()
+std::shared_ptr<Shader> loadShader(const char *name, const std::filesystem::path &cacheDirectory = {});
\ No newline at end of file
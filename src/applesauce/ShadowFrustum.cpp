@@ -0,0 +1,123 @@
+#include "ShadowFrustum.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace applesauce
+{
+    FrustumCorners frustumCorners(const glm::mat4 &viewProjection)
+    {
+        const auto inverse = glm::inverse(viewProjection);
+        FrustumCorners corners;
+        for (int i = 0; i < 8; i++)
+        {
+            const glm::vec4 ndc{i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i < 4 ? -1.0f : 1.0f, 1.0f};
+            const auto world = inverse * ndc;
+            corners[i] = glm::vec3(world) / world.w;
+        }
+        return corners;
+    }
+
+    FrustumCorners frustumSlice(const FrustumCorners &corners, float nearPlane, float farPlane, float from, float to)
+    {
+        // The edges run out from the eye, so depth is linear along them
+        const float range = farPlane - nearPlane;
+        FrustumCorners slice;
+        for (int i = 0; i < 4; i++)
+        {
+            const auto edge = corners[i + 4] - corners[i];
+            slice[i] = corners[i] + edge * ((from - nearPlane) / range);
+            slice[i + 4] = corners[i] + edge * ((to - nearPlane) / range);
+        }
+        return slice;
+    }
+
+    void cascadeSplits(float nearPlane, float farPlane, size_t count, float lambda, float *splits)
+    {
+        for (size_t i = 1; i <= count; i++)
+        {
+            const float fraction = static_cast<float>(i) / static_cast<float>(count);
+            const float logarithmic = nearPlane * std::pow(farPlane / nearPlane, fraction);
+            const float uniform = nearPlane + (farPlane - nearPlane) * fraction;
+            splits[i - 1] = lambda * logarithmic + (1.0f - lambda) * uniform;
+        }
+        splits[count - 1] = farPlane;
+    }
+
+    ShadowCascade fitShadowCascade(const FrustumCorners &slice, const glm::vec3 &lightDirection, const Bounds &scene, int resolution,
+                                   const ShadowCascade *previous, float margin)
+    {
+        // Looking along the light at the middle of the scene, which does not
+        // move, so neither do the light's texels
+        const auto center = scene.center();
+        const auto radius = scene.radius();
+        const auto up = std::abs(lightDirection.y) > 0.99f ? glm::vec3{0, 0, 1} : glm::vec3{0, 1, 0};
+        const auto lightView = glm::lookAt(center + glm::normalize(lightDirection) * radius, center, up);
+
+        const auto lightBounds = [&lightView](const glm::vec3 *points, size_t count)
+        {
+            Bounds bounds{glm::vec3(lightView * glm::vec4(points[0], 1.0f)), glm::vec3(lightView * glm::vec4(points[0], 1.0f))};
+            for (size_t i = 1; i < count; i++)
+            {
+                const auto point = glm::vec3(lightView * glm::vec4(points[i], 1.0f));
+                bounds.min = glm::min(bounds.min, point);
+                bounds.max = glm::max(bounds.max, point);
+            }
+            return bounds;
+        };
+
+        glm::vec3 sceneCorners[8];
+        for (int i = 0; i < 8; i++)
+        {
+            sceneCorners[i] = {i & 1 ? scene.max.x : scene.min.x, i & 2 ? scene.max.y : scene.min.y, i & 4 ? scene.max.z : scene.min.z};
+        }
+        const auto sceneBox = lightBounds(sceneCorners, 8);
+        auto box = lightBounds(slice.data(), slice.size());
+
+        // Only receivers in the scene need shadows, and nothing outside it casts
+        box.min = glm::max(box.min, sceneBox.min);
+        box.max = glm::min(box.max, sceneBox.max);
+        if (box.min.x >= box.max.x || box.min.y >= box.max.y)
+        {
+            box = sceneBox;
+        }
+
+        // Square, in whole units with at least a unit to spare for snapping
+        const float extent = std::max(box.max.x - box.min.x, box.max.y - box.min.y);
+        const float size = std::ceil(extent * (1.0f + 2.0f * margin)) + 1.0f;
+
+        // The previous box, if it was for the same resolution, still holds
+        // the slice and isn't needlessly large
+        glm::vec3 square;
+        if (previous && previous->box.z > 0.0f &&
+            static_cast<float>(resolution) / previous->box.z == previous->texelsPerUnit &&
+            previous->box.z <= size * (1.0f + margin) &&
+            previous->box.x <= box.min.x && box.max.x <= previous->box.x + previous->box.z &&
+            previous->box.y <= box.min.y && box.max.y <= previous->box.y + previous->box.z)
+        {
+            square = previous->box;
+        }
+        else
+        {
+            const float texel = size / static_cast<float>(resolution);
+            square = {std::floor(((box.min.x + box.max.x) * 0.5f - size * 0.5f) / texel) * texel,
+                      std::floor(((box.min.y + box.max.y) * 0.5f - size * 0.5f) / texel) * texel,
+                      size};
+        }
+
+        // The view looks down -z
+        const auto projection = glm::ortho(square.x, square.x + square.z, square.y, square.y + square.z, -sceneBox.max.z, -sceneBox.min.z);
+        return {projection * lightView, static_cast<float>(resolution) / square.z, square};
+    }
+
+    glm::vec4 cascadeRegion(size_t index, size_t count)
+    {
+        if (count <= 1)
+        {
+            return {0.0f, 0.0f, 1.0f, 1.0f};
+        }
+        return {static_cast<float>(index % 2) * 0.5f, static_cast<float>(index / 2) * 0.5f, 0.5f, 0.5f};
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Bounds.h"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <array>
+#include <cstddef>
+
+namespace applesauce
+{
+    using FrustumCorners = std::array<glm::vec3, 8>;
+
+    // World space corners of the frustum of a view projection matrix, the
+    // four on the near plane first and then the four on the far plane in the
+    // same order
+    FrustumCorners frustumCorners(const glm::mat4 &viewProjection);
+
+    // The part of a perspective frustum between two view depths, given the
+    // depths of its own near and far planes
+    FrustumCorners frustumSlice(const FrustumCorners &corners, float nearPlane, float farPlane, float from, float to);
+
+    // View depths at which each of count cascades ends, the last one at far.
+    // lambda blends from evenly spaced (0) to logarithmic (1).
+    void cascadeSplits(float nearPlane, float farPlane, size_t count, float lambda, float *splits);
+
+    struct ShadowCascade
+    {
+        // Light view and orthographic projection, for drawing the casters
+        glm::mat4 lightSpaceMatrix{1.0f};
+        // Shadow map texels per world unit across the light's view
+        float texelsPerUnit = 0;
+        // The square it covers in the light's view: left, bottom and size
+        glm::vec3 box{0.0f};
+    };
+
+    // Fits an orthographic light box around the slice of the camera frustum,
+    // as far as it overlaps the scene. Its depth covers the whole scene, so
+    // casters outside the slice still shadow what is in it.
+    //
+    // The light's orientation only depends on its direction and the box only
+    // moves in whole texels of a map of the given resolution, or grows in
+    // whole units, so shadows do not shimmer as the camera moves.
+    //
+    // Given the previous frame's cascade, the box stays where it was for as
+    // long as the slice is inside it, so the matrix (and shadows cached with
+    // it) only change every so often. margin, a fraction of the slice, is
+    // added on every side of a new box to give the slice room to move. A box
+    // is also refitted once it is more than a margin larger than needed.
+    ShadowCascade fitShadowCascade(const FrustumCorners &slice, const glm::vec3 &lightDirection, const Bounds &scene, int resolution,
+                                   const ShadowCascade *previous = nullptr, float margin = 0.0f);
+
+    // Where cascade index of count lives in the shadow map, as a fraction of
+    // it: x, y offset then width, height. One cascade has the map to itself,
+    // more share it as quarters.
+    glm::vec4 cascadeRegion(size_t index, size_t count);
+}
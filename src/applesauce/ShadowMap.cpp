@@ -0,0 +1,67 @@
+#include "ShadowMap.h"
+
+#include <stdexcept>
+
+namespace applesauce
+{
+    ShadowMap::ShadowMap(int width, int height) : size{width, height}
+    {
+        glGenFramebuffers(1, &id);
+        glBindFramebuffer(GL_FRAMEBUFFER, id);
+        depth = std::make_shared<DepthTexture2D>(width, height);
+        depth->bind();
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth->glId(), 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        const auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        if (status != GL_FRAMEBUFFER_COMPLETE)
+        {
+            glDeleteFramebuffers(1, &id);
+            throw std::runtime_error("Shadow map framebuffer is incomplete");
+        }
+    }
+
+    ShadowMap::~ShadowMap()
+    {
+        glDeleteFramebuffers(1, &id);
+    }
+
+    void ShadowMap::bind() const
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, id);
+        glViewport(0, 0, size[0], size[1]);
+    }
+
+    void ShadowMap::copyFrom(const ShadowMap &other) const
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, other.id);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, id);
+        glBlitFramebuffer(0, 0, other.size[0], other.size[1], 0, 0, size[0], size[1], GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        bind();
+    }
+
+    ShadowCache::ShadowCache(int width, int height) : cache(width, height)
+    {
+    }
+
+    void ShadowCache::beginUpdate()
+    {
+        cache.bind();
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    void ShadowCache::endUpdate(uint64_t key)
+    {
+        cachedKey = key;
+        valid = true;
+        cacheStats.rebuilds++;
+    }
+
+    void ShadowCache::restore(const ShadowMap &target)
+    {
+        target.copyFrom(cache);
+        cacheStats.restores++;
+    }
+}
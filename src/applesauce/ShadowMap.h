@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Texture.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <memory>
+
+namespace applesauce
+{
+    // A depth texture and the framebuffer that renders into it
+    class ShadowMap
+    {
+    public:
+        ShadowMap(int width, int height);
+        ~ShadowMap();
+
+        ShadowMap(const ShadowMap &) = delete;
+        ShadowMap &operator=(const ShadowMap &) = delete;
+
+        // Binds the framebuffer and sets the viewport to cover it
+        void bind() const;
+
+        // Blits other's depth over this one's, which is left bound. Both
+        // must be the same size.
+        void copyFrom(const ShadowMap &other) const;
+
+        const std::shared_ptr<DepthTexture2D> &texture() const
+        {
+            return depth;
+        }
+
+        GLuint framebuffer() const
+        {
+            return id;
+        }
+
+        int width() const
+        {
+            return size[0];
+        }
+
+        int height() const
+        {
+            return size[1];
+        }
+
+    private:
+        GLuint id = 0;
+        int size[2];
+        std::shared_ptr<DepthTexture2D> depth;
+    };
+
+    // The depth of shadow casters that never move. It is drawn once and
+    // copied into the shadow map at the start of each frame, which then only
+    // needs the casters that do move drawn on top.
+    //
+    // The key identifies what the cache holds, e.g. a hash of the light's
+    // matrix and the stationary entities. Usage per frame:
+    //
+    //   if (cache.isStale(key)) {
+    //       cache.beginUpdate();
+    //       ...draw the stationary casters...
+    //       cache.endUpdate(key);
+    //   }
+    //   cache.restore(shadowMap);
+    //   ...draw the moving casters...
+    class ShadowCache
+    {
+    public:
+        struct Stats
+        {
+            size_t rebuilds = 0;
+            size_t restores = 0;
+        };
+
+    public:
+        ShadowCache(int width, int height);
+
+        bool isStale(uint64_t key) const
+        {
+            return !valid || key != cachedKey;
+        }
+
+        void invalidate()
+        {
+            valid = false;
+        }
+
+        // Binds and clears the cached depth for drawing
+        void beginUpdate();
+        void endUpdate(uint64_t key);
+
+        // Copies the cached depth into target, leaving target bound
+        void restore(const ShadowMap &target);
+
+        const ShadowMap &cached() const
+        {
+            return cache;
+        }
+
+        // Totals since construction
+        const Stats &stats() const
+        {
+            return cacheStats;
+        }
+
+    private:
+        ShadowMap cache;
+        uint64_t cachedKey = 0;
+        bool valid = false;
+        Stats cacheStats;
+    };
+}
@@ -1,8 +1,11 @@
 #include "Texture.h"
 
-#include <png.h>
+#include <util/AssetPack.h>
+#include <util/CompressedImage.h>
+#include <util/Image.h>
 
 #include <memory>
+#include <stdexcept>
 
 namespace applesauce {
 
@@ -18,31 +21,110 @@ namespace applesauce {
 
     std::shared_ptr<Texture> textureFromPNG(const char* filename)
     {
-        png_image image;
-        /* Only the image structure version number needs to be set. */
-        std::memset(&image, 0, sizeof image);
-        image.version = PNG_IMAGE_VERSION;
+        const auto image = imageFromPNG(filename);
+        if (image.empty())
+        {
+            return nullptr;
+        }
+        auto tex = std::make_shared<Texture>();
+        setTextureImage(*tex, image);
+        return tex;
+    }
 
-        if (png_image_begin_read_from_file(&image, filename))
+    std::shared_ptr<Texture> textureFromPack(const AssetPack &pack, const std::string &name)
+    {
+        if (!pack.findTexture(name))
         {
-            image.format = PNG_FORMAT_RGBA;
-            auto buffer = reinterpret_cast<png_bytep>(malloc(PNG_IMAGE_SIZE(image)));
+            return nullptr;
+        }
+        auto tex = std::make_shared<Texture>();
+        setTextureFromPack(*tex, pack, name);
+        return tex;
+    }
 
-            if (png_image_finish_read(&image, NULL /*background*/, buffer, 0 /*row_stride*/,
-                NULL /*colormap for PNG_FORMAT_FLAG_COLORMAP */))
-            {
-                auto tex = std::make_shared<Texture>();
-                tex->setMinFilter(Texture::Filter::linearMipMapLinear);
-                tex->setMagFilter(Texture::Filter::linear);
+    std::shared_ptr<Texture> textureFromCompressedFile(const char *filename)
+    {
+        const auto image = compressedImageFromFile(filename);
+        auto tex = std::make_shared<Texture>();
+        if (!setTextureCompressed(*tex, image))
+        {
+            throw std::runtime_error("BC7 textures are not supported by this driver");
+        }
+        return tex;
+    }
+
+    bool setTextureImage(Texture &texture, const Image &image)
+    {
+        if (image.empty())
+        {
+            return false;
+        }
+
+        texture.setMinFilter(Texture::Filter::linearMipMapLinear);
+        texture.setMagFilter(Texture::Filter::linear);
+        texture.setImage(0, static_cast<int>(image.width), static_cast<int>(image.height), Texture::Format::rgba, image.pixels.data());
+        texture.generateMipmaps();
+        return true;
+    }
+
+    bool setTextureFromPack(Texture &texture, const AssetPack &pack, const std::string &name)
+    {
+        const auto record = pack.findTexture(name);
+        if (!record)
+        {
+            return false;
+        }
+
+        texture.setMinFilter(record->mipCount > 1 ? Texture::Filter::linearMipMapLinear : Texture::Filter::linear);
+        texture.setMagFilter(Texture::Filter::linear);
+
+        const auto mips = pack.mips();
+        for (uint32_t level = 0; level < record->mipCount; level++)
+        {
+            const auto &mip = mips[record->firstMip + level];
+            texture.setImage(static_cast<int>(level), mip.width, mip.height, Texture::Format::rgba, pack.blob(mip.offset));
+        }
+        return true;
+    }
+
+    static Texture::Format textureFormat(CompressedImage::Format format)
+    {
+        switch (format)
+        {
+        case CompressedImage::Format::bc1:
+            return Texture::Format::bc1;
+        case CompressedImage::Format::bc3:
+            return Texture::Format::bc3;
+        default:
+            return Texture::Format::bc7;
+        }
+    }
 
-                auto ptr = reinterpret_cast<GLubyte*>(buffer);
-                tex->setImage(image.width, image.height, Texture::Format::rgba, ptr);
-                tex->generateMipmaps();
+    bool setTextureCompressed(Texture &texture, const CompressedImage &image)
+    {
+        const auto format = textureFormat(image.format);
+        const bool supported = Texture::isSupported(format);
+        if (image.empty() || (!supported && format == Texture::Format::bc7))
+        {
+            return false;
+        }
 
-                return tex;
+        texture.setMinFilter(image.levels.size() > 1 ? Texture::Filter::linearMipMapLinear : Texture::Filter::linear);
+        texture.setMagFilter(Texture::Filter::linear);
+        for (size_t level = 0; level < image.levels.size(); level++)
+        {
+            const auto &blocks = image.levels[level];
+            if (supported)
+            {
+                texture.setCompressedImage(static_cast<int>(level), blocks.width, blocks.height, format, blocks.blocks.data(), blocks.blocks.size());
+            }
+            else
+            {
+                const auto texels = decompressLevel(image, level);
+                texture.setImage(static_cast<int>(level), texels.width, texels.height, Texture::Format::rgba, texels.pixels.data());
             }
         }
-        return nullptr;
+        return true;
     }
 
-}
\ No newline at end of file
+}
@@ -2,7 +2,26 @@
 
 #include "GLResource.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <memory>
+#include <string>
+#include <vector>
+
+// Not in every glad, the values are fixed by the extensions
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+class AssetPack;
+struct CompressedImage;
+struct Image;
 
 namespace applesauce
 {
@@ -30,7 +49,20 @@ namespace applesauce
         enum class Format
         {
             depthComponent,
-            rgba
+            rgba,
+            // Block compressed, only set with setCompressedImage()
+            bc1,
+            bc3,
+            bc7
+        };
+
+        // GL memory of every texture's levels, and what the same levels would
+        // take as plain RGBA
+        struct Memory
+        {
+            size_t textures = 0;
+            size_t bytes = 0;
+            size_t uncompressedBytes = 0;
         };
 
         enum class Filter
@@ -115,10 +147,23 @@ namespace applesauce
                 return GL_RGBA;
             case Format::depthComponent:
                 return GL_DEPTH_COMPONENT;
+            case Format::bc1:
+                return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+            case Format::bc3:
+                return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            case Format::bc7:
+                return GL_COMPRESSED_RGBA_BPTC_UNORM;
             default:
                 return 0;
             }
         }
+
+        static Memory &memoryTotals()
+        {
+            static Memory totals;
+            return totals;
+        }
+
         static GLuint genGLTexture()
         {
             GLuint result;
@@ -129,12 +174,69 @@ namespace applesauce
         static constexpr GLenum target = GL_TEXTURE_2D;
 
     public:
-        Texture2D(Format format = Format::rgba) : GLResource(genGLTexture()), internalFormat(format) {}
+        Texture2D(Format format = Format::rgba) : GLResource(genGLTexture()), internalFormat(format)
+        {
+            memoryTotals().textures++;
+        }
 
         ~Texture2D()
         {
             auto id = glId();
             glDeleteTextures(1, &id);
+            for (size_t level = 0; level < levelMemory.size(); level++)
+            {
+                account(static_cast<int>(level), 0, 0);
+            }
+            memoryTotals().textures--;
+        }
+
+        static bool isCompressed(const Format format)
+        {
+            return format == Format::bc1 || format == Format::bc3 || format == Format::bc7;
+        }
+
+        // Whether the driver takes the format, compressed ones depend on
+        // extensions
+        static bool isSupported(const Format format)
+        {
+            if (!isCompressed(format))
+            {
+                return true;
+            }
+            GLint count = 0;
+            glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+            std::vector<GLint> formats(static_cast<size_t>(std::max(count, 0)));
+            if (count > 0)
+            {
+                glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+            }
+            for (const auto supported : formats)
+            {
+                if (static_cast<GLenum>(supported) == glInternalFormat(format))
+                    return true;
+            }
+            return false;
+        }
+
+        static const Memory &memory()
+        {
+            return memoryTotals();
+        }
+
+        Format format() const
+        {
+            return internalFormat;
+        }
+
+        // Of every level of this texture
+        size_t memoryBytes() const
+        {
+            size_t bytes = 0;
+            for (const auto &level : levelMemory)
+            {
+                bytes += level.bytes;
+            }
+            return bytes;
         }
 
         void bind() const
@@ -194,11 +296,20 @@ namespace applesauce
             unbind();
         }
 
-        void setImage(int width, int height, Format format, void *data) const
+        void setImage(int width, int height, Format format, void *data)
+        {
+            setImage(0, width, height, format, data);
+        }
+
+        void setImage(int level, int width, int height, Format format, const void *data)
         {
+            if (isCompressed(internalFormat))
+            {
+                internalFormat = Format::rgba;
+            }
             bind();
             glTexImage2D(target,
-                         0, // mipmap level
+                         level,
                          glInternalFormat(internalFormat),
                          static_cast<GLsizei>(width),
                          static_cast<GLsizei>(height),
@@ -207,6 +318,35 @@ namespace applesauce
                          GL_UNSIGNED_BYTE,
                          data);
             unbind();
+            // Depth is 24 bits padded out to 32 by every driver
+            const auto bytes = static_cast<size_t>(width) * height * 4;
+            account(level, bytes, bytes);
+            if (level == 0)
+            {
+                replaceBase(width, height);
+            }
+        }
+
+        // Texels already in a block compressed format, which becomes the
+        // texture's format. size is the bytes of this level.
+        void setCompressedImage(int level, int width, int height, Format format, const void *data, size_t size)
+        {
+            internalFormat = format;
+            bind();
+            glCompressedTexImage2D(target,
+                                   level,
+                                   glInternalFormat(format),
+                                   static_cast<GLsizei>(width),
+                                   static_cast<GLsizei>(height),
+                                   0, // border always 0
+                                   static_cast<GLsizei>(size),
+                                   data);
+            unbind();
+            account(level, size, static_cast<size_t>(width) * height * 4);
+            if (level == 0)
+            {
+                replaceBase(width, height);
+            }
         }
 
         void setMinFilter(const Filter filter)
@@ -240,10 +380,64 @@ namespace applesauce
             bind();
             glGenerateMipmap(target);
             unbind();
+            // The driver makes every level down to 1x1 from level 0, in its
+            // format. Block compressed textures can't have them generated.
+            if (isCompressed(internalFormat))
+            {
+                return;
+            }
+            auto width = baseWidth;
+            auto height = baseHeight;
+            for (int level = 1; width > 1 || height > 1; level++)
+            {
+                width = std::max(width / 2, 1);
+                height = std::max(height / 2, 1);
+                const auto bytes = static_cast<size_t>(width) * height * 4;
+                account(level, bytes, bytes, true);
+            }
         }
 
     private:
+        struct LevelMemory
+        {
+            size_t bytes = 0;
+            size_t uncompressedBytes = 0;
+            // Made by generateMipmaps() rather than uploaded
+            bool generated = false;
+        };
+
+        void account(int level, size_t bytes, size_t uncompressedBytes, bool generated = false)
+        {
+            const auto index = static_cast<size_t>(level);
+            if (index >= levelMemory.size())
+            {
+                levelMemory.resize(index + 1);
+            }
+            auto &totals = memoryTotals();
+            totals.bytes = totals.bytes - levelMemory[index].bytes + bytes;
+            totals.uncompressedBytes = totals.uncompressedBytes - levelMemory[index].uncompressedBytes + uncompressedBytes;
+            levelMemory[index] = {bytes, uncompressedBytes, generated};
+        }
+
+        // Levels generated from the old level 0 are no longer counted, the
+        // new one gets its own when generateMipmaps() is called again
+        void replaceBase(int width, int height)
+        {
+            baseWidth = width;
+            baseHeight = height;
+            for (size_t level = 1; level < levelMemory.size(); level++)
+            {
+                if (levelMemory[level].generated)
+                {
+                    account(static_cast<int>(level), 0, 0);
+                }
+            }
+        }
+
         Format internalFormat;
+        std::vector<LevelMemory> levelMemory;
+        int baseWidth = 0;
+        int baseHeight = 0;
     };
 
     using Texture = Texture2D;
@@ -264,4 +458,21 @@ namespace applesauce
 
     std::shared_ptr<Texture> singleColorTexture(uint32_t color);
     std::shared_ptr<Texture> textureFromPNG(const char* filename);
+    // Uploads the baked mip chain, nullptr when the pack has no such texture
+    std::shared_ptr<Texture> textureFromPack(const AssetPack &pack, const std::string &name);
+    // A DDS or KTX2 file of BC1, BC3 or BC7 blocks, see CompressedImage.h.
+    // Throws std::runtime_error when the file can't be read or used.
+    std::shared_ptr<Texture> textureFromCompressedFile(const char *filename);
+
+    // Replace the contents of an existing texture, such as a placeholder
+    // handed out before its pixels were loaded. The image gets mipmaps made
+    // by the driver, the pack texture its baked ones. Returns false and leaves
+    // the texture alone when the image is empty or the pack has no such
+    // texture.
+    bool setTextureImage(Texture &texture, const Image &image);
+    bool setTextureFromPack(Texture &texture, const AssetPack &pack, const std::string &name);
+    // Every level as it is. A driver without BC1 or BC3 gets them decoded to
+    // RGBA instead, one without BC7 leaves the texture alone and returns
+    // false.
+    bool setTextureCompressed(Texture &texture, const CompressedImage &image);
 }
@@ -0,0 +1,215 @@
+#include "TextureAtlas.h"
+
+#include <util/Image.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace applesauce
+{
+    static bool isPowerOfTwo(uint32_t value)
+    {
+        return value != 0 && (value & (value - 1)) == 0;
+    }
+
+    static uint32_t roundUp(uint32_t value, uint32_t multiple)
+    {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+    static GLuint genGLTexture()
+    {
+        GLuint result;
+        glGenTextures(1, &result);
+        return result;
+    }
+
+    TextureAtlas::TextureAtlas(uint32_t layerSize, uint32_t layerCount, uint32_t padding)
+        : GLResource(genGLTexture()), size(layerSize), padding(padding), levelCount(0)
+    {
+        if (!isPowerOfTwo(layerSize) || !isPowerOfTwo(padding) || layerCount == 0)
+        {
+            auto id = glId();
+            glDeleteTextures(1, &id);
+            throw std::runtime_error("TextureAtlas: layer size and padding must be powers of two");
+        }
+        while (layerSize >> levelCount)
+        {
+            levelCount++;
+        }
+        atlasStats.layerCount = layerCount;
+
+        bind();
+        for (uint32_t level = 0; level < levelCount; level++)
+        {
+            const auto levelSize = static_cast<GLsizei>(size >> level);
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level), GL_RGBA8, levelSize, levelSize,
+                         static_cast<GLsizei>(layerCount), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levelCount - 1));
+        unbind();
+    }
+
+    TextureAtlas::~TextureAtlas()
+    {
+        auto id = glId();
+        glDeleteTextures(1, &id);
+    }
+
+    TextureAtlas::Entry TextureAtlas::add(const std::string &name, const Image &image, bool repeat)
+    {
+        if (const auto entry = find(name))
+        {
+            return *entry;
+        }
+        if (image.empty() || image.width > size || image.height > size)
+        {
+            throw std::runtime_error("TextureAtlas: \"" + name + "\" doesn't fit in a " + std::to_string(size) + " texel layer");
+        }
+
+        Entry entry;
+        if (repeat)
+        {
+            // Nearest texel, so a texture a power of two smaller only gets
+            // its texels repeated
+            Image resampled{size, size, std::vector<uint8_t>(static_cast<size_t>(size) * size * 4)};
+            for (uint32_t y = 0; y < size; y++)
+            {
+                const auto sourceY = static_cast<size_t>(y) * image.height / size;
+                for (uint32_t x = 0; x < size; x++)
+                {
+                    const auto sourceX = static_cast<size_t>(x) * image.width / size;
+                    std::copy_n(&image.pixels[(sourceY * image.width + sourceX) * 4], 4,
+                                &resampled.pixels[(static_cast<size_t>(y) * size + x) * 4]);
+                }
+            }
+            entry.layer = newLayer();
+            layers[entry.layer].whole = true;
+            uploadMips(entry.layer, 0, 0, resampled);
+            atlasStats.usedTexels += static_cast<size_t>(size) * size;
+        }
+        else
+        {
+            // The border repeats the edge texels, rounded out so that every
+            // block starts and ends on a multiple of the padding
+            const auto width = roundUp(image.width + 2 * padding, padding);
+            const auto height = roundUp(image.height + 2 * padding, padding);
+            Image padded{width, height, std::vector<uint8_t>(static_cast<size_t>(width) * height * 4)};
+            for (uint32_t y = 0; y < height; y++)
+            {
+                const auto sourceY = static_cast<size_t>(std::clamp<int64_t>(int64_t{y} - padding, 0, image.height - 1));
+                for (uint32_t x = 0; x < width; x++)
+                {
+                    const auto sourceX = static_cast<size_t>(std::clamp<int64_t>(int64_t{x} - padding, 0, image.width - 1));
+                    std::copy_n(&image.pixels[(sourceY * image.width + sourceX) * 4], 4,
+                                &padded.pixels[(static_cast<size_t>(y) * width + x) * 4]);
+                }
+            }
+
+            uint32_t x = 0, y = 0;
+            allocate(width, height, entry.layer, x, y);
+            uploadMips(entry.layer, x, y, padded);
+            const auto scale = 1.0f / static_cast<float>(size);
+            entry.rect = glm::vec4{static_cast<float>(x + padding) * scale, static_cast<float>(y + padding) * scale,
+                                   static_cast<float>(image.width) * scale, static_cast<float>(image.height) * scale};
+            atlasStats.usedTexels += static_cast<size_t>(image.width) * image.height;
+        }
+
+        entries[name] = entry;
+        atlasStats.entries++;
+        return entry;
+    }
+
+    const TextureAtlas::Entry *TextureAtlas::find(const std::string &name) const
+    {
+        const auto found = entries.find(name);
+        return found == entries.end() ? nullptr : &found->second;
+    }
+
+    void TextureAtlas::bind() const
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, glId());
+    }
+
+    void TextureAtlas::unbind() const
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+
+    uint32_t TextureAtlas::newLayer()
+    {
+        if (layers.size() == atlasStats.layerCount)
+        {
+            throw std::runtime_error("TextureAtlas: all " + std::to_string(atlasStats.layerCount) + " layers are taken");
+        }
+        layers.emplace_back();
+        atlasStats.layersUsed = layers.size();
+        atlasStats.layerTexels = layers.size() * size * size;
+        return static_cast<uint32_t>(layers.size() - 1);
+    }
+
+    void TextureAtlas::allocate(uint32_t width, uint32_t height, uint32_t &layer, uint32_t &x, uint32_t &y)
+    {
+        if (width > size || height > size)
+        {
+            throw std::runtime_error("TextureAtlas: " + std::to_string(width) + "x" + std::to_string(height) +
+                                     " with its border is larger than a layer");
+        }
+
+        for (uint32_t i = 0; i < layers.size(); i++)
+        {
+            auto &candidate = layers[i];
+            if (candidate.whole)
+                continue;
+
+            // The shortest shelf with room along it, so tall shelves are left
+            // for tall textures
+            Shelf *best = nullptr;
+            for (auto &shelf : candidate.shelves)
+            {
+                if (shelf.height >= height && size - shelf.x >= width && (!best || shelf.height < best->height))
+                    best = &shelf;
+            }
+            if (!best && size - candidate.top >= height)
+            {
+                candidate.shelves.push_back({candidate.top, height, 0});
+                candidate.top += height;
+                best = &candidate.shelves.back();
+            }
+            if (best)
+            {
+                layer = i;
+                x = best->x;
+                y = best->y;
+                best->x += width;
+                return;
+            }
+        }
+
+        layer = newLayer();
+        layers[layer].shelves.push_back({0, height, width});
+        layers[layer].top = height;
+        x = 0;
+        y = 0;
+    }
+
+    void TextureAtlas::uploadMips(uint32_t layer, uint32_t x, uint32_t y, const Image &image)
+    {
+        // Past the image's own 1x1 level, its last texel stands in for the
+        // coarser levels of the layer
+        const auto mips = generateMipChain(image);
+        bind();
+        for (uint32_t level = 0; level < levelCount; level++)
+        {
+            const auto &mip = mips[std::min<size_t>(level, mips.size() - 1)];
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level), static_cast<GLint>(x >> level),
+                            static_cast<GLint>(y >> level), static_cast<GLint>(layer), static_cast<GLsizei>(mip.width),
+                            static_cast<GLsizei>(mip.height), 1, GL_RGBA, GL_UNSIGNED_BYTE, mip.pixels.data());
+        }
+        unbind();
+    }
+}
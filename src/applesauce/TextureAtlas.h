@@ -0,0 +1,115 @@
+#pragma once
+
+#include "GLResource.h"
+
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Image;
+
+namespace applesauce
+{
+    // Many small textures in the layers of one GL_TEXTURE_2D_ARRAY, so that
+    // draws with different materials sample the same texture and nothing is
+    // bound between them.
+    //
+    // Textures that don't repeat are packed onto shelves, several to a layer,
+    // each with a border of its own edge texels so that filtering and the
+    // first few mips don't bleed into the neighbours. Texcoords in [0, 1] are
+    // moved into the entry's rect. Repeating textures get a whole layer,
+    // resampled to fill it, and keep their texcoords and GL_REPEAT as is.
+    class TextureAtlas : public GLResource
+    {
+    public:
+        struct Entry
+        {
+            uint32_t layer = 0;
+            // Texcoord offset in xy and scale in zw, (0, 0, 1, 1) for a whole layer
+            glm::vec4 rect{0.0f, 0.0f, 1.0f, 1.0f};
+        };
+
+        struct Stats
+        {
+            size_t entries = 0;
+            size_t layersUsed = 0;
+            size_t layerCount = 0;
+            // Texels of the entries themselves, without their borders,
+            // against every texel of the layers used
+            size_t usedTexels = 0;
+            size_t layerTexels = 0;
+
+            double occupancy() const
+            {
+                return layerTexels ? static_cast<double>(usedTexels) / layerTexels : 0.0;
+            }
+        };
+
+        // layerSize is the width and height of every layer, a power of two.
+        // padding is the border around packed entries, also a power of two,
+        // and the mips are exact down to the level it shrinks to one texel.
+        explicit TextureAtlas(uint32_t layerSize = 256, uint32_t layerCount = 4, uint32_t padding = 4);
+        ~TextureAtlas();
+
+        TextureAtlas(const TextureAtlas &) = delete;
+        TextureAtlas &operator=(const TextureAtlas &) = delete;
+
+        // Copies the image and its mips in. Adding a name again returns the
+        // entry it already has. Throws std::runtime_error when no layer has
+        // room or the image is larger than a layer.
+        Entry add(const std::string &name, const Image &image, bool repeat = false);
+
+        // nullptr when the name was never added
+        const Entry *find(const std::string &name) const;
+
+        void bind() const;
+        void unbind() const;
+
+        uint32_t layerSize() const
+        {
+            return size;
+        }
+
+        const Stats &stats() const
+        {
+            return atlasStats;
+        }
+
+    private:
+        struct Shelf
+        {
+            uint32_t y;
+            uint32_t height;
+            // Next free column
+            uint32_t x;
+        };
+
+        struct Layer
+        {
+            // Taken by one repeating texture
+            bool whole = false;
+            std::vector<Shelf> shelves;
+            // Below the last shelf
+            uint32_t top = 0;
+        };
+
+        // Index of a layer nothing has been put in yet
+        uint32_t newLayer();
+        // Finds room for a width x height block, already rounded to the
+        // padding, and returns its layer and corner
+        void allocate(uint32_t width, uint32_t height, uint32_t &layer, uint32_t &x, uint32_t &y);
+        void uploadMips(uint32_t layer, uint32_t x, uint32_t y, const Image &image);
+
+        uint32_t size;
+        uint32_t padding;
+        uint32_t levelCount;
+        std::vector<Layer> layers;
+        std::unordered_map<std::string, Entry> entries;
+
+        Stats atlasStats;
+    };
+}
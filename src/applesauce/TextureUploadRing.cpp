@@ -0,0 +1,183 @@
+#include "TextureUploadRing.h"
+
+#include <util/Image.h>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace applesauce
+{
+    // Spans start on a cache line, rows of RGBA texels are always 4 byte aligned
+    static constexpr size_t spanAlignment = 64;
+
+    static size_t levelBytes(const TextureUploadRing::Level &level)
+    {
+        return static_cast<size_t>(level.width) * level.height * 4;
+    }
+
+    static const void *bufferOffset(size_t offset)
+    {
+        return reinterpret_cast<const void *>(static_cast<uintptr_t>(offset));
+    }
+
+    TextureUploadRing::TextureUploadRing(size_t capacity) : size(capacity / spanAlignment * spanAlignment)
+    {
+        if (size == 0)
+        {
+            return;
+        }
+
+        glGenBuffers(1, &id);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, id);
+        persistent = (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) && glBufferStorage;
+        if (persistent)
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, flags);
+            mapped = static_cast<uint8_t *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size), flags));
+        }
+        else
+        {
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        if (persistent && !mapped)
+        {
+            throw std::runtime_error("Failed to map texture upload ring");
+        }
+    }
+
+    TextureUploadRing::~TextureUploadRing()
+    {
+        for (auto &span : spans)
+        {
+            glDeleteSync(span.fence);
+        }
+        if (id == 0)
+        {
+            return;
+        }
+        if (persistent)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, id);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &id);
+    }
+
+    void TextureUploadRing::upload(Texture &texture, const Level *levels, size_t count)
+    {
+        size_t total = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            total += levelBytes(levels[i]);
+        }
+
+        texture.setMinFilter(count > 1 ? Texture::Filter::linearMipMapLinear : Texture::Filter::linear);
+        texture.setMagFilter(Texture::Filter::linear);
+
+        ringStats.textures++;
+        ringStats.levels += count;
+        ringStats.bytes += total;
+
+        if (total > size)
+        {
+            ringStats.direct++;
+            for (size_t i = 0; i < count; i++)
+            {
+                texture.setImage(static_cast<int>(i), levels[i].width, levels[i].height, Texture::Format::rgba, levels[i].pixels);
+            }
+            return;
+        }
+
+        const auto offset = reserve(total);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, id);
+
+        // Nothing the GPU still reads is in the span, so it can be written
+        // without GL synchronizing
+        auto destination = mapped ? mapped + offset
+                                  : static_cast<uint8_t *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(total),
+                                                                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+        size_t cursor = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            const auto bytes = levelBytes(levels[i]);
+            if (destination)
+            {
+                std::memcpy(destination + cursor, levels[i].pixels, bytes);
+            }
+            else
+            {
+                glBufferSubData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLintptr>(offset + cursor), static_cast<GLsizeiptr>(bytes), levels[i].pixels);
+            }
+            cursor += bytes;
+        }
+        if (destination && !persistent)
+        {
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+
+        // With a buffer bound the pixel pointer is an offset into it
+        cursor = offset;
+        for (size_t i = 0; i < count; i++)
+        {
+            texture.setImage(static_cast<int>(i), levels[i].width, levels[i].height, Texture::Format::rgba, bufferOffset(cursor));
+            cursor += levelBytes(levels[i]);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        spans.push_back({offset, offset + total, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)});
+    }
+
+    void TextureUploadRing::upload(Texture &texture, const std::vector<Image> &mips)
+    {
+        std::vector<Level> levels;
+        levels.reserve(mips.size());
+        for (const auto &mip : mips)
+        {
+            levels.push_back({mip.width, mip.height, mip.pixels.data()});
+        }
+        upload(texture, levels.data(), levels.size());
+    }
+
+    size_t TextureUploadRing::reserve(size_t bytes)
+    {
+        bytes = (bytes + spanAlignment - 1) / spanAlignment * spanAlignment;
+
+        // Spans are queued in the order they follow head around the buffer, so
+        // the ones in the way are always at the front
+        if (head + bytes > size)
+        {
+            // Whatever is past head is older than anything at the start
+            while (!spans.empty() && spans.front().begin >= head)
+            {
+                retire(spans.front());
+                spans.pop_front();
+            }
+            head = 0;
+        }
+        while (!spans.empty() && spans.front().begin < head + bytes && spans.front().end > head)
+        {
+            retire(spans.front());
+            spans.pop_front();
+        }
+
+        const auto offset = head;
+        head += bytes;
+        return offset;
+    }
+
+    void TextureUploadRing::retire(Span &span)
+    {
+        // Spans come round again long after they were written, so this
+        // normally returns straight away
+        if (glClientWaitSync(span.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+        {
+            ringStats.waits++;
+            glClientWaitSync(span.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        }
+        glDeleteSync(span.fence);
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Texture.h"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+struct Image;
+
+namespace applesauce
+{
+    // Streams texels to GL through one pixel unpack buffer, so that
+    // glTexImage2D reads from GL memory and returns without copying out of
+    // client memory first.
+    //
+    // Each texture's levels are copied into the next free span of the buffer,
+    // which is fenced once its levels have been issued. A span is only
+    // written again after its fence, so a texture the GPU is still reading
+    // never gets overwritten and the driver never has to stall on it. With
+    // GL 4.4 or ARB_buffer_storage the buffer stays persistently mapped,
+    // otherwise each span is mapped unsynchronized for the copy.
+    //
+    // Only for the thread that owns the GL context.
+    class TextureUploadRing
+    {
+    public:
+        // Tightly packed 8 bit RGBA
+        struct Level
+        {
+            uint32_t width;
+            uint32_t height;
+            const void *pixels;
+        };
+
+        struct Stats
+        {
+            size_t textures = 0;
+            size_t levels = 0;
+            size_t bytes = 0;
+            // Times a span was still being read and the copy had to wait
+            size_t waits = 0;
+            // Textures larger than the whole ring, uploaded from client memory
+            size_t direct = 0;
+        };
+
+        // A capacity of 0 uploads everything from client memory
+        explicit TextureUploadRing(size_t capacity);
+        ~TextureUploadRing();
+
+        TextureUploadRing(const TextureUploadRing &) = delete;
+        TextureUploadRing &operator=(const TextureUploadRing &) = delete;
+
+        // Replaces the texture's levels, level 0 first, and sets linear
+        // filtering between them
+        void upload(Texture &texture, const Level *levels, size_t count);
+        void upload(Texture &texture, const std::vector<Image> &mips);
+
+        bool isPersistent() const
+        {
+            return persistent;
+        }
+
+        size_t capacity() const
+        {
+            return size;
+        }
+
+        GLuint glId() const
+        {
+            return id;
+        }
+
+        // Totals since the ring was made
+        const Stats &stats() const
+        {
+            return ringStats;
+        }
+
+    private:
+        struct Span
+        {
+            size_t begin;
+            size_t end;
+            GLsync fence;
+        };
+
+        // Offset of bytes free to write, waiting on older spans if need be
+        size_t reserve(size_t bytes);
+        void retire(Span &span);
+
+        GLuint id = 0;
+        size_t size = 0;
+        bool persistent = false;
+        uint8_t *mapped = nullptr;
+
+        size_t head = 0;
+        std::deque<Span> spans;
+
+        Stats ringStats;
+    };
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace applesauce
+{
+    // Hands values from one writer thread to one reader thread without either
+    // waiting on the other. The writer fills back() and publishes it; the
+    // reader picks up the latest published value with acquire(), skipping any
+    // it was too slow to see. The third slot sits in between the two.
+    template <typename T>
+    class TripleBuffer
+    {
+    public:
+        // Writer side
+        T &back()
+        {
+            return slots[backIndex];
+        }
+
+        void publish()
+        {
+            backIndex = middle.exchange(static_cast<uint8_t>(backIndex | fresh), std::memory_order_acq_rel) & indexMask;
+        }
+
+        // Reader side. Whether something was published since the last acquire()
+        bool hasNew() const
+        {
+            return middle.load(std::memory_order_acquire) & fresh;
+        }
+
+        // Swaps in the latest published value, returns false if there was none
+        bool acquire()
+        {
+            if (!hasNew())
+                return false;
+            frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & indexMask;
+            return true;
+        }
+
+        T &front()
+        {
+            return slots[frontIndex];
+        }
+
+        const T &front() const
+        {
+            return slots[frontIndex];
+        }
+
+    private:
+        static constexpr uint8_t fresh = 4;
+        static constexpr uint8_t indexMask = 3;
+
+        T slots[3];
+        uint8_t backIndex = 0;
+        std::atomic<uint8_t> middle{1};
+        uint8_t frontIndex = 2;
+    };
+}
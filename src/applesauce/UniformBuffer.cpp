@@ -0,0 +1,134 @@
+#include "UniformBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace applesauce
+{
+    UniformRing::UniformRing(size_t bytesPerFrame, GLuint binding) : binding(binding)
+    {
+        GLint alignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        if (alignment > 0)
+        {
+            offsetAlignment = static_cast<size_t>(alignment);
+        }
+        allocate(bytesPerFrame);
+    }
+
+    UniformRing::~UniformRing()
+    {
+        release();
+    }
+
+    void UniformRing::allocate(size_t bytes)
+    {
+        region = (bytes + offsetAlignment - 1) / offsetAlignment * offsetAlignment;
+
+        glGenBuffers(1, &id);
+        glBindBuffer(GL_UNIFORM_BUFFER, id);
+        const auto size = static_cast<GLsizeiptr>(region * framesInFlight);
+        persistent = (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) && glBufferStorage;
+        if (persistent)
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+            mapped = static_cast<uint8_t *>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags));
+        }
+        else
+        {
+            glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        if (persistent && !mapped)
+        {
+            throw std::runtime_error("Failed to map uniform ring");
+        }
+    }
+
+    void UniformRing::release()
+    {
+        for (auto &fence : fences)
+        {
+            if (fence)
+                glDeleteSync(fence);
+            fence = nullptr;
+        }
+        if (persistent && mapped)
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, id);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+        mapped = nullptr;
+        // GL keeps the storage until the draws that use it are done
+        glDeleteBuffers(1, &id);
+        id = 0;
+    }
+
+    void UniformRing::beginFrame()
+    {
+        frame = (frame + 1) % framesInFlight;
+        cursor = 0;
+        frameStats = {};
+
+        // The region was last written framesInFlight frames ago, so this
+        // normally returns straight away. Writing before the fence signals
+        // would change blocks the GPU may still be reading.
+        if (auto &fence = fences[frame])
+        {
+            auto status = glClientWaitSync(fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED)
+            {
+                frameStats.waits++;
+                do
+                {
+                    status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+                } while (status == GL_TIMEOUT_EXPIRED);
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    void UniformRing::endFrame()
+    {
+        fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    size_t UniformRing::write(const void *data, size_t size)
+    {
+        if (cursor + size > region)
+        {
+            // Nothing has been drawn from the new buffer, so this frame may
+            // use any of its regions and the fences go with the old one
+            release();
+            allocate(std::max(region * 2, size));
+            cursor = 0;
+            frameStats.grows++;
+        }
+        const size_t offset = frame * region + cursor;
+        if (persistent)
+        {
+            std::memcpy(mapped + offset, data, size);
+        }
+        else
+        {
+            // A plain upload, still one call per block instead of one per uniform
+            glBindBuffer(GL_UNIFORM_BUFFER, id);
+            glBufferSubData(GL_UNIFORM_BUFFER, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), data);
+        }
+        cursor += (size + offsetAlignment - 1) / offsetAlignment * offsetAlignment;
+
+        frameStats.blocks++;
+        frameStats.bytes += size;
+        return offset;
+    }
+
+    void UniformRing::bind(size_t offset, size_t size) const
+    {
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, id, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size));
+    }
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "Buffer.h"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace applesauce
+{
+    // A std140 uniform block that is rewritten whole, e.g. once per frame.
+    // T is a plain struct laid out to match the block in GLSL: vec3s padded
+    // out to vec4s, matrices as glm::mat4.
+    template <typename T>
+    class UniformBuffer : public Buffer
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Uniform blocks are copied byte for byte");
+        static_assert(sizeof(T) % 16 == 0, "std140 blocks are padded to a multiple of 16 bytes");
+
+    public:
+        UniformBuffer(GLuint binding) : Buffer(sizeof(T), Target::uniform, sizeof(T), Usage::streamDraw), binding(binding)
+        {
+        }
+
+        // Uploads the block and binds it to its binding point
+        void set(const T &block)
+        {
+            bind();
+            setSubData(0, sizeof(T), &block);
+            glBindBufferBase(GL_UNIFORM_BUFFER, binding, glId());
+        }
+
+        GLuint bindingPoint() const
+        {
+            return binding;
+        }
+
+    private:
+        const GLuint binding;
+    };
+
+    // Streams small uniform blocks that change between draws into one large
+    // buffer, binding each with glBindBufferRange instead of setting loose
+    // uniforms.
+    //
+    // The buffer is split into a region per frame in flight, each guarded by
+    // a fence. With GL 4.4 or ARB_buffer_storage it stays persistently mapped
+    // for its whole life and blocks are plain copies, otherwise each block is
+    // a glBufferSubData into the fenced region.
+    //
+    // A frame that runs out of room in its region moves to a new buffer with
+    // regions twice the size, and the ring stays that size from then on. The
+    // old buffer is released once the draws already issued from it are done.
+    //
+    // Usage per frame: beginFrame(), push() before each draw that needs its
+    // own block, endFrame() once the draws have been issued.
+    class UniformRing
+    {
+    public:
+        static constexpr size_t framesInFlight = 3;
+
+        struct Stats
+        {
+            size_t blocks = 0;
+            size_t bytes = 0;
+            // Times beginFrame() had to wait for the GPU to release a region
+            size_t waits = 0;
+            // Times the region was full and the ring grew
+            size_t grows = 0;
+        };
+
+    public:
+        UniformRing(size_t bytesPerFrame, GLuint binding);
+        ~UniformRing();
+
+        UniformRing(const UniformRing &) = delete;
+        UniformRing &operator=(const UniformRing &) = delete;
+
+        void beginFrame();
+        void endFrame();
+
+        // Copies the block into this frame's region and binds it, growing the
+        // ring when the region is full
+        template <typename T>
+        size_t push(const T &block)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "Uniform blocks are copied byte for byte");
+            const auto offset = write(&block, sizeof(T));
+            bind(offset, sizeof(T));
+            return offset;
+        }
+
+        size_t write(const void *data, size_t size);
+        void bind(size_t offset, size_t size) const;
+
+        bool isPersistent() const
+        {
+            return persistent;
+        }
+
+        // Offsets handed out are multiples of this
+        size_t alignment() const
+        {
+            return offsetAlignment;
+        }
+
+        size_t regionSize() const
+        {
+            return region;
+        }
+
+        GLuint glId() const
+        {
+            return id;
+        }
+
+        // Of the current or last frame
+        const Stats &stats() const
+        {
+            return frameStats;
+        }
+
+    private:
+        // A buffer of framesInFlight regions of bytes each, with no fences
+        void allocate(size_t bytes);
+        void release();
+
+        const GLuint binding;
+        GLuint id = 0;
+        size_t offsetAlignment = 256;
+        size_t region = 0;
+        bool persistent = false;
+
+        uint8_t *mapped = nullptr;
+        size_t frame = 0;
+        size_t cursor = 0;
+        GLsync fences[framesInFlight] = {};
+
+        Stats frameStats;
+    };
+}
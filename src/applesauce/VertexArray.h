@@ -13,6 +13,8 @@ namespace applesauce
         position = 0,
         normal,
         texcoord,
+        // A mat4 takes up four consecutive locations, one per column
+        modelMatrix,
     };
 
     struct VertexAttributeDescription
@@ -74,6 +76,23 @@ namespace applesauce
             _safeElementCount = buffer.elementCount();
         }
 
+        // Points the per-instance model matrix attribute at buffer, starting at
+        // byteOffset. Expects this vertex array to be bound and leaves buffer
+        // bound to GL_ARRAY_BUFFER.
+        void setInstanceMatrixBuffer(const applesauce::Buffer &buffer, size_t byteOffset) const
+        {
+            buffer.bindTo(Buffer::Target::vertex_array);
+
+            const auto firstIndex = static_cast<GLuint>(VertexAttribute::modelMatrix);
+            for (GLuint column = 0; column < 4; column++)
+            {
+                const auto offset = byteOffset + column * sizeof(GLfloat) * 4;
+                glVertexAttribPointer(firstIndex + column, 4, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 16, reinterpret_cast<void *>(offset));
+                glVertexAttribDivisor(firstIndex + column, 1);
+                glEnableVertexAttribArray(firstIndex + column);
+            }
+        }
+
         size_t safeElementCount() const
         {
             return _safeElementCount;
@@ -0,0 +1,81 @@
+// Offline asset bake. Converts every glTF and PNG under the asset directory
+// into a single pack that the game maps at startup instead of parsing JSON,
+// decoding base64 and PNGs.
+//
+//   asset_baker <asset directory> <output pack>
+
+#include "util/AssetPack.h"
+#include "util/Image.h"
+#include "util/gltf.h"
+
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static std::vector<fs::path> filesWithExtension(const fs::path &directory, const std::string &extension)
+{
+    std::vector<fs::path> result;
+    if (!fs::is_directory(directory))
+    {
+        return result;
+    }
+    for (const auto &entry : fs::directory_iterator(directory))
+    {
+        if (entry.is_regular_file() && entry.path().extension() == extension)
+        {
+            result.push_back(entry.path());
+        }
+    }
+    // Same input, same pack
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        std::cerr << "usage: asset_baker <asset directory> <output pack>" << std::endl;
+        return 1;
+    }
+    const fs::path assetDirectory(argv[1]);
+    const std::string output(argv[2]);
+
+    try
+    {
+        AssetPackWriter writer;
+        for (const auto &path : filesWithExtension(assetDirectory / "gltf", ".gltf"))
+        {
+            writer.addglTF(path.stem().string(), glTFFromFile(path.string().c_str()));
+            std::cout << "mesh    " << path.filename().string() << std::endl;
+        }
+
+        for (const auto &path : filesWithExtension(assetDirectory / "textures", ".png"))
+        {
+            const auto image = imageFromPNG(path.string().c_str());
+            if (image.empty())
+            {
+                throw std::runtime_error("Unable to read \"" + path.string() + "\"");
+            }
+            const auto mips = generateMipChain(image);
+            writer.addTexture(path.stem().string(), mips);
+            std::cout << "texture " << path.filename().string() << " " << image.width << "x" << image.height
+                      << ", " << mips.size() << " mips" << std::endl;
+        }
+
+        fs::create_directories(fs::absolute(output).parent_path());
+        writer.write(output);
+        std::cout << "wrote " << output << " (" << fs::file_size(output) << " bytes)" << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "asset_baker: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
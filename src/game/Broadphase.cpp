@@ -0,0 +1,37 @@
+#include "Broadphase.h"
+
+#include <algorithm>
+
+void SweepAndPrune::clear()
+{
+    entries.clear();
+}
+
+void SweepAndPrune::add(uint32_t id, const AABB &box)
+{
+    entries.push_back({box, id});
+}
+
+const std::vector<SweepAndPrune::Pair> &SweepAndPrune::findPairs()
+{
+    pairs.clear();
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &lhs, const Entry &rhs)
+              { return lhs.box.min.x < rhs.box.min.x; });
+
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        const auto &a = entries[i];
+        for (size_t j = i + 1; j < entries.size() && entries[j].box.min.x <= a.box.max.x; j++)
+        {
+            const auto &b = entries[j];
+            if (a.box.min.y <= b.box.max.y && a.box.max.y >= b.box.min.y)
+            {
+                pairs.emplace_back(std::min(a.id, b.id), std::max(a.id, b.id));
+            }
+        }
+    }
+
+    std::sort(pairs.begin(), pairs.end());
+    return pairs;
+}
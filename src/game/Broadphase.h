@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Collision.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Sort-and-sweep broadphase along x. Boxes are added each tick with an id of
+// the caller's choosing, findPairs() then reports every pair of boxes that
+// overlap, with the lower id first and the pairs sorted so results do not
+// depend on the order boxes were added in.
+class SweepAndPrune
+{
+public:
+    using Pair = std::pair<uint32_t, uint32_t>;
+
+    void clear();
+    void add(uint32_t id, const AABB &box);
+    const std::vector<Pair> &findPairs();
+
+    size_t size() const
+    {
+        return entries.size();
+    }
+
+private:
+    struct Entry
+    {
+        AABB box;
+        uint32_t id;
+    };
+
+    // Both are kept around between ticks so steady state does not allocate
+    std::vector<Entry> entries;
+    std::vector<Pair> pairs;
+};
@@ -3,10 +3,6 @@
 #include <glm/glm.hpp>
 #include <algorithm>
 #include <limits>
-#include <sstream>
-#include <string>
-
-#include <iostream>
 
 static Quad AABB2Quad(const AABB &aabb)
 {
@@ -50,7 +46,7 @@ bool checkCollision(const AABB &lhs, const AABB &rhs)
            (lhs.min.y <= rhs.max.y && lhs.max.y >= rhs.min.y);
 }
 
-static bool checkCollision(const AABB &aabb, const Quad &quad, glm::vec2 &normal, float &minOverlap)
+bool checkCollision(const AABB &aabb, const Quad &quad, glm::vec2 &normal, float &minOverlap)
 {
     Quad aabbQuad = AABB2Quad(aabb);
     return checkCollision(aabbQuad, quad, normal, minOverlap);
@@ -90,82 +86,4 @@ bool checkCollision(const Quad &lhs, const Quad &rhs, glm::vec2 &normal, float &
         std::swap(quadA, quadB);
     }
     return true;
-}
-
-bool TileMap::checkCollision(const Quad &boxQuad, glm::vec2 &ejectionVector)
-{
-    // Create an AABB from the boxQuad points
-    glm::vec2 minExtents = boxQuad.points[0];
-    glm::vec2 maxExtents = boxQuad.points[0];
-    for (size_t i = 1; i < 4; i++)
-    {
-        minExtents.x = std::min(minExtents.x, boxQuad.points[i].x);
-        minExtents.y = std::min(minExtents.y, boxQuad.points[i].y);
-        maxExtents.x = std::max(maxExtents.x, boxQuad.points[i].x);
-        maxExtents.y = std::max(maxExtents.y, boxQuad.points[i].y);
-    }
-    glm::vec2 boxCenter = (minExtents + maxExtents) / 2.0f;
-
-    auto minCoords = pointToTileCoordinates(minExtents);
-    auto maxCoords = pointToTileCoordinates(maxExtents);
-
-    ejectionVector = glm::vec2{0};
-    // Only check tiles overlapped
-
-    bool collisionDetected = false;
-    for (size_t i = maxCoords.second; i <= minCoords.second; i++)
-    {
-        for (size_t j = minCoords.first; j <= maxCoords.first; j++)
-        {
-            if (!isCollidable(j, i))
-                continue;
-
-            const auto tile = tileAABB(j, i);
-            float overlapAmount = 0;
-            glm::vec2 ejectionNormal;
-            if (!::checkCollision(tile, boxQuad, ejectionNormal, overlapAmount))
-                continue;
-            ejectionVector += glm::normalize(boxCenter - tile.center()) * overlapAmount;
-            collisionDetected = true;
-        }
-    }
-    return collisionDetected;
-}
-
-static std::vector<std::string> split(const std::string &s, char delimiter = '\n')
-{
-    std::vector<std::string> tokens;
-
-    std::stringstream ss(s);
-    std::string token;
-    while (std::getline(ss, token, delimiter))
-    {
-        tokens.push_back(token);
-    }
-    return tokens;
-}
-
-void prepareTileMap(const char *playField, TileMap &tm)
-{
-    auto lines = split(playField);
-
-    size_t maxColumns = 0;
-    for (const auto &line : lines)
-    {
-        maxColumns = std::max(maxColumns, line.size());
-    }
-    tm.tiles.reserve(lines.size());
-    for (const auto &line : lines)
-    {
-        std::vector<TileMap::Tile> row;
-        row.reserve(maxColumns);
-        for (const auto &character : line)
-        {
-            row.emplace_back(TileMap::Tile{character == '*'});
-        }
-        tm.tiles.emplace_back(std::move(row));
-    }
-
-    tm.center.x = static_cast<float>(tm.tiles[0].size()) * 0.5f * tm.tileSize;
-    tm.center.y = static_cast<float>(tm.tiles.size()) * 0.5f * tm.tileSize;
 }
\ No newline at end of file
@@ -0,0 +1,401 @@
+#include "GameWorld.h"
+
+#include "entities/Level.h"
+#include "entities/Tenk.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/vec4.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+const char *arenaPlayField = "********************************\n"
+                             "**                             *\n"
+                             "*                              *\n"
+                             "*              **              *\n"
+                             "*              **              *\n"
+                             "*              **              *\n"
+                             "*    **                  **    *\n"
+                             "*     *                  *     *\n"
+                             "*  T  *   ***      ***   *  T  *\n"
+                             "*     *   ***      ***   *     *\n"
+                             "*     *                  *     *\n"
+                             "*    **                  **    *\n"
+                             "*              **              *\n"
+                             "*              **              *\n"
+                             "*              **              *\n"
+                             "*                            ***\n"
+                             "*                            ***\n"
+                             "********************************";
+
+static Quad quadFromTransform(const glm::mat4 &modelMatrix, float size)
+{
+    float halfSize = size / 2.0f;
+    glm::vec4 upperLeft{-halfSize, 0, -halfSize, 1.0f};
+    glm::vec4 lowerLeft{-halfSize, 0, halfSize, 1.0f};
+    glm::vec4 lowerRight{halfSize, 0, halfSize, 1.0f};
+    glm::vec4 upperRight{halfSize, 0, -halfSize, 1.0f};
+
+    auto tfUpperLeft = modelMatrix * upperLeft;
+    auto tfLowerLeft = modelMatrix * lowerLeft;
+    auto tfLowerRight = modelMatrix * lowerRight;
+    auto tfUpperRight = modelMatrix * upperRight;
+
+    return {glm::vec2{tfUpperLeft.x, tfUpperLeft.z},
+            glm::vec2{tfLowerLeft.x, tfLowerLeft.z},
+            glm::vec2{tfLowerRight.x, tfLowerRight.z},
+            glm::vec2{tfUpperRight.x, tfUpperRight.z}};
+}
+
+static AABB aabbFromPosition(const glm::vec3 &position, float size)
+{
+    float halfSize = size / 2.0f;
+    return {{position.x - halfSize, position.z - halfSize},
+            {position.x + halfSize, position.z + halfSize}};
+}
+
+void GameWorld::load(const char *playField)
+{
+    prepareTileMap(playField, tm);
+
+    std::stringstream stream(playField);
+    std::string line;
+
+    int tankId = 0;
+    int row = 0;
+    int maxCol = -1;
+    while (std::getline(stream, line, '\n'))
+    {
+        int col = 0;
+        for (const auto &character : line)
+        {
+            const glm::vec3 position{col, 0, row};
+            switch (character)
+            {
+            case '*':
+                spawn(new Wall(), position);
+                break;
+            case 'T':
+                auto t = spawn(new Tenk(tankId++), position);
+                tenkList.push_back(std::dynamic_pointer_cast<Tenk>(t));
+                break;
+            }
+
+            col++;
+        }
+        maxCol = std::max(maxCol, col);
+        row++;
+    }
+
+    for (auto &position : store.positions)
+    {
+        position.x -= static_cast<float>(maxCol) / 2.0f;
+        position.z = (static_cast<float>(row - 1) - position.z) - static_cast<float>(row) / 2.0f;
+    }
+    applesauce::systems::buildModelMatrices(store);
+
+    arenaSize = {maxCol, row};
+}
+
+void GameWorld::loadLevel(const std::string &filename)
+{
+    auto level = std::make_unique<LevelFile>(filename);
+    const auto spawns = level->spawns();
+    arenaSize = {static_cast<int>(level->columns()), static_cast<int>(level->rows())};
+    tm.stream(std::move(level));
+
+    int tankId = 0;
+    for (const auto &point : spawns)
+    {
+        auto t = spawn(new Tenk(tankId++), tilePosition(point.column, point.row));
+        tenkList.push_back(std::dynamic_pointer_cast<Tenk>(t));
+    }
+
+    // Nothing may start moving before the tiles around it are in
+    streamTiles();
+    tm.waitForLoads();
+    updateChunkWalls();
+    applesauce::systems::buildModelMatrices(store);
+}
+
+void GameWorld::update(float dt)
+{
+    applesauce::Profiler::Scope updateScope(profiler, "World update");
+
+    if (tm.isStreaming())
+    {
+        applesauce::Profiler::Scope scope(profiler, "Tile streaming");
+        streamTiles();
+    }
+
+    store.removeDestroyed();
+
+    forEachRange(store.size(), [this](size_t begin, size_t end)
+                 { applesauce::systems::buildModelMatrices(store, begin, end); });
+
+    // Entities spawned by others are appended and updated this tick too.
+    // Spawning may reallocate the store, so hold on to the entity itself.
+    {
+        applesauce::Profiler::Scope scope(profiler, "Entities");
+        for (size_t i = 0; i < store.size(); i++)
+        {
+            if (auto entity = store.entities[i].get())
+            {
+                entity->update(dt);
+            }
+        }
+    }
+
+    {
+        applesauce::Profiler::Scope scope(profiler, "Move and wall collision");
+        deferring = true;
+        forEachRange(store.size(), [this, dt](size_t begin, size_t end)
+                     { moveAndCollideWithWalls(dt, begin, end); });
+        deferring = false;
+        applyCommands();
+    }
+
+    // Update modelMatrix of all entities in preparation for render
+    forEachRange(store.size(), [this](size_t begin, size_t end)
+                 { applesauce::systems::buildModelMatrices(store, begin, end); });
+
+    applesauce::Profiler::Scope collisionScope(profiler, "Entity collision");
+
+    // Only collidable entities take part, the static walls are handled by the tile map
+    collidables.clear();
+    broadphase.clear();
+    for (size_t i = 0; i < store.size(); i++)
+    {
+        if (store.colliders[i].enabled)
+        {
+            broadphase.add(static_cast<uint32_t>(collidables.size()), aabbFromPosition(store.positions[i], store.colliders[i].size));
+            collidables.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    for (const auto &[indexA, indexB] : broadphase.findPairs())
+    {
+        auto entA = store.entities[collidables[indexA]].get();
+        auto entB = store.entities[collidables[indexB]].get();
+        if (!entA || !entB)
+            continue;
+
+        // If either entity is the originator of the other, skip
+        if ((entA->originator != nullptr && entA->originator == entB) || (entB->originator != nullptr && entB->originator == entA))
+            continue;
+
+        // TODO: Different collision types
+        // The shell only needs to overlap on the AABB. Nothing more.
+        // Tank to tank is similar to tank to wall. The tanks should
+        // stop each other from penetrating.
+
+        // Figure out a better way of telling the tanks are bumping (maybe even just have them as a permenant pair)
+        if (dynamic_cast<Tenk *>(entA) && dynamic_cast<Tenk *>(entB))
+        {
+            Quad quadA = quadFromTransform(entA->modelMatrix(), entA->collider().size);
+            Quad quadB = quadFromTransform(entB->modelMatrix(), entB->collider().size);
+
+            float minOverlap = 0;
+            glm::vec2 normal;
+            if (checkCollision(quadA, quadB, normal, minOverlap))
+            {
+                glm::vec3 normal3{normal.x, 0, normal.y};
+                if (glm::dot(normal3, glm::normalize(entA->position() - entB->position())) > 0)
+                {
+                    normal3 = -normal3;
+                }
+                entA->position() -= normal3 * minOverlap * 0.5f;
+                entB->position() += normal3 * minOverlap * 0.5f;
+            }
+        }
+        entA->onTouch(*entB);
+        entB->onTouch(*entA);
+    }
+}
+
+std::shared_ptr<applesauce::Entity> GameWorld::spawn(std::shared_ptr<applesauce::Entity> entity, const glm::vec3 &position, const glm::quat &orientation)
+{
+    // From a worker, the entity is set up in that thread's staging store and
+    // only moved into the world once the phase is over
+    auto *target = &store;
+    std::unique_lock<std::mutex> lock;
+    if (deferring)
+    {
+        const auto thread = jobs ? jobs->threadIndex() : 0;
+        target = &stagingStores[thread];
+        commandBuffers[thread].push_back({currentSlots[thread], static_cast<uint32_t>(thread), static_cast<uint32_t>(target->size()), nullptr});
+        // init() may load resources, which is not thread safe
+        lock = std::unique_lock<std::mutex>(initMutex);
+    }
+
+    // Either may refer into the store, which add() can reallocate
+    const auto spawnPosition = position;
+    const auto spawnOrientation = orientation;
+
+    const auto slot = target->add(entity);
+    entity->world = this;
+    entity->init(resourceManager);
+    target->positions[slot] = spawnPosition;
+    target->orientations[slot] = spawnOrientation;
+    target->modelMatrices[slot] = glm::translate(glm::mat4{1.0f}, spawnPosition) * glm::mat4(spawnOrientation);
+    return entity;
+}
+
+void GameWorld::moveAndCollideWithWalls(float dt, size_t begin, size_t end)
+{
+    applesauce::systems::integrate(store, dt, begin, end);
+
+    // This is collision vs walls specifically. It uses the transform from the
+    // start of the tick, entities spawned since then have theirs from spawn().
+    const auto thread = jobs ? jobs->threadIndex() : 0;
+    for (size_t i = begin; i < end; i++)
+    {
+        const auto &collider = store.colliders[i];
+        if (!collider.enabled)
+            continue;
+
+        // A box exactly touching a tile collides with nothing to eject by,
+        // and normalizing that would turn the entity into NaNs
+        glm::vec2 ejectionVector;
+        if (tm.checkCollision(quadFromTransform(store.modelMatrices[i], collider.size), ejectionVector) &&
+            glm::dot(ejectionVector, ejectionVector) > 0.0f)
+        {
+            store.positions[i].x += ejectionVector.x;
+            store.positions[i].z += ejectionVector.y;
+
+            // TODO: This is not quite right as the ejection vector may be the sum of
+            // multiple ejections, but it should get us enough information to react
+            // nicely.
+            const auto normal = glm::normalize(ejectionVector);
+            if (auto entity = store.entities[i].get())
+            {
+                currentSlots[thread] = static_cast<uint32_t>(i);
+                entity->onTouch(glm::vec3(normal.x, 0, normal.y));
+            }
+        }
+    }
+}
+
+void GameWorld::streamTiles()
+{
+    // Chunks are kept around everything that can move into a wall
+    streamPoints.clear();
+    for (size_t i = 0; i < store.size(); i++)
+    {
+        if (store.colliders[i].enabled && !store.stationary[i])
+            streamPoints.push_back({store.positions[i].x, store.positions[i].z});
+    }
+    tm.streamAround(streamPoints.data(), streamPoints.size());
+    updateChunkWalls();
+}
+
+void GameWorld::updateChunkWalls()
+{
+    for (const auto chunk : tm.evictedChunks())
+    {
+        for (const auto id : chunkWalls[chunk])
+        {
+            uint32_t slot;
+            if (!store.findSlot(id, slot))
+                continue;
+            if (auto &wall = store.entities[slot])
+                wall->markDestroyed();
+            else
+                store.destroyed[slot] = 1;
+        }
+        chunkWalls.erase(chunk);
+    }
+    for (const auto chunk : tm.loadedChunks())
+    {
+        auto &walls = chunkWalls[chunk];
+        const auto [firstColumn, firstRow] = tm.chunkOrigin(chunk);
+        const auto lastColumn = std::min(firstColumn + tm.chunkSize(), tm.columns());
+        const auto lastRow = std::min(firstRow + tm.chunkSize(), tm.rows());
+        for (auto row = firstRow; row < lastRow; row++)
+        {
+            for (auto column = firstColumn; column < lastColumn; column++)
+            {
+                // Never deferred, so the wall is the last slot of the store
+                if (tm.isCollidable(column, row))
+                {
+                    spawn(new Wall(), tilePosition(column, row));
+                    walls.push_back(store.ids.back());
+                }
+            }
+        }
+    }
+}
+
+glm::vec3 GameWorld::tilePosition(uint32_t column, uint32_t row) const
+{
+    return {static_cast<float>(column) - static_cast<float>(arenaSize.columns) / 2.0f,
+            0,
+            static_cast<float>(arenaSize.rows - 1) - static_cast<float>(row) - static_cast<float>(arenaSize.rows) / 2.0f};
+}
+
+void GameWorld::applyCommands()
+{
+    // A slot is only ever handled by one thread, so sorting by slot alone
+    // keeps each slot's commands in the order they were issued
+    mergedCommands.clear();
+    for (auto &buffer : commandBuffers)
+    {
+        std::move(buffer.begin(), buffer.end(), std::back_inserter(mergedCommands));
+        buffer.clear();
+    }
+    std::stable_sort(mergedCommands.begin(), mergedCommands.end(),
+                     [](const EntityCommand &lhs, const EntityCommand &rhs)
+                     { return lhs.slot < rhs.slot; });
+
+    for (const auto &command : mergedCommands)
+    {
+        if (command.destroy)
+            command.destroy->markDestroyed();
+        else
+            store.take(stagingStores[command.thread], command.staged);
+    }
+    mergedCommands.clear();
+    for (auto &staging : stagingStores)
+    {
+        staging.clear();
+    }
+}
+
+void GameWorld::setJobSystem(applesauce::JobSystem *system)
+{
+    jobs = system;
+    const size_t threads = jobs ? jobs->threadCount() : 1;
+    commandBuffers.resize(threads);
+    stagingStores.resize(threads);
+    currentSlots.resize(threads);
+}
+
+void GameWorld::destroy(applesauce::Entity &entity)
+{
+    if (!deferring)
+    {
+        entity.markDestroyed();
+        return;
+    }
+    const auto thread = jobs ? jobs->threadIndex() : 0;
+    commandBuffers[thread].push_back({currentSlots[thread], static_cast<uint32_t>(thread), 0, &entity});
+}
+
+applesauce::SlabPool &GameWorld::entityPool(std::type_index type)
+{
+    // onTouch() may spawn on any worker while deferring, and the first spawn
+    // of a type adds its pool to the map
+    std::unique_lock<std::mutex> lock;
+    if (deferring)
+    {
+        lock = std::unique_lock<std::mutex>(initMutex);
+    }
+    auto &pool = entityPools[type];
+    if (!pool)
+    {
+        pool = std::make_unique<applesauce::SlabPool>();
+    }
+    return *pool;
+}
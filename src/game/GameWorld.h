@@ -0,0 +1,156 @@
+#pragma once
+
+#include "Broadphase.h"
+#include "Collision.h"
+#include "TileMap.h"
+
+#include <applesauce/Entity.h>
+#include <applesauce/EntityStore.h>
+#include <applesauce/JobSystem.h>
+#include <applesauce/Profiler.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+class Tenk;
+
+extern const char *arenaPlayField;
+
+// Owns the entities and runs the game rules for one fixed step at a time.
+// Nothing in here touches GL or the window, so it runs just as well headless
+// with an applesauce::NullResourceManager.
+//
+// With a job system, movement and collision against the tile map run over
+// ranges of slots on every thread. Entity::onTouch(normal) is then called on
+// a worker and may only change its own entity. spawn() and destroy() from
+// there are recorded and applied in slot order once the phase is over, so
+// the outcome does not depend on the number of threads; a spawned entity
+// can be set up straight away but only joins the world then.
+class GameWorld : public applesauce::IWorld
+{
+public:
+    using Entities = std::vector<std::shared_ptr<applesauce::Entity>>;
+
+    struct Size
+    {
+        int columns;
+        int rows;
+    };
+
+public:
+    GameWorld(applesauce::ResourceManager &resourceManager) : resourceManager(resourceManager) {}
+
+    // Builds the tile map and spawns walls and tanks from a play field, with
+    // the arena centered on the origin.
+    void load(const char *playField);
+
+    // Spawns the tanks of a level file and streams its tile map in around
+    // whatever moves. Walls are spawned and destroyed along with the chunk
+    // they are in. Throws std::runtime_error if the file can't be read.
+    void loadLevel(const std::string &filename);
+    void update(float dt);
+
+    // Spreads update() over the system's threads when set, may be null
+    void setJobSystem(applesauce::JobSystem *system);
+
+    // Times the stages of update() when set, may be null
+    void setProfiler(applesauce::Profiler *p)
+    {
+        profiler = p;
+    }
+
+    using IWorld::spawn;
+    std::shared_ptr<applesauce::Entity> spawn(std::shared_ptr<applesauce::Entity> entity, const glm::vec3 &position = glm::vec3{0}, const glm::quat &orientation = glm::quat{glm::vec3{0}}) override;
+
+    void destroy(applesauce::Entity &entity) override;
+
+    const Entities &entities() const
+    {
+        return store.entities;
+    }
+
+    // Component arrays of every entity, in the same order as entities()
+    const applesauce::EntityStore &components() const
+    {
+        return store;
+    }
+
+    const std::vector<std::shared_ptr<Tenk>> &tenks() const
+    {
+        return tenkList;
+    }
+
+    const TileMap &tileMap() const
+    {
+        return tm;
+    }
+
+    Size size() const
+    {
+        return arenaSize;
+    }
+
+protected:
+    applesauce::SlabPool &entityPool(std::type_index type) override;
+
+private:
+    struct EntityCommand
+    {
+        // Slot whose callback issued the command, the order they are applied in
+        uint32_t slot;
+        uint32_t thread;
+        // Spawns move this slot of the thread's staging store into the world
+        uint32_t staged;
+        applesauce::Entity *destroy;
+    };
+
+    template <typename Fn>
+    void forEachRange(size_t count, Fn &&fn)
+    {
+        if (jobs)
+            jobs->parallelFor(count, 1024, fn);
+        else if (count > 0)
+            fn(size_t{0}, count);
+    }
+
+    void moveAndCollideWithWalls(float dt, size_t begin, size_t end);
+    void streamTiles();
+    void updateChunkWalls();
+    glm::vec3 tilePosition(uint32_t column, uint32_t row) const;
+    void applyCommands();
+
+    applesauce::ResourceManager &resourceManager;
+
+    // Declared before the entities so that it is destroyed after them
+    std::unordered_map<std::type_index, std::unique_ptr<applesauce::SlabPool>> entityPools;
+
+    applesauce::EntityStore store;
+    std::vector<std::shared_ptr<Tenk>> tenkList;
+
+    TileMap tm;
+    Size arenaSize{0, 0};
+
+    // Streamed levels only, the store ids of the walls spawned for each
+    // resident chunk. Walls may be gone before their chunk, so they are
+    // looked up again rather than held on to.
+    std::vector<glm::vec2> streamPoints;
+    std::unordered_map<size_t, std::vector<uint64_t>> chunkWalls;
+
+    applesauce::Profiler *profiler = nullptr;
+    applesauce::JobSystem *jobs = nullptr;
+
+    // Per thread, filled while deferring
+    bool deferring = false;
+    std::vector<std::vector<EntityCommand>> commandBuffers{1};
+    std::vector<applesauce::EntityStore> stagingStores{1};
+    std::vector<uint32_t> currentSlots = std::vector<uint32_t>(1);
+    std::vector<EntityCommand> mergedCommands;
+    std::mutex initMutex;
+
+    SweepAndPrune broadphase;
+    std::vector<uint32_t> collidables;
+};
@@ -0,0 +1,154 @@
+#include "LevelFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+LevelFile::LevelFile(const std::string &filename) : file(filename, std::ios::binary)
+{
+    if (!file)
+    {
+        throw std::runtime_error("LevelFile: Unable to open \"" + filename + "\"");
+    }
+    file.seekg(0, std::ios::end);
+    const auto fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!file || header.magic != magic || header.version != version)
+    {
+        throw std::runtime_error("LevelFile: \"" + filename + "\" is not a version " + std::to_string(version) + " level");
+    }
+    if (header.chunkSize == 0 || header.columns == 0 || header.rows == 0)
+    {
+        throw std::runtime_error("LevelFile: \"" + filename + "\" has no tiles");
+    }
+
+    // Sized before anything is allocated for them, a damaged header could
+    // otherwise ask for gigabytes
+    const uint64_t spawnBytes = static_cast<uint64_t>(header.spawnCount) * sizeof(Spawn);
+    const uint64_t chunkCount = static_cast<uint64_t>(chunkColumns()) * chunkRows();
+    if (chunkCount > fileSize / sizeof(uint64_t) || sizeof(header) + spawnBytes + chunkCount * sizeof(uint64_t) > fileSize)
+    {
+        throw std::runtime_error("LevelFile: \"" + filename + "\" is truncated");
+    }
+
+    spawnPoints.resize(header.spawnCount);
+    file.read(reinterpret_cast<char *>(spawnPoints.data()), spawnPoints.size() * sizeof(Spawn));
+    chunkOffsets.resize(static_cast<size_t>(chunkColumns()) * chunkRows());
+    file.read(reinterpret_cast<char *>(chunkOffsets.data()), chunkOffsets.size() * sizeof(uint64_t));
+    if (!file)
+    {
+        throw std::runtime_error("LevelFile: \"" + filename + "\" is truncated");
+    }
+
+    const uint64_t chunkBytes = static_cast<uint64_t>(header.chunkSize) * header.chunkSize;
+    for (const auto offset : chunkOffsets)
+    {
+        if (offset != 0 && (offset > fileSize || chunkBytes > fileSize - offset))
+        {
+            throw std::runtime_error("LevelFile: \"" + filename + "\" has a chunk outside the file");
+        }
+    }
+}
+
+bool LevelFile::readChunk(size_t index, uint8_t *tiles)
+{
+    const size_t chunkBytes = static_cast<size_t>(header.chunkSize) * header.chunkSize;
+    const auto offset = chunkOffsets.at(index);
+    if (offset == 0)
+    {
+        std::memset(tiles, empty, chunkBytes);
+        return false;
+    }
+    file.seekg(static_cast<std::streamoff>(offset));
+    file.read(reinterpret_cast<char *>(tiles), static_cast<std::streamsize>(chunkBytes));
+    if (!file)
+    {
+        throw std::runtime_error("LevelFile: Unable to read chunk " + std::to_string(index));
+    }
+    return true;
+}
+
+LevelData parsePlayField(const char *playField)
+{
+    std::vector<std::string> lines;
+    std::stringstream stream(playField);
+    std::string line;
+    size_t maxColumns = 0;
+    while (std::getline(stream, line, '\n'))
+    {
+        maxColumns = std::max(maxColumns, line.size());
+        lines.push_back(line);
+    }
+
+    LevelData level;
+    level.resize(static_cast<uint32_t>(maxColumns), static_cast<uint32_t>(lines.size()));
+    for (uint32_t row = 0; row < level.rows; row++)
+    {
+        for (uint32_t column = 0; column < lines[row].size(); column++)
+        {
+            switch (lines[row][column])
+            {
+            case '*':
+                level.at(column, row) = LevelFile::wall;
+                break;
+            case 'T':
+                level.spawns.push_back({column, row});
+                break;
+            }
+        }
+    }
+    return level;
+}
+
+void writeLevelFile(const std::string &filename, const LevelData &level, uint32_t chunkSize)
+{
+    const uint32_t chunkColumns = (level.columns + chunkSize - 1) / chunkSize;
+    const uint32_t chunkRows = (level.rows + chunkSize - 1) / chunkSize;
+    const size_t chunkBytes = static_cast<size_t>(chunkSize) * chunkSize;
+
+    const LevelFile::Header header{LevelFile::magic, LevelFile::version, level.columns, level.rows, chunkSize,
+                                   static_cast<uint32_t>(level.spawns.size())};
+    std::vector<uint64_t> offsets(static_cast<size_t>(chunkColumns) * chunkRows, 0);
+    uint64_t end = sizeof(header) + level.spawns.size() * sizeof(LevelFile::Spawn) + offsets.size() * sizeof(uint64_t);
+
+    // Chunks are cut out of the rows first, so that empty ones can be left out
+    std::vector<uint8_t> chunks;
+    std::vector<uint8_t> chunk(chunkBytes);
+    for (uint32_t chunkRow = 0; chunkRow < chunkRows; chunkRow++)
+    {
+        for (uint32_t chunkColumn = 0; chunkColumn < chunkColumns; chunkColumn++)
+        {
+            std::fill(chunk.begin(), chunk.end(), LevelFile::empty);
+            bool isEmpty = true;
+            for (uint32_t y = 0; y < chunkSize && chunkRow * chunkSize + y < level.rows; y++)
+            {
+                const auto row = chunkRow * chunkSize + y;
+                const auto first = chunkColumn * chunkSize;
+                const auto count = std::min(chunkSize, level.columns - first);
+                const auto source = level.tiles.begin() + static_cast<ptrdiff_t>(static_cast<size_t>(row) * level.columns + first);
+                std::copy(source, source + count, chunk.begin() + static_cast<ptrdiff_t>(y * chunkSize));
+                isEmpty = isEmpty && std::all_of(source, source + count, [](uint8_t tile)
+                                                 { return tile == LevelFile::empty; });
+            }
+            if (isEmpty)
+                continue;
+
+            offsets[static_cast<size_t>(chunkRow) * chunkColumns + chunkColumn] = end;
+            chunks.insert(chunks.end(), chunk.begin(), chunk.end());
+            end += chunkBytes;
+        }
+    }
+
+    std::ofstream out(filename, std::ios::binary);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(level.spawns.data()), static_cast<std::streamsize>(level.spawns.size() * sizeof(LevelFile::Spawn)));
+    out.write(reinterpret_cast<const char *>(offsets.data()), static_cast<std::streamsize>(offsets.size() * sizeof(uint64_t)));
+    out.write(reinterpret_cast<const char *>(chunks.data()), static_cast<std::streamsize>(chunks.size()));
+    if (!out)
+    {
+        throw std::runtime_error("LevelFile: Unable to write \"" + filename + "\"");
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Tile grids on disk, cut into square chunks so that a level of any size can
+// be read a piece at a time. The header is followed by the spawn points and
+// then a table with the file offset of every chunk, row major, or 0 for a
+// chunk with nothing but empty tiles in it, which is not stored at all. A
+// stored chunk is chunkSize * chunkSize tiles of one byte each, row major.
+//
+// Rows count down from the top of the level, as in a play field string.
+class LevelFile
+{
+public:
+    static constexpr uint32_t magic = 0x4c56474c; // "LGVL"
+    static constexpr uint32_t version = 1;
+
+    // Tile values
+    static constexpr uint8_t empty = 0;
+    static constexpr uint8_t wall = 1;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t columns;
+        uint32_t rows;
+        uint32_t chunkSize;
+        uint32_t spawnCount;
+    };
+
+    // Where a tank starts, in tiles
+    struct Spawn
+    {
+        uint32_t column;
+        uint32_t row;
+    };
+
+    // Reads the header, spawns and chunk table, throws std::runtime_error if
+    // the file is missing, from another version or the table points outside
+    // of it. Chunks are read on demand.
+    explicit LevelFile(const std::string &filename);
+
+    uint32_t columns() const
+    {
+        return header.columns;
+    }
+
+    uint32_t rows() const
+    {
+        return header.rows;
+    }
+
+    uint32_t chunkSize() const
+    {
+        return header.chunkSize;
+    }
+
+    uint32_t chunkColumns() const
+    {
+        return (header.columns + header.chunkSize - 1) / header.chunkSize;
+    }
+
+    uint32_t chunkRows() const
+    {
+        return (header.rows + header.chunkSize - 1) / header.chunkSize;
+    }
+
+    const std::vector<Spawn> &spawns() const
+    {
+        return spawnPoints;
+    }
+
+    // Fills tiles with the chunkSize * chunkSize tiles of a chunk, where
+    // tiles past the edge of the level are empty. Returns false for a chunk
+    // that is all empty without reading anything. Not thread safe, the file
+    // has a single read position.
+    bool readChunk(size_t index, uint8_t *tiles);
+
+private:
+    std::ifstream file;
+    Header header{};
+    std::vector<Spawn> spawnPoints;
+    std::vector<uint64_t> chunkOffsets;
+};
+
+// A level with every tile in memory, for building and writing level files
+struct LevelData
+{
+    uint32_t columns = 0;
+    uint32_t rows = 0;
+    // Row major, LevelFile tile values
+    std::vector<uint8_t> tiles;
+    std::vector<LevelFile::Spawn> spawns;
+
+    void resize(uint32_t columnCount, uint32_t rowCount)
+    {
+        columns = columnCount;
+        rows = rowCount;
+        tiles.assign(static_cast<size_t>(columns) * rows, LevelFile::empty);
+    }
+
+    uint8_t &at(uint32_t column, uint32_t row)
+    {
+        return tiles[static_cast<size_t>(row) * columns + column];
+    }
+};
+
+// '*' is a wall and 'T' a tank, lines shorter than the longest are padded
+// with empty tiles
+LevelData parsePlayField(const char *playField);
+
+// Throws std::runtime_error when the file can't be written
+void writeLevelFile(const std::string &filename, const LevelData &level, uint32_t chunkSize = 64);
@@ -0,0 +1,371 @@
+#include "TileMap.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Evicted chunks keep their memory for the next load, up to this many
+static constexpr size_t maxSpareChunks = 64;
+
+const uint64_t TileMap::allWalls[defaultChunkSize] = {
+    ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull,
+    ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull,
+    ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull,
+    ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull};
+
+// Index of the lowest set bit, word must not be 0
+static unsigned lowestBit(uint64_t word)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(word));
+#endif
+}
+
+// Bits first to last, inclusive
+static uint64_t bitRange(unsigned first, unsigned last)
+{
+    return (~uint64_t{0} >> (63 - last)) & (~uint64_t{0} << first);
+}
+
+TileMap::~TileMap()
+{
+    stopLoading();
+}
+
+void TileMap::resize(uint32_t columns, uint32_t rows, uint32_t chunkSize)
+{
+    stopLoading();
+    level.reset();
+    setSize(columns, rows, chunkSize);
+    chunks.assign(static_cast<size_t>(chunkColumns) * chunkRowCount,
+                  Chunk{ChunkState::resident, 0, 0, std::vector<uint64_t>(chunkSize, 0)});
+    for (auto &chunk : chunks)
+    {
+        chunk.bits = chunk.rows.data();
+    }
+
+    mapStats = {};
+    mapStats.residentChunks = chunks.size();
+    mapStats.residentBytes = chunks.size() * chunkSize * sizeof(uint64_t);
+}
+
+void TileMap::stream(std::unique_ptr<LevelFile> levelFile, int nearRadius, int farRadius)
+{
+    stopLoading();
+    setSize(levelFile->columns(), levelFile->rows(), levelFile->chunkSize());
+    chunks.assign(static_cast<size_t>(chunkColumns) * chunkRowCount, Chunk{});
+    mapStats = {};
+
+    level = std::move(levelFile);
+    loadRadius = nearRadius;
+    evictRadius = std::max(farRadius, nearRadius);
+    streamCount = 0;
+    loader = std::thread([this]()
+                         { loaderMain(); });
+}
+
+void TileMap::setSize(uint32_t columns, uint32_t rows, uint32_t chunkSize)
+{
+    if (chunkSize == 0 || chunkSize > 64 || (chunkSize & (chunkSize - 1)) != 0)
+    {
+        throw std::runtime_error("TileMap: Chunks of " + std::to_string(chunkSize) + " tiles are not a power of two that fits in a word");
+    }
+    columnCount = columns;
+    rowCount = rows;
+    chunkTiles = chunkSize;
+    chunkShift = lowestBit(chunkSize);
+    chunkColumns = (columns + chunkSize - 1) / chunkSize;
+    chunkRowCount = (rows + chunkSize - 1) / chunkSize;
+    center = glm::vec2{static_cast<float>(columns), static_cast<float>(rows)} * 0.5f * static_cast<float>(tileSize);
+}
+
+void TileMap::streamAround(const glm::vec2 *points, size_t count)
+{
+    loaded.clear();
+    evicted.clear();
+    if (!level)
+        return;
+
+    takeFinishedLoads();
+
+    // Only the chunks that hold a point, once each. Points off the map count
+    // as being at its edge.
+    streamCount++;
+    nearChunks.clear();
+    for (size_t i = 0; i < count; i++)
+    {
+        const auto x = std::clamp(std::floor(points[i].x + center.x + 0.5f), 0.0f, static_cast<float>(columnCount - 1));
+        const auto y = std::clamp(std::floor(static_cast<float>(rowCount) - (points[i].y + center.y + 0.5f)), 0.0f, static_cast<float>(rowCount - 1));
+        const auto index = chunkIndex(x, y);
+        if (chunks[index].holdsPoint != streamCount)
+        {
+            chunks[index].holdsPoint = streamCount;
+            nearChunks.push_back(index);
+        }
+    }
+
+    const auto now = Clock::now();
+    bool requested = false;
+    for (const auto near : nearChunks)
+    {
+        const auto nearColumn = static_cast<int>(near % chunkColumns);
+        const auto nearRow = static_cast<int>(near / chunkColumns);
+        for (int row = std::max(0, nearRow - evictRadius); row <= std::min(static_cast<int>(chunkRowCount) - 1, nearRow + evictRadius); row++)
+        {
+            for (int column = std::max(0, nearColumn - evictRadius); column <= std::min(static_cast<int>(chunkColumns) - 1, nearColumn + evictRadius); column++)
+            {
+                const auto index = static_cast<size_t>(row) * chunkColumns + static_cast<size_t>(column);
+                auto &chunk = chunks[index];
+                chunk.wanted = streamCount;
+                if (chunk.state != ChunkState::missing || std::abs(row - nearRow) > loadRadius || std::abs(column - nearColumn) > loadRadius)
+                    continue;
+
+                std::lock_guard<std::mutex> lock(loadMutex);
+                Load load{index, now, {}};
+                if (!spareRows.empty())
+                {
+                    load.rows = std::move(spareRows.back());
+                    spareRows.pop_back();
+                }
+                requests.push_back(std::move(load));
+                inFlight++;
+                chunk.state = ChunkState::pending;
+                requested = true;
+            }
+        }
+    }
+    if (requested)
+    {
+        loadRequested.notify_one();
+    }
+
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        if (chunks[i].state == ChunkState::resident && chunks[i].wanted != streamCount)
+        {
+            evict(i);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(loadMutex);
+    mapStats.pendingChunks = inFlight;
+}
+
+void TileMap::waitForLoads()
+{
+    loaded.clear();
+    evicted.clear();
+    if (!level)
+        return;
+    {
+        std::unique_lock<std::mutex> lock(loadMutex);
+        loadFinished.wait(lock, [this]()
+                          { return inFlight == 0; });
+    }
+    takeFinishedLoads();
+    mapStats.pendingChunks = 0;
+}
+
+void TileMap::setCollidable(size_t x, size_t y, bool collidable)
+{
+    if (x >= columnCount || y >= rowCount)
+    {
+        throw std::out_of_range("TileMap: Tile " + std::to_string(x) + ", " + std::to_string(y) + " is off the map");
+    }
+    auto &chunk = chunks[chunkIndex(x, y)];
+    if (chunk.state != ChunkState::resident)
+    {
+        throw std::runtime_error("TileMap: Tile " + std::to_string(x) + ", " + std::to_string(y) + " is not resident");
+    }
+    const auto bit = uint64_t{1} << (x & (chunkTiles - 1));
+    auto &row = chunk.rows[y & (chunkTiles - 1)];
+    row = collidable ? row | bit : row & ~bit;
+}
+
+void TileMap::stopLoading()
+{
+    if (loader.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(loadMutex);
+            stopping = true;
+        }
+        loadRequested.notify_one();
+        loader.join();
+    }
+    requests.clear();
+    finished.clear();
+    inFlight = 0;
+    stopping = false;
+}
+
+void TileMap::loaderMain()
+{
+    // Level files have a byte per tile
+    std::vector<uint8_t> tiles(static_cast<size_t>(chunkTiles) * chunkTiles);
+
+    std::unique_lock<std::mutex> lock(loadMutex);
+    while (true)
+    {
+        loadRequested.wait(lock, [this]()
+                           { return stopping || !requests.empty(); });
+        if (stopping)
+            return;
+
+        auto load = std::move(requests.front());
+        requests.pop_front();
+        lock.unlock();
+
+        try
+        {
+            level->readChunk(load.chunk, tiles.data());
+        }
+        catch (const std::runtime_error &e)
+        {
+            // Walled off rather than open, so nothing falls out of the level
+            std::cout << e.what() << std::endl;
+            std::fill(tiles.begin(), tiles.end(), LevelFile::wall);
+        }
+        load.rows.assign(chunkTiles, 0);
+        for (uint32_t y = 0; y < chunkTiles; y++)
+        {
+            for (uint32_t x = 0; x < chunkTiles; x++)
+            {
+                if (tiles[y * chunkTiles + x] != LevelFile::empty)
+                    load.rows[y] |= uint64_t{1} << x;
+            }
+        }
+
+        lock.lock();
+        finished.push_back(std::move(load));
+        inFlight--;
+        loadFinished.notify_all();
+    }
+}
+
+void TileMap::takeFinishedLoads()
+{
+    std::lock_guard<std::mutex> lock(loadMutex);
+    const auto now = Clock::now();
+    for (auto &load : finished)
+    {
+        auto &chunk = chunks[load.chunk];
+        chunk.rows = std::move(load.rows);
+        chunk.bits = chunk.rows.data();
+        chunk.state = ChunkState::resident;
+        loaded.push_back(load.chunk);
+
+        const std::chrono::duration<double> latency = now - load.requested;
+        mapStats.chunksLoaded++;
+        mapStats.residentChunks++;
+        mapStats.residentBytes += chunk.rows.size() * sizeof(uint64_t);
+        mapStats.loadSeconds += latency.count();
+        mapStats.maxLoadSeconds = std::max(mapStats.maxLoadSeconds, latency.count());
+    }
+    finished.clear();
+}
+
+void TileMap::evict(size_t index)
+{
+    auto &chunk = chunks[index];
+    mapStats.chunksEvicted++;
+    mapStats.residentChunks--;
+    mapStats.residentBytes -= chunk.rows.size() * sizeof(uint64_t);
+    {
+        std::lock_guard<std::mutex> lock(loadMutex);
+        if (spareRows.size() < maxSpareChunks)
+            spareRows.push_back(std::move(chunk.rows));
+    }
+    chunk.rows = {};
+    chunk.bits = allWalls;
+    chunk.state = ChunkState::missing;
+    evicted.push_back(index);
+}
+
+bool TileMap::checkCollision(const Quad &boxQuad, glm::vec2 &ejectionVector) const
+{
+    // Create an AABB from the boxQuad points
+    glm::vec2 minExtents = boxQuad.points[0];
+    glm::vec2 maxExtents = boxQuad.points[0];
+    for (size_t i = 1; i < 4; i++)
+    {
+        minExtents.x = std::min(minExtents.x, boxQuad.points[i].x);
+        minExtents.y = std::min(minExtents.y, boxQuad.points[i].y);
+        maxExtents.x = std::max(maxExtents.x, boxQuad.points[i].x);
+        maxExtents.y = std::max(maxExtents.y, boxQuad.points[i].y);
+    }
+    glm::vec2 boxCenter = (minExtents + maxExtents) / 2.0f;
+
+    ejectionVector = glm::vec2{0};
+
+    // Only check tiles overlapped, and only those on the map. Once off-map
+    // boxes are out, truncating floors what is left to clamp.
+    const float left = minExtents.x + center.x + 0.5f;
+    const float right = maxExtents.x + center.x + 0.5f;
+    const float top = static_cast<float>(rowCount) - (maxExtents.y + center.y + 0.5f);
+    const float bottom = static_cast<float>(rowCount) - (minExtents.y + center.y + 0.5f);
+    if (!(right >= 0.0f && bottom >= 0.0f && left < static_cast<float>(columnCount) && top < static_cast<float>(rowCount)))
+        return false;
+
+    // Each row is masked down to the columns overlapped a chunk at a time, and
+    // only the walls left in the word are tested. Same order as a plain scan,
+    // so the ejection adds up the same.
+    const auto first = left > 0.0f ? static_cast<size_t>(left) : 0;
+    const auto last = right < static_cast<float>(columnCount) ? static_cast<size_t>(right) : columnCount - size_t{1};
+    const auto firstRow = top > 0.0f ? static_cast<size_t>(top) : 0;
+    const auto lastRow = bottom < static_cast<float>(rowCount) ? static_cast<size_t>(bottom) : rowCount - size_t{1};
+    const float halfTile = tileSize * 0.5f;
+    bool collisionDetected = false;
+    for (auto i = firstRow; i <= lastRow; i++)
+    {
+        const float tileMinY = static_cast<float>(((rowCount - 1) - i) * tileSize) - halfTile - center.y;
+        const auto rowInChunk = i & (chunkTiles - 1);
+        for (auto chunkStart = first & ~size_t{chunkTiles - 1}; chunkStart <= last; chunkStart += chunkTiles)
+        {
+            const auto begin = static_cast<unsigned>(std::max(first, chunkStart) - chunkStart);
+            const auto end = static_cast<unsigned>(std::min(last, chunkStart + chunkTiles - 1) - chunkStart);
+            auto walls = rowBits(chunks[chunkIndex(chunkStart, i)], rowInChunk) & bitRange(begin, end);
+            while (walls)
+            {
+                const auto j = chunkStart + lowestBit(walls);
+                walls &= walls - 1;
+
+                const float tileMinX = static_cast<float>(j * tileSize) - halfTile - center.x;
+                const AABB tile{{tileMinX, tileMinY}, {tileMinX + tileSize, tileMinY + tileSize}};
+                float overlapAmount = 0;
+                glm::vec2 ejectionNormal;
+                if (!::checkCollision(tile, boxQuad, ejectionNormal, overlapAmount))
+                    continue;
+                ejectionVector += glm::normalize(boxCenter - tile.center()) * overlapAmount;
+                collisionDetected = true;
+            }
+        }
+    }
+    return collisionDetected;
+}
+
+void prepareTileMap(const char *playField, TileMap &tm)
+{
+    const auto level = parsePlayField(playField);
+    tm.resize(level.columns, level.rows);
+    for (uint32_t row = 0; row < level.rows; row++)
+    {
+        for (uint32_t column = 0; column < level.columns; column++)
+        {
+            if (level.tiles[static_cast<size_t>(row) * level.columns + column] == LevelFile::wall)
+                tm.setCollidable(column, row, true);
+        }
+    }
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include "Collision.h"
+#include "LevelFile.h"
+
+#include <glm/vec2.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// The walls of a level as a grid of tiles, centered on the origin with rows
+// counting down from +y. Tiles live in square chunks, so that a level far
+// larger than memory needs only hold the chunks around what is moving. A
+// chunk is a bitset, one 64 bit word per row with the first column in the
+// lowest bit, and collision queries test a whole row of tiles at once.
+//
+// A map built in memory has every chunk resident. A streamed one starts with
+// none: streamAround() asks a loader thread for the chunks near a set of
+// points, takes in what it has finished and drops chunks that are far from
+// all of them. Tiles of a chunk that is not resident count as walls, so
+// nothing can move into a part of the level that is not there yet.
+class TileMap
+{
+public:
+    // Also the largest, so that a row of a chunk fits in a word. Chunk sizes
+    // are powers of two, to find a tile's chunk with shifts.
+    static constexpr uint32_t defaultChunkSize = 64;
+
+    struct Stats
+    {
+        size_t residentChunks = 0;
+        size_t pendingChunks = 0;
+        size_t residentBytes = 0;
+        // Totals since streaming started
+        size_t chunksLoaded = 0;
+        size_t chunksEvicted = 0;
+        // From asking for a chunk to it being resident
+        double loadSeconds = 0;
+        double maxLoadSeconds = 0;
+    };
+
+    TileMap() = default;
+    ~TileMap();
+
+    TileMap(const TileMap &) = delete;
+    TileMap &operator=(const TileMap &) = delete;
+
+    // An empty map with every chunk resident, centered on the origin. Stops
+    // any streaming. Throws std::runtime_error for a chunk size that is not a
+    // power of two up to 64.
+    void resize(uint32_t columns, uint32_t rows, uint32_t chunkSize = defaultChunkSize);
+
+    // Takes the size from the level, with no chunks resident until
+    // streamAround() brings them in. Chunks within loadRadius chunks of a
+    // point are loaded, ones further than evictRadius from every point are
+    // dropped.
+    void stream(std::unique_ptr<LevelFile> level, int loadRadius = 1, int evictRadius = 2);
+
+    bool isStreaming() const
+    {
+        return level != nullptr;
+    }
+
+    // Call between ticks, never while collision queries run on other threads
+    void streamAround(const glm::vec2 *points, size_t count);
+
+    // Blocks until every chunk asked for is resident
+    void waitForLoads();
+
+    // Chunks that became resident or were dropped in the last streamAround()
+    // or waitForLoads()
+    const std::vector<size_t> &loadedChunks() const
+    {
+        return loaded;
+    }
+
+    const std::vector<size_t> &evictedChunks() const
+    {
+        return evicted;
+    }
+
+    uint32_t columns() const
+    {
+        return columnCount;
+    }
+
+    uint32_t rows() const
+    {
+        return rowCount;
+    }
+
+    uint32_t chunkSize() const
+    {
+        return chunkTiles;
+    }
+
+    size_t chunkCount() const
+    {
+        return chunks.size();
+    }
+
+    // Tile coordinates of a chunk's top left tile
+    std::pair<uint32_t, uint32_t> chunkOrigin(size_t chunk) const
+    {
+        return {static_cast<uint32_t>(chunk % chunkColumns) * chunkTiles, static_cast<uint32_t>(chunk / chunkColumns) * chunkTiles};
+    }
+
+    bool isResident(size_t chunk) const
+    {
+        return chunks[chunk].state == ChunkState::resident;
+    }
+
+    // Outside the map there is nothing to collide with
+    bool isCollidable(size_t x, size_t y) const
+    {
+        if (x >= columnCount || y >= rowCount)
+            return false;
+        return (rowBits(chunks[chunkIndex(x, y)], y & (chunkTiles - 1)) >> (x & (chunkTiles - 1))) & 1;
+    }
+
+    // Only for resident chunks, throws std::out_of_range for tiles off the map
+    void setCollidable(size_t x, size_t y, bool collidable);
+
+    AABB tileAABB(size_t x, size_t y) const
+    {
+        y = (rowCount - 1) - y;
+        glm::vec2 min = glm::vec2{static_cast<float>(x * tileSize) - tileSize * 0.5f, static_cast<float>(y * tileSize) - tileSize * 0.5f} - center;
+        glm::vec2 max = glm::vec2{min.x + tileSize, min.y + tileSize};
+        return {min, max};
+    }
+
+    // Given a point, return tile coordinates
+    std::pair<size_t, size_t> pointToTileCoordinates(glm::vec2 point) const
+    {
+        glm::vec2 adjustedPoint = point + center + glm::vec2{0.5f, 0.5f};
+
+        return {static_cast<size_t>(adjustedPoint.x), static_cast<size_t>(rowCount - adjustedPoint.y)};
+    }
+
+    bool checkCollision(const Quad &quad, glm::vec2 &ejectionVector) const;
+
+    const Stats &stats() const
+    {
+        return mapStats;
+    }
+
+    glm::vec2 center{0};
+    int tileSize = 1.0f;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    enum class ChunkState : uint8_t
+    {
+        missing,
+        pending,
+        resident
+    };
+
+    // What a chunk that is not resident reads as
+    static const uint64_t allWalls[defaultChunkSize];
+
+    struct Chunk
+    {
+        ChunkState state = ChunkState::missing;
+        // Last streamAround() that wanted it, and that had a point in it
+        uint32_t wanted = 0;
+        uint32_t holdsPoint = 0;
+        // One word per row of tiles, a set bit is a wall
+        std::vector<uint64_t> rows;
+        // The rows while resident, otherwise allWalls
+        const uint64_t *bits = allWalls;
+    };
+
+    struct Load
+    {
+        size_t chunk;
+        Clock::time_point requested;
+        std::vector<uint64_t> rows;
+    };
+
+    static uint64_t rowBits(const Chunk &chunk, size_t row)
+    {
+        return chunk.bits[row];
+    }
+
+    size_t chunkIndex(size_t x, size_t y) const
+    {
+        return (y >> chunkShift) * chunkColumns + (x >> chunkShift);
+    }
+
+    void setSize(uint32_t columns, uint32_t rows, uint32_t chunkSize);
+    void stopLoading();
+    void loaderMain();
+    void takeFinishedLoads();
+    void evict(size_t chunk);
+
+    uint32_t columnCount = 0;
+    uint32_t rowCount = 0;
+    uint32_t chunkTiles = defaultChunkSize;
+    uint32_t chunkShift = 6;
+    uint32_t chunkColumns = 0;
+    uint32_t chunkRowCount = 0;
+    std::vector<Chunk> chunks;
+
+    // Streaming, the queues and spare buffers are shared with the loader
+    std::unique_ptr<LevelFile> level;
+    int loadRadius = 1;
+    int evictRadius = 2;
+    uint32_t streamCount = 0;
+    std::vector<size_t> nearChunks;
+    std::vector<size_t> loaded;
+    std::vector<size_t> evicted;
+
+    std::thread loader;
+    std::mutex loadMutex;
+    std::condition_variable loadRequested;
+    std::condition_variable loadFinished;
+    std::deque<Load> requests;
+    std::vector<Load> finished;
+    std::vector<std::vector<uint64_t>> spareRows;
+    size_t inFlight = 0;
+    bool stopping = false;
+
+    Stats mapStats;
+};
+
+void prepareTileMap(const char *playField, TileMap &tm);
@@ -1,10 +1,13 @@
+#pragma once
+
 #include <applesauce/Entity.h>
 
 class Wall : public applesauce::Entity
 {
     void init(applesauce::ResourceManager &rm)
     {
-        mesh = rm.getMesh("Wall");
+        mesh() = rm.getMesh("Wall");
+        setStationary(true);
     }
     void update(float)
     {
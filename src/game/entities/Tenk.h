@@ -3,20 +3,21 @@
 #include <applesauce/Input.h>
 #include <applesauce/Entity.h>
 
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
 #include "glm/gtx/string_cast.hpp"
 
+#include <iostream>
+
 class Shell : public applesauce::Entity
 {
 public:
     void init(applesauce::ResourceManager &rm) override
     {
-        mesh = rm.getMesh("TinyBox");
-        collidable = true;
-        collisionSize = 0.25;
-    }
-    void update(float dt) override
-    {
-        position += velocity * dt;
+        mesh() = rm.getMesh("TinyBox");
+        collider() = {true, 0.25f};
+        setKinematic(true);
     }
 
     void onTouch(const glm::vec3 &) override
@@ -43,11 +44,11 @@ public:
             Shell::onTouch(normal);
         }
         // "bounce"
-        std::cout << "Old Velocity" << glm::to_string(velocity) << std::endl;
-        velocity = glm::reflect(velocity, normal);
-        std::cout << "New Velocity" << glm::to_string(velocity) << std::endl;
+        std::cout << "Old Velocity" << glm::to_string(velocity()) << std::endl;
+        velocity() = glm::reflect(velocity(), normal);
+        std::cout << "New Velocity" << glm::to_string(velocity()) << std::endl;
         // nudge it out a bit.
-        position += velocity * 0.1f;
+        position() += velocity() * 0.1f;
         bounceCount--;
     }
 };
@@ -72,9 +73,9 @@ public:
 
     void init(applesauce::ResourceManager &rm) override
     {
-        mesh = rm.getMesh("Tenk");
-        collidable = true;
-        collisionSize = 1.7f;
+        mesh() = rm.getMesh("Tenk");
+        collider() = {true, 1.7f};
+        setKinematic(true);
         spinOutTimer = 0.0f;
     }
     void update(float dt) override
@@ -87,7 +88,7 @@ public:
         }
         else
         {
-            velocity = glm::vec3{0};
+            velocity() = glm::vec3{0};
             float speed = 6.0f;
             if (applesauce::Input::isPressed(leftKey))
             {
@@ -101,32 +102,28 @@ public:
             bool backingUp = false;
             if (applesauce::Input::isPressed(forwardKey))
             {
-                glm::vec3 direction = glm::mat3(orientation) * glm::vec3{0, 0, -1.0f};
-                velocity = direction * speed;
+                glm::vec3 direction = glm::mat3(orientation()) * glm::vec3{0, 0, -1.0f};
+                velocity() = direction * speed;
             }
             else if (applesauce::Input::isPressed(backupKey))
             {
-                glm::vec3 direction = glm::mat3(orientation) * glm::vec3{0, 0, -1.0f};
-                velocity = direction * speed * -0.5f;
+                glm::vec3 direction = glm::mat3(orientation()) * glm::vec3{0, 0, -1.0f};
+                velocity() = direction * speed * -0.5f;
                 backingUp = true;
             }
             if (!backingUp && cooldownTimer <= 0 && applesauce::Input::isPressed(shootKey))
             {
                 glm::vec3 barrelExit{8.881790563464165e-06f, 0.9173035621643066f, -0.6668300032615662f};
-                auto worldBarrelExit = glm::mat3(orientation) * barrelExit + position;
-
-                auto shell = std::dynamic_pointer_cast<Shell>(world->spawn(new Shell, worldBarrelExit));
-                if (shell)
-                {
-                    glm::vec3 direction = glm::mat3(orientation) * glm::vec3{0, 0, -1.0f};
-                    shell->velocity = direction * 20.0f;
-                    shell->originator = this;
-                }
+                auto worldBarrelExit = glm::mat3(orientation()) * barrelExit + position();
+
+                auto shell = world->spawn<Shell>(worldBarrelExit);
+                glm::vec3 direction = glm::mat3(orientation()) * glm::vec3{0, 0, -1.0f};
+                shell->velocity() = direction * 20.0f;
+                shell->originator = this;
                 cooldownTimer = 1.5f;
             }
         }
-        position += velocity * dt;
-        orientation = glm::rotate(orientation, spinSpeed * dt, glm::vec3{0, 1.0f, 0});
+        orientation() = glm::rotate(orientation(), spinSpeed * dt, glm::vec3{0, 1.0f, 0});
 
         if (cooldownTimer > 0)
         {
@@ -143,7 +140,7 @@ public:
     {
         if (spinOutTimer > 0)
         {
-            velocity = glm::vec3{0};
+            velocity() = glm::vec3{0};
         }
     }
 
@@ -154,7 +151,7 @@ public:
     {
         if (e.originator != nullptr)
         {
-            velocity = glm::normalize(e.velocity) * 20.0f;
+            velocity() = glm::normalize(e.velocity()) * 20.0f;
             spinOutTimer = 1.0f;
         }
     }
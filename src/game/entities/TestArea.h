@@ -1,3 +1,5 @@
+#pragma once
+
 #include <applesauce/Entity.h>
 
 #include <glm/gtx/euler_angles.hpp>
@@ -6,7 +8,7 @@
 #include <cmath>
 #include <cstdlib>
 
-float fRand(float max)
+inline float fRand(float max)
 {
     return max * static_cast<float>(rand() % 10000) / 10000.0f;
 }
@@ -17,13 +19,13 @@ class TinyBlock : public applesauce::Entity
 
     void init(applesauce::ResourceManager &rm)
     {
-        mesh = rm.getMesh("TinyBox");
+        mesh() = rm.getMesh("TinyBox");
         timer = rand() % 400;
 
         float speed = fRand(12.0f) + 0.6f;
         glm::vec3 vel{0, 1.0f, 0};
         vel = glm::mat3(glm::yawPitchRoll(fRand(1.0f) - 0.5f, 0.0f, fRand(1.0f) - 0.5f)) * vel;
-        velocity = vel * speed;
+        velocity() = vel * speed;
     }
     void update(float dt)
     {
@@ -31,16 +33,16 @@ class TinyBlock : public applesauce::Entity
         {
             destroy();
         }
-        velocity += glm::vec3(0, -9.8f, 0) * dt;
-        position += velocity * dt;
+        velocity() += glm::vec3(0, -9.8f, 0) * dt;
+        position() += velocity() * dt;
 
         // bounce
-        if (position.y < 0.125)
+        if (position().y < 0.125)
         {
-            position.y = 0.126;
-            velocity.y *= -0.5f;
-            velocity.x += velocity.x * -0.1f;
-            velocity.z += velocity.z * -0.1f;
+            position().y = 0.126;
+            velocity().y *= -0.5f;
+            velocity().x += velocity().x * -0.1f;
+            velocity().z += velocity().z * -0.1f;
         }
 
         timer--;
@@ -55,7 +57,7 @@ class Block : public applesauce::Entity
     float timer = 0;
     void init(applesauce::ResourceManager &rm)
     {
-        mesh = rm.getMesh("Box");
+        mesh() = rm.getMesh("Box");
         timeLimit = fRand(10.0f) + 2.0f;
     }
     void update(float dt)
@@ -65,12 +67,12 @@ class Block : public applesauce::Entity
             size_t spawnCount = static_cast<size_t>(rand() % 10) + 10;
             for (size_t i = 0; i <= spawnCount; ++i)
             {
-                world->spawn(new TinyBlock, position, glm::quat{});
+                world->spawn<TinyBlock>(position(), glm::quat{});
             }
             destroy();
         }
         const float spinSpeed = (timer / timeLimit) * topSpinSpeed * dt;
-        orientation = glm::rotate(orientation, spinSpeed, glm::vec3{0, 1.0f, 0});
+        orientation() = glm::rotate(orientation(), spinSpeed, glm::vec3{0, 1.0f, 0});
         timer += dt;
     }
 };
@@ -79,7 +81,8 @@ class Floor : public applesauce::Entity
 {
     void init(applesauce::ResourceManager &rm)
     {
-        mesh = rm.getMesh("Plane");
+        mesh() = rm.getMesh("Plane");
+        setStationary(true);
     }
     void update(float)
     {
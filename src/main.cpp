@@ -1,20 +1,31 @@
 #define _USE_MATH_DEFINES
 
 #include "applesauce/App.h"
+#include "applesauce/AsyncResourceManager.h"
+#include "applesauce/Culling.h"
 #include "applesauce/Debug.h"
 #include "applesauce/Entity.h"
+#include "applesauce/InstancedRenderer.h"
+#include "applesauce/RenderQueue.h"
 #include "applesauce/Input.h"
 #include "applesauce/VertexBuffer.h"
 #include "applesauce/VertexArray.h"
 #include "applesauce/Shader.h"
+#include "applesauce/ShadowFrustum.h"
+#include "applesauce/ShadowMap.h"
 #include "applesauce/Texture.h"
+#include "applesauce/TextureAtlas.h"
+#include "applesauce/UniformBuffer.h"
 #include "applesauce/Camera.h"
 #include "applesauce/Mesh.h"
 
 #include "game/entities/Tenk.h"
 #include "game/entities/Level.h"
 #include "game/entities/TestArea.h"
-#include "game/Collision.h"
+#include "game/GameWorld.h"
+
+#include "util/AssetPack.h"
+#include "util/Image.h"
 
 #define GLM_SWIZZLE
 #include <glm/gtc/matrix_transform.hpp>
@@ -31,70 +42,198 @@
 #include <imgui_impl_opengl3.h>
 
 #include <algorithm>
+#include <chrono>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <cmath>
+#include <filesystem>
+#include <fstream>
 #include <list>
 #include <memory>
 #include <ostream>
+#include <stdexcept>
 #include <sstream>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 static constexpr unsigned int SHADOW_WIDTH = 2048,
                               SHADOW_HEIGHT = 2048;
 
-Quad quadFromEntity(const applesauce::Entity &entity, float size)
+// Render queue passes, in the order they are drawn. The shadow passes take
+// one pass per cascade. Stationary shadow casters are only drawn when the
+// shadow cache is rebuilt.
+static constexpr uint32_t staticShadowPass = 0,
+                          shadowPass = 4,
+                          opaquePass = 8;
+
+// What the static shadow cache holds: the light's views of the stationary
+// instances. Ids are never reused, so any change to that set changes the key.
+// Meshes load in the background behind handles that don't change, so the
+// mesh generation is part of it too.
+static uint64_t staticShadowKey(const applesauce::ShadowCascade *cascades, size_t count, const applesauce::RenderSnapshot &snapshot,
+                                uint64_t meshGeneration)
+{
+    uint64_t hash = 14695981039346656037ull;
+    const auto mix = [&hash](const void *data, size_t size)
+    {
+        const auto bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+    };
+    for (size_t i = 0; i < count; i++)
+        mix(&cascades[i].lightSpaceMatrix, sizeof(cascades[i].lightSpaceMatrix));
+    mix(&meshGeneration, sizeof(meshGeneration));
+    for (const auto &instance : snapshot.instances)
+    {
+        if (instance.stationary)
+            mix(&instance.id, sizeof(instance.id));
+    }
+    return hash;
+}
+
+// GPU time of the named scopes of a profiled frame
+static double gpuScopeSeconds(const applesauce::Profiler::Frame &frame, const char *name)
+{
+    double seconds = 0;
+    for (const auto &sample : frame.gpu)
+    {
+        if (std::strcmp(sample.name, name) == 0)
+            seconds += sample.duration;
+    }
+    return seconds;
+}
+
+// Uniform block binding points, and std140 mirrors of the blocks declared in
+// the basic and shadow shaders. vec3s are padded out to vec4s.
+static constexpr GLuint frameBlockBinding = 0,
+                        materialBlockBinding = 1;
+
+struct FrameBlock
 {
-    float halfSize = size / 2.0f;
-    glm::vec4 upperLeft{-halfSize, 0, -halfSize, 1.0f};
-    glm::vec4 lowerLeft{-halfSize, 0, halfSize, 1.0f};
-    glm::vec4 lowerRight{halfSize, 0, halfSize, 1.0f};
-    glm::vec4 upperRight{halfSize, 0, -halfSize, 1.0f};
-
-    auto tfUpperLeft = entity.modelMatrix * upperLeft;
-    auto tfLowerLeft = entity.modelMatrix * lowerLeft;
-    auto tfLowerRight = entity.modelMatrix * lowerRight;
-    auto tfUpperRight = entity.modelMatrix * upperRight;
-
-    return {glm::vec2{tfUpperLeft.x, tfUpperLeft.z},
-            glm::vec2{tfLowerLeft.x, tfLowerLeft.z},
-            glm::vec2{tfLowerRight.x, tfLowerRight.z},
-            glm::vec2{tfUpperRight.x, tfUpperRight.z}};
+    glm::mat4 viewMatrix;
+    glm::mat4 projectionMatrix;
+    glm::mat4 shadowMatrices[4];
+    glm::mat4 lightSpaceMatrices[4];
+    glm::vec4 cascadeSplits;
+    glm::vec4 ambientSky;
+    glm::vec4 ambientEquator;
+    glm::vec4 ambientGround;
+    glm::vec4 lightColor;
+    glm::vec4 lightDirection;
+};
+
+struct MaterialBlock
+{
+    glm::vec4 color;
+    float metallicFactor;
+    float roughnessFactor;
+    float padding[2];
+    glm::vec4 atlasRect;
+    int atlasLayer;
+    int atlasPadding[3];
+};
+
+// Frame times over the whole ring, then one row per nesting level for the
+// scopes of a single frame, scaled to the frame's CPU time
+static void drawTimeline(const char *label, const std::vector<applesauce::Profiler::Sample> &samples, double frameDuration)
+{
+    static const ImU32 palette[] = {IM_COL32(70, 130, 180, 255), IM_COL32(60, 160, 110, 255),
+                                    IM_COL32(200, 140, 50, 255), IM_COL32(170, 80, 160, 255)};
+
+    ImGui::Text("%s", label);
+    auto *drawList = ImGui::GetWindowDrawList();
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const float width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+    const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+    const float scale = width / static_cast<float>(std::max(frameDuration, 1e-6));
+
+    uint32_t rows = 1;
+    for (const auto &sample : samples)
+    {
+        rows = std::max(rows, sample.depth + 1);
+
+        const ImVec2 min{origin.x + static_cast<float>(sample.start) * scale, origin.y + sample.depth * rowHeight};
+        const ImVec2 max{std::max(min.x + 1.0f, origin.x + static_cast<float>(sample.start + sample.duration) * scale), min.y + rowHeight - 1.0f};
+        drawList->AddRectFilled(min, max, palette[sample.depth % 4]);
+        drawList->PushClipRect(min, max, true);
+        drawList->AddText(ImVec2{min.x + 2.0f, min.y + 2.0f}, IM_COL32(255, 255, 255, 255), sample.name);
+        drawList->PopClipRect();
+        if (ImGui::IsMouseHoveringRect(min, max))
+        {
+            ImGui::SetTooltip("%s: %.3f ms", sample.name, sample.duration * 1000.0);
+        }
+    }
+    ImGui::Dummy(ImVec2{width, rows * rowHeight});
 }
 
-AABB aabbFromEntity(const applesauce::Entity &entity)
+static void drawProfiler(const applesauce::Profiler &profiler)
 {
-    float halfSize = entity.collisionSize / 2.0f;
-    return {{entity.position.x - halfSize, entity.position.z - halfSize},
-            {entity.position.x + halfSize, entity.position.z + halfSize}};
+    ImGui::Begin("Profiler");
+
+    float frameTimes[applesauce::Profiler::defaultCapacity];
+    const size_t count = std::min(profiler.frameCount(), applesauce::Profiler::defaultCapacity);
+    for (size_t i = 0; i < count; i++)
+    {
+        frameTimes[i] = static_cast<float>(profiler.frame(profiler.frameCount() - count + i).duration * 1000.0);
+    }
+    ImGui::PlotLines("ms/frame", frameTimes, static_cast<int>(count), 0, nullptr, 0.0f, 33.3f, ImVec2{0, 60});
+
+    if (const auto frame = profiler.latest())
+    {
+        ImGui::Text("Frame %llu: CPU %.3f ms, GPU %.3f ms", static_cast<unsigned long long>(frame->index),
+                    frame->duration * 1000.0, frame->gpuDuration * 1000.0);
+        drawTimeline("CPU", frame->cpu, frame->duration);
+        drawTimeline("GPU", frame->gpu, frame->duration);
+    }
+    ImGui::Text("GPU frames dropped: %llu", static_cast<unsigned long long>(profiler.stats().gpuFramesDropped));
+
+    if (ImGui::Button("Write trace"))
+    {
+        std::ofstream trace("profile.json");
+        profiler.writeChromeTrace(trace);
+        std::cout << "Wrote " << profiler.frameCount() << " frames to profile.json" << std::endl;
+    }
+
+    ImGui::End();
 }
 
 class Triangles : public App,
-                  public applesauce::IWorld,
-                  public applesauce::ResourceManager,
                   public Window::ScrollHandler,
                   public Window::MouseHandler,
                   public Window::KeyHandler
 {
 public:
+    Triangles(int benchWallCount = 0, bool cacheStaticShadows = true, int cascadeCount = 1, std::string levelPath = "",
+              double uploadBudget = 0.002, bool waitForAssets = false, bool useAtlas = true, bool cacheShaders = true)
+        : cacheShaders(cacheShaders), useAtlas(useAtlas), benchWallCount(benchWallCount), uploadBudget(uploadBudget), waitForAssets(waitForAssets), cacheStaticShadows(cacheStaticShadows),
+          fitShadowFrustum(cascadeCount > 0), cascadeCount(std::max(cascadeCount, 1)), levelPath(std::move(levelPath)) {}
+
+    // Input and the camera distance belong to the simulation, which may be
+    // on another thread
     void onKeyDown(int keycode) override
     {
         std::cout << "KeyDown: " << keycode << std::endl;
-        applesauce::Input::press(keycode);
+        post([keycode]()
+             { applesauce::Input::press(keycode); });
     }
 
     void onKeyUp(int keycode) override
     {
         std::cout << "KeyUp: " << keycode << std::endl;
-        applesauce::Input::release(keycode);
+        post([keycode]()
+             { applesauce::Input::release(keycode); });
     }
 
     void onScroll(double, double yoffset) override
     {
-        dist -= yoffset;
-        dist = std::max(dist, 0.1f);
+        post([this, yoffset]()
+             {
+                 dist -= yoffset;
+                 dist = std::max(dist, 0.1f);
+             });
     }
 
     void onMouseDown(MouseHandler::Button button) override
@@ -124,15 +263,6 @@ public:
         last_ypos = ypos;
     }
 
-    std::shared_ptr<applesauce::Mesh> getMesh(const std::string &key) override
-    {
-        return meshes[key];
-    }
-    std::shared_ptr<applesauce::Texture2D> getTexture(const std::string &key) override
-    {
-        return textures[key];
-    }
-
     void init() override
     {
 
@@ -152,254 +282,426 @@ public:
         window.setMouseHandler(this);
         window.setKeyHandler(this);
 
-        // Loads from assets/shaders/basic.fs.glsl and assets/shaders/basic.vs.glsl
-        shader = loadShader("basic");
-        shadow = loadShader("shadow");
-        quad = loadShader("quad");
+        // Loads from assets/shaders/basic.fs.glsl and assets/shaders/basic.vs.glsl,
+        // or the program linked on an earlier run
+        const auto shaderCache = cacheShaders ? std::filesystem::path(shaderCacheDirectory) : std::filesystem::path();
+        shader = loadShader("basic", shaderCache);
+        shadow = loadShader("shadow", shaderCache);
+        quad = loadShader("quad", shaderCache);
+
+        // Everything but the samplers and the shadow cascade being drawn comes
+        // from uniform blocks, the samplers never change
+        shader->bindUniformBlock("Frame", frameBlockBinding);
+        shader->bindUniformBlock("Material", materialBlockBinding);
+        shadow->bindUniformBlock("Frame", frameBlockBinding);
+        cascadeUniform = shadow->uniformHandle("Cascade");
+        shader->use();
+        shader->set("albedo", 0);
+        shader->set("shadowMap", 1);
+        shader->set("albedoAtlas", atlasTextureUnit);
+
+        frameUniforms = std::make_unique<applesauce::UniformBuffer<FrameBlock>>(frameBlockBinding);
+        materialRing = std::make_unique<applesauce::UniformRing>(64 * 1024, materialBlockBinding);
+
+        // The baked pack is mapped and uploaded as is. Without one (or with a
+        // stale one) fall back to parsing the source assets. Either way the
+        // loads finish in the background, display() uploads a few each frame.
+        std::shared_ptr<const AssetPack> pack;
+        try
+        {
+            pack = std::make_shared<AssetPack>("assets/assets.pack");
+        }
+        catch (const std::runtime_error &e)
+        {
+            std::cout << e.what() << ", loading source assets" << std::endl;
+        }
 
-        textures.emplace("White", applesauce::singleColorTexture(0xFFFFFFFF));
-        textures.emplace("Checker", applesauce::textureFromPNG("assets/textures/Checker.png"));
-        textures.emplace("White Square", applesauce::textureFromPNG("assets/textures/White Square.png"));
+        const auto loadTexture = [this, &pack](const std::string &name)
+        {
+            return pack ? resources.loadTexture(name, pack)
+                        : resources.loadTexture(name, "assets/textures/" + name + ".png");
+        };
+        const auto loadMeshes = [this, &pack](const std::string &name, applesauce::AsyncResourceManager::MeshReady ready)
+        {
+            if (pack)
+                resources.loadMeshes(pack, name, std::move(ready));
+            else
+                resources.loadMeshes("assets/gltf/" + name + ".gltf", std::move(ready));
+        };
+
+        const auto white = resources.addTexture("White", applesauce::singleColorTexture(0xFFFFFFFF));
+
+        // Every texture is small enough to share one array texture, which
+        // stays bound for the whole main pass (--no-atlas to bind each one).
+        // Until a texture is in the atlas its material samples white.
+        applesauce::TextureAtlas::Entry whiteEntry{};
+        const auto placeInAtlas = [](applesauce::Material &material, const applesauce::TextureAtlas::Entry &entry)
+        {
+            material.atlasLayer = static_cast<int>(entry.layer);
+            material.atlasRect = entry.rect;
+        };
+        const auto loadMaterialTexture = [&](const std::string &name, bool repeat, std::shared_ptr<applesauce::Material> material)
+        {
+            if (!useAtlas)
+            {
+                material->baseTexture = loadTexture(name);
+                return;
+            }
+            material->baseTexture = white;
+            auto ready = [material, placeInAtlas](const applesauce::TextureAtlas::Entry &entry)
+            { placeInAtlas(*material, entry); };
+            if (pack)
+                resources.loadAtlasTexture(*atlas, name, pack, repeat, std::move(ready));
+            else
+                resources.loadAtlasTexture(*atlas, name, "assets/textures/" + name + ".png", repeat, std::move(ready));
+        };
+        if (useAtlas)
+        {
+            atlas = std::make_unique<applesauce::TextureAtlas>(64, 4, 4);
+            whiteEntry = atlas->add("White", Image{1, 1, {0xFF, 0xFF, 0xFF, 0xFF}});
+        }
 
         auto boxMaterial = std::make_shared<applesauce::Material>(applesauce::Material{{1.0f, 1.0f, 1.0f}, // baseColor - white
                                                                                        0.5,                // roughnessFactor
                                                                                        0.5,                // metallicFactor
-                                                                                       getTexture("White Square")});
+                                                                                       white});
+        loadMaterialTexture("White Square", false, boxMaterial);
 
+        // The floor's texcoords run across the whole arena, so the checker repeats
         auto checkerMaterial = std::make_shared<applesauce::Material>(applesauce::Material{{1.0f, 0.6f, 0.1f}, // baseColor - white
                                                                                            0.5,                // roughnessFactor
                                                                                            0.5,                // metallicFactor
-                                                                                           getTexture("Checker")});
-
-        meshes.emplace("TinyBox", std::make_shared<applesauce::Mesh>(makeBoxMesh(0.25f, boxMaterial)));
-        meshes.emplace("Box", std::make_shared<applesauce::Mesh>(makeBoxMesh(1.0f, boxMaterial)));
-
-        for (auto &[name, mesh] : applesauce::loadMeshes("assets/gltf/tenk9aa.gltf"))
+                                                                                           white});
+        loadMaterialTexture("Checker", true, checkerMaterial);
+
+        resources.addMesh("TinyBox", makeBoxMesh(0.25f, boxMaterial));
+        resources.addMesh("Box", makeBoxMesh(1.0f, boxMaterial));
+
+        // The second tank is "red", right now that needs its own copy of the
+        // mesh. Handed out before the tank is loaded and filled in with it.
+        loadMeshes("tenk9aa", [this, white, whiteEntry, placeInAtlas](const std::string &name, applesauce::Mesh &mesh)
+                   {
+                       for (auto prim : mesh.primitives)
+                       {
+                           prim.material->baseTexture = white;
+                           if (useAtlas)
+                               placeInAtlas(*prim.material, whiteEntry);
+                       }
+                       if (name != "Tenk")
+                           return;
+
+                       auto red = resources.addMesh("Red Tenk", mesh);
+                       red->primitives.front().material = std::make_shared<applesauce::Material>(*mesh.primitives.front().material);
+                       red->primitives.front().material->baseColor = glm::vec3{
+                           0.8000000715255737,
+                           0.01729123666882515,
+                           0.06288419663906097};
+                   });
+
+        loadMeshes("wall-and-floor", [this, white, whiteEntry, placeInAtlas](const std::string &, applesauce::Mesh &mesh)
+                   {
+                       for (auto prim : mesh.primitives)
+                       {
+                           prim.material->baseTexture = white;
+                           if (useAtlas)
+                               placeInAtlas(*prim.material, whiteEntry);
+                           prim.material->baseColor = glm::vec3{0.3, 0.3, 1.0};
+                       }
+                   });
+
+        // The profiler belongs to the drawing thread
+        if (!isThreaded())
         {
-            for (auto prim : mesh.primitives)
-            {
-                prim.material->baseTexture = getTexture("White");
-            }
-            meshes.emplace(name, std::make_shared<applesauce::Mesh>(mesh));
+            world.setProfiler(&profiler);
         }
-
-        for (auto &[name, mesh] : applesauce::loadMeshes("assets/gltf/wall-and-floor.gltf"))
+        if (levelPath.empty())
+            world.load(arenaPlayField);
+        else
+            world.loadLevel(levelPath);
+        const auto &tenks = world.tenks();
+        if (tenks.size() < 2)
         {
-            for (auto prim : mesh.primitives)
-            {
-                prim.material->baseTexture = getTexture("White");
-                prim.material->baseColor = glm::vec3{0.3, 0.3, 1.0};
-            }
-            meshes.emplace(name, std::make_shared<applesauce::Mesh>(mesh));
-        }
-
-        const char *playField = "********************************\n"
-                                "**                             *\n"
-                                "*                              *\n"
-                                "*              **              *\n"
-                                "*              **              *\n"
-                                "*              **              *\n"
-                                "*    **                  **    *\n"
-                                "*     *                  *     *\n"
-                                "*  T  *   ***      ***   *  T  *\n"
-                                "*     *   ***      ***   *     *\n"
-                                "*     *                  *     *\n"
-                                "*    **                  **    *\n"
-                                "*              **              *\n"
-                                "*              **              *\n"
-                                "*              **              *\n"
-                                "*                            ***\n"
-                                "*                            ***\n"
-                                "********************************";
-
-        prepareTileMap(playField, tm);
-
-        std::stringstream stream(playField);
-        std::string line;
-
-        int tankId = 0;
-        int row = 0;
-        int maxCol = -1;
-        while (std::getline(stream, line, '\n'))
-        {
-            int col = 0;
-            for (const auto &character : line)
-            {
-                const glm::vec3 position{col, 0, row};
-                switch (character)
-                {
-                case '*':
-                    spawn(new Wall(), position);
-                    break;
-                case 'T':
-                    auto t = spawn(new Tenk(tankId++), position);
-                    tenks.push_back(std::dynamic_pointer_cast<Tenk>(t));
-                    break;
-                }
-
-                col++;
-            }
-            maxCol = std::max(maxCol, col);
-            row++;
+            throw std::runtime_error("A level needs two tanks, it has " + std::to_string(tenks.size()));
         }
-        /*        glm::vec3 baseColor;
-        float metallicFactor;
-        float roughnessFactor;
-        std::shared_ptr<Texture> baseTexture = nullptr;*/
+        const auto [maxCol, row] = world.size();
 
-        // Make the second tank "red" (right now need to copy the mesh)
-        tenks[1]->mesh = std::make_shared<applesauce::Mesh>(*(tenks[0]->mesh));
-        tenks[1]->mesh->primitives.front().material = std::make_shared<applesauce::Material>(
-            *(tenks[0]->mesh->primitives.front().material));
+        // Kept by the resource manager, render snapshots rely on meshes
+        // outliving entities
+        tenks[1]->mesh() = resources.getMesh("Red Tenk");
 
-        tenks[1]->mesh->primitives.front().material->baseColor = glm::vec3{
-            0.8000000715255737,
-            0.01729123666882515,
-            0.06288419663906097};
+        resources.addMesh("Plane", makePlaneMesh(maxCol - 1, row - 1, checkerMaterial));
+        world.spawn(new Floor());
 
-        for (auto &entity : entities)
+        // Benchmark walls are lined up behind the far wall of the arena. They are
+        // only rendered, the tile map does not know about them.
+        const int benchColumns = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(benchWallCount))));
+        for (int i = 0; i < benchWallCount; i++)
         {
-            entity->position.x -= static_cast<float>(maxCol) / 2.0f;
-            entity->position.z = (static_cast<float>(row - 1) - entity->position.z) - static_cast<float>(row) / 2.0f;
+            const glm::vec3 position{static_cast<float>(i % benchColumns - benchColumns / 2),
+                                     0,
+                                     -static_cast<float>(row) / 2.0f - 2.0f - static_cast<float>(i / benchColumns)};
+            world.spawn(new Wall(), position);
         }
 
-        meshes.emplace("Plane", std::make_shared<applesauce::Mesh>(makePlaneMesh(maxCol - 1, row - 1, checkerMaterial)));
-        spawn(new Floor());
+        // Everything that can receive or cast a shadow, the tile map plus the
+        // benchmark walls behind it
+        const int benchRows = benchColumns > 0 ? (benchWallCount + benchColumns - 1) / benchColumns : 0;
+        sceneBounds = {{-static_cast<float>(std::max(maxCol, benchColumns)) / 2.0f - 1.0f, -0.5f, -static_cast<float>(row) / 2.0f - 2.0f - static_cast<float>(benchRows)},
+                       {static_cast<float>(std::max(maxCol, benchColumns)) / 2.0f + 1.0f, 2.5f, static_cast<float>(row) / 2.0f + 1.0f}};
 
-        glGenFramebuffers(1, &depthMapFBO);
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-        depthMap = std::make_shared<applesauce::DepthTexture2D>(SHADOW_WIDTH, SHADOW_HEIGHT);
-        depthMap->bind();
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap->glId(), 0);
-        glDrawBuffer(GL_NONE);
-        glReadBuffer(GL_NONE);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        shadowMap = std::make_unique<applesauce::ShadowMap>(SHADOW_WIDTH, SHADOW_HEIGHT);
+        shadowCache = std::make_unique<applesauce::ShadowCache>(SHADOW_WIDTH, SHADOW_HEIGHT);
 
         applesauce::Input::init();
+
+        // The old way, everything in place before the first frame
+        if (waitForAssets)
+        {
+            resources.finish();
+        }
     }
 
     void update(float dt) override
     {
-        entities.erase(std::remove_if(entities.begin(), entities.end(), [](const auto &e)
-                                      { return e->isPendingDestruction; }),
-                       entities.end());
-        for (auto &entity : entities)
+        world.update(dt);
+
+        const auto &tenks = world.tenks();
+        glm::vec3 tenk0Trend = tenks[0]->position() + tenks[0]->velocity() * 0.5f;
+        glm::vec3 tenk1Trend = tenks[1]->position() + tenks[1]->velocity() * 0.5f;
+        glm::vec3 tenkCenter = tenk0Trend + (tenk1Trend - tenk0Trend) * 0.5f;
+        cameraTarget += (tenkCenter - cameraTarget) * dt;
+
+        float tenksDist = glm::distance(tenks[0]->position(), tenks[1]->position());
+        float targetDist = (tenksDist - dist) * 0.5f + 4.0f;
+        dist += targetDist * dt;
+    }
+
+    void capture(applesauce::RenderSnapshot &snapshot) override
+    {
+        applesauce::captureInstances(world.components(), snapshot);
+        snapshot.cameraTarget = cameraTarget;
+        snapshot.cameraDistance = dist;
+    }
+
+    void display() override
+    {
         {
-            entity->modelMatrix = glm::translate(glm::mat4{1.0f}, entity->position) * glm::mat4(entity->orientation);
-            entity->update(dt);
+            applesauce::Profiler::Scope scope(&profiler, "Upload");
+            resources.upload(uploadBudget);
+            if (assetsReadySeconds == 0 && resources.idle())
+            {
+                const std::chrono::duration<double> ready = std::chrono::steady_clock::now() - startTime;
+                assetsReadySeconds = ready.count();
+                std::cout << "Assets: all uploaded " << assetsReadySeconds * 1000.0 << " ms after start" << std::endl;
+            }
+        }
+
+        const auto submitStart = std::chrono::steady_clock::now();
+
+        glm::vec3 lightDir = glm::normalize(glm::vec3{0.5, 1, 0.25});
+
+        // Without fitting, one hand sized box around the origin covers
+        // whatever the camera sees
+        static float lightDist = 10.0f;
+        static float lightSize = 17.0f;
+        static float lightNear = 0.1f;
+        static float lightFar = 20.0f;
+        const glm::mat4 lightView = glm::lookAt(lightDir * lightDist,
+                                                glm::vec3(0),
+                                                glm::vec3(0, 1, 0));
+
+        // Everything in the world is drawn from the last two snapshots, blended
+        // by how far the clock has got towards the next tick
+        const auto &previous = previousSnapshot();
+        const auto &current = currentSnapshot();
+        const auto blend = snapshotBlend();
+        applesauce::interpolateInstances(previous, current, blend, instanceMatrices);
+        const auto cameraDistance = glm::mix(previous.cameraDistance, current.cameraDistance, blend);
+
+        const auto [width, height] = window.framebufferSize();
+        camera.viewport = {width, height};
+        camera.position = glm::mat3(glm::yawPitchRoll(theta, pitch, 0.0f)) * glm::vec3{0, 0, -cameraDistance};
+        glm::mat4 view = camera.lookAtMatrix(glm::mix(previous.cameraTarget, current.cameraTarget, blend));
+        glm::mat4 projection = camera.projectionMatrix();
+        camera.fieldOfVision = 45.0f;
 
-            if (entity->collidable)
+        // Fitted cascades split the camera frustum up to the farthest corner
+        // of the scene, each one gets a quarter of the shadow map
+        {
+            applesauce::Profiler::Scope scope(&profiler, "Shadow frustum");
+            const size_t count = fitShadowFrustum ? static_cast<size_t>(cascadeCount) : 1;
+            float splits[4] = {camera.farPlaneDistance, camera.farPlaneDistance, camera.farPlaneDistance, camera.farPlaneDistance};
+            // Boxes are only kept from a frame with the same cascades
+            const bool keepBoxes = activeCascades == count;
+            activeCascades = count;
+            if (fitShadowFrustum)
             {
-                glm::vec2 ejectionVector;
-                // TODO: Can we avoid updating this matrix twice?
-                // This is collision vs walls specifically
-                if (tm.checkCollision(quadFromEntity(*entity, entity->collisionSize), ejectionVector))
+                const auto eye = glm::vec3(glm::inverse(view)[3]);
+                const glm::vec3 forward{-view[0][2], -view[1][2], -view[2][2]};
+                float shadowDistance = camera.nearPlaneDistance;
+                for (int i = 0; i < 8; i++)
+                {
+                    const glm::vec3 corner{i & 1 ? sceneBounds.max.x : sceneBounds.min.x,
+                                           i & 2 ? sceneBounds.max.y : sceneBounds.min.y,
+                                           i & 4 ? sceneBounds.max.z : sceneBounds.min.z};
+                    shadowDistance = std::max(shadowDistance, glm::dot(corner - eye, forward));
+                }
+                shadowDistance = std::clamp(shadowDistance, camera.nearPlaneDistance + 1.0f, camera.farPlaneDistance);
+                applesauce::cascadeSplits(camera.nearPlaneDistance, shadowDistance, count, cascadeLambda, splits);
+
+                const auto corners = applesauce::frustumCorners(projection * view);
+                float from = camera.nearPlaneDistance;
+                for (size_t i = 0; i < count; i++)
                 {
-                    entity->position.x += ejectionVector.x;
-                    entity->position.z += ejectionVector.y;
-
-                    // TODO: This is not quite right as the ejection vector may be the sum of
-                    // multiple ejections, but it should get us enough information to react
-                    // nicely.
-                    const auto normal = glm::normalize(ejectionVector);
-                    entity->onTouch(glm::vec3(normal.x, 0, normal.y));
+                    const auto region = applesauce::cascadeRegion(i, count);
+                    const auto slice = applesauce::frustumSlice(corners, camera.nearPlaneDistance, camera.farPlaneDistance, from, splits[i]);
+                    cascades[i] = applesauce::fitShadowCascade(slice, lightDir, sceneBounds, static_cast<int>(SHADOW_WIDTH * region.z),
+                                                               keepBoxes ? &cascades[i] : nullptr, shadowMargin);
+                    from = splits[i];
                 }
             }
+            else
+            {
+                cascades[0].lightSpaceMatrix = glm::ortho(-lightSize, lightSize, -lightSize, lightSize, lightNear, lightFar) * lightView;
+                cascades[0].texelsPerUnit = SHADOW_WIDTH / (2.0f * lightSize);
+                cascades[0].box = glm::vec3{0.0f};
+            }
+            cascadeSplitDepths = {splits[0], splits[1], splits[2], splits[3]};
+            for (size_t i = count; i < 4; i++)
+            {
+                cascades[i] = cascades[count - 1];
+                cascadeSplitDepths[i] = cascadeSplitDepths[count - 1];
+            }
+        }
 
-            // Update modelMatrix of all entities in preparation for render
-            entity->modelMatrix = glm::translate(glm::mat4{1.0f}, entity->position) * glm::mat4(entity->orientation);
+        // Cull every primitive against the camera and each cascade's light
+        // box, each pass only batches what it can see.
+        {
+            applesauce::Profiler::Scope scope(&profiler, "Culling");
+            cullingSet.clear();
+            cullingPrimitives.clear();
+            for (size_t i = 0; i < current.instances.size(); i++)
+            {
+                for (const auto &primitive : current.instances[i].mesh->primitives)
+                {
+                    cullingSet.add(applesauce::worldSphere(primitive.bounds, instanceMatrices[i]));
+                    cullingPrimitives.push_back({&primitive, &instanceMatrices[i], current.instances[i].stationary});
+                }
+            }
+            shadowCullStats = {};
+            for (size_t c = 0; c < activeCascades; c++)
+            {
+                const auto stats = cullingSet.cull(applesauce::Frustum::fromMatrix(cascades[c].lightSpaceMatrix), shadowVisible[c]);
+                shadowCullStats.tested += stats.tested;
+                shadowCullStats.culled += stats.culled;
+            }
+            mainCullStats = cullingSet.cull(applesauce::Frustum::fromMatrix(projection * view), mainVisible);
         }
 
-        for (auto i = entities.begin(); i != entities.end(); i++)
+        // With the cache, stationary casters are drawn only when it is out of
+        // date and the shadow pass proper is just what moves
+        const auto shadowKey = staticShadowKey(cascades, activeCascades, current, resources.meshGeneration());
+        const bool rebuildShadowCache = cacheStaticShadows && shadowCache->isStale(shadowKey);
+        shadowRebuilds.add(rebuildShadowCache ? 1.0 : 0.0);
+
         {
-            for (auto j = i; ++j != entities.end();)
+            applesauce::Profiler::Scope scope(&profiler, "Batching");
+            renderQueue.begin();
+            for (size_t c = 0; c < activeCascades; c++)
             {
-                auto &entA = *i;
-                auto &entB = *j;
-
-                // If either entity is the originator of the other, skip
-                if ((entA->originator != nullptr && entA->originator == entB.get()) || (entB->originator != nullptr && entB->originator == entA.get()))
-                    continue;
-
-                // TODO: Different collision types
-                // The shell only needs to overlap on the AABB. Nothing more.
-                // Tank to tank is similar to tank to wall. The tanks should
-                // stop each other from penetrating.
-                if (checkCollision(aabbFromEntity(*entA), aabbFromEntity(*entB)))
+                staticShadowRenderers[c].begin();
+                shadowRenderers[c].begin();
+                for (size_t i = 0; i < cullingPrimitives.size(); i++)
                 {
-                    // Figure out a better way of telling the tanks are bumping (maybe even just have them as a permenant pair)
-                    if (std::dynamic_pointer_cast<Tenk>(entA) && std::dynamic_pointer_cast<Tenk>(entB))
+                    const auto [primitive, modelMatrix, stationary] = cullingPrimitives[i];
+                    if (shadowVisible[c][i])
                     {
-                        Quad quadA = quadFromEntity(*entA, entA->collisionSize);
-                        Quad quadB = quadFromEntity(*entB, entB->collisionSize);
-
-                        float minOverlap = 0;
-                        glm::vec2 normal;
-                        if (checkCollision(quadA, quadB, normal, minOverlap))
-                        {
-                            glm::vec3 normal3{normal.x, 0, normal.y};
-                            if (glm::dot(normal3, glm::normalize(entA->position - entB->position)) > 0)
-                            {
-                                normal3 = -normal3;
-                            }
-                            entA->position -= normal3 * minOverlap * 0.5f;
-                            entB->position += normal3 * minOverlap * 0.5f;
-                        }
+                        if (!cacheStaticShadows || !stationary)
+                            shadowRenderers[c].add(*primitive, *modelMatrix);
+                        else if (rebuildShadowCache)
+                            staticShadowRenderers[c].add(*primitive, *modelMatrix);
                     }
-                    entA->onTouch(*entB);
-                    entB->onTouch(*entA);
                 }
+                staticShadowRenderers[c].end();
+                shadowRenderers[c].end();
+
+                // The shadow passes only need vertex data
+                staticShadowRenderers[c].submit(renderQueue, staticShadowPass + c, *shadow, lightView, lightFar, false);
+                shadowRenderers[c].submit(renderQueue, shadowPass + c, *shadow, lightView, lightFar, false);
             }
-        }
 
-        glm::vec3 tenk0Trend = tenks[0]->position + tenks[0]->velocity * 0.5f;
-        glm::vec3 tenk1Trend = tenks[1]->position + tenks[1]->velocity * 0.5f;
-        glm::vec3 tenkCenter = tenk0Trend + (tenk1Trend - tenk0Trend) * 0.5f;
-        cameraTarget += (tenkCenter - cameraTarget) * dt;
+            renderer.begin();
+            for (size_t i = 0; i < cullingPrimitives.size(); i++)
+            {
+                if (mainVisible[i])
+                    renderer.add(*cullingPrimitives[i].primitive, *cullingPrimitives[i].modelMatrix);
+            }
+            renderer.end();
 
-        float tenksDist = glm::distance(tenks[0]->position, tenks[1]->position);
-        float targetDist = (tenksDist - dist) * 0.5f + 4.0f;
-        dist += targetDist * dt;
-    }
+            // All passes are queued up front
+            renderer.submit(renderQueue, opaquePass, *shader, view, camera.farPlaneDistance);
+            renderQueue.sort();
+        }
 
-    void display() override
-    {
-        glm::vec3 lightDir = glm::normalize(glm::vec3{0.5, 1, 0.25});
+        // Light space is -1 to 1, the shadow map 0 to 1 and each cascade only
+        // gets its own region of that
+        FrameBlock frame{};
+        frame.viewMatrix = view;
+        frame.projectionMatrix = projection;
+        for (size_t c = 0; c < 4; c++)
+        {
+            const auto region = applesauce::cascadeRegion(std::min(c, activeCascades - 1), activeCascades);
+            const glm::mat4 toRegion = glm::scale(glm::translate(glm::mat4{1.0f}, glm::vec3{region.x, region.y, 0.0f}),
+                                                  glm::vec3{region.z, region.w, 1.0f});
+            const glm::mat4 bias = glm::scale(glm::translate(glm::mat4{1.0f}, glm::vec3{0.5f}), glm::vec3{0.5f});
+            frame.shadowMatrices[c] = toRegion * bias * cascades[c].lightSpaceMatrix;
+            frame.lightSpaceMatrices[c] = cascades[c].lightSpaceMatrix;
+        }
+        frame.cascadeSplits = cascadeSplitDepths;
+        frame.ambientSky = glm::vec4{triAmbient.sky, 0.0f};
+        frame.ambientEquator = glm::vec4{triAmbient.equator, 0.0f};
+        frame.ambientGround = glm::vec4{triAmbient.ground, 0.0f};
+        frame.lightColor = glm::vec4{1.0f, 1.0f, 1.0f, 0.0f};
+        frame.lightDirection = glm::vec4{glm::mat3(view) * lightDir, 0.0f};
+
+        // Everything that is constant over the frame goes up in one block
+        frameUniforms->set(frame);
 
-        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-        glClear(GL_DEPTH_BUFFER_BIT);
         glEnable(GL_DEPTH_TEST);
         glEnable(GL_CULL_FACE);
 
         glCullFace(GL_FRONT);
 
-        static float lightDist = 10.0f;
-        static float lightSize = 17.0f;
-        static float lightNear = 0.1f;
-        static float lightFar = 20.0f;
         shadow->use();
-        glm::mat4 lightSpaceMatrix;
         { // Shadow map part
-            glm::mat4 view = glm::lookAt(lightDir * lightDist,
-                                         glm::vec3(0),
-                                         glm::vec3(0, 1, 0));
-            glm::mat4 projection = glm::ortho(-lightSize, lightSize, -lightSize, lightSize, lightNear, lightFar);
-            lightSpaceMatrix = projection * view;
-
-            for (const auto &entity : entities)
+            applesauce::Profiler::GpuScope scope(&profiler, "Shadow pass");
+            const auto drawCascades = [&](uint32_t pass)
             {
-                glm::mat4 MVPMatrix = lightSpaceMatrix * entity->modelMatrix;
-
-                shadow->set("MVPMatrix", MVPMatrix);
-
-                for (const auto &primitive : entity->mesh->primitives)
+                for (size_t c = 0; c < activeCascades; c++)
+                {
+                    const auto region = applesauce::cascadeRegion(c, activeCascades);
+                    glViewport(static_cast<GLint>(region.x * SHADOW_WIDTH), static_cast<GLint>(region.y * SHADOW_HEIGHT),
+                               static_cast<GLsizei>(region.z * SHADOW_WIDTH), static_cast<GLsizei>(region.w * SHADOW_HEIGHT));
+                    shadow->set(cascadeUniform, static_cast<int>(c));
+                    renderQueue.dispatch(pass + c, [](const applesauce::Material *) {});
+                }
+            };
+            if (cacheStaticShadows)
+            {
+                if (rebuildShadowCache)
                 {
-                    primitive.vertexArray->bind();
-                    primitive.indexBuffer->bindTo(applesauce::Buffer::Target::element_array);
-                    glDrawElements(GL_TRIANGLES, primitive.elementCount, GL_UNSIGNED_SHORT, reinterpret_cast<void *>(0));
+                    shadowCache->beginUpdate();
+                    drawCascades(staticShadowPass);
+                    shadowCache->endUpdate(shadowKey);
                 }
+                shadowCache->restore(*shadowMap);
+            }
+            else
+            {
+                shadowMap->bind();
+                glClear(GL_DEPTH_BUFFER_BIT);
             }
+            drawCascades(shadowPass);
         }
 
         glDisable(GL_POLYGON_OFFSET_FILL);
@@ -411,73 +713,60 @@ public:
         shader->use();
 
         glActiveTexture(GL_TEXTURE0 + 1);
-        depthMap->bind();
+        shadowMap->texture()->bind();
+        if (atlas)
+        {
+            glActiveTexture(GL_TEXTURE0 + atlasTextureUnit);
+            atlas->bind();
+        }
+        glActiveTexture(GL_TEXTURE0);
 
-        const auto [width, height] = window.framebufferSize();
-        camera.viewport = {width, height};
         glViewport(0, 0, width, height);
 
         window.clear({0.01f, 0.01f, 0.01f, 1.0f});
 
-        camera.position = glm::mat3(glm::yawPitchRoll(theta, pitch, 0.0f)) * glm::vec3{0, 0, -dist};
-        glm::mat4 view = camera.lookAtMatrix(cameraTarget);
-        glm::mat4 projection = camera.projectionMatrix();
-        camera.fieldOfVision = 45.0f;
-
-        glm::vec3 LightDirection = glm::mat3(view) * lightDir;
-
-        // This should have a translate of 0.5 in each coordinate, but instead scale is influencing,
-        // so some ordering is wrong. The 1.0f translate is a hacky fix.
-        glm::mat4 shadowMatrix = glm::translate(glm::scale(glm::mat4{1.0f}, glm::vec3{0.5f}), glm::vec3{1.0f});
-
-        shadowMatrix *= lightSpaceMatrix;
-
-        for (const auto &entity : entities)
         {
-            glm::mat4 modelView = view * entity->modelMatrix;
-            glm::mat3 normalMatrix = glm::mat3(modelView);
-
-            glm::mat4 MVPMatrix = projection * modelView;
-            glm::mat4 LightViewMatrix = shadowMatrix * entity->modelMatrix;
-
-            shader->set("MVPMatrix", MVPMatrix);
-            shader->set("ModelViewMatrix", modelView);
-            shader->set("LightViewMatrix", LightViewMatrix);
-            shader->set("NormalMatrix", normalMatrix);
-            shader->set("AmbientSky", triAmbient.sky);
-            shader->set("AmbientEquator", triAmbient.equator);
-            shader->set("AmbientGround", triAmbient.ground);
-            shader->set("LightColor", glm::vec3{1.0, 1.0, 1.0});
-            shader->set("LightDirection", LightDirection);
-
-            shader->set("albedo", 0);
-            shader->set("shadowMap", 1);
+            // Materials can be edited from the overlay, so their blocks are
+            // streamed each frame, one per material change in draw order
+            applesauce::Profiler::GpuScope scope(&profiler, "Main pass");
+            materialRing->beginFrame();
+            renderQueue.dispatch(opaquePass, [&](const applesauce::Material *material)
+                                 {
+                                     if (material)
+                                     {
+                                         materialRing->push(MaterialBlock{glm::vec4{material->baseColor, 1.0f},
+                                                                          material->metallicFactor,
+                                                                          material->roughnessFactor,
+                                                                          {},
+                                                                          material->atlasRect,
+                                                                          material->atlasLayer,
+                                                                          {}});
+                                     }
+                                     else
+                                     {
+                                         materialRing->push(MaterialBlock{glm::vec4{1.0f}, 0.0f, 0.25f, {}, glm::vec4{0.0f, 0.0f, 1.0f, 1.0f}, -1, {}});
+                                     }
+                                 });
+            materialRing->endFrame();
+        }
 
-            for (const auto &primitive : entity->mesh->primitives)
-            {
-                if (primitive.material)
-                {
-                    const auto &material = primitive.material;
-                    shader->set("Color", primitive.material->baseColor);
-                    shader->set("MetallicFactor", primitive.material->metallicFactor);
-                    shader->set("RoughnessFactor", primitive.material->roughnessFactor);
-
-                    glActiveTexture(GL_TEXTURE0);
-                    if (material->baseTexture)
-                        material->baseTexture->bind();
-                    else
-                        glBindTexture(GL_TEXTURE_2D, 0);
-                }
-                else
-                {
-                    shader->set("Color", glm::vec3(1.0, 1.0, 1.0));
-                    shader->set("MetallicFactor", 0.0f);
-                    shader->set("RoughnessFactor", 0.25f);
-                }
-                primitive.vertexArray->bind();
-                primitive.indexBuffer->bindTo(applesauce::Buffer::Target::element_array);
-                glDrawElements(GL_TRIANGLES, primitive.elementCount, GL_UNSIGNED_SHORT, reinterpret_cast<void *>(0));
-            }
+        const std::chrono::duration<double> submitTime = std::chrono::steady_clock::now() - submitStart;
+        const auto &renderStats = renderer.stats();
+        const auto &queueStats = renderQueue.stats();
+        benchFrames++;
+        benchDrawCalls += queueStats.drawCalls;
+        benchBindsSaved += queueStats.bindsSaved;
+        benchTextureBinds += queueStats.textureBinds;
+        benchMainCulled += mainCullStats.culled;
+        benchShadowCulled += shadowCullStats.culled;
+        benchTexelsPerUnit += cascades[0].texelsPerUnit;
+        benchShadowRebuilds += static_cast<size_t>(shadowRebuilds.latest());
+        benchSubmitSeconds += submitTime.count();
+        // GPU times arrive a couple of frames late
+        if (const auto frame = profiler.latest(); frame && frame->gpuReady)
+        {
+            benchShadowGpuSeconds += gpuScopeSeconds(*frame, "Shadow pass");
+            benchShadowGpuFrames++;
         }
 
         ImGui_ImplOpenGL3_NewFrame();
@@ -490,26 +779,110 @@ public:
         ImGui::ColorEdit3("equator", &triAmbient.equator[0]);
         ImGui::ColorEdit3("ground", &triAmbient.ground[0]);
 
-        ImGui::ColorEdit3("tenk", (float *)&getMesh("Tenk")->primitives.front().material->baseColor);
-
-        ImGui::ColorEdit3("floorColor", (float *)&getMesh("Plane")->primitives.front().material->baseColor);
-        ImGui::SliderFloat("floorRoughness", (float *)&getMesh("Plane")->primitives.front().material->roughnessFactor, 0, 1.0f);
-        ImGui::SliderFloat("floorMetallic", (float *)&getMesh("Plane")->primitives.front().material->metallicFactor, 0, 1.0f);
-
-        ImGui::SliderFloat("wallRoughness", (float *)&getMesh("Wall")->primitives.front().material->roughnessFactor, 0, 1.0f);
-        ImGui::SliderFloat("wallMetallic", (float *)&getMesh("Wall")->primitives.front().material->metallicFactor, 0, 1.0f);
+        // Meshes still loading have no material to edit
+        const auto materialOf = [this](const char *name) -> applesauce::Material *
+        {
+            const auto mesh = resources.getMesh(name);
+            return mesh->primitives.empty() ? nullptr : mesh->primitives.front().material.get();
+        };
+        if (auto tenk = materialOf("Tenk"))
+        {
+            ImGui::ColorEdit3("tenk", &tenk->baseColor[0]);
+        }
+        if (auto floor = materialOf("Plane"))
+        {
+            ImGui::ColorEdit3("floorColor", &floor->baseColor[0]);
+            ImGui::SliderFloat("floorRoughness", &floor->roughnessFactor, 0, 1.0f);
+            ImGui::SliderFloat("floorMetallic", &floor->metallicFactor, 0, 1.0f);
+        }
+        if (auto wall = materialOf("Wall"))
+        {
+            ImGui::SliderFloat("wallRoughness", &wall->roughnessFactor, 0, 1.0f);
+            ImGui::SliderFloat("wallMetallic", &wall->metallicFactor, 0, 1.0f);
+        }
 
-        ImGui::SliderFloat("lightDist", &lightDist, 0.001f, 40.0f);
-        ImGui::SliderFloat("lightSize", &lightSize, 0.001f, 40.0f);
-        ImGui::SliderFloat("lightNear", &lightNear, 0.001f, 40.0f);
-        ImGui::SliderFloat("lightFar", &lightFar, 0.001f, 40.0f);
+        ImGui::Checkbox("Fit shadow frustum", &fitShadowFrustum);
+        if (fitShadowFrustum)
+        {
+            ImGui::SliderInt("cascades", &cascadeCount, 1, 4);
+            ImGui::SliderFloat("cascadeLambda", &cascadeLambda, 0.0f, 1.0f);
+            ImGui::SliderFloat("shadowMargin", &shadowMargin, 0.0f, 0.5f);
+        }
+        else
+        {
+            ImGui::SliderFloat("lightDist", &lightDist, 0.001f, 40.0f);
+            ImGui::SliderFloat("lightSize", &lightSize, 0.001f, 40.0f);
+            ImGui::SliderFloat("lightNear", &lightNear, 0.001f, 40.0f);
+            ImGui::SliderFloat("lightFar", &lightFar, 0.001f, 40.0f);
+        }
 
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+        const auto &loadStats = resources.stats();
+        ImGui::Text("Startup %.1f ms to first frame, assets %.1f ms", startupSeconds * 1000.0, assetsReadySeconds * 1000.0);
+        const auto &shaderStats = shaderCacheStats();
+        ImGui::Text("Shaders: %zu in %.1f ms, %zu cached, %zu compiled",
+                    shaderStats.programs, shaderStats.seconds * 1000.0, shaderStats.hits, shaderStats.programs - shaderStats.hits);
+        ImGui::Text("Uploads: %zu of %zu (%zu failed), max %.3f ms/frame, %zu over budget",
+                    loadStats.uploaded, loadStats.requested, loadStats.failed,
+                    loadStats.maxFrameUploadSeconds * 1000.0, loadStats.stalls);
+        const auto &ringStats = resources.textureUploads().stats();
+        ImGui::Text("Texture uploads: %zu, %.1f MB through the %s ring, %zu waits",
+                    ringStats.textures, ringStats.bytes / (1024.0 * 1024.0),
+                    resources.textureUploads().isPersistent() ? "persistent" : "mapped", ringStats.waits);
+        const auto &textureMemory = applesauce::Texture::memory();
+        ImGui::Text("Texture memory: %.2f MB in %zu textures, %.2f MB as RGBA",
+                    textureMemory.bytes / (1024.0 * 1024.0), textureMemory.textures,
+                    textureMemory.uncompressedBytes / (1024.0 * 1024.0));
+        ImGui::Text("Draw calls: %zu (%zu batches, %zu instances), submit %.3f ms",
+                    queueStats.drawCalls, renderStats.batches, renderStats.instances, submitTime.count() * 1000.0);
+        ImGui::Text("Binds: %zu shader, %zu texture, %zu vertex array, %zu saved",
+                    queueStats.shaderBinds, queueStats.textureBinds, queueStats.vertexArrayBinds, queueStats.bindsSaved);
+        ImGui::Text("Material blocks: %zu (%zu bytes, %s ring of %zu bytes a frame, %zu waits)",
+                    materialRing->stats().blocks, materialRing->stats().bytes,
+                    materialRing->isPersistent() ? "persistent" : "copied", materialRing->regionSize(), materialRing->stats().waits);
+        if (atlas)
+        {
+            const auto &atlasStats = atlas->stats();
+            ImGui::Text("Atlas: %zu textures in %zu of %zu layers, %.1f%% occupied",
+                        atlasStats.entries, atlasStats.layersUsed, atlasStats.layerCount, atlasStats.occupancy() * 100.0);
+        }
+        ImGui::Text("Culled: main %zu of %zu, shadow %zu of %zu",
+                    mainCullStats.culled, mainCullStats.tested, shadowCullStats.culled, shadowCullStats.tested);
+
+        if (ImGui::Checkbox("Cache static shadows", &cacheStaticShadows))
+        {
+            shadowCache->invalidate();
+        }
+        size_t castersDrawn = 0;
+        for (size_t c = 0; c < activeCascades; c++)
+        {
+            castersDrawn += shadowRenderers[c].stats().instances + staticShadowRenderers[c].stats().instances;
+            ImGui::Text("Cascade %zu: to %.1f, %.1f texels/unit", c, cascadeSplitDepths[static_cast<int>(c)], cascades[c].texelsPerUnit);
+        }
+        ImGui::Text("Shadow cache rebuilt on %.1f%% of recent frames", shadowRebuilds.mean() * 100.0);
+        ImGui::Text("Shadow pass GPU %.3f ms, %zu casters drawn, cache rebuilt %zu times",
+                    profiler.latest() ? gpuScopeSeconds(*profiler.latest(), "Shadow pass") * 1000.0 : 0.0,
+                    castersDrawn, shadowCache->stats().rebuilds);
+
+        const auto &frameTiming = timing();
+        ImGui::Text("Simulation %s, tick %llu", isThreaded() ? "threaded" : "inline",
+                    static_cast<unsigned long long>(current.tick));
+        ImGui::Text("Latency %.2f ms (max %.2f), frame jitter %.2f ms, tick jitter %.2f ms",
+                    frameTiming.latency.mean() * 1000.0, frameTiming.latency.max() * 1000.0,
+                    frameTiming.frameInterval.deviation() * 1000.0, frameTiming.tickLateness.deviation() * 1000.0);
+        ImGui::Text("Snapshots skipped: %llu, backlogs dropped: %llu",
+                    static_cast<unsigned long long>(frameTiming.snapshotsSkipped),
+                    static_cast<unsigned long long>(frameTiming.backlogsDropped));
 
         ImGui::End();
 
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        drawProfiler(profiler);
+
+        {
+            applesauce::Profiler::GpuScope scope(&profiler, "ImGui");
+            ImGui::Render();
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
 
         /*
                 glDisable(GL_DEPTH_TEST);
@@ -524,34 +897,129 @@ public:
 
     void cleanUp() override
     {
+        if (benchWallCount > 0 && benchFrames > 0)
+        {
+            std::cout << "Benchmark: " << benchWallCount << " extra walls, " << benchFrames << " frames\n";
+            std::cout << "\tDraw calls/frame: " << static_cast<double>(benchDrawCalls) / benchFrames << std::endl;
+            std::cout << "\tCPU submit ms/frame: " << benchSubmitSeconds * 1000.0 / benchFrames << std::endl;
+            std::cout << "\tBinds saved/frame: " << static_cast<double>(benchBindsSaved) / benchFrames << std::endl;
+            std::cout << "\tTexture binds/frame (" << (atlas ? "atlas" : "no atlas") << "): "
+                      << static_cast<double>(benchTextureBinds) / benchFrames << std::endl;
+            std::cout << "\tCulled/frame: main " << static_cast<double>(benchMainCulled) / benchFrames
+                      << ", shadow " << static_cast<double>(benchShadowCulled) / benchFrames << std::endl;
+            std::cout << "\tShadow pass GPU ms/frame (" << (cacheStaticShadows ? "cached" : "uncached") << "): "
+                      << (benchShadowGpuFrames ? benchShadowGpuSeconds * 1000.0 / benchShadowGpuFrames : 0.0)
+                      << ", cache rebuilt " << shadowCache->stats().rebuilds << " times" << std::endl;
+            std::cout << "\tShadow texels/unit (" << (fitShadowFrustum ? "fitted, " + std::to_string(activeCascades) + " cascades" : "fixed")
+                      << "): " << benchTexelsPerUnit / benchFrames << " nearest, cache rebuilt on "
+                      << static_cast<double>(benchShadowRebuilds) * 100.0 / benchFrames << "% of frames" << std::endl;
+        }
+        const auto &loadStats = resources.stats();
+        std::cout << "Asset loading (" << (waitForAssets ? "blocking" : "async") << "):\n";
+        std::cout << "\tFirst frame ms: " << startupSeconds * 1000.0 << ", all uploaded ms: " << assetsReadySeconds * 1000.0 << std::endl;
+        const auto &shaderStats = shaderCacheStats();
+        std::cout << "\tShaders: " << shaderStats.programs << " in " << shaderStats.seconds * 1000.0 << " ms";
+        if (cacheShaders && Shader::binariesSupported())
+            std::cout << ", cache " << shaderStats.hits << " hits, " << shaderStats.misses << " misses, "
+                      << shaderStats.rejected << " rejected, " << shaderStats.writes << " written";
+        else
+            std::cout << ", " << (cacheShaders ? "no program binaries on this driver" : "not cached");
+        std::cout << std::endl;
+        std::cout << "\tUploaded: " << loadStats.uploaded << " of " << loadStats.requested << ", " << loadStats.failed << " failed" << std::endl;
+        std::cout << "\tDecode ms: " << loadStats.decodeSeconds * 1000.0 << " on workers, upload ms: "
+                  << loadStats.uploadSeconds * 1000.0 << " over " << loadStats.uploadFrames << " frames" << std::endl;
+        std::cout << "\tUpload stalls: " << loadStats.stalls << " frames over " << uploadBudget * 1000.0
+                  << " ms, worst " << loadStats.maxFrameUploadSeconds * 1000.0 << " ms" << std::endl;
+        const auto &ringStats = resources.textureUploads().stats();
+        std::cout << "\tTextures: " << ringStats.textures << " (" << ringStats.levels << " levels, "
+                  << ringStats.bytes / (1024.0 * 1024.0) << " MB), " << ringStats.direct << " too large for the ring, "
+                  << ringStats.waits << " waits on the GPU" << std::endl;
+        const auto &textureMemory = applesauce::Texture::memory();
+        std::cout << "\tTexture memory: " << textureMemory.bytes / (1024.0 * 1024.0) << " MB in " << textureMemory.textures
+                  << " textures, " << textureMemory.uncompressedBytes / (1024.0 * 1024.0) << " MB as RGBA" << std::endl;
+        if (atlas)
+        {
+            const auto &atlasStats = atlas->stats();
+            std::cout << "\tAtlas: " << atlasStats.entries << " textures in " << atlasStats.layersUsed << " of "
+                      << atlasStats.layerCount << " " << atlas->layerSize() << "x" << atlas->layerSize() << " layers, "
+                      << atlasStats.occupancy() * 100.0 << "% occupied" << std::endl;
+        }
+        const auto &frameTiming = timing();
+        std::cout << "Frame timing (" << (isThreaded() ? "threaded" : "inline") << " simulation):\n";
+        std::cout << "\tLatency ms: " << frameTiming.latency.mean() * 1000.0 << " mean, "
+                  << frameTiming.latency.max() * 1000.0 << " max" << std::endl;
+        std::cout << "\tFrame ms: " << frameTiming.frameInterval.mean() * 1000.0 << " mean, "
+                  << frameTiming.frameInterval.deviation() * 1000.0 << " jitter" << std::endl;
+        std::cout << "\tTick lateness ms: " << frameTiming.tickLateness.mean() * 1000.0 << " mean, "
+                  << frameTiming.tickLateness.deviation() * 1000.0 << " jitter" << std::endl;
+        std::cout << "\tSnapshots skipped: " << frameTiming.snapshotsSkipped << std::endl;
         std::cout << "Camera Stats:\n";
         std::cout << "\tPitch: " << pitch << std::endl;
         std::cout << "\tTheta: " << theta << std::endl;
         std::cout << "\tDist: " << dist << std::endl;
     }
 
-    std::shared_ptr<applesauce::Entity> spawn(applesauce::Entity *entity, const glm::vec3 &position = glm::vec3{0}, const glm::quat &orientation = glm::quat{glm::vec3{0}}) override
-    {
-        auto e = std::shared_ptr<applesauce::Entity>(entity);
-        e->init(*this);
-        e->position = position;
-        e->orientation = orientation;
-        e->world = this;
-        entities.emplace_back(e);
-        return entities.back();
-    }
-
 private:
     std::shared_ptr<Shader> shader;
     std::shared_ptr<Shader> shadow;
     std::shared_ptr<Shader> quad;
 
-    std::list<std::shared_ptr<applesauce::Entity>> entities;
+    // Linked programs are kept here between runs unless --no-shader-cache
+    static constexpr const char *shaderCacheDirectory = "cache/shaders";
+    bool cacheShaders = true;
+
+    std::unique_ptr<applesauce::UniformBuffer<FrameBlock>> frameUniforms;
+    std::unique_ptr<applesauce::UniformRing> materialRing;
+
+    // Small textures share one array texture unless --no-atlas. Unit 0 stays
+    // the albedo texture of materials outside it, and 1 the shadow map.
+    static constexpr GLint atlasTextureUnit = 2;
+    std::unique_ptr<applesauce::TextureAtlas> atlas;
+    bool useAtlas = true;
 
-    std::unordered_map<std::string, std::shared_ptr<applesauce::Mesh>> meshes;
-    std::unordered_map<std::string, std::shared_ptr<applesauce::Texture>> textures;
+    applesauce::InstancedRenderer renderer;
+    applesauce::InstancedRenderer shadowRenderers[4];
+    applesauce::InstancedRenderer staticShadowRenderers[4];
+    applesauce::RenderQueue renderQueue;
 
-    std::vector<std::shared_ptr<Tenk>> tenks;
+    // Interpolated, one per instance of the current snapshot
+    std::vector<glm::mat4> instanceMatrices;
+
+    // Scratch for culling, one entry per primitive of every entity
+    applesauce::CullingSet cullingSet;
+    struct CullingPrimitive
+    {
+        const applesauce::Mesh::Primitive *primitive;
+        const glm::mat4 *modelMatrix;
+        bool stationary;
+    };
+    std::vector<CullingPrimitive> cullingPrimitives;
+    std::vector<uint8_t> mainVisible;
+    std::vector<uint8_t> shadowVisible[4];
+    applesauce::CullStats mainCullStats;
+    applesauce::CullStats shadowCullStats;
+
+    // Benchmark mode (--bench-walls N), --no-shadow-cache to compare
+    int benchWallCount = 0;
+    size_t benchFrames = 0;
+    size_t benchDrawCalls = 0;
+    size_t benchBindsSaved = 0;
+    size_t benchTextureBinds = 0;
+    size_t benchMainCulled = 0;
+    size_t benchShadowCulled = 0;
+    double benchSubmitSeconds = 0;
+    double benchShadowGpuSeconds = 0;
+    double benchTexelsPerUnit = 0;
+    size_t benchShadowRebuilds = 0;
+    size_t benchShadowGpuFrames = 0;
+
+    // Meshes and textures, loaded in the background. At most uploadBudget
+    // seconds of each frame go to GL uploads (--upload-budget-ms N), or
+    // everything loads before the first frame with --wait-for-assets.
+    applesauce::AsyncResourceManager resources;
+    double uploadBudget = 0.002;
+    bool waitForAssets = false;
+    double assetsReadySeconds = 0;
 
     Camera camera;
     glm::vec3 cameraTarget = glm::vec3{0};
@@ -579,15 +1047,90 @@ private:
     };
 
     // Shadow map bits
-    GLuint depthMapFBO;
-    std::shared_ptr<applesauce::DepthTexture2D> depthMap;
-
-    TileMap tm;
+    std::unique_ptr<applesauce::ShadowMap> shadowMap;
+    std::unique_ptr<applesauce::ShadowCache> shadowCache;
+    bool cacheStaticShadows = true;
+
+    // Shadow frustum, fitted to the camera and the scene in --cascades N
+    // cascades unless --fixed-shadow-frustum
+    applesauce::Bounds sceneBounds;
+    applesauce::ShadowCascade cascades[4];
+    glm::vec4 cascadeSplitDepths{0};
+    size_t activeCascades = 1;
+    bool fitShadowFrustum = true;
+    int cascadeCount = 1;
+    float cascadeLambda = 0.5f;
+    // Room left around a fitted box for the camera to move before it is
+    // fitted again, which rebuilds the shadow cache
+    float shadowMargin = 0.1f;
+    applesauce::RollingStats shadowRebuilds;
+    Shader::UniformHandle cascadeUniform;
+
+    // Streamed from a file with --level, the built in arena otherwise
+    std::string levelPath;
+
+    GameWorld world{resources};
 };
 
-int main()
+int main(int argc, char **argv)
 {
-    Triangles app;
-    app.run();
+    int benchWallCount = 0;
+    bool renderThread = false;
+    bool cacheStaticShadows = true;
+    int cascadeCount = 1;
+    std::string levelPath;
+    double uploadBudget = 0.002;
+    bool waitForAssets = false;
+    bool useAtlas = true;
+    bool cacheShaders = true;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--bench-walls") == 0 && i + 1 < argc)
+        {
+            benchWallCount = std::max(0, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--render-thread") == 0)
+        {
+            renderThread = true;
+        }
+        else if (std::strcmp(argv[i], "--no-shadow-cache") == 0)
+        {
+            cacheStaticShadows = false;
+        }
+        else if (std::strcmp(argv[i], "--cascades") == 0 && i + 1 < argc)
+        {
+            cascadeCount = std::clamp(std::atoi(argv[++i]), 1, 4);
+        }
+        else if (std::strcmp(argv[i], "--fixed-shadow-frustum") == 0)
+        {
+            cascadeCount = 0;
+        }
+        else if (std::strcmp(argv[i], "--level") == 0 && i + 1 < argc)
+        {
+            levelPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--upload-budget-ms") == 0 && i + 1 < argc)
+        {
+            uploadBudget = std::max(0.0, std::atof(argv[++i])) / 1000.0;
+        }
+        else if (std::strcmp(argv[i], "--wait-for-assets") == 0)
+        {
+            waitForAssets = true;
+        }
+        else if (std::strcmp(argv[i], "--no-atlas") == 0)
+        {
+            useAtlas = false;
+        }
+        else if (std::strcmp(argv[i], "--no-shader-cache") == 0)
+        {
+            cacheShaders = false;
+        }
+    }
+
+    Triangles app(benchWallCount, cacheStaticShadows, cascadeCount, levelPath, uploadBudget, waitForAssets, useAtlas, cacheShaders);
+    if (renderThread)
+        app.run_threaded();
+    else
+        app.run();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,248 @@
+// Headless build of the game: no window, no GL, no rendering. Runs the fixed
+// step update as fast as the CPU allows with scripted input, for load and
+// soak testing.
+//
+//   simulation [--ticks N] [--seed S] [--threads N] [--drones N] [--profile trace.json]
+//              [--level file.level] [--write-level file.level]
+//
+// --threads spreads each tick over a job system with that many threads, 0
+// for one per core. --drones swaps the arena for an open field with that
+// many entities bouncing around it, to measure how the update scales.
+// --level streams the tile map from a level file instead, --write-level
+// writes the play field that would have been simulated to one and exits.
+// With --profile the last few thousand ticks are timed with CPU scopes and
+// written out as a Chrome trace.
+
+#include "applesauce/Entity.h"
+#include "applesauce/Input.h"
+#include "applesauce/InputScript.h"
+#include "applesauce/JobSystem.h"
+#include "applesauce/Profiler.h"
+
+#include "game/GameWorld.h"
+#include "game/LevelFile.h"
+#include "game/entities/Tenk.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+
+static constexpr float step = 1.0f / 60.0f;
+
+// Both players mash random controls, changing their mind every half second or so
+static applesauce::InputScript randomScript(uint64_t ticks, unsigned int seed)
+{
+    const int keys[2][5] = {
+        {GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_SPACE},
+        {GLFW_KEY_LEFT, GLFW_KEY_RIGHT, GLFW_KEY_UP, GLFW_KEY_DOWN, GLFW_KEY_PERIOD},
+    };
+
+    std::mt19937 rng(seed);
+    applesauce::InputScript script;
+    for (const auto &playerKeys : keys)
+    {
+        for (uint64_t tick = 0; tick < ticks;)
+        {
+            const uint64_t duration = 10 + rng() % 50;
+            const int key = playerKeys[rng() % 5];
+            script.hold(tick, duration, key);
+            tick += duration + rng() % 10;
+        }
+    }
+    return script;
+}
+
+// Bounces off the walls forever, never touching anything else
+class Drone : public applesauce::Entity
+{
+public:
+    void init(applesauce::ResourceManager &) override
+    {
+        collider() = {true, 0.25f};
+        setKinematic(true);
+    }
+
+    void onTouch(const glm::vec3 &normal) override
+    {
+        velocity() = glm::reflect(velocity(), normal);
+    }
+};
+
+// Walled in square with a pillar every few tiles, roomy enough for the
+// given number of drones
+static std::string droneField(size_t drones)
+{
+    const auto side = std::max<size_t>(32, static_cast<size_t>(std::sqrt(static_cast<double>(drones) * 4.0)));
+    std::string field;
+    for (size_t row = 0; row < side; row++)
+    {
+        for (size_t col = 0; col < side; col++)
+        {
+            const bool border = row == 0 || col == 0 || row == side - 1 || col == side - 1;
+            const bool pillar = row % 8 == 4 && col % 8 == 4;
+            field += border || pillar ? '*' : ' ';
+        }
+        field += '\n';
+    }
+    return field;
+}
+
+static void spawnDrones(GameWorld &world, size_t drones, unsigned int seed)
+{
+    std::mt19937 rng(seed);
+    const auto extent = static_cast<float>(world.size().columns) / 2.0f - 2.0f;
+    std::uniform_real_distribution<float> coordinate(-extent, extent);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    for (size_t i = 0; i < drones; i++)
+    {
+        auto drone = world.spawn<Drone>(glm::vec3{coordinate(rng), 0, coordinate(rng)});
+        const auto heading = angle(rng);
+        drone->velocity() = glm::vec3{std::cos(heading), 0, std::sin(heading)} * 3.0f;
+    }
+}
+
+// Order dependent hash of where everything ended up, to compare runs
+static uint64_t checksum(const GameWorld &world)
+{
+    uint64_t hash = 14695981039346656037ull;
+    const auto mix = [&hash](float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        hash = (hash ^ bits) * 1099511628211ull;
+    };
+    for (const auto &position : world.components().positions)
+    {
+        mix(position.x);
+        mix(position.y);
+        mix(position.z);
+    }
+    return hash;
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t ticks = 60 * 60 * 10;
+    unsigned int seed = 1;
+    const char *profilePath = nullptr;
+    size_t drones = 0;
+    long threads = -1;
+    const char *levelPath = nullptr;
+    const char *writeLevelPath = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--ticks") == 0 && i + 1 < argc)
+        {
+            ticks = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = std::strtol(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--drones") == 0 && i + 1 < argc)
+        {
+            drones = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+        {
+            profilePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--level") == 0 && i + 1 < argc)
+        {
+            levelPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--write-level") == 0 && i + 1 < argc)
+        {
+            writeLevelPath = argv[++i];
+        }
+    }
+
+    std::srand(seed);
+    applesauce::Input::init();
+
+    applesauce::NullResourceManager resources;
+    GameWorld world(resources);
+    const auto field = drones ? droneField(drones) : std::string(arenaPlayField);
+    if (writeLevelPath)
+    {
+        writeLevelFile(writeLevelPath, parsePlayField(field.c_str()));
+        std::cout << "Wrote " << writeLevelPath << std::endl;
+        return 0;
+    }
+    if (levelPath)
+        world.loadLevel(levelPath);
+    else
+        world.load(field.c_str());
+    spawnDrones(world, drones, seed);
+
+    std::unique_ptr<applesauce::JobSystem> jobs;
+    if (threads >= 0)
+    {
+        jobs = std::make_unique<applesauce::JobSystem>(static_cast<size_t>(threads));
+        world.setJobSystem(jobs.get());
+    }
+
+    auto script = randomScript(ticks, seed);
+
+    std::unique_ptr<applesauce::Profiler> profiler;
+    if (profilePath)
+    {
+        profiler = std::make_unique<applesauce::Profiler>(applesauce::Profiler::Mode::cpuOnly, 3600);
+        world.setProfiler(profiler.get());
+    }
+
+    size_t peakEntities = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t tick = 0; tick < ticks; tick++)
+    {
+        if (profiler)
+            profiler->beginFrame();
+        applesauce::Input::beginFrame();
+        script.apply(tick);
+        world.update(step);
+        peakEntities = std::max(peakEntities, world.entities().size());
+        if (profiler)
+            profiler->endFrame();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "Simulated " << ticks << " ticks (" << ticks * step << " s of game time) in "
+              << elapsed.count() << " s\n";
+    std::cout << "\tTicks/sec: " << static_cast<double>(ticks) / elapsed.count() << "\n";
+    std::cout << "\tThreads: " << (jobs ? jobs->threadCount() : 1) << "\n";
+    std::cout << "\tEntities: " << world.entities().size() << " (peak " << peakEntities << ")\n";
+    std::cout << "\tChecksum: " << std::hex << checksum(world) << std::dec << std::endl;
+    if (world.tileMap().isStreaming())
+    {
+        const auto &tiles = world.tileMap().stats();
+        std::cout << "\tTile chunks: " << tiles.residentChunks << " of " << world.tileMap().chunkCount() << " resident ("
+                  << tiles.residentBytes / 1024 << " KiB), " << tiles.chunksLoaded << " loaded, " << tiles.chunksEvicted << " evicted\n";
+        std::cout << "\tChunk load ms: " << (tiles.chunksLoaded ? tiles.loadSeconds * 1000.0 / tiles.chunksLoaded : 0.0)
+                  << " mean, " << tiles.maxLoadSeconds * 1000.0 << " max" << std::endl;
+    }
+
+    if (profiler)
+    {
+        std::ofstream trace(profilePath);
+        profiler->writeChromeTrace(trace);
+        if (!trace)
+        {
+            std::cerr << "Could not write " << profilePath << std::endl;
+            return 1;
+        }
+        std::cout << "\tProfile: last " << profiler->frameCount() << " ticks written to " << profilePath << std::endl;
+    }
+    return 0;
+}
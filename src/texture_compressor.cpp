@@ -0,0 +1,79 @@
+// Offline texture compression. Encodes a PNG and its mip chain as BC1, or
+// BC3 when the alpha matters, and writes them to a DDS file that
+// textureFromCompressedFile() uploads as is.
+//
+//   texture_compressor [--bc3] <input png> <output dds>
+
+#include "util/CompressedImage.h"
+#include "util/Image.h"
+
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Of level 0 against the source, over the colour channels and alpha
+static double peakSignalToNoise(const Image &source, const Image &decoded)
+{
+    double squaredError = 0;
+    for (size_t i = 0; i < source.pixels.size(); i++)
+    {
+        const double difference = static_cast<double>(source.pixels[i]) - decoded.pixels[i];
+        squaredError += difference * difference;
+    }
+    const auto meanSquaredError = squaredError / static_cast<double>(source.pixels.size());
+    return meanSquaredError > 0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : INFINITY;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> arguments(argv + 1, argv + argc);
+    auto format = CompressedImage::Format::bc1;
+    if (!arguments.empty() && arguments.front() == "--bc3")
+    {
+        format = CompressedImage::Format::bc3;
+        arguments.erase(arguments.begin());
+    }
+    if (arguments.size() != 2)
+    {
+        std::cerr << "usage: texture_compressor [--bc3] <input png> <output dds>" << std::endl;
+        return 1;
+    }
+    const auto &input = arguments[0];
+    const auto &output = arguments[1];
+
+    try
+    {
+        const auto image = imageFromPNG(input.c_str());
+        if (image.empty())
+        {
+            throw std::runtime_error("Unable to read \"" + input + "\"");
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto mips = generateMipChain(image);
+        const auto compressed = compressMipChain(mips, format);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        writeDDS(output.c_str(), compressed);
+
+        size_t rgbaBytes = 0;
+        size_t compressedBytes = 0;
+        for (size_t level = 0; level < mips.size(); level++)
+        {
+            rgbaBytes += mips[level].pixels.size();
+            compressedBytes += compressed.levels[level].blocks.size();
+        }
+        std::cout << (format == CompressedImage::Format::bc3 ? "BC3 " : "BC1 ") << input << " " << image.width << "x"
+                  << image.height << ", " << mips.size() << " mips in " << elapsed.count() * 1000.0 << " ms" << std::endl;
+        std::cout << "wrote " << output << " (" << compressedBytes << " bytes of blocks, " << rgbaBytes << " as RGBA), PSNR "
+                  << peakSignalToNoise(image, decompressLevel(compressed, 0)) << " dB" << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "texture_compressor: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
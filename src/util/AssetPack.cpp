@@ -0,0 +1,368 @@
+#include "AssetPack.h"
+#include "gltf.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+static bool fits(uint64_t offset, uint64_t size, uint64_t limit)
+{
+    return offset <= limit && size <= limit - offset;
+}
+
+AssetPack::AssetPack(const std::string &filename) : file(filename)
+{
+    if (!file.isOpen())
+    {
+        throw std::runtime_error("AssetPack: Unable to open \"" + filename + "\"");
+    }
+    validate();
+}
+
+const AssetPack::Header &AssetPack::header() const
+{
+    return *reinterpret_cast<const Header *>(file.data());
+}
+
+template <typename T>
+AssetPack::Records<T> AssetPack::records(const Section &section) const
+{
+    return {reinterpret_cast<const T *>(file.data() + section.offset), static_cast<size_t>(section.size / sizeof(T))};
+}
+
+AssetPack::Records<AssetPack::MeshRecord> AssetPack::meshes() const
+{
+    return records<MeshRecord>(header().meshes);
+}
+
+AssetPack::Records<AssetPack::PrimitiveRecord> AssetPack::primitives() const
+{
+    return records<PrimitiveRecord>(header().primitives);
+}
+
+AssetPack::Records<AssetPack::MaterialRecord> AssetPack::materials() const
+{
+    return records<MaterialRecord>(header().materials);
+}
+
+AssetPack::Records<AssetPack::TextureRecord> AssetPack::textures() const
+{
+    return records<TextureRecord>(header().textures);
+}
+
+AssetPack::Records<AssetPack::MipRecord> AssetPack::mips() const
+{
+    return records<MipRecord>(header().mips);
+}
+
+const char *AssetPack::string(uint32_t offset) const
+{
+    return reinterpret_cast<const char *>(file.data() + header().strings.offset + offset);
+}
+
+const uint8_t *AssetPack::blob(uint64_t offset) const
+{
+    return file.data() + header().blobs.offset + offset;
+}
+
+const AssetPack::Vertex *AssetPack::vertices(const PrimitiveRecord &primitive) const
+{
+    return reinterpret_cast<const Vertex *>(blob(primitive.vertexOffset));
+}
+
+const uint16_t *AssetPack::indices(const PrimitiveRecord &primitive) const
+{
+    return reinterpret_cast<const uint16_t *>(blob(primitive.indexOffset));
+}
+
+const AssetPack::TextureRecord *AssetPack::findTexture(const std::string &name) const
+{
+    for (const auto &texture : textures())
+    {
+        if (name == string(texture.name))
+        {
+            return &texture;
+        }
+    }
+    return nullptr;
+}
+
+void AssetPack::validate() const
+{
+    const auto fail = [](const std::string &reason)
+    { throw std::runtime_error("AssetPack: " + reason); };
+
+    if (file.size() < sizeof(Header))
+        fail("File is too small");
+    if (header().magic != magic)
+        fail("Not an asset pack");
+    if (header().version != version)
+        fail("Version " + std::to_string(header().version) + " is not supported, rebuild with asset_baker");
+
+    const auto checkSection = [&](const Section &section, size_t recordSize, const char *name)
+    {
+        if (section.offset % pageSize != 0 || !fits(section.offset, section.size, file.size()) ||
+            section.size % recordSize != 0)
+        {
+            fail(std::string("Malformed ") + name + " section");
+        }
+    };
+    const auto &h = header();
+    checkSection(h.meshes, sizeof(MeshRecord), "mesh");
+    checkSection(h.primitives, sizeof(PrimitiveRecord), "primitive");
+    checkSection(h.materials, sizeof(MaterialRecord), "material");
+    checkSection(h.textures, sizeof(TextureRecord), "texture");
+    checkSection(h.mips, sizeof(MipRecord), "mip");
+    checkSection(h.strings, 1, "string");
+    checkSection(h.blobs, 1, "blob");
+
+    if (h.strings.size > 0 && *(file.data() + h.strings.offset + h.strings.size - 1) != '\0')
+        fail("Unterminated string table");
+    const auto checkString = [&](uint32_t offset)
+    {
+        if (offset >= h.strings.size)
+            fail("String out of range");
+    };
+    const auto checkBlob = [&](uint64_t offset, uint64_t size, uint64_t alignment)
+    {
+        if (offset % alignment != 0 || !fits(offset, size, h.blobs.size))
+            fail("Data out of range");
+    };
+
+    for (const auto &mesh : meshes())
+    {
+        checkString(mesh.source);
+        checkString(mesh.name);
+        if (!fits(mesh.firstPrimitive, mesh.primitiveCount, primitives().size()))
+            fail("Mesh primitives out of range");
+    }
+    for (const auto &primitive : primitives())
+    {
+        if (primitive.material >= materials().size())
+            fail("Primitive material out of range");
+        checkBlob(primitive.vertexOffset, uint64_t{primitive.vertexCount} * sizeof(Vertex), alignof(Vertex));
+        checkBlob(primitive.indexOffset, uint64_t{primitive.indexCount} * sizeof(uint16_t), alignof(uint16_t));
+    }
+    for (const auto &material : materials())
+    {
+        if (material.texture < -1 || material.texture >= static_cast<int64_t>(textures().size()))
+            fail("Material texture out of range");
+    }
+    for (const auto &texture : textures())
+    {
+        checkString(texture.name);
+        if (!fits(texture.firstMip, texture.mipCount, mips().size()))
+            fail("Texture mips out of range");
+    }
+    for (const auto &mip : mips())
+    {
+        if (mip.size != uint64_t{mip.width} * mip.height * 4)
+            fail("Mip size does not match its dimensions");
+        checkBlob(mip.offset, mip.size, 1);
+    }
+}
+
+uint32_t AssetPackWriter::addString(const std::string &text)
+{
+    const auto offset = static_cast<uint32_t>(strings.size());
+    strings.insert(strings.end(), text.begin(), text.end());
+    strings.push_back('\0');
+    return offset;
+}
+
+uint64_t AssetPackWriter::addBlob(const void *data, size_t size)
+{
+    blobs.resize((blobs.size() + AssetPack::blobAlignment - 1) / AssetPack::blobAlignment * AssetPack::blobAlignment);
+    const auto offset = blobs.size();
+    const auto bytes = static_cast<const uint8_t *>(data);
+    blobs.insert(blobs.end(), bytes, bytes + size);
+    return offset;
+}
+
+void AssetPackWriter::addMesh(const std::string &source, const std::string &name, const std::vector<Primitive> &meshPrimitives)
+{
+    meshes.push_back({addString(source), addString(name), static_cast<uint32_t>(primitives.size()),
+                      static_cast<uint32_t>(meshPrimitives.size())});
+    for (const auto &primitive : meshPrimitives)
+    {
+        AssetPack::PrimitiveRecord record{};
+        record.material = static_cast<uint32_t>(materials.size());
+        record.vertexCount = static_cast<uint32_t>(primitive.vertices.size());
+        record.indexCount = static_cast<uint32_t>(primitive.indices.size());
+        record.vertexOffset = addBlob(primitive.vertices.data(), primitive.vertices.size() * sizeof(AssetPack::Vertex));
+        record.indexOffset = addBlob(primitive.indices.data(), primitive.indices.size() * sizeof(uint16_t));
+        for (size_t v = 0; v < primitive.vertices.size(); v++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                const float value = primitive.vertices[v].position[axis];
+                record.boundsMin[axis] = v == 0 ? value : std::min(record.boundsMin[axis], value);
+                record.boundsMax[axis] = v == 0 ? value : std::max(record.boundsMax[axis], value);
+            }
+        }
+        primitives.push_back(record);
+        materials.push_back(primitive.material);
+    }
+}
+
+// Reads element i of a float accessor, whatever its stride
+static void readFloats(glTFBufferCache &cache, const glTF &gltf, int accessorIndex, int componentCount,
+                       size_t i, float *out)
+{
+    const auto &accessor = gltf.accessors.at(accessorIndex);
+    if (accessor.componentType != glTF::Accessor::ComponentType::FLOAT || accessor.componentCount() != componentCount)
+    {
+        throw std::runtime_error("glTF: Accessor " + std::to_string(accessorIndex) + " is not a float vector");
+    }
+    const auto elementSize = sizeof(float) * componentCount;
+    const auto stride = gltf.bufferViews.at(accessor.bufferView).byteStride;
+    const auto view = cache.accessor(accessorIndex);
+    const auto offset = i * (stride > 0 ? static_cast<size_t>(stride) : elementSize);
+    if (offset + elementSize > view.size)
+    {
+        throw std::runtime_error("glTF: Accessor " + std::to_string(accessorIndex) + " is out of range");
+    }
+    std::memcpy(out, view.data + offset, elementSize);
+}
+
+static std::vector<uint16_t> readIndices(glTFBufferCache &cache, const glTF &gltf, int accessorIndex)
+{
+    using ComponentType = glTF::Accessor::ComponentType;
+    const auto &accessor = gltf.accessors.at(accessorIndex);
+    size_t indexSize = 0;
+    switch (accessor.componentType)
+    {
+    case ComponentType::UNSIGNED_BYTE:
+        indexSize = 1;
+        break;
+    case ComponentType::UNSIGNED_SHORT:
+        indexSize = 2;
+        break;
+    case ComponentType::UNSIGNED_INT:
+        indexSize = 4;
+        break;
+    default:
+        throw std::runtime_error("glTF: Accessor " + std::to_string(accessorIndex) + " has an unsupported index type");
+    }
+
+    const auto view = cache.accessor(accessorIndex);
+    if (static_cast<size_t>(accessor.count) * indexSize > view.size)
+    {
+        throw std::runtime_error("glTF: Accessor " + std::to_string(accessorIndex) + " is out of range");
+    }
+
+    std::vector<uint16_t> result(accessor.count);
+    for (size_t i = 0; i < result.size(); i++)
+    {
+        uint32_t index = 0;
+        std::memcpy(&index, view.data + i * indexSize, indexSize);
+        if (index > std::numeric_limits<uint16_t>::max())
+        {
+            throw std::runtime_error("glTF: Accessor " + std::to_string(accessorIndex) + " needs 32 bit indices");
+        }
+        result[i] = static_cast<uint16_t>(index);
+    }
+    return result;
+}
+
+void AssetPackWriter::addglTF(const std::string &source, const glTF &gltf)
+{
+    glTFBufferCache cache(gltf);
+    for (const auto &mesh : gltf.meshes)
+    {
+        std::vector<Primitive> meshPrimitives;
+        for (const auto &gltfPrimitive : mesh.primitives)
+        {
+            const auto attribute = [&](const char *name)
+            {
+                const auto found = gltfPrimitive.attributes.find(name);
+                return found == gltfPrimitive.attributes.end() ? -1 : found->second;
+            };
+            const int position = attribute("POSITION");
+            const int normal = attribute("NORMAL");
+            const int texcoord = attribute("TEXCOORD_0");
+            if (position < 0 || gltfPrimitive.indices < 0)
+            {
+                throw std::runtime_error("glTF: Mesh \"" + mesh.name + "\" has a primitive without positions or indices");
+            }
+
+            Primitive primitive{};
+            primitive.vertices.resize(gltf.accessors.at(position).count);
+            for (size_t i = 0; i < primitive.vertices.size(); i++)
+            {
+                auto &vertex = primitive.vertices[i];
+                readFloats(cache, gltf, position, 3, i, vertex.position);
+                if (normal >= 0)
+                    readFloats(cache, gltf, normal, 3, i, vertex.normal);
+                if (texcoord >= 0)
+                    readFloats(cache, gltf, texcoord, 2, i, vertex.texcoord);
+            }
+            primitive.indices = readIndices(cache, gltf, gltfPrimitive.indices);
+
+            primitive.material = {{1.0f, 1.0f, 1.0f}, 1.0f, 1.0f, -1};
+            if (gltfPrimitive.material >= 0)
+            {
+                const auto &pbr = gltf.materials.at(gltfPrimitive.material).pbrMetallicRoughness;
+                primitive.material = {{pbr.baseColorFactor[0], pbr.baseColorFactor[1], pbr.baseColorFactor[2]},
+                                      pbr.metallicFactor,
+                                      pbr.roughnessFactor,
+                                      -1};
+            }
+            meshPrimitives.push_back(std::move(primitive));
+        }
+        addMesh(source, mesh.name, meshPrimitives);
+    }
+}
+
+void AssetPackWriter::addTexture(const std::string &name, const std::vector<Image> &textureMips)
+{
+    if (textureMips.empty())
+    {
+        throw std::runtime_error("AssetPack: Texture \"" + name + "\" has no image");
+    }
+    textures.push_back({addString(name), textureMips.front().width, textureMips.front().height,
+                        static_cast<uint32_t>(mips.size()), static_cast<uint32_t>(textureMips.size()), 0});
+    for (const auto &mip : textureMips)
+    {
+        mips.push_back({mip.width, mip.height, addBlob(mip.pixels.data(), mip.pixels.size()), mip.pixels.size()});
+    }
+}
+
+std::vector<uint8_t> AssetPackWriter::build() const
+{
+    std::vector<uint8_t> result(sizeof(AssetPack::Header));
+    AssetPack::Header header{};
+    header.magic = AssetPack::magic;
+    header.version = AssetPack::version;
+
+    const auto place = [&](AssetPack::Section &section, const void *data, size_t size)
+    {
+        result.resize((result.size() + AssetPack::pageSize - 1) / AssetPack::pageSize * AssetPack::pageSize);
+        section = {result.size(), size};
+        const auto bytes = static_cast<const uint8_t *>(data);
+        result.insert(result.end(), bytes, bytes + size);
+    };
+    place(header.meshes, meshes.data(), meshes.size() * sizeof(meshes[0]));
+    place(header.primitives, primitives.data(), primitives.size() * sizeof(primitives[0]));
+    place(header.materials, materials.data(), materials.size() * sizeof(materials[0]));
+    place(header.textures, textures.data(), textures.size() * sizeof(textures[0]));
+    place(header.mips, mips.data(), mips.size() * sizeof(mips[0]));
+    place(header.strings, strings.data(), strings.size());
+    place(header.blobs, blobs.data(), blobs.size());
+
+    std::memcpy(result.data(), &header, sizeof(header));
+    return result;
+}
+
+void AssetPackWriter::write(const std::string &filename) const
+{
+    const auto bytes = build();
+    std::ofstream out(filename, std::ios::binary);
+    out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!out)
+    {
+        throw std::runtime_error("AssetPack: Unable to write \"" + filename + "\"");
+    }
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "Image.h"
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct glTF;
+
+// Baked assets, laid out the way they get handed to GL so that loading is
+// just mapping the file. The header is followed by one section per record
+// type plus a string table and a blob section for vertex, index and pixel
+// data. Every section starts on a page boundary.
+class AssetPack
+{
+public:
+    static constexpr uint32_t magic = 0x4b415041; // "APAK"
+    static constexpr uint32_t version = 2;
+    static constexpr uint32_t pageSize = 4096;
+    static constexpr uint32_t blobAlignment = 16;
+
+    struct Section
+    {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        Section meshes;
+        Section primitives;
+        Section materials;
+        Section textures;
+        Section mips;
+        Section strings;
+        Section blobs;
+    };
+
+    // Interleaved position, normal and texcoord
+    struct Vertex
+    {
+        float position[3];
+        float normal[3];
+        float texcoord[2];
+    };
+
+    // Names are offsets into the string section. source is the file the mesh
+    // was baked from, without directory or extension.
+    struct MeshRecord
+    {
+        uint32_t source;
+        uint32_t name;
+        uint32_t firstPrimitive;
+        uint32_t primitiveCount;
+    };
+
+    // Data offsets are relative to the blob section. Indices are 16 bit.
+    // Bounds are the model space box around the positions.
+    struct PrimitiveRecord
+    {
+        uint32_t material;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t padding;
+        uint64_t vertexOffset;
+        uint64_t indexOffset;
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+
+    struct MaterialRecord
+    {
+        float baseColor[3];
+        float metallicFactor;
+        float roughnessFactor;
+        int32_t texture; // -1 for none
+    };
+
+    struct TextureRecord
+    {
+        uint32_t name;
+        uint32_t width;
+        uint32_t height;
+        uint32_t firstMip;
+        uint32_t mipCount;
+        uint32_t padding;
+    };
+
+    // RGBA8 pixels in the blob section
+    struct MipRecord
+    {
+        uint32_t width;
+        uint32_t height;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    template <typename T>
+    struct Records
+    {
+        const T *data;
+        size_t count;
+
+        const T *begin() const { return data; }
+        const T *end() const { return data + count; }
+        size_t size() const { return count; }
+        const T &operator[](size_t i) const { return data[i]; }
+    };
+
+    // Maps and validates the pack, throws std::runtime_error if it is missing,
+    // from another version or any record points outside the file.
+    explicit AssetPack(const std::string &filename);
+
+    Records<MeshRecord> meshes() const;
+    Records<PrimitiveRecord> primitives() const;
+    Records<MaterialRecord> materials() const;
+    Records<TextureRecord> textures() const;
+    Records<MipRecord> mips() const;
+
+    const char *string(uint32_t offset) const;
+    const uint8_t *blob(uint64_t offset) const;
+
+    const Vertex *vertices(const PrimitiveRecord &primitive) const;
+    const uint16_t *indices(const PrimitiveRecord &primitive) const;
+
+    // nullptr when not in the pack
+    const TextureRecord *findTexture(const std::string &name) const;
+
+    size_t size() const
+    {
+        return file.size();
+    }
+
+private:
+    const Header &header() const;
+    template <typename T>
+    Records<T> records(const Section &section) const;
+    void validate() const;
+
+    MappedFile file;
+};
+
+class AssetPackWriter
+{
+public:
+    struct Primitive
+    {
+        std::vector<AssetPack::Vertex> vertices;
+        std::vector<uint16_t> indices;
+        AssetPack::MaterialRecord material;
+    };
+
+    void addMesh(const std::string &source, const std::string &name, const std::vector<Primitive> &primitives);
+
+    // Every mesh in the file. Positions, normals and texcoords are converted
+    // to interleaved floats, indices to 16 bit. Throws std::runtime_error for
+    // anything the runtime can't draw.
+    void addglTF(const std::string &source, const glTF &gltf);
+
+    // mips[0] is the full size image
+    void addTexture(const std::string &name, const std::vector<Image> &mips);
+
+    std::vector<uint8_t> build() const;
+
+    // Throws std::runtime_error when the file can't be written
+    void write(const std::string &filename) const;
+
+private:
+    uint32_t addString(const std::string &text);
+    uint64_t addBlob(const void *data, size_t size);
+
+    std::vector<AssetPack::MeshRecord> meshes;
+    std::vector<AssetPack::PrimitiveRecord> primitives;
+    std::vector<AssetPack::MaterialRecord> materials;
+    std::vector<AssetPack::TextureRecord> textures;
+    std::vector<AssetPack::MipRecord> mips;
+    std::vector<char> strings;
+    std::vector<uint8_t> blobs;
+};
@@ -0,0 +1,651 @@
+#include "CompressedImage.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+// Both containers are little endian, as is everything this runs on
+template <typename T>
+static T read(const uint8_t *data, size_t offset)
+{
+    T value;
+    std::memcpy(&value, data + offset, sizeof(T));
+    return value;
+}
+
+static bool fits(uint64_t offset, uint64_t size, uint64_t total)
+{
+    return offset <= total && size <= total - offset;
+}
+
+static constexpr uint32_t fourCC(const char (&code)[5])
+{
+    return static_cast<uint32_t>(code[0]) | static_cast<uint32_t>(code[1]) << 8 |
+           static_cast<uint32_t>(code[2]) << 16 | static_cast<uint32_t>(code[3]) << 24;
+}
+
+// Levels one after another from offset, each half the size of the last
+static void readLevels(CompressedImage &image, const uint8_t *data, size_t size, size_t offset,
+                       uint32_t width, uint32_t height, uint32_t levelCount, const char *container)
+{
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        const auto bytes = CompressedImage::levelBytes(image.format, width, height);
+        if (!fits(offset, bytes, size))
+        {
+            throw std::runtime_error(std::string(container) + ": Level " + std::to_string(level) + " is out of range");
+        }
+        image.levels.push_back({width, height, std::vector<uint8_t>(data + offset, data + offset + bytes)});
+        offset += bytes;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+}
+
+// DDS
+
+namespace dds
+{
+    constexpr size_t headerSize = 124;
+    constexpr size_t dx10HeaderSize = 20;
+
+    // Offsets into the header, after the magic number
+    constexpr size_t flags = 4;
+    constexpr size_t height = 8;
+    constexpr size_t width = 12;
+    constexpr size_t pitchOrLinearSize = 16;
+    constexpr size_t mipMapCount = 24;
+    constexpr size_t pixelFormat = 72;
+    constexpr size_t pixelFormatFlags = pixelFormat + 4;
+    constexpr size_t pixelFormatFourCC = pixelFormat + 8;
+    constexpr size_t caps = 104;
+    constexpr size_t caps2 = 108;
+
+    constexpr uint32_t flagCaps = 0x1;
+    constexpr uint32_t flagHeight = 0x2;
+    constexpr uint32_t flagWidth = 0x4;
+    constexpr uint32_t flagPixelFormat = 0x1000;
+    constexpr uint32_t flagMipMapCount = 0x20000;
+    constexpr uint32_t flagLinearSize = 0x80000;
+    constexpr uint32_t pixelFormatHasFourCC = 0x4;
+    constexpr uint32_t capsComplex = 0x8;
+    constexpr uint32_t capsTexture = 0x1000;
+    constexpr uint32_t capsMipMap = 0x400000;
+    // Cube maps and volumes
+    constexpr uint32_t caps2NotFlat = 0x200 | 0x200000;
+
+    constexpr uint32_t dimensionTexture2D = 3;
+    constexpr uint32_t dxgiBC1 = 71;
+    constexpr uint32_t dxgiBC3 = 77;
+    constexpr uint32_t dxgiBC7 = 98;
+}
+
+static CompressedImage imageFromDDS(const uint8_t *data, size_t size)
+{
+    const auto fail = [](const std::string &reason)
+    { throw std::runtime_error("DDS: " + reason); };
+
+    if (size < 4 + dds::headerSize)
+        fail("File is too small");
+    const auto header = data + 4;
+    if (read<uint32_t>(header, 0) != dds::headerSize)
+        fail("Malformed header");
+    if (read<uint32_t>(header, dds::caps2) & dds::caps2NotFlat)
+        fail("Only 2D textures are supported");
+    if (!(read<uint32_t>(header, dds::pixelFormatFlags) & dds::pixelFormatHasFourCC))
+        fail("Only block compressed textures are supported");
+
+    CompressedImage image;
+    size_t offset = 4 + dds::headerSize;
+    switch (read<uint32_t>(header, dds::pixelFormatFourCC))
+    {
+    case fourCC("DXT1"):
+        image.format = CompressedImage::Format::bc1;
+        break;
+    case fourCC("DXT5"):
+        image.format = CompressedImage::Format::bc3;
+        break;
+    case fourCC("DX10"):
+    {
+        if (!fits(offset, dds::dx10HeaderSize, size))
+            fail("File is too small");
+        const auto dx10 = data + offset;
+        offset += dds::dx10HeaderSize;
+        if (read<uint32_t>(dx10, 4) != dds::dimensionTexture2D || read<uint32_t>(dx10, 12) > 1)
+            fail("Only 2D textures are supported");
+
+        // Typeless, UNORM and sRGB come in that order for each
+        const auto dxgiFormat = read<uint32_t>(dx10, 0);
+        if (dxgiFormat >= dds::dxgiBC1 - 1 && dxgiFormat <= dds::dxgiBC1 + 1)
+            image.format = CompressedImage::Format::bc1;
+        else if (dxgiFormat >= dds::dxgiBC3 - 1 && dxgiFormat <= dds::dxgiBC3 + 1)
+            image.format = CompressedImage::Format::bc3;
+        else if (dxgiFormat >= dds::dxgiBC7 - 1 && dxgiFormat <= dds::dxgiBC7 + 1)
+            image.format = CompressedImage::Format::bc7;
+        else
+            fail("DXGI format " + std::to_string(dxgiFormat) + " is not supported");
+        break;
+    }
+    default:
+        fail("Only BC1, BC3 and BC7 are supported");
+    }
+
+    const auto width = read<uint32_t>(header, dds::width);
+    const auto height = read<uint32_t>(header, dds::height);
+    if (width == 0 || height == 0)
+        fail("Empty texture");
+    const auto mipMapCount = read<uint32_t>(header, dds::mipMapCount);
+    const auto levelCount = (read<uint32_t>(header, dds::flags) & dds::flagMipMapCount) && mipMapCount > 0 ? mipMapCount : 1;
+    if (levelCount > 32)
+        fail("Too many levels");
+
+    readLevels(image, data, size, offset, width, height, levelCount, "DDS");
+    return image;
+}
+
+void writeDDS(const char *filename, const CompressedImage &image)
+{
+    if (image.empty())
+    {
+        throw std::runtime_error("DDS: Nothing to write to \"" + std::string(filename) + "\"");
+    }
+
+    const auto &top = image.levels.front();
+    const auto levelCount = static_cast<uint32_t>(image.levels.size());
+    uint8_t header[dds::headerSize] = {};
+    const auto write = [&](size_t offset, uint32_t value)
+    { std::memcpy(header + offset, &value, sizeof(value)); };
+
+    write(0, dds::headerSize);
+    write(dds::flags, dds::flagCaps | dds::flagHeight | dds::flagWidth | dds::flagPixelFormat | dds::flagMipMapCount | dds::flagLinearSize);
+    write(dds::height, top.height);
+    write(dds::width, top.width);
+    write(dds::pitchOrLinearSize, static_cast<uint32_t>(top.blocks.size()));
+    write(dds::mipMapCount, levelCount);
+    write(dds::pixelFormat, 32);
+    write(dds::pixelFormatFlags, dds::pixelFormatHasFourCC);
+    write(dds::caps, dds::capsTexture | (levelCount > 1 ? dds::capsComplex | dds::capsMipMap : 0));
+
+    // BC7 has no FourCC of its own
+    uint32_t dx10[5] = {dds::dxgiBC7, dds::dimensionTexture2D, 0, 1, 0};
+    switch (image.format)
+    {
+    case CompressedImage::Format::bc1:
+        write(dds::pixelFormatFourCC, fourCC("DXT1"));
+        break;
+    case CompressedImage::Format::bc3:
+        write(dds::pixelFormatFourCC, fourCC("DXT5"));
+        break;
+    case CompressedImage::Format::bc7:
+        write(dds::pixelFormatFourCC, fourCC("DX10"));
+        break;
+    }
+
+    std::ofstream file(filename, std::ios::binary);
+    file.write("DDS ", 4);
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    if (image.format == CompressedImage::Format::bc7)
+    {
+        file.write(reinterpret_cast<const char *>(dx10), sizeof(dx10));
+    }
+    for (const auto &level : image.levels)
+    {
+        file.write(reinterpret_cast<const char *>(level.blocks.data()), static_cast<std::streamsize>(level.blocks.size()));
+    }
+    if (!file)
+    {
+        throw std::runtime_error("DDS: Unable to write \"" + std::string(filename) + "\"");
+    }
+}
+
+// KTX2
+
+namespace ktx2
+{
+    constexpr uint8_t identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    constexpr size_t headerSize = 80;
+    constexpr size_t levelIndexEntrySize = 24;
+
+    // Offsets from the start of the file
+    constexpr size_t vkFormat = 12;
+    constexpr size_t pixelWidth = 20;
+    constexpr size_t pixelHeight = 24;
+    constexpr size_t pixelDepth = 28;
+    constexpr size_t layerCount = 32;
+    constexpr size_t faceCount = 36;
+    constexpr size_t levelCount = 40;
+    constexpr size_t supercompressionScheme = 44;
+
+    // VkFormat, each followed by its sRGB twin
+    constexpr uint32_t bc1RGB = 131;
+    constexpr uint32_t bc1RGBA = 133;
+    constexpr uint32_t bc3 = 137;
+    constexpr uint32_t bc7 = 145;
+}
+
+static CompressedImage imageFromKTX2(const uint8_t *data, size_t size)
+{
+    const auto fail = [](const std::string &reason)
+    { throw std::runtime_error("KTX2: " + reason); };
+
+    if (size < ktx2::headerSize)
+        fail("File is too small");
+    if (read<uint32_t>(data, ktx2::pixelDepth) != 0 || read<uint32_t>(data, ktx2::layerCount) > 1 ||
+        read<uint32_t>(data, ktx2::faceCount) != 1)
+        fail("Only 2D textures are supported");
+    if (read<uint32_t>(data, ktx2::supercompressionScheme) != 0)
+        fail("Supercompressed textures are not supported");
+
+    CompressedImage image;
+    const auto vkFormat = read<uint32_t>(data, ktx2::vkFormat);
+    if (vkFormat >= ktx2::bc1RGB && vkFormat <= ktx2::bc1RGBA + 1)
+        image.format = CompressedImage::Format::bc1;
+    else if (vkFormat == ktx2::bc3 || vkFormat == ktx2::bc3 + 1)
+        image.format = CompressedImage::Format::bc3;
+    else if (vkFormat == ktx2::bc7 || vkFormat == ktx2::bc7 + 1)
+        image.format = CompressedImage::Format::bc7;
+    else
+        fail("VkFormat " + std::to_string(vkFormat) + " is not supported");
+
+    auto width = read<uint32_t>(data, ktx2::pixelWidth);
+    auto height = read<uint32_t>(data, ktx2::pixelHeight);
+    if (width == 0 || height == 0)
+        fail("Empty texture");
+    // 0 asks the loader to make the mips, this one takes what is there
+    const auto levelCount = std::max(read<uint32_t>(data, ktx2::levelCount), 1u);
+    if (levelCount > 32 || !fits(ktx2::headerSize, levelCount * ktx2::levelIndexEntrySize, size))
+        fail("Malformed level index");
+
+    // Levels are indexed largest first, whatever order they sit in the file
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        const auto entry = ktx2::headerSize + level * ktx2::levelIndexEntrySize;
+        const auto offset = read<uint64_t>(data, entry);
+        const auto length = read<uint64_t>(data, entry + 8);
+        const auto bytes = CompressedImage::levelBytes(image.format, width, height);
+        if (length < bytes || !fits(offset, length, size))
+            fail("Level " + std::to_string(level) + " is out of range");
+
+        image.levels.push_back({width, height, std::vector<uint8_t>(data + offset, data + offset + bytes)});
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    return image;
+}
+
+CompressedImage compressedImageFromMemory(const uint8_t *data, size_t size)
+{
+    if (size >= 4 && std::memcmp(data, "DDS ", 4) == 0)
+    {
+        return imageFromDDS(data, size);
+    }
+    if (size >= sizeof(ktx2::identifier) && std::memcmp(data, ktx2::identifier, sizeof(ktx2::identifier)) == 0)
+    {
+        return imageFromKTX2(data, size);
+    }
+    throw std::runtime_error("Neither a DDS nor a KTX2 file");
+}
+
+CompressedImage compressedImageFromFile(const char *filename)
+{
+    const MappedFile file(filename);
+    if (!file.isOpen())
+    {
+        throw std::runtime_error("Unable to open \"" + std::string(filename) + "\"");
+    }
+    return compressedImageFromMemory(file.data(), file.size());
+}
+
+// Block encoding. Colour endpoints are the ends of the block's principal
+// axis, which for the smooth gradients of most blocks is close to the best
+// pair at a fraction of the cost of searching for it.
+
+namespace
+{
+    struct Texel
+    {
+        int r, g, b, a;
+    };
+
+    uint16_t pack565(const Texel &color)
+    {
+        const auto quantize = [](int value, int bits)
+        { return (value * ((1 << bits) - 1) + 127) / 255; };
+        return static_cast<uint16_t>(quantize(color.r, 5) << 11 | quantize(color.g, 6) << 5 | quantize(color.b, 5));
+    }
+
+    Texel unpack565(uint16_t color)
+    {
+        const int r = color >> 11 & 31;
+        const int g = color >> 5 & 63;
+        const int b = color & 31;
+        return {r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2, 255};
+    }
+
+    Texel mix(const Texel &a, const Texel &b, int weightA, int weightB)
+    {
+        const int total = weightA + weightB;
+        return {(a.r * weightA + b.r * weightB) / total, (a.g * weightA + b.g * weightB) / total,
+                (a.b * weightA + b.b * weightB) / total, 255};
+    }
+
+    int distance(const Texel &a, const Texel &b)
+    {
+        return (a.r - b.r) * (a.r - b.r) + (a.g - b.g) * (a.g - b.g) + (a.b - b.b) * (a.b - b.b);
+    }
+
+    // Palette of a colour block as the decoder sees it. Three colours and
+    // transparent black when color0 <= color1 in BC1.
+    void colorPalette(uint16_t color0, uint16_t color1, bool fourColors, Texel palette[4])
+    {
+        palette[0] = unpack565(color0);
+        palette[1] = unpack565(color1);
+        if (fourColors)
+        {
+            palette[2] = mix(palette[0], palette[1], 2, 1);
+            palette[3] = mix(palette[0], palette[1], 1, 2);
+        }
+        else
+        {
+            palette[2] = mix(palette[0], palette[1], 1, 1);
+            palette[3] = {0, 0, 0, 0};
+        }
+    }
+
+    // Transparent texels are only kept apart when allowed, i.e. in BC1
+    void encodeColorBlock(const Texel texels[16], bool transparency, uint8_t *out)
+    {
+        bool transparent[16] = {};
+        bool anyTransparent = false;
+        for (int i = 0; i < 16; i++)
+        {
+            transparent[i] = transparency && texels[i].a < 128;
+            anyTransparent |= transparent[i];
+        }
+
+        float mean[3] = {};
+        int opaque = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            if (transparent[i])
+                continue;
+            mean[0] += texels[i].r;
+            mean[1] += texels[i].g;
+            mean[2] += texels[i].b;
+            opaque++;
+        }
+
+        uint16_t color0 = 0;
+        uint16_t color1 = 0;
+        if (opaque > 0)
+        {
+            for (auto &m : mean)
+                m /= static_cast<float>(opaque);
+
+            float covariance[6] = {};
+            for (int i = 0; i < 16; i++)
+            {
+                if (transparent[i])
+                    continue;
+                const float d[3] = {texels[i].r - mean[0], texels[i].g - mean[1], texels[i].b - mean[2]};
+                covariance[0] += d[0] * d[0];
+                covariance[1] += d[0] * d[1];
+                covariance[2] += d[0] * d[2];
+                covariance[3] += d[1] * d[1];
+                covariance[4] += d[1] * d[2];
+                covariance[5] += d[2] * d[2];
+            }
+
+            // A few rounds of power iteration find the axis well enough
+            float axis[3] = {1.0f, 1.0f, 1.0f};
+            for (int iteration = 0; iteration < 4; iteration++)
+            {
+                const float next[3] = {covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+                                       covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+                                       covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]};
+                const float length = std::max({std::fabs(next[0]), std::fabs(next[1]), std::fabs(next[2])});
+                if (length < 1e-6f)
+                    break;
+                for (int c = 0; c < 3; c++)
+                    axis[c] = next[c] / length;
+            }
+
+            float low = 0;
+            float high = 0;
+            for (int i = 0; i < 16; i++)
+            {
+                if (transparent[i])
+                    continue;
+                const float t = (texels[i].r - mean[0]) * axis[0] + (texels[i].g - mean[1]) * axis[1] + (texels[i].b - mean[2]) * axis[2];
+                low = std::min(low, t);
+                high = std::max(high, t);
+            }
+            const float lengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+            const auto endpoint = [&](float t)
+            {
+                const auto channel = [&](int c)
+                { return std::clamp(static_cast<int>(std::lround(mean[c] + axis[c] * t / lengthSquared)), 0, 255); };
+                return Texel{channel(0), channel(1), channel(2), 255};
+            };
+            color0 = pack565(endpoint(high));
+            color1 = pack565(endpoint(low));
+        }
+
+        // color0 > color1 picks four colours, otherwise three and transparent
+        const bool fourColors = !anyTransparent;
+        if (fourColors ? color0 < color1 : color0 > color1)
+        {
+            std::swap(color0, color1);
+        }
+
+        Texel palette[4];
+        colorPalette(color0, color1, fourColors || color0 > color1, palette);
+        uint32_t indices = 0;
+        if (color0 != color1 || anyTransparent)
+        {
+            const int candidates = fourColors ? 4 : 3;
+            for (int i = 0; i < 16; i++)
+            {
+                uint32_t best = 3;
+                if (!transparent[i])
+                {
+                    int bestDistance = distance(texels[i], palette[0]);
+                    best = 0;
+                    for (int p = 1; p < candidates; p++)
+                    {
+                        const auto d = distance(texels[i], palette[p]);
+                        if (d < bestDistance)
+                        {
+                            bestDistance = d;
+                            best = static_cast<uint32_t>(p);
+                        }
+                    }
+                }
+                indices |= best << (2 * i);
+            }
+        }
+
+        std::memcpy(out, &color0, 2);
+        std::memcpy(out + 2, &color1, 2);
+        std::memcpy(out + 4, &indices, 4);
+    }
+
+    void decodeColorBlock(const uint8_t *in, bool bc1, Texel texels[16])
+    {
+        const auto color0 = read<uint16_t>(in, 0);
+        const auto color1 = read<uint16_t>(in, 2);
+        const auto indices = read<uint32_t>(in, 4);
+        Texel palette[4];
+        colorPalette(color0, color1, !bc1 || color0 > color1, palette);
+        for (int i = 0; i < 16; i++)
+        {
+            texels[i] = palette[indices >> (2 * i) & 3];
+        }
+    }
+
+    void alphaPalette(int alpha0, int alpha1, int palette[8])
+    {
+        palette[0] = alpha0;
+        palette[1] = alpha1;
+        if (alpha0 > alpha1)
+        {
+            for (int i = 1; i < 7; i++)
+                palette[i + 1] = (alpha0 * (7 - i) + alpha1 * i) / 7;
+        }
+        else
+        {
+            for (int i = 1; i < 5; i++)
+                palette[i + 1] = (alpha0 * (5 - i) + alpha1 * i) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    void encodeAlphaBlock(const Texel texels[16], uint8_t *out)
+    {
+        int alpha0 = 0;
+        int alpha1 = 255;
+        for (int i = 0; i < 16; i++)
+        {
+            alpha0 = std::max(alpha0, texels[i].a);
+            alpha1 = std::min(alpha1, texels[i].a);
+        }
+
+        // Eight interpolated values between the extremes
+        int palette[8];
+        alphaPalette(alpha0, alpha1, palette);
+        uint64_t indices = 0;
+        if (alpha0 != alpha1)
+        {
+            for (int i = 0; i < 16; i++)
+            {
+                uint64_t best = 0;
+                for (int p = 1; p < 8; p++)
+                {
+                    if (std::abs(texels[i].a - palette[p]) < std::abs(texels[i].a - palette[best]))
+                        best = static_cast<uint64_t>(p);
+                }
+                indices |= best << (3 * i);
+            }
+        }
+
+        out[0] = static_cast<uint8_t>(alpha0);
+        out[1] = static_cast<uint8_t>(alpha1);
+        for (int i = 0; i < 6; i++)
+        {
+            out[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+        }
+    }
+
+    void decodeAlphaBlock(const uint8_t *in, Texel texels[16])
+    {
+        int palette[8];
+        alphaPalette(in[0], in[1], palette);
+        uint64_t indices = 0;
+        for (int i = 0; i < 6; i++)
+        {
+            indices |= static_cast<uint64_t>(in[2 + i]) << (8 * i);
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            texels[i].a = palette[indices >> (3 * i) & 7];
+        }
+    }
+}
+
+CompressedImage compressMipChain(const std::vector<Image> &mips, CompressedImage::Format format)
+{
+    if (format == CompressedImage::Format::bc7)
+    {
+        throw std::runtime_error("BC7 encoding is not supported");
+    }
+
+    CompressedImage result;
+    result.format = format;
+    const auto blockBytes = CompressedImage::blockBytes(format);
+    for (const auto &mip : mips)
+    {
+        CompressedImage::Level level{mip.width, mip.height, std::vector<uint8_t>(CompressedImage::levelBytes(format, mip.width, mip.height))};
+        auto out = level.blocks.data();
+        for (uint32_t blockY = 0; blockY < mip.height; blockY += 4)
+        {
+            for (uint32_t blockX = 0; blockX < mip.width; blockX += 4)
+            {
+                // Blocks hanging off the edge repeat its last texels
+                Texel texels[16];
+                for (uint32_t i = 0; i < 16; i++)
+                {
+                    const auto x = std::min(blockX + i % 4, mip.width - 1);
+                    const auto y = std::min(blockY + i / 4, mip.height - 1);
+                    const auto pixel = &mip.pixels[(static_cast<size_t>(y) * mip.width + x) * 4];
+                    texels[i] = {pixel[0], pixel[1], pixel[2], pixel[3]};
+                }
+
+                if (format == CompressedImage::Format::bc3)
+                {
+                    encodeAlphaBlock(texels, out);
+                    encodeColorBlock(texels, false, out + 8);
+                }
+                else
+                {
+                    encodeColorBlock(texels, true, out);
+                }
+                out += blockBytes;
+            }
+        }
+        result.levels.push_back(std::move(level));
+    }
+    return result;
+}
+
+Image decompressLevel(const CompressedImage &image, size_t levelIndex)
+{
+    Image result;
+    if (image.format == CompressedImage::Format::bc7 || levelIndex >= image.levels.size())
+    {
+        return result;
+    }
+
+    const auto &level = image.levels[levelIndex];
+    result.width = level.width;
+    result.height = level.height;
+    result.pixels.resize(static_cast<size_t>(level.width) * level.height * 4);
+
+    const auto blockBytes = CompressedImage::blockBytes(image.format);
+    auto in = level.blocks.data();
+    for (uint32_t blockY = 0; blockY < level.height; blockY += 4)
+    {
+        for (uint32_t blockX = 0; blockX < level.width; blockX += 4)
+        {
+            Texel texels[16];
+            if (image.format == CompressedImage::Format::bc3)
+            {
+                decodeColorBlock(in + 8, false, texels);
+                decodeAlphaBlock(in, texels);
+            }
+            else
+            {
+                decodeColorBlock(in, true, texels);
+            }
+            in += blockBytes;
+
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                const auto x = blockX + i % 4;
+                const auto y = blockY + i / 4;
+                if (x >= level.width || y >= level.height)
+                    continue;
+                const auto pixel = &result.pixels[(static_cast<size_t>(y) * level.width + x) * 4];
+                pixel[0] = static_cast<uint8_t>(texels[i].r);
+                pixel[1] = static_cast<uint8_t>(texels[i].g);
+                pixel[2] = static_cast<uint8_t>(texels[i].b);
+                pixel[3] = static_cast<uint8_t>(texels[i].a);
+            }
+        }
+    }
+    return result;
+}
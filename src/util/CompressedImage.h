@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Image.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Block compressed texels as GL takes them in glCompressedTexImage2D. Every
+// format stores 4x4 texel blocks, levels smaller than a block still take a
+// whole one.
+struct CompressedImage
+{
+    enum class Format
+    {
+        // RGB with 1 bit alpha, 8 bytes a block
+        bc1,
+        // RGB with interpolated alpha, 16 bytes a block
+        bc3,
+        // Higher quality RGBA, 16 bytes a block. Only loaded, never encoded.
+        bc7
+    };
+
+    struct Level
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> blocks;
+    };
+
+    Format format = Format::bc1;
+    // Level 0 first
+    std::vector<Level> levels;
+
+    bool empty() const
+    {
+        return levels.empty();
+    }
+
+    static size_t blockBytes(Format format)
+    {
+        return format == Format::bc1 ? 8 : 16;
+    }
+
+    static size_t levelBytes(Format format, uint32_t width, uint32_t height)
+    {
+        return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+    }
+};
+
+// Reads a DDS or KTX2 file, told apart by their magic numbers. Only BC1, BC3
+// and BC7 2D textures are taken. Throws std::runtime_error when the file
+// can't be read or holds anything else.
+extern CompressedImage compressedImageFromFile(const char *filename);
+extern CompressedImage compressedImageFromMemory(const uint8_t *data, size_t size);
+
+// Writes a DDS file with every level, throws std::runtime_error on failure
+extern void writeDDS(const char *filename, const CompressedImage &image);
+
+// Encodes each level of a mip chain. BC1 keeps alpha only as on or off at
+// half way, BC3 keeps it whole.
+extern CompressedImage compressMipChain(const std::vector<Image> &mips, CompressedImage::Format format);
+
+// Back to RGBA, for drivers without the format and for measuring the error.
+// Returns an empty image for BC7.
+extern Image decompressLevel(const CompressedImage &image, size_t level);
@@ -0,0 +1,75 @@
+#include "Image.h"
+
+#include <png.h>
+
+#include <algorithm>
+#include <cstring>
+
+Image imageFromPNG(const char *filename)
+{
+    png_image png;
+    std::memset(&png, 0, sizeof png);
+    png.version = PNG_IMAGE_VERSION;
+
+    Image result;
+    if (!png_image_begin_read_from_file(&png, filename))
+    {
+        return result;
+    }
+
+    png.format = PNG_FORMAT_RGBA;
+    std::vector<uint8_t> pixels(PNG_IMAGE_SIZE(png));
+    if (!png_image_finish_read(&png, nullptr, pixels.data(), 0, nullptr))
+    {
+        png_image_free(&png);
+        return result;
+    }
+
+    result.width = png.width;
+    result.height = png.height;
+    result.pixels = std::move(pixels);
+    return result;
+}
+
+static Image downsample(const Image &source)
+{
+    Image result;
+    result.width = std::max(source.width / 2, 1u);
+    result.height = std::max(source.height / 2, 1u);
+    result.pixels.resize(static_cast<size_t>(result.width) * result.height * 4);
+
+    for (uint32_t y = 0; y < result.height; y++)
+    {
+        const uint32_t y0 = std::min(y * 2, source.height - 1);
+        const uint32_t y1 = std::min(y * 2 + 1, source.height - 1);
+        for (uint32_t x = 0; x < result.width; x++)
+        {
+            const uint32_t x0 = std::min(x * 2, source.width - 1);
+            const uint32_t x1 = std::min(x * 2 + 1, source.width - 1);
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                const auto texel = [&](uint32_t sx, uint32_t sy)
+                { return static_cast<uint32_t>(source.pixels[(static_cast<size_t>(sy) * source.width + sx) * 4 + c]); };
+                const uint32_t sum = texel(x0, y0) + texel(x1, y0) + texel(x0, y1) + texel(x1, y1);
+                result.pixels[(static_cast<size_t>(y) * result.width + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+            }
+        }
+    }
+    return result;
+}
+
+std::vector<Image> generateMipChain(const Image &image)
+{
+    std::vector<Image> chain;
+    if (image.empty())
+    {
+        return chain;
+    }
+
+    chain.push_back(image);
+    while (chain.back().width > 1 || chain.back().height > 1)
+    {
+        chain.push_back(downsample(chain.back()));
+    }
+    return chain;
+}
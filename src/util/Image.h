@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Tightly packed 8 bit RGBA pixels
+struct Image
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;
+
+    bool empty() const
+    {
+        return width == 0 || height == 0;
+    }
+};
+
+// Returns an empty image when the file can't be read
+extern Image imageFromPNG(const char *filename);
+
+// Full chain from the image itself down to 1x1, each level a 2x2 box filter
+// of the one above. Odd edges repeat their last row or column.
+extern std::vector<Image> generateMipChain(const Image &image);
@@ -0,0 +1,130 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string &filename)
+{
+    fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+    {
+        fileHandle = nullptr;
+        return;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize))
+    {
+        close();
+        return;
+    }
+    opened = true;
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (length == 0)
+    {
+        return;
+    }
+
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle)
+    {
+        mapping = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    }
+    if (!mapping)
+    {
+        close();
+    }
+}
+
+void MappedFile::close()
+{
+    if (mapping)
+        UnmapViewOfFile(mapping);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle)
+        CloseHandle(fileHandle);
+    mapping = nullptr;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+    length = 0;
+    opened = false;
+}
+#else
+MappedFile::MappedFile(const std::string &filename)
+{
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) == 0)
+    {
+        opened = true;
+        length = static_cast<size_t>(status.st_size);
+        if (length > 0)
+        {
+            void *result = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (result != MAP_FAILED)
+            {
+                mapping = result;
+            }
+            else
+            {
+                opened = false;
+                length = 0;
+            }
+        }
+    }
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+}
+
+void MappedFile::close()
+{
+    if (mapping)
+        munmap(mapping, length);
+    mapping = nullptr;
+    length = 0;
+    opened = false;
+}
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        std::swap(mapping, other.mapping);
+        std::swap(length, other.length);
+        std::swap(opened, other.opened);
+#ifdef _WIN32
+        std::swap(fileHandle, other.fileHandle);
+        std::swap(mappingHandle, other.mappingHandle);
+#endif
+    }
+    return *this;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only view of a whole file mapped into memory. Pages are only read in
+// from disk when touched, and the data can be handed straight to GL without
+// copying it into a std::vector first.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string &filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    bool isOpen() const
+    {
+        return mapping != nullptr || (opened && length == 0);
+    }
+
+    const uint8_t *data() const
+    {
+        return static_cast<const uint8_t *>(mapping);
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+private:
+    void close();
+
+    void *mapping = nullptr;
+    size_t length = 0;
+    bool opened = false;
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+};
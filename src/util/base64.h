@@ -2,4 +2,27 @@
 
 #include <cstddef>
 
-extern int decodeBase64(const char *base64Input, char *output, size_t len);
\ No newline at end of file
+enum class Base64Decoder
+{
+    automatic,
+    scalar,
+    sse41,
+    avx2,
+};
+
+// Decodes len characters of standard base64 (RFC 4648, padded) into output,
+// which must have room for base64DecodedLength(len) bytes. Returns the number
+// of bytes written, or -1 if len is not a multiple of 4, a character is
+// outside the alphabet or the padding is misplaced.
+//
+// automatic picks the widest decoder the CPU supports at runtime. Asking for
+// an unsupported one falls back to scalar.
+extern int decodeBase64(const char *base64Input, char *output, size_t len, Base64Decoder decoder = Base64Decoder::automatic);
+
+// Upper bound of the decoded size, exact when the input is unpadded
+inline size_t base64DecodedLength(size_t len)
+{
+    return len / 4 * 3;
+}
+
+extern bool isBase64DecoderSupported(Base64Decoder decoder);
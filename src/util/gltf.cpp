@@ -1,7 +1,12 @@
 #include "gltf.h"
+#include "MappedFile.h"
 
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
 void from_json(const nlohmann::json &j, glTF::Accessor::ComponentType &ct)
 {
     ct = glTF::Accessor::ComponentType::NONE;
@@ -63,6 +68,12 @@ void from_json(const nlohmann::json &j, glTF::Accessor &a)
 
     if (j.count("normalized"))
         j.at("normalized").get_to(a.normalized);
+
+    if (j.count("min"))
+        j.at("min").get_to(a.min);
+
+    if (j.count("max"))
+        j.at("max").get_to(a.max);
 }
 
 void from_json(const nlohmann::json &j, glTF::Asset::Version &v)
@@ -77,7 +88,9 @@ void from_json(const nlohmann::json &j, glTF::Asset &a)
 
 void from_json(const nlohmann::json &j, glTF::Buffer &b)
 {
-    j.at("uri").get_to(b.uri);
+    // Only the GLB BIN chunk buffer may leave out the uri
+    if (j.count("uri"))
+        j.at("uri").get_to(b.uri);
     j.at("byteLength").get_to(b.byteLength);
 }
 
@@ -168,10 +181,174 @@ void from_json(const nlohmann::json &j, glTF &gltf)
     }
 }
 
-glTF glTFFromString(const char *jsonText)
+static void mapExternalBuffers(glTF &gltf, const std::string &baseDirectory)
+{
+    for (auto &buffer : gltf.buffers)
+    {
+        if (buffer.isMapped() || buffer.uri.empty() || buffer.uri.compare(0, 5, "data:") == 0)
+            continue;
+
+        auto file = std::make_shared<MappedFile>(baseDirectory + buffer.uri);
+        if (!file->isOpen() || file->size() < static_cast<size_t>(buffer.byteLength))
+        {
+            throw std::runtime_error("glTF: Unable to map buffer \"" + baseDirectory + buffer.uri + "\"");
+        }
+        buffer.data = file->data();
+        buffer.storage = std::move(file);
+    }
+}
+
+glTF glTFFromString(const char *jsonText, const std::string &baseDirectory)
 {
     glTF gltf;
     auto j = nlohmann::json::parse(jsonText);
     j.get_to(gltf);
+    mapExternalBuffers(gltf, baseDirectory);
+    return gltf;
+}
+
+static constexpr uint32_t glbMagic = 0x46546C67;     // "glTF"
+static constexpr uint32_t glbJsonChunk = 0x4E4F534A; // "JSON"
+static constexpr uint32_t glbBinChunk = 0x004E4942;  // "BIN\0"
+
+static uint32_t readUint32(const uint8_t *data)
+{
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+glTF glTFFromGLB(const uint8_t *data, size_t size, std::shared_ptr<const void> storage, const std::string &baseDirectory)
+{
+    if (size < 12 || readUint32(data) != glbMagic)
+    {
+        throw std::runtime_error("glTF: Not a GLB file");
+    }
+    if (readUint32(data + 4) != 2)
+    {
+        throw std::runtime_error("glTF: Unsupported GLB version");
+    }
+    size = std::min<size_t>(size, readUint32(data + 8));
+
+    const uint8_t *json = nullptr;
+    size_t jsonLength = 0;
+    const uint8_t *bin = nullptr;
+    size_t binLength = 0;
+
+    size_t offset = 12;
+    while (offset + 8 <= size)
+    {
+        const size_t chunkLength = readUint32(data + offset);
+        const uint32_t chunkType = readUint32(data + offset + 4);
+        offset += 8;
+        if (chunkLength > size - offset)
+        {
+            throw std::runtime_error("glTF: Truncated GLB chunk");
+        }
+
+        if (chunkType == glbJsonChunk && !json)
+        {
+            json = data + offset;
+            jsonLength = chunkLength;
+        }
+        else if (chunkType == glbBinChunk && !bin)
+        {
+            bin = data + offset;
+            binLength = chunkLength;
+        }
+        // Chunks are 4 byte aligned, unknown ones are skipped
+        offset += (chunkLength + 3) & ~size_t{3};
+    }
+
+    if (!json)
+    {
+        throw std::runtime_error("glTF: GLB has no JSON chunk");
+    }
+
+    glTF gltf;
+    auto j = nlohmann::json::parse(json, json + jsonLength);
+    j.get_to(gltf);
+
+    if (!gltf.buffers.empty() && gltf.buffers[0].uri.empty())
+    {
+        if (!bin || binLength < static_cast<size_t>(gltf.buffers[0].byteLength))
+        {
+            throw std::runtime_error("glTF: GLB BIN chunk is missing or too short");
+        }
+        gltf.buffers[0].data = bin;
+        gltf.buffers[0].storage = std::move(storage);
+    }
+
+    mapExternalBuffers(gltf, baseDirectory);
+    return gltf;
+}
+
+glTF glTFFromFile(const char *filename)
+{
+    const std::string path(filename);
+    const auto separator = path.find_last_of("/\\");
+    const auto baseDirectory = separator == std::string::npos ? std::string() : path.substr(0, separator + 1);
+
+    auto file = std::make_shared<MappedFile>(path);
+    if (!file->isOpen())
+    {
+        throw std::runtime_error("glTF: Unable to open \"" + path + "\"");
+    }
+
+    if (file->size() >= 4 && readUint32(file->data()) == glbMagic)
+    {
+        const auto data = file->data();
+        const auto size = file->size();
+        return glTFFromGLB(data, size, std::move(file), baseDirectory);
+    }
+
+    glTF gltf;
+    auto j = nlohmann::json::parse(file->data(), file->data() + file->size());
+    j.get_to(gltf);
+    mapExternalBuffers(gltf, baseDirectory);
     return gltf;
 }
+
+glTFBufferCache::View glTFBufferCache::buffer(int index)
+{
+    const auto &source = gltf.buffers.at(index);
+    if (source.isMapped())
+    {
+        return {source.data, static_cast<size_t>(source.byteLength)};
+    }
+
+    auto &bytes = decoded[index];
+    if (bytes.empty() && source.byteLength > 0)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        bytes = source.getBytes();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        cacheStats.decodeCount++;
+        cacheStats.decodedBytes += bytes.size();
+        cacheStats.decodeSeconds += elapsed.count();
+    }
+    return {bytes.data(), bytes.size()};
+}
+
+glTFBufferCache::View glTFBufferCache::bufferView(int index)
+{
+    const auto &view = gltf.bufferViews.at(index);
+    const auto bytes = buffer(view.buffer);
+    if (static_cast<size_t>(view.byteOffset) + view.byteLength > bytes.size)
+    {
+        throw std::runtime_error("glTF: Buffer view " + std::to_string(index) + " is out of range");
+    }
+    return {bytes.data + view.byteOffset, static_cast<size_t>(view.byteLength)};
+}
+
+glTFBufferCache::View glTFBufferCache::accessor(int index)
+{
+    const auto &accessor = gltf.accessors.at(index);
+    const auto view = bufferView(accessor.bufferView);
+    if (static_cast<size_t>(accessor.byteOffset) > view.size)
+    {
+        throw std::runtime_error("glTF: Accessor " + std::to_string(index) + " is out of range");
+    }
+    return {view.data + accessor.byteOffset, view.size - accessor.byteOffset};
+}
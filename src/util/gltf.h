@@ -2,7 +2,12 @@
 
 #include "base64.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <cstring>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -77,6 +82,9 @@ public:
         bool normalized;
         int count;
         Type type;
+        // Per component, only present for some accessors (always for POSITION)
+        std::vector<float> min = {};
+        std::vector<float> max = {};
 
         bool operator==(const Accessor &rhs) const
         {
@@ -114,17 +122,38 @@ public:
         std::string uri;
         int byteLength;
 
+        // Set when the bytes are already binary, either the BIN chunk of a GLB
+        // or an external file. data points into storage, which is typically
+        // a memory mapped file.
+        const uint8_t *data = nullptr;
+        std::shared_ptr<const void> storage = nullptr;
+
         bool operator==(const Buffer &rhs) const
         {
             return uri == rhs.uri && byteLength == rhs.byteLength;
         }
 
+        bool isMapped() const
+        {
+            return data != nullptr;
+        }
+
         std::vector<uint8_t> getBytes() const
         {
-            std::vector<uint8_t> result(byteLength);
+            if (isMapped())
+            {
+                return std::vector<uint8_t>(data, data + byteLength);
+            }
+
             std::string base64String = uri.substr(uri.find(',') + 1);
+            std::vector<uint8_t> result(std::max<size_t>(base64DecodedLength(base64String.length()), 1));
 
-            decodeBase64(base64String.c_str(), reinterpret_cast<char *>(&result[0]), base64String.length());
+            const int decoded = decodeBase64(base64String.c_str(), reinterpret_cast<char *>(&result[0]), base64String.length());
+            if (decoded < 0 || decoded < byteLength)
+            {
+                throw std::runtime_error("glTF buffer has malformed base64 data");
+            }
+            result.resize(byteLength);
             return result;
         }
     };
@@ -259,4 +288,53 @@ public:
     Meshes meshes;
 };
 
-extern glTF glTFFromString(const char *jsonText);
\ No newline at end of file
+// Bytes of every buffer of one glTF, each decoded at most once and only when
+// first asked for. Mapped buffers are used in place. Views stay valid for the
+// lifetime of the cache and of the glTF it was built from.
+class glTFBufferCache
+{
+public:
+    struct View
+    {
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+    };
+
+    struct Stats
+    {
+        size_t decodeCount = 0;
+        size_t decodedBytes = 0;
+        double decodeSeconds = 0;
+    };
+
+public:
+    explicit glTFBufferCache(const glTF &gltf) : gltf(gltf), decoded(gltf.buffers.size()) {}
+
+    View buffer(int index);
+    View bufferView(int index);
+
+    // From the first element of the accessor to the end of its buffer view
+    View accessor(int index);
+
+    const Stats &stats() const
+    {
+        return cacheStats;
+    }
+
+private:
+    const glTF &gltf;
+    std::vector<std::vector<uint8_t>> decoded;
+    Stats cacheStats;
+};
+
+// External buffer URIs are resolved relative to baseDirectory, which should be
+// empty or end in a separator.
+extern glTF glTFFromString(const char *jsonText, const std::string &baseDirectory = "");
+
+// Binary glTF. The BIN chunk is referenced, not copied, so storage has to own
+// the memory behind data.
+extern glTF glTFFromGLB(const uint8_t *data, size_t size, std::shared_ptr<const void> storage, const std::string &baseDirectory = "");
+
+// Loads either flavour, picked by the GLB magic rather than the extension.
+// The file is memory mapped and stays mapped while any buffer refers to it.
+extern glTF glTFFromFile(const char *filename);
\ No newline at end of file
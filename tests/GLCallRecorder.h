@@ -0,0 +1,109 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Swaps glad's function pointers for recording wrappers so tests can count
+// the GL calls a piece of code makes. Calls are forwarded to the original
+// function when one is loaded, so it works both with a live context and as
+// a pure stub.
+class GLCallRecorder
+{
+private:
+    template <auto *Slot, typename Fn = std::remove_pointer_t<decltype(Slot)>>
+    struct Hook;
+
+    template <auto *Slot, typename R, typename... Args>
+    struct Hook<Slot, R(APIENTRYP)(Args...)>
+    {
+        static inline R(APIENTRYP original)(Args...) = nullptr;
+        static inline size_t *counter = nullptr;
+
+        static R APIENTRY record(Args... args)
+        {
+            ++*counter;
+            if (original)
+                return original(args...);
+            if constexpr (!std::is_void_v<R>)
+                return R{};
+        }
+    };
+
+public:
+    GLCallRecorder()
+    {
+        hook<&glad_glGetUniformLocation>("glGetUniformLocation");
+        hook<&glad_glUniform1i>("glUniform1i");
+        hook<&glad_glUniform1f>("glUniform1f");
+        hook<&glad_glUniform3fv>("glUniform3fv");
+        hook<&glad_glUniform4fv>("glUniform4fv");
+        hook<&glad_glUniformMatrix3fv>("glUniformMatrix3fv");
+        hook<&glad_glUniformMatrix4fv>("glUniformMatrix4fv");
+        hook<&glad_glDrawElements>("glDrawElements");
+        hook<&glad_glDrawElementsInstanced>("glDrawElementsInstanced");
+        hook<&glad_glUseProgram>("glUseProgram");
+        hook<&glad_glActiveTexture>("glActiveTexture");
+        hook<&glad_glBindTexture>("glBindTexture");
+        hook<&glad_glBindVertexArray>("glBindVertexArray");
+        hook<&glad_glBindBuffer>("glBindBuffer");
+        hook<&glad_glBindBufferBase>("glBindBufferBase");
+        hook<&glad_glBindBufferRange>("glBindBufferRange");
+        hook<&glad_glBufferSubData>("glBufferSubData");
+    }
+
+    ~GLCallRecorder()
+    {
+        for (auto &restore : restorers)
+        {
+            restore();
+        }
+    }
+
+    GLCallRecorder(const GLCallRecorder &) = delete;
+    GLCallRecorder &operator=(const GLCallRecorder &) = delete;
+
+    size_t count(const std::string &name) const
+    {
+        const auto found = counts.find(name);
+        return found == counts.end() ? 0 : found->second;
+    }
+
+    size_t total() const
+    {
+        size_t result = 0;
+        for (const auto &[name, count] : counts)
+        {
+            result += count;
+        }
+        return result;
+    }
+
+    void reset()
+    {
+        for (auto &[name, count] : counts)
+        {
+            count = 0;
+        }
+    }
+
+private:
+    template <auto *Slot>
+    void hook(const char *name)
+    {
+        using H = Hook<Slot>;
+        H::original = *Slot;
+        H::counter = &counts[name];
+        *Slot = &H::record;
+        restorers.emplace_back([]()
+                               { *Slot = H::original; });
+    }
+
+    std::map<std::string, size_t> counts;
+    std::vector<std::function<void()>> restorers;
+};
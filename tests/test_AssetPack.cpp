@@ -0,0 +1,230 @@
+#include <gtest/gtest.h>
+
+#include <util/AssetPack.h>
+#include <util/Image.h>
+#include <util/gltf.h>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static const std::filesystem::path assetDirectory(ASSET_DIR);
+
+static std::filesystem::path packDirectory()
+{
+    const auto directory = std::filesystem::temp_directory_path() / "combat_gl_pack_test";
+    std::filesystem::create_directories(directory);
+    return directory;
+}
+
+static void writeFile(const std::filesystem::path &path, const std::vector<uint8_t> &bytes)
+{
+    std::ofstream f{path, std::ios::binary};
+    f.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+}
+
+static Image makeImage(uint32_t width, uint32_t height, std::vector<uint8_t> pixels)
+{
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.pixels = std::move(pixels);
+    return image;
+}
+
+TEST(AssetPack, CanGenerateMipChain)
+{
+    // 3x2, the odd column is repeated when halving
+    const auto image = makeImage(3, 2, {
+                                           0, 0, 0, 0, 40, 40, 40, 40, 100, 100, 100, 100,
+                                           0, 0, 0, 0, 40, 40, 40, 40, 100, 100, 100, 100,
+                                       });
+
+    const auto chain = generateMipChain(image);
+    ASSERT_EQ(2, chain.size());
+    EXPECT_EQ(1, chain[1].width);
+    EXPECT_EQ(1, chain[1].height);
+    EXPECT_EQ((std::vector<uint8_t>{20, 20, 20, 20}), chain[1].pixels);
+
+    EXPECT_EQ(7, generateMipChain(makeImage(64, 64, std::vector<uint8_t>(64 * 64 * 4))).size());
+    EXPECT_EQ(5, generateMipChain(makeImage(16, 1, std::vector<uint8_t>(16 * 4))).size());
+    EXPECT_TRUE(generateMipChain(Image{}).empty());
+}
+
+TEST(AssetPack, CanRoundTripBakedMeshes)
+{
+    const auto gltfPath = assetDirectory / "gltf" / "wall-and-floor.gltf";
+    const auto gltf = glTFFromFile(gltfPath.string().c_str());
+
+    AssetPackWriter writer;
+    writer.addglTF("wall-and-floor", gltf);
+    const auto path = packDirectory() / "meshes.pack";
+    writer.write(path.string());
+
+    const AssetPack pack(path.string());
+    ASSERT_EQ(gltf.meshes.size(), pack.meshes().size());
+
+    glTFBufferCache cache(gltf);
+    for (size_t m = 0; m < gltf.meshes.size(); m++)
+    {
+        const auto &mesh = pack.meshes()[m];
+        EXPECT_STREQ("wall-and-floor", pack.string(mesh.source));
+        EXPECT_EQ(gltf.meshes[m].name, pack.string(mesh.name));
+        ASSERT_EQ(gltf.meshes[m].primitives.size(), mesh.primitiveCount);
+
+        for (uint32_t p = 0; p < mesh.primitiveCount; p++)
+        {
+            const auto &gltfPrimitive = gltf.meshes[m].primitives[p];
+            const auto &primitive = pack.primitives()[mesh.firstPrimitive + p];
+
+            const int positionAccessor = gltfPrimitive.attributes.at("POSITION");
+            ASSERT_EQ(gltf.accessors[positionAccessor].count, static_cast<int>(primitive.vertexCount));
+            const auto positions = cache.accessor(positionAccessor);
+            const auto stride = gltf.bufferViews[gltf.accessors[positionAccessor].bufferView].byteStride;
+            for (uint32_t v = 0; v < primitive.vertexCount; v++)
+            {
+                float expected[3];
+                std::memcpy(expected, positions.data + v * (stride > 0 ? stride : 12), sizeof(expected));
+                EXPECT_EQ(0, std::memcmp(expected, pack.vertices(primitive)[v].position, sizeof(expected)));
+            }
+
+            const auto indices = cache.accessor(gltfPrimitive.indices);
+            ASSERT_EQ(gltf.accessors[gltfPrimitive.indices].count, static_cast<int>(primitive.indexCount));
+            EXPECT_EQ(0, std::memcmp(indices.data, pack.indices(primitive), primitive.indexCount * sizeof(uint16_t)));
+
+            const auto &material = pack.materials()[primitive.material];
+            const auto &pbr = gltf.materials[gltfPrimitive.material].pbrMetallicRoughness;
+            EXPECT_FLOAT_EQ(pbr.baseColorFactor[0], material.baseColor[0]);
+            EXPECT_FLOAT_EQ(pbr.roughnessFactor, material.roughnessFactor);
+            EXPECT_EQ(-1, material.texture);
+        }
+    }
+}
+
+TEST(AssetPack, CanRoundTripBakedTextures)
+{
+    const auto image = imageFromPNG((assetDirectory / "textures" / "Checker.png").string().c_str());
+    ASSERT_FALSE(image.empty());
+
+    AssetPackWriter writer;
+    writer.addTexture("Checker", generateMipChain(image));
+    const auto path = packDirectory() / "textures.pack";
+    writer.write(path.string());
+
+    const AssetPack pack(path.string());
+    EXPECT_EQ(nullptr, pack.findTexture("Missing"));
+    const auto texture = pack.findTexture("Checker");
+    ASSERT_NE(nullptr, texture);
+    EXPECT_EQ(image.width, texture->width);
+    EXPECT_EQ(image.height, texture->height);
+    EXPECT_EQ(7, texture->mipCount);
+
+    const auto &base = pack.mips()[texture->firstMip];
+    ASSERT_EQ(image.pixels.size(), base.size);
+    EXPECT_EQ(0, std::memcmp(image.pixels.data(), pack.blob(base.offset), base.size));
+    EXPECT_EQ(1, pack.mips()[texture->firstMip + texture->mipCount - 1].width);
+
+    // Sections and data the GPU reads are aligned
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(pack.blob(0)) % AssetPack::pageSize);
+    EXPECT_EQ(0, base.offset % AssetPack::blobAlignment);
+}
+
+TEST(AssetPack, CanRejectCorruptPacks)
+{
+    AssetPackWriter writer;
+    writer.addMesh("test", "Triangle", {{{{{0, 0, 0}, {0, 1, 0}, {0, 0}}}, {0, 0, 0}, {{1, 1, 1}, 1, 1, -1}}});
+    const auto good = writer.build();
+    const auto path = packDirectory() / "corrupt.pack";
+
+    writeFile(path, good);
+    EXPECT_NO_THROW(AssetPack{path.string()});
+
+    EXPECT_THROW(AssetPack{(packDirectory() / "missing.pack").string()}, std::runtime_error);
+
+    auto badMagic = good;
+    badMagic[0] ^= 0xFF;
+    writeFile(path, badMagic);
+    EXPECT_THROW(AssetPack{path.string()}, std::runtime_error);
+
+    auto badVersion = good;
+    badVersion[offsetof(AssetPack::Header, version)] += 1;
+    writeFile(path, badVersion);
+    EXPECT_THROW(AssetPack{path.string()}, std::runtime_error);
+
+    const std::vector<uint8_t> truncated(good.begin(), good.end() - 8);
+    writeFile(path, truncated);
+    EXPECT_THROW(AssetPack{path.string()}, std::runtime_error);
+
+    AssetPack::Header header;
+    std::memcpy(&header, good.data(), sizeof(header));
+    AssetPack::PrimitiveRecord primitive;
+    std::memcpy(&primitive, good.data() + header.primitives.offset, sizeof(primitive));
+    primitive.indexCount = 1000;
+    auto outOfRange = good;
+    std::memcpy(outOfRange.data() + header.primitives.offset, &primitive, sizeof(primitive));
+    writeFile(path, outOfRange);
+    EXPECT_THROW(AssetPack{path.string()}, std::runtime_error);
+
+    std::filesystem::remove(path);
+}
+
+// Startup cost of the assets the game loads: parsing the glTF and PNG
+// sources up to having GL ready bytes, against mapping the baked pack.
+TEST(AssetPack, CanLoadFasterThanSourceAssets)
+{
+    const char *meshes[] = {"tenk9aa", "wall-and-floor"};
+    const char *textures[] = {"Checker", "White Square"};
+
+    AssetPackWriter writer;
+    for (const auto name : meshes)
+        writer.addglTF(name, glTFFromFile((assetDirectory / "gltf" / (std::string(name) + ".gltf")).string().c_str()));
+    for (const auto name : textures)
+        writer.addTexture(name, generateMipChain(imageFromPNG((assetDirectory / "textures" / (std::string(name) + ".png")).string().c_str())));
+    const auto path = packDirectory() / "startup.pack";
+    writer.write(path.string());
+
+    constexpr int iterations = 10;
+    size_t sourceBytes = 0;
+    const auto sourceStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        for (const auto name : meshes)
+        {
+            const auto gltf = glTFFromFile((assetDirectory / "gltf" / (std::string(name) + ".gltf")).string().c_str());
+            glTFBufferCache cache(gltf);
+            for (size_t b = 0; b < gltf.buffers.size(); b++)
+                sourceBytes += cache.buffer(static_cast<int>(b)).size;
+        }
+        for (const auto name : textures)
+        {
+            const auto image = imageFromPNG((assetDirectory / "textures" / (std::string(name) + ".png")).string().c_str());
+            sourceBytes += image.pixels.size();
+        }
+    }
+    const std::chrono::duration<double, std::milli> sourceTime = (std::chrono::steady_clock::now() - sourceStart) / iterations;
+
+    size_t packBytes = 0;
+    const auto packStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        const AssetPack pack(path.string());
+        // What the runtime loader does before handing the pointers to GL
+        for (const auto &primitive : pack.primitives())
+            packBytes += primitive.vertexCount * sizeof(AssetPack::Vertex) + primitive.indexCount * sizeof(uint16_t);
+        for (const auto &mip : pack.mips())
+            packBytes += mip.size;
+    }
+    const std::chrono::duration<double, std::milli> packTime = (std::chrono::steady_clock::now() - packStart) / iterations;
+
+    EXPECT_GT(sourceBytes, 0);
+    EXPECT_GT(packBytes, 0);
+    std::cout << "glTF + PNG sources " << sourceTime.count() << " ms, baked pack (" << std::filesystem::file_size(path)
+              << " bytes) " << packTime.count() << " ms" << std::endl;
+
+    std::filesystem::remove_all(packDirectory());
+}
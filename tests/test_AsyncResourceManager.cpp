@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+
+#include "AppleSauceTest.h"
+#include <applesauce/AsyncResourceManager.h>
+#include <applesauce/ShadowMap.h>
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <set>
+#include <string>
+#include <thread>
+
+using namespace applesauce;
+
+class AppleSauceAsyncResources : public AppleSauceTest
+{
+};
+
+static std::string assetPath(const std::string &name)
+{
+    return (std::filesystem::path(ASSET_DIR) / name).string();
+}
+
+static GLint textureWidth(const Texture2D &texture)
+{
+    GLint width = 0;
+    texture.bind();
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+    texture.unbind();
+    return width;
+}
+
+TEST_F(AppleSauceAsyncResources, CanHandOutPlaceholdersAtOnce)
+{
+    AsyncResourceManager resources;
+    const auto tenk = resources.getMesh("Tenk");
+    const auto texture = resources.loadTexture("Checker", assetPath("textures/Checker.png"));
+    resources.loadMeshes(assetPath("gltf/tenk9aa.gltf"));
+
+    // Nothing is uploaded until this thread asks for it
+    ASSERT_NE(nullptr, texture);
+    EXPECT_EQ(texture, resources.getTexture("Checker"));
+    EXPECT_EQ(1, textureWidth(*texture));
+    EXPECT_TRUE(tenk->primitives.empty());
+    EXPECT_EQ(nullptr, resources.getTexture("Never asked for"));
+
+    resources.finish();
+    EXPECT_TRUE(resources.idle());
+    EXPECT_EQ(2, resources.stats().uploaded);
+
+    // Same handles, real contents
+    EXPECT_EQ(tenk, resources.getMesh("Tenk"));
+    EXPECT_FALSE(tenk->primitives.empty());
+    EXPECT_GT(textureWidth(*texture), 1);
+    EXPECT_EQ(texture, resources.loadTexture("Checker", assetPath("textures/Checker.png")));
+}
+
+TEST_F(AppleSauceAsyncResources, CanPrepareMeshesAsTheyArrive)
+{
+    AsyncResourceManager resources;
+    const auto white = resources.addTexture("White", singleColorTexture(0xFFFFFFFF));
+
+    std::set<std::string> names;
+    resources.loadMeshes(assetPath("gltf/wall-and-floor.gltf"), [&](const std::string &name, Mesh &mesh)
+                         {
+                             EXPECT_EQ(resources.getMesh(name).get(), &mesh);
+                             for (auto &primitive : mesh.primitives)
+                             {
+                                 primitive.material->baseTexture = white;
+                             }
+                             names.insert(name);
+                         });
+    EXPECT_TRUE(names.empty());
+    resources.finish();
+
+    ASSERT_EQ(1, names.count("Wall"));
+    EXPECT_EQ(white, resources.getMesh("Wall")->primitives.front().material->baseTexture);
+}
+
+// A shadow cache drawn while the walls were still empty placeholders is out
+// of date once they arrive, even though nothing else about the scene changed
+TEST_F(AppleSauceAsyncResources, CanInvalidateShadowCacheWhenMeshArrives)
+{
+    AsyncResourceManager resources;
+    const auto wall = resources.getMesh("Wall");
+    resources.loadMeshes(assetPath("gltf/wall-and-floor.gltf"));
+
+    ShadowCache cache(64, 64);
+    cache.beginUpdate();
+    cache.endUpdate(resources.meshGeneration());
+    EXPECT_FALSE(cache.isStale(resources.meshGeneration()));
+
+    resources.finish();
+    EXPECT_FALSE(wall->primitives.empty());
+    EXPECT_TRUE(cache.isStale(resources.meshGeneration()));
+
+    // Only until it is drawn again
+    const auto generation = resources.meshGeneration();
+    cache.beginUpdate();
+    cache.endUpdate(generation);
+    EXPECT_FALSE(cache.isStale(resources.meshGeneration()));
+}
+
+TEST_F(AppleSauceAsyncResources, CanLoadTexturesIntoAnAtlas)
+{
+    AsyncResourceManager resources;
+    TextureAtlas atlas(64, 2, 4);
+
+    std::set<std::string> ready;
+    resources.loadAtlasTexture(atlas, "White Square", assetPath("textures/White Square.png"), false,
+                               [&](const TextureAtlas::Entry &entry)
+                               {
+                                   EXPECT_FLOAT_EQ(32.0f / 64.0f, entry.rect.z);
+                                   ready.insert("White Square");
+                               });
+    resources.loadAtlasTexture(atlas, "Checker", assetPath("textures/Checker.png"), true,
+                               [&](const TextureAtlas::Entry &entry)
+                               {
+                                   EXPECT_EQ(glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), entry.rect);
+                                   ready.insert("Checker");
+                               });
+    EXPECT_EQ(0, atlas.stats().entries);
+    resources.finish();
+
+    EXPECT_EQ(2, ready.size());
+    EXPECT_EQ(2, atlas.stats().entries);
+    EXPECT_EQ(2, atlas.stats().layersUsed);
+    EXPECT_NE(atlas.find("White Square")->layer, atlas.find("Checker")->layer);
+}
+
+TEST_F(AppleSauceAsyncResources, CanCarryOnPastMissingFiles)
+{
+    AsyncResourceManager resources;
+    const auto texture = resources.loadTexture("Missing", assetPath("textures/Missing.png"));
+    resources.loadMeshes(assetPath("gltf/missing.gltf"));
+    resources.loadTexture("Checker", assetPath("textures/Checker.png"));
+    resources.finish();
+
+    EXPECT_EQ(3, resources.stats().requested);
+    EXPECT_EQ(1, resources.stats().uploaded);
+    EXPECT_EQ(2, resources.stats().failed);
+    EXPECT_EQ(1, textureWidth(*texture));
+}
+
+// With no budget at all every frame still uploads one load, and only one
+TEST_F(AppleSauceAsyncResources, CanSpreadUploadsOverFrames)
+{
+    AsyncResourceManager resources(2, 2);
+    resources.loadTexture("Checker", assetPath("textures/Checker.png"));
+    resources.loadTexture("White Square", assetPath("textures/White Square.png"));
+    resources.loadMeshes(assetPath("gltf/tenk9aa.gltf"));
+    resources.loadMeshes(assetPath("gltf/wall-and-floor.gltf"));
+
+    size_t frames = 0;
+    while (!resources.idle() && frames < 10000)
+    {
+        const auto uploaded = resources.stats().uploaded;
+        resources.upload(0.0);
+        EXPECT_LE(resources.stats().uploaded, uploaded + 1);
+        frames++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_TRUE(resources.idle());
+    EXPECT_EQ(4, resources.stats().uploaded);
+    EXPECT_EQ(4, resources.stats().uploadFrames);
+    EXPECT_EQ(4, resources.stats().stalls);
+}
+
+// How long the drawing thread is held up before it can show a frame: loading
+// everything in place against only asking for it
+TEST_F(AppleSauceAsyncResources, BenchmarkTimeToFirstFrame)
+{
+    using Clock = std::chrono::steady_clock;
+
+    const auto blockingStart = Clock::now();
+    {
+        const auto checker = textureFromPNG(assetPath("textures/Checker.png").c_str());
+        const auto whiteSquare = textureFromPNG(assetPath("textures/White Square.png").c_str());
+        const auto tenk = loadMeshes(assetPath("gltf/tenk9aa.gltf").c_str());
+        const auto walls = loadMeshes(assetPath("gltf/wall-and-floor.gltf").c_str());
+    }
+    const std::chrono::duration<double> blocking = Clock::now() - blockingStart;
+
+    AsyncResourceManager resources;
+    const auto asyncStart = Clock::now();
+    resources.loadTexture("Checker", assetPath("textures/Checker.png"));
+    resources.loadTexture("White Square", assetPath("textures/White Square.png"));
+    resources.loadMeshes(assetPath("gltf/tenk9aa.gltf"));
+    resources.loadMeshes(assetPath("gltf/wall-and-floor.gltf"));
+    const std::chrono::duration<double> requested = Clock::now() - asyncStart;
+
+    // Frames at a 2 ms upload budget until everything is in
+    size_t frames = 0;
+    while (!resources.idle())
+    {
+        resources.upload(0.002);
+        frames++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const std::chrono::duration<double> ready = Clock::now() - asyncStart;
+    const auto &stats = resources.stats();
+
+    std::cout << "Blocking load: " << blocking.count() * 1000.0 << " ms before the first frame" << std::endl;
+    std::cout << "Async load: " << requested.count() * 1000.0 << " ms before the first frame, everything in after "
+              << ready.count() * 1000.0 << " ms (" << frames << " frames)" << std::endl;
+    std::cout << "\tDecode " << stats.decodeSeconds * 1000.0 << " ms on workers, upload " << stats.uploadSeconds * 1000.0
+              << " ms, worst frame " << stats.maxFrameUploadSeconds * 1000.0 << " ms, " << stats.stalls << " over budget" << std::endl;
+    RecordProperty("BlockingMicroseconds", static_cast<int>(blocking.count() * 1e6));
+    RecordProperty("AsyncMicroseconds", static_cast<int>(requested.count() * 1e6));
+    RecordProperty("UploadStalls", static_cast<int>(stats.stalls));
+
+    EXPECT_EQ(4, stats.uploaded);
+}
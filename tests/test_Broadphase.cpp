@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <game/Broadphase.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+
+static std::vector<AABB> randomBoxes(size_t count, float worldSize, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<float> position(-worldSize * 0.5f, worldSize * 0.5f);
+    std::uniform_real_distribution<float> size(0.25f, 1.7f);
+
+    std::vector<AABB> boxes;
+    boxes.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const glm::vec2 center{position(rng), position(rng)};
+        const float halfSize = size(rng) * 0.5f;
+        boxes.push_back({center - glm::vec2{halfSize}, center + glm::vec2{halfSize}});
+    }
+    return boxes;
+}
+
+static std::vector<SweepAndPrune::Pair> bruteForcePairs(const std::vector<AABB> &boxes)
+{
+    std::vector<SweepAndPrune::Pair> result;
+    for (uint32_t i = 0; i < boxes.size(); i++)
+    {
+        for (uint32_t j = i + 1; j < boxes.size(); j++)
+        {
+            if (checkCollision(boxes[i], boxes[j]))
+                result.emplace_back(i, j);
+        }
+    }
+    return result;
+}
+
+TEST(Broadphase, CanFindNoPairsWhenEmpty)
+{
+    SweepAndPrune broadphase;
+    EXPECT_TRUE(broadphase.findPairs().empty());
+}
+
+TEST(Broadphase, CanFindOverlappingPair)
+{
+    SweepAndPrune broadphase;
+    broadphase.add(7, {{0, 0}, {1, 1}});
+    broadphase.add(3, {{0.5f, 0.5f}, {1.5f, 1.5f}});
+    broadphase.add(5, {{4, 4}, {5, 5}});
+
+    const auto &pairs = broadphase.findPairs();
+    ASSERT_EQ(1, pairs.size());
+    EXPECT_EQ(SweepAndPrune::Pair(3, 7), pairs.front());
+}
+
+TEST(Broadphase, CanRejectPairsOverlappingOnlyOnX)
+{
+    SweepAndPrune broadphase;
+    broadphase.add(0, {{0, 0}, {1, 1}});
+    broadphase.add(1, {{0, 2}, {1, 3}});
+
+    EXPECT_TRUE(broadphase.findPairs().empty());
+}
+
+TEST(Broadphase, CanMatchBruteForce)
+{
+    std::mt19937 rng(1234);
+    const auto boxes = randomBoxes(2000, 60.0f, rng);
+
+    SweepAndPrune broadphase;
+    for (uint32_t i = 0; i < boxes.size(); i++)
+    {
+        broadphase.add(i, boxes[i]);
+    }
+
+    EXPECT_EQ(bruteForcePairs(boxes), broadphase.findPairs());
+}
+
+// Scaling benchmark from 10 to 10k dynamic entities. The world grows with the
+// entity count so density stays about the same as the arena with debris.
+TEST(Broadphase, CanScaleToTenThousandEntities)
+{
+    SweepAndPrune broadphase;
+    std::mt19937 rng(42);
+
+    for (size_t count : {10, 100, 1000, 10000})
+    {
+        const auto boxes = randomBoxes(count, std::sqrt(static_cast<float>(count)) * 4.0f, rng);
+
+        const auto bruteStart = std::chrono::steady_clock::now();
+        const auto expected = bruteForcePairs(boxes);
+        const std::chrono::duration<double, std::micro> bruteTime = std::chrono::steady_clock::now() - bruteStart;
+
+        constexpr int iterations = 10;
+        const auto sweepStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            broadphase.clear();
+            for (uint32_t id = 0; id < boxes.size(); id++)
+            {
+                broadphase.add(id, boxes[id]);
+            }
+            broadphase.findPairs();
+        }
+        const std::chrono::duration<double, std::micro> sweepTime = (std::chrono::steady_clock::now() - sweepStart) / iterations;
+
+        EXPECT_EQ(expected, broadphase.findPairs());
+        std::cout << count << " entities: all pairs " << bruteTime.count() << " us, sweep and prune "
+                  << sweepTime.count() << " us, " << expected.size() << " pairs" << std::endl;
+    }
+}
@@ -0,0 +1,224 @@
+#include <gtest/gtest.h>
+
+#include <util/CompressedImage.h>
+#include <util/Image.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static const std::filesystem::path assetDirectory(ASSET_DIR);
+
+static double peakSignalToNoise(const Image &a, const Image &b)
+{
+    double squaredError = 0;
+    for (size_t i = 0; i < a.pixels.size(); i++)
+    {
+        const double difference = static_cast<double>(a.pixels[i]) - b.pixels[i];
+        squaredError += difference * difference;
+    }
+    const auto meanSquaredError = squaredError / static_cast<double>(a.pixels.size());
+    return meanSquaredError > 0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : 100.0;
+}
+
+// A smooth diagonal colour ramp, with a second ramp in alpha or opaque
+static Image gradient(uint32_t width, uint32_t height, bool alpha = true)
+{
+    Image image{width, height, std::vector<uint8_t>(static_cast<size_t>(width) * height * 4)};
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            auto pixel = &image.pixels[(static_cast<size_t>(y) * width + x) * 4];
+            pixel[0] = static_cast<uint8_t>(x * 255 / (width - 1));
+            pixel[1] = static_cast<uint8_t>(y * 255 / (height - 1));
+            pixel[2] = static_cast<uint8_t>((x + y) * 255 / (width + height - 2));
+            pixel[3] = alpha ? static_cast<uint8_t>(255 - y * 255 / (height - 1)) : 255;
+        }
+    }
+    return image;
+}
+
+static void put32(std::vector<uint8_t> &bytes, size_t offset, uint32_t value)
+{
+    std::memcpy(bytes.data() + offset, &value, sizeof(value));
+}
+
+static void put64(std::vector<uint8_t> &bytes, size_t offset, uint64_t value)
+{
+    std::memcpy(bytes.data() + offset, &value, sizeof(value));
+}
+
+TEST(CompressedImage, CanDecodeKnownBlock)
+{
+    // Pure red and pure blue, the four colour mode, one row per palette entry
+    CompressedImage image;
+    image.format = CompressedImage::Format::bc1;
+    image.levels.push_back({4, 4, {0x00, 0xF8, 0x1F, 0x00, 0x00, 0x55, 0xAA, 0xFF}});
+
+    const auto decoded = decompressLevel(image, 0);
+    ASSERT_EQ(4, decoded.width);
+    const auto texel = [&](int x, int y)
+    {
+        const auto pixel = &decoded.pixels[(y * 4 + x) * 4];
+        return std::vector<int>{pixel[0], pixel[1], pixel[2], pixel[3]};
+    };
+    EXPECT_EQ((std::vector<int>{255, 0, 0, 255}), texel(0, 0));
+    EXPECT_EQ((std::vector<int>{0, 0, 255, 255}), texel(3, 1));
+    EXPECT_EQ((std::vector<int>{170, 0, 85, 255}), texel(1, 2));
+    EXPECT_EQ((std::vector<int>{85, 0, 170, 255}), texel(2, 3));
+}
+
+TEST(CompressedImage, CanEncodeWithLittleError)
+{
+    const auto image = gradient(64, 64);
+    const auto mips = generateMipChain(image);
+
+    const auto bc1 = compressMipChain(mips, CompressedImage::Format::bc1);
+    ASSERT_EQ(mips.size(), bc1.levels.size());
+    EXPECT_EQ(16 * 16 * 8, bc1.levels[0].blocks.size());
+    // Levels under a block still take a whole one
+    EXPECT_EQ(8, bc1.levels.back().blocks.size());
+
+    const auto bc3 = compressMipChain(mips, CompressedImage::Format::bc3);
+    EXPECT_EQ(2 * bc1.levels[0].blocks.size(), bc3.levels[0].blocks.size());
+
+    // BC1 only has on or off alpha, so compare colour through BC3 too
+    const auto decoded = decompressLevel(bc3, 0);
+    EXPECT_GT(peakSignalToNoise(image, decoded), 38.0);
+
+    const auto checker = imageFromPNG((assetDirectory / "textures" / "Checker.png").string().c_str());
+    ASSERT_FALSE(checker.empty());
+    const auto checkerBC1 = compressMipChain({checker}, CompressedImage::Format::bc1);
+    EXPECT_GT(peakSignalToNoise(checker, decompressLevel(checkerBC1, 0)), 35.0);
+
+    EXPECT_THROW(compressMipChain(mips, CompressedImage::Format::bc7), std::runtime_error);
+}
+
+TEST(CompressedImage, CanKeepCutOutAlphaInBC1)
+{
+    Image image{8, 4, std::vector<uint8_t>(8 * 4 * 4, 200)};
+    for (size_t i = 0; i < image.pixels.size(); i += 8)
+    {
+        image.pixels[i + 3] = 0;
+    }
+
+    const auto decoded = decompressLevel(compressMipChain({image}, CompressedImage::Format::bc1), 0);
+    for (size_t i = 0; i < image.pixels.size(); i += 4)
+    {
+        EXPECT_EQ(image.pixels[i + 3] < 128 ? 0 : 255, decoded.pixels[i + 3]) << "Texel " << i / 4;
+    }
+}
+
+TEST(CompressedImage, CanRoundTripDDS)
+{
+    const auto path = std::filesystem::temp_directory_path() / "combat_gl_compressed_test.dds";
+    const auto mips = generateMipChain(gradient(24, 12));
+    for (const auto format : {CompressedImage::Format::bc1, CompressedImage::Format::bc3})
+    {
+        const auto image = compressMipChain(mips, format);
+        writeDDS(path.string().c_str(), image);
+
+        const auto read = compressedImageFromFile(path.string().c_str());
+        EXPECT_EQ(format, read.format);
+        ASSERT_EQ(image.levels.size(), read.levels.size());
+        for (size_t level = 0; level < image.levels.size(); level++)
+        {
+            EXPECT_EQ(image.levels[level].width, read.levels[level].width);
+            EXPECT_EQ(image.levels[level].height, read.levels[level].height);
+            EXPECT_EQ(image.levels[level].blocks, read.levels[level].blocks);
+        }
+    }
+
+    // BC7 is only passed through, behind the DX10 header
+    CompressedImage bc7;
+    bc7.format = CompressedImage::Format::bc7;
+    bc7.levels.push_back({4, 4, std::vector<uint8_t>(16, 0x5A)});
+    writeDDS(path.string().c_str(), bc7);
+    const auto read = compressedImageFromFile(path.string().c_str());
+    EXPECT_EQ(CompressedImage::Format::bc7, read.format);
+    EXPECT_EQ(bc7.levels[0].blocks, read.levels[0].blocks);
+    EXPECT_TRUE(decompressLevel(read, 0).empty());
+
+    std::filesystem::remove(path);
+}
+
+TEST(CompressedImage, CanReadKTX2)
+{
+    // 8x8 BC3 with two levels, the smaller one first in the file
+    std::vector<uint8_t> file(80 + 2 * 24);
+    const uint8_t identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    std::memcpy(file.data(), identifier, sizeof(identifier));
+    put32(file, 12, 137); // VK_FORMAT_BC3_UNORM_BLOCK
+    put32(file, 16, 1);
+    put32(file, 20, 8);
+    put32(file, 24, 8);
+    put32(file, 36, 1);
+    put32(file, 40, 2);
+
+    const auto smallOffset = file.size();
+    file.resize(file.size() + 16, 0x22);
+    const auto largeOffset = file.size();
+    file.resize(file.size() + 64, 0x11);
+    put64(file, 80, largeOffset);
+    put64(file, 88, 64);
+    put64(file, 104, smallOffset);
+    put64(file, 112, 16);
+
+    const auto image = compressedImageFromMemory(file.data(), file.size());
+    EXPECT_EQ(CompressedImage::Format::bc3, image.format);
+    ASSERT_EQ(2, image.levels.size());
+    EXPECT_EQ(8, image.levels[0].width);
+    EXPECT_EQ(std::vector<uint8_t>(64, 0x11), image.levels[0].blocks);
+    EXPECT_EQ(4, image.levels[1].width);
+    EXPECT_EQ(std::vector<uint8_t>(16, 0x22), image.levels[1].blocks);
+
+    // A level running off the end of the file
+    put64(file, 112, 4096);
+    EXPECT_THROW(compressedImageFromMemory(file.data(), file.size()), std::runtime_error);
+    put64(file, 112, 16);
+
+    put32(file, 12, 37); // VK_FORMAT_R8G8B8A8_UNORM
+    EXPECT_THROW(compressedImageFromMemory(file.data(), file.size()), std::runtime_error);
+
+    const uint8_t png[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    EXPECT_THROW(compressedImageFromMemory(png, sizeof(png)), std::runtime_error);
+    EXPECT_THROW(compressedImageFromFile((assetDirectory / "textures" / "Missing.dds").string().c_str()), std::runtime_error);
+}
+
+// Encoding speed, and what the texture would take in GL memory either way
+TEST(CompressedImage, BenchmarkEncoding)
+{
+    const auto mips = generateMipChain(gradient(1024, 1024, false));
+    size_t rgbaBytes = 0;
+    for (const auto &mip : mips)
+    {
+        rgbaBytes += mip.pixels.size();
+    }
+
+    for (const auto format : {CompressedImage::Format::bc1, CompressedImage::Format::bc3})
+    {
+        const auto name = format == CompressedImage::Format::bc1 ? "BC1" : "BC3";
+        const auto start = std::chrono::steady_clock::now();
+        const auto image = compressMipChain(mips, format);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        size_t bytes = 0;
+        for (const auto &level : image.levels)
+        {
+            bytes += level.blocks.size();
+        }
+        const auto megatexels = static_cast<double>(rgbaBytes) / 4 / 1e6;
+        std::cout << name << ": " << megatexels / elapsed.count() << " Mtexels/s, " << bytes << " bytes against "
+                  << rgbaBytes << " as RGBA (" << static_cast<double>(rgbaBytes) / bytes << "x), PSNR "
+                  << peakSignalToNoise(mips[0], decompressLevel(image, 0)) << " dB" << std::endl;
+        RecordProperty(std::string(name) + "Microseconds", static_cast<int>(elapsed.count() * 1e6));
+        // Exactly an eighth or a quarter but for the levels under a block
+        EXPECT_LE(bytes, rgbaBytes / (format == CompressedImage::Format::bc1 ? 8 : 4) + 32);
+    }
+}
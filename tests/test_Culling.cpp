@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <applesauce/Culling.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace applesauce;
+
+static bool visible(const Frustum &frustum, const Sphere &sphere)
+{
+    CullingSet set;
+    set.add(sphere);
+    std::vector<uint8_t> result;
+    set.cull(frustum, result);
+    return result[0] != 0;
+}
+
+TEST(Culling, CanComputeBoundsFromPoints)
+{
+    const glm::vec3 points[] = {{1, -2, 0}, {-1, 3, 0.5f}, {0, 0, -4}};
+    const auto bounds = Bounds::fromPoints(points, 3);
+    EXPECT_EQ(glm::vec3(-1, -2, -4), bounds.min);
+    EXPECT_EQ(glm::vec3(1, 3, 0.5f), bounds.max);
+    EXPECT_EQ(glm::vec3(0, 0.5f, -1.75f), bounds.center());
+}
+
+TEST(Culling, CanTransformBoundingSphere)
+{
+    const Bounds unitBox{{-0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, 0.5f}};
+    const auto transform = glm::scale(glm::translate(glm::mat4{1.0f}, glm::vec3{3, 0, 0}), glm::vec3{1, 4, 1});
+
+    const auto sphere = worldSphere(unitBox, transform);
+    EXPECT_EQ(glm::vec3(3, 0, 0), sphere.center);
+    EXPECT_FLOAT_EQ(unitBox.radius() * 4.0f, sphere.radius);
+}
+
+TEST(Culling, CanCullAgainstPerspectiveFrustum)
+{
+    // Looking down -z from the origin
+    const auto frustum = Frustum::fromMatrix(glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f));
+
+    EXPECT_TRUE(visible(frustum, {{0, 0, -10}, 1}));
+    EXPECT_FALSE(visible(frustum, {{0, 0, 10}, 1}));
+    EXPECT_FALSE(visible(frustum, {{0, 0, -200}, 1}));
+    EXPECT_FALSE(visible(frustum, {{50, 0, -10}, 1}));
+    // Centre outside, but reaching in
+    EXPECT_TRUE(visible(frustum, {{0, 0, -101}, 2}));
+    EXPECT_TRUE(visible(frustum, {{8, 0, -10}, 4}));
+}
+
+TEST(Culling, CanCullAgainstLightBox)
+{
+    const auto lightView = glm::lookAt(glm::vec3{0, 10, 0}, glm::vec3{0}, glm::vec3{0, 0, 1});
+    const auto frustum = Frustum::fromMatrix(glm::ortho(-17.0f, 17.0f, -17.0f, 17.0f, 0.1f, 20.0f) * lightView);
+
+    EXPECT_TRUE(visible(frustum, {{0, 0, 0}, 1}));
+    EXPECT_TRUE(visible(frustum, {{16, 0, -16}, 1}));
+    EXPECT_FALSE(visible(frustum, {{30, 0, 0}, 1}));
+    EXPECT_FALSE(visible(frustum, {{0, -15, 0}, 1}));
+}
+
+static CullingSet randomSpheres(size_t count, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<float> position(-120.0f, 120.0f);
+    std::uniform_real_distribution<float> radius(0.1f, 3.0f);
+    CullingSet set;
+    for (size_t i = 0; i < count; i++)
+    {
+        set.add({{position(rng), position(rng), position(rng)}, radius(rng)});
+    }
+    return set;
+}
+
+TEST(Culling, CanMatchScalarCulling)
+{
+    std::mt19937 rng(3);
+    const auto frustum = Frustum::fromMatrix(glm::perspective(glm::radians(45.0f), 1.5f, 0.1f, 100.0f) *
+                                             glm::lookAt(glm::vec3{0, 20, 20}, glm::vec3{0}, glm::vec3{0, 1, 0}));
+
+    // Not a multiple of four, so the tail is covered too
+    const auto set = randomSpheres(10003, rng);
+    std::vector<uint8_t> simd, scalar;
+    const auto simdStats = set.cull(frustum, simd);
+    const auto scalarStats = set.cullScalar(frustum, scalar);
+
+    EXPECT_EQ(scalar, simd);
+    EXPECT_EQ(10003, simdStats.tested);
+    EXPECT_EQ(scalarStats.drawn, simdStats.drawn);
+    EXPECT_EQ(simdStats.tested, simdStats.drawn + simdStats.culled);
+    EXPECT_GT(simdStats.culled, 0);
+    EXPECT_GT(simdStats.drawn, 0);
+}
+
+TEST(Culling, CanCullFasterWithSIMD)
+{
+    std::mt19937 rng(8);
+    const auto frustum = Frustum::fromMatrix(glm::perspective(glm::radians(45.0f), 1.5f, 0.1f, 100.0f));
+    const auto set = randomSpheres(100000, rng);
+    std::vector<uint8_t> result;
+
+    constexpr int iterations = 20;
+    size_t drawn = 0;
+    const auto scalarStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        drawn += set.cullScalar(frustum, result).drawn;
+    const std::chrono::duration<double, std::micro> scalarTime = (std::chrono::steady_clock::now() - scalarStart) / iterations;
+
+    const auto simdStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        drawn -= set.cull(frustum, result).drawn;
+    const std::chrono::duration<double, std::micro> simdTime = (std::chrono::steady_clock::now() - simdStart) / iterations;
+
+    EXPECT_EQ(0, drawn);
+    std::cout << set.size() << " spheres: scalar " << scalarTime.count() << " us, SIMD " << simdTime.count() << " us" << std::endl;
+}
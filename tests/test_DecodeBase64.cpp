@@ -2,7 +2,15 @@
 
 #include <util/base64.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
 #include <memory>
+#include <random>
+#include <string>
+#include <vector>
 
 TEST(Base64, CanDecodeThreeCharacters)
 {
@@ -51,3 +59,151 @@ TEST(Base64, CanDecodeArbitrarilyLongSequence)
     EXPECT_EQ(11, decodeBase64(base64String, decodedBuffer, 16));
     EXPECT_STREQ(expected, decodedBuffer);
 }
+
+static std::string encodeBase64(const std::vector<uint8_t> &bytes)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string result;
+    for (size_t i = 0; i < bytes.size(); i += 3)
+    {
+        const size_t remaining = bytes.size() - i;
+        uint32_t bits = static_cast<uint32_t>(bytes[i]) << 16;
+        if (remaining > 1)
+            bits |= static_cast<uint32_t>(bytes[i + 1]) << 8;
+        if (remaining > 2)
+            bits |= bytes[i + 2];
+
+        result += alphabet[bits >> 18 & 63];
+        result += alphabet[bits >> 12 & 63];
+        result += remaining > 1 ? alphabet[bits >> 6 & 63] : '=';
+        result += remaining > 2 ? alphabet[bits & 63] : '=';
+    }
+    return result;
+}
+
+static std::vector<Base64Decoder> supportedDecoders()
+{
+    std::vector<Base64Decoder> decoders;
+    for (auto decoder : {Base64Decoder::scalar, Base64Decoder::sse41, Base64Decoder::avx2})
+    {
+        if (isBase64DecoderSupported(decoder))
+            decoders.push_back(decoder);
+    }
+    return decoders;
+}
+
+static const char *decoderName(Base64Decoder decoder)
+{
+    switch (decoder)
+    {
+    case Base64Decoder::scalar:
+        return "scalar";
+    case Base64Decoder::sse41:
+        return "sse4.1";
+    case Base64Decoder::avx2:
+        return "avx2";
+    default:
+        return "automatic";
+    }
+}
+
+TEST(Base64, CanDecodeEmptyInput)
+{
+    char decodedBuffer[1] = {'x'};
+    EXPECT_EQ(0, decodeBase64("", decodedBuffer, 0));
+    EXPECT_EQ('x', decodedBuffer[0]);
+}
+
+TEST(Base64, CanRejectLengthNotMultipleOfFour)
+{
+    char decodedBuffer[8];
+    EXPECT_EQ(-1, decodeBase64("TWFuT", decodedBuffer, 5));
+    EXPECT_EQ(-1, decodeBase64("TWE", decodedBuffer, 3));
+}
+
+TEST(Base64, CanRejectMisplacedPadding)
+{
+    char decodedBuffer[8];
+    EXPECT_EQ(-1, decodeBase64("T===", decodedBuffer, 4));
+    EXPECT_EQ(-1, decodeBase64("====", decodedBuffer, 4));
+    EXPECT_EQ(-1, decodeBase64("TQ=u", decodedBuffer, 4));
+    EXPECT_EQ(-1, decodeBase64("TQ==TWFu", decodedBuffer, 8));
+}
+
+TEST(Base64, CanRejectInvalidCharactersInEveryDecoder)
+{
+    const std::vector<uint8_t> bytes(300, 0xA5);
+    const auto encoded = encodeBase64(bytes);
+
+    std::vector<char> decodedBuffer(bytes.size());
+    for (auto decoder : supportedDecoders())
+    {
+        for (char bad : {'*', '-', '_', ' ', '\n', '\0', '=', '\x80', '\xff'})
+        {
+            // Hit the vector body, the scalar tail and the final group
+            for (size_t position : {size_t{0}, size_t{37}, size_t{250}, encoded.size() - 3})
+            {
+                auto corrupt = encoded;
+                corrupt[position] = bad;
+                EXPECT_EQ(-1, decodeBase64(corrupt.data(), decodedBuffer.data(), corrupt.size(), decoder))
+                    << decoderName(decoder) << " accepted " << static_cast<int>(bad) << " at " << position;
+            }
+        }
+    }
+}
+
+TEST(Base64, CanRoundTripRandomBytesInEveryDecoder)
+{
+    std::mt19937 rng(9);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    for (size_t length = 0; length < 400; length++)
+    {
+        std::vector<uint8_t> bytes(length);
+        for (auto &b : bytes)
+            b = static_cast<uint8_t>(byte(rng));
+        const auto encoded = encodeBase64(bytes);
+
+        for (auto decoder : supportedDecoders())
+        {
+            // Guard bytes after the output catch vector stores running past the end
+            std::vector<uint8_t> decoded(base64DecodedLength(encoded.size()) + 32, 0xEE);
+            const int count = decodeBase64(encoded.data(), reinterpret_cast<char *>(decoded.data()), encoded.size(), decoder);
+
+            ASSERT_EQ(static_cast<int>(length), count) << decoderName(decoder);
+            EXPECT_TRUE(std::equal(bytes.begin(), bytes.end(), decoded.begin())) << decoderName(decoder) << " length " << length;
+            EXPECT_TRUE(std::all_of(decoded.begin() + base64DecodedLength(encoded.size()), decoded.end(),
+                                    [](uint8_t b)
+                                    { return b == 0xEE; }))
+                << decoderName(decoder) << " wrote past the output at length " << length;
+        }
+    }
+}
+
+// Throughput of each decoder on a payload about the size of an embedded
+// glTF buffer.
+TEST(Base64, CanDecodeFasterWithVectorDecoders)
+{
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<uint8_t> bytes(8 * 1024 * 1024);
+    for (auto &b : bytes)
+        b = static_cast<uint8_t>(byte(rng));
+    const auto encoded = encodeBase64(bytes);
+    std::vector<char> decoded(base64DecodedLength(encoded.size()));
+
+    for (auto decoder : supportedDecoders())
+    {
+        constexpr int iterations = 10;
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            ASSERT_EQ(static_cast<int>(bytes.size()), decodeBase64(encoded.data(), decoded.data(), encoded.size(), decoder));
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        const double megabytesPerSecond = encoded.size() * iterations / elapsed.count() / (1024.0 * 1024.0);
+        std::cout << decoderName(decoder) << ": " << megabytesPerSecond << " MB/s of base64 input" << std::endl;
+        RecordProperty(std::string("base64_") + decoderName(decoder) + "_mb_per_s", static_cast<int>(megabytesPerSecond));
+    }
+}
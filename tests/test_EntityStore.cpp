@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+
+#include <applesauce/Entity.h>
+#include <applesauce/EntityStore.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <random>
+#include <vector>
+
+struct Marker : public applesauce::Entity
+{
+};
+
+TEST(EntityStore, CanRenumberSlotsOnRemoval)
+{
+    applesauce::EntityStore store;
+    std::vector<std::shared_ptr<Marker>> markers;
+    for (int i = 0; i < 4; i++)
+    {
+        markers.push_back(std::make_shared<Marker>());
+        store.add(markers.back());
+        markers.back()->position() = glm::vec3{static_cast<float>(i)};
+    }
+
+    markers[1]->destroy();
+    store.add(nullptr);
+    store.destroyed[4] = 1;
+    store.removeDestroyed();
+
+    ASSERT_EQ(3, store.size());
+    EXPECT_TRUE(markers[1]->isPendingDestruction);
+    EXPECT_EQ(1, markers[1].use_count());
+    EXPECT_EQ(glm::vec3{0.0f}, markers[0]->position());
+    EXPECT_EQ(glm::vec3{2.0f}, markers[2]->position());
+    EXPECT_EQ(glm::vec3{3.0f}, markers[3]->position());
+    EXPECT_EQ(markers[3], store.entities[2]);
+
+    // Survivors moved down don't pick up the flag of the slot they moved into
+    EXPECT_EQ(0, store.destroyed[1]);
+    EXPECT_EQ(0, store.destroyed[2]);
+    store.removeDestroyed();
+    ASSERT_EQ(3, store.size());
+    EXPECT_EQ(markers[2], store.entities[1]);
+    EXPECT_EQ(markers[3], store.entities[2]);
+}
+
+TEST(EntityStore, CanTakeSlotFromAnotherStore)
+{
+    applesauce::EntityStore staging;
+    auto marker = std::make_shared<Marker>();
+    staging.add(nullptr);
+    staging.add(marker);
+    marker->position() = glm::vec3{1.0f, 2.0f, 3.0f};
+    marker->velocity() = glm::vec3{4.0f};
+    marker->setKinematic(true);
+
+    applesauce::EntityStore store;
+    store.add(nullptr);
+    EXPECT_EQ(1, store.take(staging, 1));
+    staging.clear();
+
+    ASSERT_EQ(2, store.size());
+    EXPECT_EQ(marker, store.entities[1]);
+    EXPECT_EQ((glm::vec3{1.0f, 2.0f, 3.0f}), marker->position());
+    EXPECT_EQ(glm::vec3{4.0f}, marker->velocity());
+    EXPECT_EQ(1, store.kinematic[1]);
+}
+
+TEST(EntityStore, CanIntegrateKinematicSlotsOnly)
+{
+    applesauce::EntityStore store;
+    store.add(nullptr);
+    store.add(nullptr);
+    store.velocities[0] = store.velocities[1] = glm::vec3{1.0f, 0, 2.0f};
+    store.kinematic[0] = 1;
+
+    applesauce::systems::integrate(store, 0.5f);
+    applesauce::systems::buildModelMatrices(store);
+
+    EXPECT_EQ((glm::vec3{0.5f, 0, 1.0f}), store.positions[0]);
+    EXPECT_EQ(glm::vec3{0}, store.positions[1]);
+    EXPECT_EQ((glm::vec4{0.5f, 0, 1.0f, 1.0f}), store.modelMatrices[0][3]);
+}
+
+// The per entity work of a tick as it was done before the component store:
+// a virtual update that integrates, two model matrix rebuilds and gathering
+// the collidables, over a std::list of shared_ptrs.
+struct LegacyEntity
+{
+    glm::vec3 position = glm::vec3{0};
+    glm::vec3 velocity = glm::vec3(0);
+    glm::quat orientation = glm::quat{glm::vec3{0}};
+    std::shared_ptr<applesauce::Mesh> mesh = nullptr;
+    glm::mat4 modelMatrix = glm::mat4{1.0f};
+    applesauce::IWorld *world = nullptr;
+    bool collidable = true;
+    float collisionSize = 0.25f;
+    LegacyEntity *originator = nullptr;
+    bool isPendingDestruction = false;
+
+    virtual ~LegacyEntity() {}
+    virtual void update(float dt)
+    {
+        position += velocity * dt;
+    }
+};
+
+// Per tick cost for 50k moving entities, old layout against the component
+// arrays. The legacy list is linked in shuffled order, like a list that has
+// seen a lot of spawns and removals.
+TEST(EntityStore, CanSweepFiftyThousandEntities)
+{
+    constexpr size_t entityCount = 50000;
+    constexpr int ticks = 60;
+    constexpr float dt = 1.0f / 60.0f;
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> random(-10.0f, 10.0f);
+
+    std::vector<std::shared_ptr<LegacyEntity>> allocated;
+    for (size_t i = 0; i < entityCount; i++)
+    {
+        auto entity = std::make_shared<LegacyEntity>();
+        entity->position = {random(rng), 0, random(rng)};
+        entity->velocity = {random(rng), 0, random(rng)};
+        allocated.push_back(entity);
+    }
+    std::shuffle(allocated.begin(), allocated.end(), rng);
+    std::list<std::shared_ptr<LegacyEntity>> legacy(allocated.begin(), allocated.end());
+    allocated.clear();
+
+    applesauce::EntityStore store;
+    for (const auto &entity : legacy)
+    {
+        const auto slot = store.add(nullptr);
+        store.positions[slot] = entity->position;
+        store.velocities[slot] = entity->velocity;
+        store.kinematic[slot] = 1;
+        store.colliders[slot] = {true, 0.25f};
+    }
+
+    std::vector<glm::vec3> gathered;
+    gathered.reserve(entityCount);
+
+    const auto legacyStart = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < ticks; tick++)
+    {
+        legacy.erase(std::remove_if(legacy.begin(), legacy.end(), [](const auto &e)
+                                    { return e->isPendingDestruction; }),
+                     legacy.end());
+        gathered.clear();
+        for (auto &entity : legacy)
+        {
+            entity->modelMatrix = glm::translate(glm::mat4{1.0f}, entity->position) * glm::mat4(entity->orientation);
+            entity->update(dt);
+            entity->modelMatrix = glm::translate(glm::mat4{1.0f}, entity->position) * glm::mat4(entity->orientation);
+        }
+        for (const auto &entity : legacy)
+        {
+            if (entity->collidable)
+                gathered.push_back(entity->position);
+        }
+    }
+    const std::chrono::duration<double, std::milli> legacyTime = (std::chrono::steady_clock::now() - legacyStart) / ticks;
+
+    const auto storeStart = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < ticks; tick++)
+    {
+        store.removeDestroyed();
+        gathered.clear();
+        applesauce::systems::buildModelMatrices(store);
+        applesauce::systems::integrate(store, dt);
+        applesauce::systems::buildModelMatrices(store);
+        for (size_t i = 0; i < store.size(); i++)
+        {
+            if (store.colliders[i].enabled)
+                gathered.push_back(store.positions[i]);
+        }
+    }
+    const std::chrono::duration<double, std::milli> storeTime = (std::chrono::steady_clock::now() - storeStart) / ticks;
+
+    // Both layouts did the same arithmetic in the same order
+    size_t slot = 0;
+    for (const auto &entity : legacy)
+    {
+        ASSERT_EQ(entity->position, store.positions[slot++]);
+    }
+
+    std::cout << entityCount << " entities per tick: list of shared_ptr " << legacyTime.count()
+              << " ms, component arrays " << storeTime.count() << " ms" << std::endl;
+    RecordProperty("LegacyTickMicroseconds", static_cast<int>(legacyTime.count() * 1000.0));
+    RecordProperty("StoreTickMicroseconds", static_cast<int>(storeTime.count() * 1000.0));
+}
@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+
+#include <util/MappedFile.h>
+#include <util/gltf.h>
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static void appendUint32(std::vector<uint8_t> &out, uint32_t value)
+{
+    const auto p = reinterpret_cast<const uint8_t *>(&value);
+    out.insert(out.end(), p, p + sizeof(value));
+}
+
+static std::vector<uint8_t> makeGLB(const std::string &json, const std::vector<uint8_t> &bin)
+{
+    std::string paddedJson = json;
+    while (paddedJson.size() % 4)
+        paddedJson += ' ';
+    std::vector<uint8_t> paddedBin = bin;
+    while (paddedBin.size() % 4)
+        paddedBin.push_back(0);
+
+    std::vector<uint8_t> glb;
+    appendUint32(glb, 0x46546C67);
+    appendUint32(glb, 2);
+    appendUint32(glb, static_cast<uint32_t>(12 + 8 + paddedJson.size() + 8 + paddedBin.size()));
+    appendUint32(glb, static_cast<uint32_t>(paddedJson.size()));
+    appendUint32(glb, 0x4E4F534A);
+    glb.insert(glb.end(), paddedJson.begin(), paddedJson.end());
+    appendUint32(glb, static_cast<uint32_t>(paddedBin.size()));
+    appendUint32(glb, 0x004E4942);
+    glb.insert(glb.end(), paddedBin.begin(), paddedBin.end());
+    return glb;
+}
+
+static std::string readFile(const std::filesystem::path &path)
+{
+    std::ifstream f{path, std::ios::binary};
+    return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+static void writeFile(const std::filesystem::path &path, const void *data, size_t size)
+{
+    std::ofstream f{path, std::ios::binary};
+    f.write(static_cast<const char *>(data), size);
+}
+
+// Converts a glTF with one embedded base64 buffer into its GLB equivalent
+static std::vector<uint8_t> glbFromEmbedded(const std::string &gltfText)
+{
+    auto json = nlohmann::json::parse(gltfText);
+    const auto bytes = glTFFromString(gltfText.c_str()).buffers.at(0).getBytes();
+    json["buffers"][0].erase("uri");
+    return makeGLB(json.dump(), bytes);
+}
+
+static const char *triangleJson = R"({
+    "asset": { "version": "2.0" },
+    "buffers": [ { "byteLength": 6 } ],
+    "bufferViews": [ { "buffer": 0, "byteLength": 6, "target": 34963 } ]
+})";
+
+TEST(GLB, CanReferenceBinChunkWithoutCopying)
+{
+    const auto glb = makeGLB(triangleJson, {0, 0, 1, 0, 2, 0});
+    const auto gltf = glTFFromGLB(glb.data(), glb.size(), nullptr);
+
+    ASSERT_EQ(1, gltf.buffers.size());
+    ASSERT_TRUE(gltf.buffers[0].isMapped());
+    EXPECT_EQ(glb.data() + glb.size() - 8, gltf.buffers[0].data);
+    EXPECT_EQ((std::vector<uint8_t>{0, 0, 1, 0, 2, 0}), gltf.buffers[0].getBytes());
+    EXPECT_EQ(1, gltf.bufferViews.size());
+}
+
+TEST(GLB, CanRejectMalformedContainers)
+{
+    auto glb = makeGLB(triangleJson, {0, 0, 1, 0, 2, 0});
+
+    auto badMagic = glb;
+    badMagic[0] = 'x';
+    EXPECT_THROW(glTFFromGLB(badMagic.data(), badMagic.size(), nullptr), std::runtime_error);
+
+    auto truncated = glb;
+    truncated.resize(glb.size() - 4);
+    EXPECT_THROW(glTFFromGLB(truncated.data(), truncated.size(), nullptr), std::runtime_error);
+
+    const auto noBin = makeGLB(triangleJson, {});
+    EXPECT_THROW(glTFFromGLB(noBin.data(), noBin.size(), nullptr), std::runtime_error);
+}
+
+TEST(GLB, CanMapExternalBinFiles)
+{
+    const auto directory = std::filesystem::temp_directory_path() / "combat_gl_glb_test";
+    std::filesystem::create_directories(directory);
+
+    const uint8_t bin[] = {0, 0, 1, 0, 2, 0, 0, 0};
+    writeFile(directory / "triangle.bin", bin, sizeof(bin));
+    const std::string json = R"({
+        "asset": { "version": "2.0" },
+        "buffers": [ { "uri": "triangle.bin", "byteLength": 6 } ]
+    })";
+    writeFile(directory / "triangle.gltf", json.data(), json.size());
+
+    const auto gltf = glTFFromFile((directory / "triangle.gltf").string().c_str());
+    ASSERT_TRUE(gltf.buffers[0].isMapped());
+    EXPECT_EQ((std::vector<uint8_t>{0, 0, 1, 0, 2, 0}), gltf.buffers[0].getBytes());
+
+    EXPECT_THROW(glTFFromString(R"({ "asset": { "version": "2.0" },
+                                     "buffers": [ { "uri": "missing.bin", "byteLength": 6 } ] })",
+                                directory.string() + "/"),
+                 std::runtime_error);
+
+    std::filesystem::remove_all(directory);
+}
+
+// Load time of the tank as shipped (base64 embedded in JSON) against the same
+// asset as GLB. Both are timed up to having the buffer bytes ready for GL.
+TEST(GLB, CanLoadFasterThanEmbeddedBase64)
+{
+    const std::filesystem::path source = std::filesystem::path(ASSET_DIR) / "gltf" / "tenk9aa.gltf";
+    const auto gltfText = readFile(source);
+    ASSERT_FALSE(gltfText.empty()) << source;
+
+    const auto directory = std::filesystem::temp_directory_path() / "combat_gl_glb_bench";
+    std::filesystem::create_directories(directory);
+    const auto glbPath = directory / "tenk9aa.glb";
+    const auto glb = glbFromEmbedded(gltfText);
+    writeFile(glbPath, glb.data(), glb.size());
+
+    constexpr int iterations = 50;
+    uint64_t checksum[2] = {0, 0};
+
+    const auto embeddedStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        const auto gltf = glTFFromFile(source.string().c_str());
+        const auto bytes = gltf.buffers[0].getBytes();
+        checksum[0] += bytes[bytes.size() / 2];
+    }
+    const std::chrono::duration<double, std::milli> embeddedTime = (std::chrono::steady_clock::now() - embeddedStart) / iterations;
+
+    const auto glbStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        const auto gltf = glTFFromFile(glbPath.string().c_str());
+        const auto &buffer = gltf.buffers[0];
+        checksum[1] += buffer.data[buffer.byteLength / 2];
+    }
+    const std::chrono::duration<double, std::milli> glbTime = (std::chrono::steady_clock::now() - glbStart) / iterations;
+
+    EXPECT_EQ(checksum[0], checksum[1]);
+    EXPECT_EQ(glTFFromFile(source.string().c_str()).buffers[0].getBytes(),
+              glTFFromFile(glbPath.string().c_str()).buffers[0].getBytes());
+
+    std::cout << "tenk9aa: .gltf " << gltfText.size() << " bytes, " << embeddedTime.count() << " ms; .glb "
+              << glb.size() << " bytes, " << glbTime.count() << " ms" << std::endl;
+    RecordProperty("EmbeddedLoadMicroseconds", static_cast<int>(embeddedTime.count() * 1000.0));
+    RecordProperty("GLBLoadMicroseconds", static_cast<int>(glbTime.count() * 1000.0));
+
+    std::filesystem::remove_all(directory);
+}
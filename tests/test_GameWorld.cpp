@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+
+#include <applesauce/Entity.h>
+#include <applesauce/Input.h>
+#include <applesauce/InputScript.h>
+#include <game/GameWorld.h>
+#include <game/LevelFile.h>
+#include <game/entities/Tenk.h>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// None of these tests open a window: the world runs against a
+// NullResourceManager and Input is driven by scripts.
+
+static constexpr float step = 1.0f / 60.0f;
+
+static const char *boxField = "**********\n"
+                              "*        *\n"
+                              "*        *\n"
+                              "*   T    *\n"
+                              "*        *\n"
+                              "*        *\n"
+                              "**********";
+
+class GameWorldTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        applesauce::Input::init();
+    }
+
+    void run(GameWorld &world, applesauce::InputScript &script, uint64_t ticks)
+    {
+        for (uint64_t tick = 0; tick < ticks; tick++)
+        {
+            applesauce::Input::beginFrame();
+            script.apply(tick);
+            world.update(step);
+        }
+    }
+
+    applesauce::NullResourceManager resources;
+};
+
+TEST_F(GameWorldTest, CanLoadPlayField)
+{
+    GameWorld world(resources);
+    world.load(boxField);
+
+    EXPECT_EQ(10, world.size().columns);
+    EXPECT_EQ(7, world.size().rows);
+    ASSERT_EQ(1, world.tenks().size());
+    EXPECT_EQ(10 * 2 + 5 * 2 + 1, world.entities().size());
+    EXPECT_EQ(nullptr, world.tenks().front()->mesh());
+}
+
+TEST_F(GameWorldTest, CanStopTankAtWall)
+{
+    GameWorld world(resources);
+    world.load(boxField);
+    const auto tenk = world.tenks().front();
+    const auto start = tenk->position();
+
+    // Three seconds of full throttle covers far more than the distance to the wall
+    applesauce::InputScript script;
+    script.hold(0, 180, GLFW_KEY_W);
+    run(world, script, 200);
+
+    // The bottom wall's tiles span z in [-4, -3]
+    EXPECT_LT(tenk->position().z, start.z - 1.0f);
+    EXPECT_GT(tenk->position().z, -3.0f);
+    EXPECT_FLOAT_EQ(start.x, tenk->position().x);
+}
+
+TEST_F(GameWorldTest, CanStreamLevelFile)
+{
+    const auto path = (std::filesystem::temp_directory_path() / "combat_gl_world_test.level").string();
+    writeLevelFile(path, parsePlayField(boxField), 4);
+
+    {
+        GameWorld world(resources);
+        world.loadLevel(path);
+
+        // The same world as from the play field, with the walls spawned by chunk
+        EXPECT_EQ(10, world.size().columns);
+        EXPECT_EQ(7, world.size().rows);
+        ASSERT_EQ(1, world.tenks().size());
+        EXPECT_EQ(10 * 2 + 5 * 2 + 1, world.entities().size());
+        EXPECT_TRUE(world.tileMap().isStreaming());
+
+        const auto tenk = world.tenks().front();
+        const auto start = tenk->position();
+        applesauce::InputScript script;
+        script.hold(0, 180, GLFW_KEY_W);
+        run(world, script, 200);
+        EXPECT_LT(tenk->position().z, start.z - 1.0f);
+        EXPECT_GT(tenk->position().z, -3.0f);
+    }
+    std::filesystem::remove(path);
+}
+
+// A wall destroyed while its chunk is resident is gone before the chunk is
+// evicted, and the chunk's walls come back when it is loaded again
+TEST_F(GameWorldTest, CanEvictAndReloadChunks)
+{
+    const auto path = (std::filesystem::temp_directory_path() / "combat_gl_corridor_test.level").string();
+    const std::string border(40, '*');
+    const auto corridor = border + "\n*T" + std::string(37, ' ') + "*\n" + border;
+    writeLevelFile(path, parsePlayField(corridor.c_str()), 4);
+
+    {
+        GameWorld world(resources);
+        world.loadLevel(path);
+        ASSERT_EQ(1, world.tenks().size());
+        const auto tenk = world.tenks().front();
+
+        // Walls in the first chunk, columns 0 to 3
+        const auto firstChunkWalls = [&]()
+        {
+            std::vector<std::shared_ptr<applesauce::Entity>> walls;
+            for (const auto &entity : world.entities())
+            {
+                if (entity && entity != tenk && entity->position().x < 4.0f - 20.0f)
+                    walls.push_back(entity);
+            }
+            return walls;
+        };
+        // Chunks load on another thread, so give them a few ticks
+        applesauce::InputScript script;
+        const auto moveTo = [&](uint32_t column, size_t expectedWalls)
+        {
+            tenk->position().x = static_cast<float>(column) - 20.0f;
+            for (int tick = 0; tick < 500 && firstChunkWalls().size() != expectedWalls; tick++)
+            {
+                run(world, script, 1);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return firstChunkWalls().size();
+        };
+
+        // 4 along the top and bottom, 1 at the end of the corridor
+        ASSERT_EQ(9, firstChunkWalls().size());
+        firstChunkWalls().front()->destroy();
+        run(world, script, 1);
+        EXPECT_EQ(8, firstChunkWalls().size());
+
+        EXPECT_EQ(0, moveTo(30, 0));
+        EXPECT_EQ(9, moveTo(1, 9));
+        EXPECT_EQ(0, moveTo(30, 0));
+        EXPECT_LE(2, world.tileMap().stats().chunksEvicted);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_F(GameWorldTest, CanDestroyShellOnWall)
+{
+    GameWorld world(resources);
+    world.load(boxField);
+    const auto entityCount = world.entities().size();
+
+    auto shell = world.spawn(new Shell, glm::vec3{0, 0.9f, 0});
+    shell->velocity() = glm::vec3{20.0f, 0, 0};
+
+    applesauce::InputScript script;
+    run(world, script, 60);
+
+    EXPECT_TRUE(shell->isPendingDestruction);
+    EXPECT_EQ(entityCount, world.entities().size());
+}
+
+TEST_F(GameWorldTest, CanReplayDeterministically)
+{
+    applesauce::InputScript script;
+    script.hold(0, 40, GLFW_KEY_W)
+        .hold(10, 25, GLFW_KEY_A)
+        .hold(30, 5, GLFW_KEY_SPACE)
+        .hold(0, 60, GLFW_KEY_UP)
+        .hold(45, 30, GLFW_KEY_RIGHT)
+        .hold(70, 5, GLFW_KEY_PERIOD)
+        .hold(80, 100, GLFW_KEY_S);
+
+    const auto simulate = [&]()
+    {
+        applesauce::Input::init();
+        script.rewind();
+
+        GameWorld world(resources);
+        world.load(arenaPlayField);
+        run(world, script, 600);
+
+        return world.components().positions;
+    };
+
+    const auto first = simulate();
+    const auto second = simulate();
+
+    ASSERT_EQ(first.size(), second.size());
+    for (size_t i = 0; i < first.size(); i++)
+    {
+        EXPECT_EQ(first[i], second[i]) << "entity " << i;
+    }
+}
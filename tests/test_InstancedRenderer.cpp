@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include "AppleSauceTest.h"
+#include "GLCallRecorder.h"
+#include <applesauce/InstancedRenderer.h>
+#include <applesauce/Mesh.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <memory>
+
+class AppleSauceInstancedRenderer : public AppleSauceTest
+{
+protected:
+    std::shared_ptr<applesauce::Material> material = std::make_shared<applesauce::Material>(applesauce::Material{{1.0f, 1.0f, 1.0f}, 0.5f, 0.5f});
+    std::shared_ptr<applesauce::Material> otherMaterial = std::make_shared<applesauce::Material>(applesauce::Material{{1.0f, 0.0f, 0.0f}, 0.5f, 0.5f});
+};
+
+TEST_F(AppleSauceInstancedRenderer, CanGroupIdenticalMeshesIntoOneBatch)
+{
+    const auto box = makeBoxMesh(1.0f, material);
+
+    applesauce::InstancedRenderer renderer;
+    renderer.begin();
+    for (int i = 0; i < 100; i++)
+    {
+        renderer.add(box, glm::translate(glm::mat4{1.0f}, glm::vec3{static_cast<float>(i), 0, 0}));
+    }
+    renderer.end();
+
+    ASSERT_EQ(1, renderer.currentBatches().size());
+    EXPECT_EQ(100, renderer.currentBatches().front().instanceCount);
+    EXPECT_EQ(material.get(), renderer.currentBatches().front().material);
+}
+
+TEST_F(AppleSauceInstancedRenderer, CanSeparateBatchesByMaterial)
+{
+    const auto box = makeBoxMesh(1.0f, material);
+    auto redBox = box;
+    redBox.primitives.front().material = otherMaterial;
+
+    applesauce::InstancedRenderer renderer;
+    renderer.begin();
+    renderer.add(box, glm::mat4{1.0f});
+    renderer.add(redBox, glm::mat4{1.0f});
+    renderer.add(box, glm::mat4{1.0f});
+    renderer.end();
+
+    ASSERT_EQ(2, renderer.currentBatches().size());
+    EXPECT_EQ(2, renderer.currentBatches()[0].instanceCount);
+    EXPECT_EQ(0, renderer.currentBatches()[0].firstInstance);
+    EXPECT_EQ(1, renderer.currentBatches()[1].instanceCount);
+    EXPECT_EQ(2, renderer.currentBatches()[1].firstInstance);
+}
+
+TEST_F(AppleSauceInstancedRenderer, CanIssueOneDrawCallPerBatch)
+{
+    const auto box = makeBoxMesh(1.0f, material);
+    const auto tinyBox = makeBoxMesh(0.25f, material);
+
+    applesauce::InstancedRenderer renderer;
+    renderer.begin();
+    for (int i = 0; i < 500; i++)
+    {
+        renderer.add(box, glm::mat4{1.0f});
+        renderer.add(tinyBox, glm::mat4{1.0f});
+    }
+    renderer.end();
+
+    GLCallRecorder recorder;
+    size_t materialChanges = 0;
+    renderer.draw([&](const applesauce::Material *)
+                  { materialChanges++; });
+
+    EXPECT_EQ(2, recorder.count("glDrawElementsInstanced"));
+    EXPECT_EQ(0, recorder.count("glDrawElements"));
+    EXPECT_EQ(2, materialChanges);
+    EXPECT_EQ(2, renderer.stats().drawCalls);
+    EXPECT_EQ(1000, renderer.stats().instances);
+}
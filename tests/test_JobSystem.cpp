@@ -0,0 +1,245 @@
+#include <gtest/gtest.h>
+
+#include <applesauce/Entity.h>
+#include <applesauce/Input.h>
+#include <applesauce/JobSystem.h>
+#include <game/GameWorld.h>
+#include <game/entities/Tenk.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+TEST(JobSystem, CanRunEveryIndexOnce)
+{
+    for (size_t threads : {1, 4})
+    {
+        applesauce::JobSystem jobs(threads);
+        EXPECT_EQ(threads, jobs.threadCount());
+
+        std::vector<std::atomic<int>> visits(100000);
+        jobs.parallelFor(visits.size(), 256, [&visits](size_t begin, size_t end)
+                         {
+                             for (size_t i = begin; i < end; i++)
+                                 visits[i]++;
+                         });
+        for (const auto &count : visits)
+        {
+            ASSERT_EQ(1, count.load());
+        }
+    }
+}
+
+TEST(JobSystem, CanWaitOnJobsStartedByJobs)
+{
+    applesauce::JobSystem jobs(4);
+    std::atomic<size_t> total{0};
+    jobs.parallelFor(64, 1, [&jobs, &total](size_t, size_t)
+                     { jobs.parallelFor(1000, 100, [&total](size_t begin, size_t end)
+                                        { total += end - begin; }); });
+    EXPECT_EQ(64 * 1000, total.load());
+    EXPECT_GE(jobs.stats().jobs, 64);
+}
+
+TEST(JobSystem, CanCountJobs)
+{
+    applesauce::JobSystem jobs(2);
+    std::atomic<int> sum{0};
+    applesauce::JobSystem::Counter counter;
+    for (int i = 0; i < 10; i++)
+    {
+        jobs.run([](void *data, size_t begin, size_t end)
+                 { *static_cast<std::atomic<int> *>(data) += static_cast<int>(end - begin); },
+                 &sum, 0, static_cast<size_t>(i), counter);
+    }
+    jobs.wait(counter);
+    EXPECT_TRUE(counter.done());
+    EXPECT_EQ(45, sum.load());
+}
+
+namespace
+{
+    // Bounces off the walls forever
+    class Bouncer : public applesauce::Entity
+    {
+    public:
+        void init(applesauce::ResourceManager &) override
+        {
+            collider() = {true, 0.25f};
+            setKinematic(true);
+        }
+
+        void onTouch(const glm::vec3 &normal) override
+        {
+            velocity() = glm::reflect(velocity(), normal);
+        }
+    };
+
+    // Splits into two shells the first time it hits a wall
+    class Splitter : public Bouncer
+    {
+    public:
+        void onTouch(const glm::vec3 &normal) override
+        {
+            for (float side : {-1.0f, 1.0f})
+            {
+                const glm::vec3 across{normal.z * side, 0, -normal.x * side};
+                auto shell = world->spawn<Shell>(position() + normal * 0.5f + across * 0.5f);
+                shell->velocity() = glm::reflect(velocity(), normal) + across;
+                shell->originator = this;
+            }
+            destroy();
+        }
+    };
+
+    std::string openField(size_t side)
+    {
+        std::string field;
+        for (size_t row = 0; row < side; row++)
+        {
+            for (size_t col = 0; col < side; col++)
+            {
+                const bool border = row == 0 || col == 0 || row == side - 1 || col == side - 1;
+                field += border || (row % 8 == 4 && col % 8 == 4) ? '*' : ' ';
+            }
+            field += '\n';
+        }
+        return field;
+    }
+
+    template <typename T>
+    void spawnMany(GameWorld &world, size_t count, unsigned int seed)
+    {
+        std::mt19937 rng(seed);
+        const auto extent = static_cast<float>(world.size().columns) / 2.0f - 2.0f;
+        std::uniform_real_distribution<float> coordinate(-extent, extent);
+        std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+        for (size_t i = 0; i < count; i++)
+        {
+            auto entity = world.spawn<T>(glm::vec3{coordinate(rng), 0, coordinate(rng)});
+            const auto heading = angle(rng);
+            entity->velocity() = glm::vec3{std::cos(heading), 0, std::sin(heading)} * 4.0f;
+        }
+    }
+
+    uint64_t checksum(const GameWorld &world)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (const auto &position : world.components().positions)
+        {
+            for (float value : {position.x, position.y, position.z})
+            {
+                uint32_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                hash = (hash ^ bits) * 1099511628211ull;
+            }
+        }
+        return hash;
+    }
+}
+
+class JobSystemWorld : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        applesauce::Input::init();
+    }
+
+    // Runs the same world with the given number of threads, 0 for none
+    uint64_t simulate(size_t threads, size_t bouncers, size_t splitters, int ticks, size_t *entityCount = nullptr)
+    {
+        std::unique_ptr<applesauce::JobSystem> jobs;
+        GameWorld world(resources);
+        if (threads)
+        {
+            jobs = std::make_unique<applesauce::JobSystem>(threads);
+            world.setJobSystem(jobs.get());
+        }
+        const auto field = openField(static_cast<size_t>(std::sqrt(static_cast<double>(bouncers + splitters) * 4.0)) + 16);
+        world.load(field.c_str());
+        spawnMany<Bouncer>(world, bouncers, 1);
+        spawnMany<Splitter>(world, splitters, 2);
+
+        for (int tick = 0; tick < ticks; tick++)
+        {
+            applesauce::Input::beginFrame();
+            world.update(1.0f / 60.0f);
+        }
+        if (entityCount)
+            *entityCount = world.entities().size();
+        return checksum(world);
+    }
+
+    applesauce::NullResourceManager resources;
+};
+
+TEST_F(JobSystemWorld, CanUpdateDeterministicallyOnAnyNumberOfThreads)
+{
+    // Splitters spawn and destroy from onTouch on the workers, which only
+    // comes out the same if the commands are applied in slot order
+    size_t serialCount = 0;
+    const auto serial = simulate(0, 3000, 3000, 240, &serialCount);
+    for (size_t threads : {1, 2, 4})
+    {
+        size_t count = 0;
+        EXPECT_EQ(serial, simulate(threads, 3000, 3000, 240, &count)) << threads << " threads";
+        EXPECT_EQ(serialCount, count) << threads << " threads";
+    }
+}
+
+TEST_F(JobSystemWorld, CanDeferSpawnAndDestroyUntilPhaseEnds)
+{
+    applesauce::JobSystem jobs(4);
+    GameWorld world(resources);
+    world.setJobSystem(&jobs);
+    world.load(openField(16).c_str());
+    const auto walls = world.entities().size();
+
+    // Heading straight for the left wall, it splits within the first second
+    auto splitter = world.spawn<Splitter>(glm::vec3{-5.0f, 0, 0.5f});
+    splitter->velocity() = glm::vec3{-6.0f, 0, 0};
+    for (int tick = 0; tick < 60 && !splitter->isPendingDestruction; tick++)
+    {
+        applesauce::Input::beginFrame();
+        world.update(1.0f / 60.0f);
+    }
+    // The shells joined the world during that update, the splitter leaves on the next
+    ASSERT_TRUE(splitter->isPendingDestruction);
+    EXPECT_EQ(walls + 3, world.entities().size());
+    applesauce::Input::beginFrame();
+    world.update(1.0f / 60.0f);
+    EXPECT_EQ(walls + 2, world.entities().size());
+
+    // Spawning outside of update() is immediate
+    world.spawn<Bouncer>();
+    EXPECT_EQ(walls + 3, world.entities().size());
+    EXPECT_EQ(glm::vec3{0}, world.components().positions.back());
+}
+
+TEST_F(JobSystemWorld, BenchmarkTicksPerSecond)
+{
+    constexpr size_t entityCount = 10000;
+    constexpr int ticks = 60;
+
+    const size_t cores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    uint64_t expected = 0;
+    for (size_t threads : {size_t{1}, size_t{2}, size_t{4}, cores})
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const auto result = simulate(threads, entityCount, 0, ticks);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        if (expected == 0)
+            expected = result;
+        EXPECT_EQ(expected, result);
+        std::cout << entityCount << " entities on " << threads << " threads: "
+                  << static_cast<double>(ticks) / elapsed.count() << " ticks/sec" << std::endl;
+    }
+}
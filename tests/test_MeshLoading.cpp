@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+
+#include "AppleSauceTest.h"
+#include <applesauce/Mesh.h>
+#include <util/AssetPack.h>
+#include <util/gltf.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+static const char *twoViewJson = R"({
+    "asset": { "version": "2.0" },
+    "buffers": [ { "uri": "data:application/octet-stream;base64,AAABAAIAAAAAAAAAAAAAAAAAAAAAAIA/AAAAAAAAAAAAAAAAAACAPwAAAAA=", "byteLength": 44 } ],
+    "bufferViews": [
+        { "buffer": 0, "byteLength": 6, "target": 34963 },
+        { "buffer": 0, "byteOffset": 8, "byteLength": 36, "target": 34962 }
+    ],
+    "accessors": [
+        { "bufferView": 0, "componentType": 5123, "count": 3, "type": "SCALAR" },
+        { "bufferView": 1, "byteOffset": 12, "componentType": 5126, "count": 2, "type": "VEC3" }
+    ]
+})";
+
+static std::string assetPath(const char *name)
+{
+    return (std::filesystem::path(ASSET_DIR) / "gltf" / name).string();
+}
+
+TEST(glTFBufferCache, CanDecodeEachBufferOnce)
+{
+    const auto gltf = glTFFromString(twoViewJson);
+    glTFBufferCache cache(gltf);
+
+    const auto indices = cache.accessor(0);
+    const auto vertices = cache.accessor(1);
+    cache.bufferView(0);
+    cache.bufferView(1);
+
+    EXPECT_EQ(1, cache.stats().decodeCount);
+    EXPECT_EQ(44, cache.stats().decodedBytes);
+
+    ASSERT_EQ(6, indices.size);
+    EXPECT_EQ(1, indices.data[2]);
+    EXPECT_EQ(cache.buffer(0).data + 8 + 12, vertices.data);
+    EXPECT_EQ(24, vertices.size);
+}
+
+TEST(glTFBufferCache, CanRejectViewsOutOfRange)
+{
+    auto gltf = glTFFromString(twoViewJson);
+    gltf.bufferViews[1].byteLength = 64;
+    gltf.accessors[0].byteOffset = 12;
+    glTFBufferCache cache(gltf);
+
+    EXPECT_THROW(cache.bufferView(1), std::runtime_error);
+    EXPECT_THROW(cache.accessor(0), std::runtime_error);
+}
+
+// More indices than their view holds would read past the buffer on upload
+TEST(DecodedMeshes, CanRejectIndicesOutOfRange)
+{
+    auto json = std::string(twoViewJson);
+    json.insert(json.rfind('}'), R"(,
+    "meshes": [ { "name": "Triangle", "primitives": [ { "attributes": { "POSITION": 1 }, "indices": 0 } ] } ])");
+    const auto path = (std::filesystem::temp_directory_path() / "combat_gl_indices_test.gltf").string();
+
+    std::ofstream(path) << json;
+    EXPECT_NE(nullptr, applesauce::decodeMeshes(path.c_str()));
+
+    const std::string indexCount = "\"count\": 3";
+    const auto countAt = json.find(indexCount);
+    ASSERT_NE(std::string::npos, countAt);
+    json.replace(countAt, indexCount.size(), "\"count\": 4");
+    std::ofstream(path) << json;
+    EXPECT_THROW(applesauce::decodeMeshes(path.c_str()), std::runtime_error);
+
+    std::filesystem::remove(path);
+}
+
+// CPU side of loading the tank: the old loader decoded the whole buffer again
+// for each primitive's indices, the cache decodes it once.
+TEST(glTFBufferCache, CanAvoidRedecodingPerPrimitive)
+{
+    const auto gltf = glTFFromFile(assetPath("tenk9aa.gltf").c_str());
+
+    size_t primitiveCount = 0;
+    size_t previousBytes = 0;
+    const auto previousStart = std::chrono::steady_clock::now();
+    previousBytes += gltf.buffers[0].getBytes().size();
+    for (const auto &mesh : gltf.meshes)
+    {
+        for (const auto &primitive : mesh.primitives)
+        {
+            const auto &view = gltf.bufferViews[gltf.accessors[primitive.indices].bufferView];
+            previousBytes += gltf.buffers[view.buffer].getBytes().size();
+            primitiveCount++;
+        }
+    }
+    const std::chrono::duration<double, std::milli> previousTime = std::chrono::steady_clock::now() - previousStart;
+
+    glTFBufferCache cache(gltf);
+    const auto cacheStart = std::chrono::steady_clock::now();
+    cache.buffer(0);
+    for (const auto &mesh : gltf.meshes)
+    {
+        for (const auto &primitive : mesh.primitives)
+        {
+            cache.accessor(primitive.indices);
+        }
+    }
+    const std::chrono::duration<double, std::milli> cacheTime = std::chrono::steady_clock::now() - cacheStart;
+
+    std::cout << "tenk9aa (" << primitiveCount << " primitives): per primitive decode " << previousBytes << " bytes in "
+              << previousTime.count() << " ms, cached " << cache.stats().decodedBytes << " bytes in "
+              << cacheTime.count() << " ms" << std::endl;
+
+    EXPECT_EQ(gltf.buffers[0].byteLength, cache.stats().decodedBytes);
+    EXPECT_EQ(1, cache.stats().decodeCount);
+}
+
+class AppleSauceMeshLoading : public AppleSauceTest
+{
+};
+
+// Loader benchmark: decode work and time per asset
+TEST_F(AppleSauceMeshLoading, CanReportDecodeCostPerAsset)
+{
+    for (const auto name : {"tenk6a.gltf", "tenk7.gltf", "tenk9aa.gltf", "wall-and-floor.gltf"})
+    {
+        const auto path = assetPath(name);
+        const auto gltf = glTFFromFile(path.c_str());
+        size_t bufferBytes = 0;
+        for (const auto &buffer : gltf.buffers)
+        {
+            bufferBytes += buffer.byteLength;
+        }
+
+        applesauce::MeshLoadStats stats;
+        const auto meshes = applesauce::loadMeshes(path.c_str(), &stats);
+
+        EXPECT_EQ(gltf.meshes.size(), meshes.size()) << name;
+        EXPECT_EQ(gltf.buffers.size(), stats.decodeCount) << name;
+        EXPECT_EQ(bufferBytes, stats.decodedBytes) << name;
+
+        std::cout << name << ": decoded " << stats.decodedBytes << " bytes in " << stats.decodeSeconds * 1000.0
+                  << " ms, load " << stats.totalSeconds * 1000.0 << " ms" << std::endl;
+    }
+}
+
+TEST_F(AppleSauceMeshLoading, CanLoadSameMeshesFromPack)
+{
+    const auto path = assetPath("tenk9aa.gltf");
+    AssetPackWriter writer;
+    writer.addglTF("tenk9aa", glTFFromFile(path.c_str()));
+    const auto packPath = std::filesystem::temp_directory_path() / "combat_gl_mesh_pack.pack";
+    writer.write(packPath.string());
+
+    const auto fromSource = applesauce::loadMeshes(path.c_str());
+    const auto fromPack = applesauce::loadMeshes(AssetPack(packPath.string()), "tenk9aa");
+    std::filesystem::remove(packPath);
+
+    ASSERT_EQ(fromSource.size(), fromPack.size());
+    for (const auto &[name, mesh] : fromSource)
+    {
+        const auto found = fromPack.find(name);
+        ASSERT_NE(fromPack.end(), found) << name;
+        ASSERT_EQ(mesh.primitives.size(), found->second.primitives.size()) << name;
+        auto packPrimitive = found->second.primitives.begin();
+        for (const auto &primitive : mesh.primitives)
+        {
+            EXPECT_EQ(primitive.elementCount, packPrimitive->elementCount);
+            EXPECT_EQ(primitive.material->baseColor, packPrimitive->material->baseColor);
+            EXPECT_EQ(primitive.bounds.min, packPrimitive->bounds.min);
+            EXPECT_EQ(primitive.bounds.max, packPrimitive->bounds.max);
+            ++packPrimitive;
+        }
+    }
+}
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+
+#include <applesauce/Entity.h>
+#include <applesauce/Input.h>
+#include <applesauce/Pool.h>
+#include <game/GameWorld.h>
+#include <game/entities/Tenk.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+// Every plain new in the test binary goes through here so tests can tell
+// whether a piece of code touched the heap. Any thread may allocate, gtest's
+// and the job system's included, so the count is atomic.
+static std::atomic<size_t> allocationCount{0};
+
+void *operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (auto p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+TEST(SlabPool, CanReuseReleasedBlocks)
+{
+    applesauce::SlabPool pool(4);
+
+    std::vector<void *> blocks;
+    for (int i = 0; i < 6; i++)
+    {
+        blocks.push_back(pool.allocate(48, 16));
+        EXPECT_EQ(0, reinterpret_cast<uintptr_t>(blocks.back()) % 16);
+    }
+    EXPECT_EQ(2, pool.slabCount());
+    EXPECT_EQ(6, pool.inUse());
+
+    for (auto block : blocks)
+    {
+        pool.deallocate(block);
+    }
+    EXPECT_EQ(0, pool.inUse());
+
+    for (int i = 0; i < 8; i++)
+    {
+        pool.allocate(48, 16);
+    }
+    EXPECT_EQ(2, pool.slabCount());
+    EXPECT_EQ(8, pool.capacity());
+}
+
+TEST(SlabPool, CanRejectOversizedBlocks)
+{
+    applesauce::SlabPool pool;
+    pool.allocate(32, 8);
+    EXPECT_THROW(pool.allocate(64, 8), std::bad_alloc);
+}
+
+TEST(SlabPool, CanBackSharedPointers)
+{
+    applesauce::SlabPool pool;
+    {
+        auto shell = std::allocate_shared<Shell>(applesauce::PoolAllocator<Shell>(pool));
+        std::shared_ptr<applesauce::Entity> entity = shell;
+        EXPECT_EQ(1, pool.inUse());
+    }
+    EXPECT_EQ(0, pool.inUse());
+}
+
+// Fires a ring of shells from the middle of the arena every tick, which all
+// end up against the walls or each other. Once the pools, the entity list
+// and the broadphase have grown to the peak there should be no allocations.
+TEST(SlabPool, CanSpawnShellsWithoutAllocating)
+{
+    constexpr float step = 1.0f / 60.0f;
+    constexpr int shellsPerTick = 16;
+    constexpr int warmUpTicks = 120;
+    constexpr int measuredTicks = 600;
+
+    applesauce::Input::init();
+
+    const auto fire = [](applesauce::IWorld &world, bool pooled)
+    {
+        for (int i = 0; i < shellsPerTick; i++)
+        {
+            const float angle = static_cast<float>(i) * 6.2831853f / shellsPerTick;
+            const glm::vec3 velocity{std::cos(angle) * 20.0f, 0, std::sin(angle) * 20.0f};
+            if (pooled)
+                world.spawn<Shell>(glm::vec3{0, 0.9f, 3.0f})->velocity() = velocity;
+            else
+                world.spawn(new Shell, glm::vec3{0, 0.9f, 3.0f})->velocity() = velocity;
+        }
+    };
+
+    const auto measure = [&](bool pooled)
+    {
+        applesauce::NullResourceManager resources;
+        GameWorld world(resources);
+        world.load(arenaPlayField);
+
+        for (int tick = 0; tick < warmUpTicks; tick++)
+        {
+            fire(world, pooled);
+            world.update(step);
+        }
+
+        allocationCount.store(0, std::memory_order_relaxed);
+        for (int tick = 0; tick < measuredTicks; tick++)
+        {
+            fire(world, pooled);
+            world.update(step);
+        }
+        return allocationCount.load(std::memory_order_relaxed);
+    };
+
+    const auto allocationsBefore = measure(false);
+    const auto allocationsAfter = measure(true);
+
+    std::cout << "Allocations for " << shellsPerTick * measuredTicks << " shells: "
+              << allocationsBefore << " with new, " << allocationsAfter << " pooled" << std::endl;
+    RecordProperty("AllocationsUnpooled", static_cast<int>(allocationsBefore));
+    RecordProperty("AllocationsPooled", static_cast<int>(allocationsAfter));
+
+    EXPECT_GE(allocationsBefore, static_cast<size_t>(shellsPerTick * measuredTicks * 2));
+    EXPECT_EQ(0, allocationsAfter);
+}
@@ -0,0 +1,201 @@
+#include <gtest/gtest.h>
+
+#include "AppleSauceTest.h"
+#include <applesauce/Profiler.h>
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using applesauce::Profiler;
+
+TEST(Profiler, CanNestCpuScopes)
+{
+    Profiler profiler(Profiler::Mode::cpuOnly);
+    profiler.beginFrame();
+    {
+        Profiler::Scope outer(&profiler, "Outer");
+        {
+            Profiler::Scope inner(&profiler, "Inner");
+        }
+        Profiler::Scope sibling(&profiler, "Sibling");
+    }
+    profiler.endFrame();
+
+    ASSERT_EQ(1, profiler.frameCount());
+    const auto &cpu = profiler.frame(0).cpu;
+    ASSERT_EQ(3, cpu.size());
+    EXPECT_STREQ("Outer", cpu[0].name);
+    EXPECT_EQ(0, cpu[0].depth);
+    EXPECT_STREQ("Inner", cpu[1].name);
+    EXPECT_EQ(1, cpu[1].depth);
+    EXPECT_STREQ("Sibling", cpu[2].name);
+    EXPECT_EQ(1, cpu[2].depth);
+
+    EXPECT_LE(cpu[0].start, cpu[1].start);
+    EXPECT_LE(cpu[1].start + cpu[1].duration, cpu[2].start);
+    EXPECT_LE(cpu[2].start + cpu[2].duration, cpu[0].start + cpu[0].duration);
+    EXPECT_LE(cpu[0].duration, profiler.frame(0).duration);
+    EXPECT_EQ(3, profiler.stats().cpuScopes);
+}
+
+TEST(Profiler, CanKeepOnlyTheLastFrames)
+{
+    Profiler profiler(Profiler::Mode::cpuOnly, 4);
+    EXPECT_EQ(nullptr, profiler.latest());
+
+    for (int i = 0; i < 10; i++)
+    {
+        profiler.beginFrame();
+        Profiler::Scope scope(&profiler, "Tick");
+        // Reading the ring mid frame still only sees completed frames
+        if (i > 0)
+        {
+            EXPECT_EQ(static_cast<uint64_t>(i - 1), profiler.latest()->index);
+        }
+        profiler.endFrame();
+    }
+
+    ASSERT_EQ(4, profiler.frameCount());
+    EXPECT_EQ(6, profiler.frame(0).index);
+    EXPECT_EQ(9, profiler.frame(3).index);
+    EXPECT_EQ(9, profiler.latest()->index);
+    EXPECT_EQ(10, profiler.stats().frames);
+    for (size_t i = 0; i < profiler.frameCount(); i++)
+    {
+        ASSERT_EQ(1, profiler.frame(i).cpu.size());
+    }
+}
+
+TEST(Profiler, CanCloseScopesLeftOpen)
+{
+    Profiler profiler(Profiler::Mode::cpuOnly);
+    // Outside of a frame scopes are ignored
+    profiler.beginScope("Ignored");
+    profiler.endScope();
+
+    profiler.beginFrame();
+    profiler.beginScope("Open");
+    profiler.beginScope("Also open");
+    profiler.endFrame();
+
+    const auto &cpu = profiler.latest()->cpu;
+    ASSERT_EQ(2, cpu.size());
+    EXPECT_GE(cpu[0].duration, cpu[1].duration);
+    EXPECT_EQ(2, profiler.stats().cpuScopes);
+
+    // GPU scopes do nothing headless
+    profiler.beginFrame();
+    {
+        Profiler::GpuScope scope(&profiler, "Pass");
+    }
+    profiler.endFrame();
+    EXPECT_EQ(1, profiler.latest()->cpu.size());
+    EXPECT_TRUE(profiler.latest()->gpu.empty());
+
+    Profiler::Scope nothing(nullptr, "Not profiled");
+}
+
+TEST(Profiler, CanWriteChromeTrace)
+{
+    Profiler profiler(Profiler::Mode::cpuOnly);
+    for (int i = 0; i < 3; i++)
+    {
+        profiler.beginFrame();
+        Profiler::Scope scope(&profiler, "Update \"world\"");
+        profiler.endFrame();
+    }
+
+    std::stringstream out;
+    profiler.writeChromeTrace(out);
+    const auto trace = nlohmann::json::parse(out.str());
+
+    size_t frames = 0, updates = 0;
+    double lastFrame = -1;
+    for (const auto &event : trace["traceEvents"])
+    {
+        if (event["ph"] != "X")
+            continue;
+        EXPECT_EQ(1, event["tid"]);
+        if (event["name"] == "Frame")
+        {
+            EXPECT_GT(event["ts"].get<double>(), lastFrame);
+            lastFrame = event["ts"].get<double>();
+            frames++;
+        }
+        else
+        {
+            EXPECT_EQ("Update \"world\"", event["name"]);
+            EXPECT_GE(event["ts"].get<double>(), lastFrame);
+            updates++;
+        }
+    }
+    EXPECT_EQ(3, frames);
+    EXPECT_EQ(3, updates);
+}
+
+// Cost of a scope, which matters for how finely the update can be instrumented
+TEST(Profiler, CanReportScopeOverhead)
+{
+    Profiler profiler(Profiler::Mode::cpuOnly, 4);
+    constexpr int frames = 100;
+    constexpr int scopesPerFrame = 1000;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        profiler.beginFrame();
+        for (int j = 0; j < scopesPerFrame; j++)
+        {
+            Profiler::Scope scope(&profiler, "Scope");
+        }
+        profiler.endFrame();
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(frames * scopesPerFrame, profiler.stats().cpuScopes);
+    std::cout << "Profiler scope: " << elapsed.count() / (frames * scopesPerFrame) << " ns" << std::endl;
+}
+
+class AppleSauceProfiler : public AppleSauceTest
+{
+};
+
+TEST_F(AppleSauceProfiler, CanTimeGpuScopesWithoutStalling)
+{
+    Profiler profiler;
+    for (int i = 0; i < 4; i++)
+    {
+        profiler.beginFrame();
+        {
+            Profiler::GpuScope pass(&profiler, "Pass");
+            Profiler::GpuScope clear(&profiler, "Clear");
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+        profiler.endFrame();
+    }
+    // The newest frames are not read back yet, they may still be in flight
+    ASSERT_EQ(4, profiler.frameCount());
+    EXPECT_FALSE(profiler.frame(3).gpuReady);
+
+    // Frame 4 reuses the query set of frame 2 and reads it back first
+    glFinish();
+    profiler.beginFrame();
+    profiler.endFrame();
+
+    const auto frame = profiler.latest();
+    ASSERT_NE(nullptr, frame);
+    EXPECT_EQ(2, frame->index);
+    ASSERT_EQ(2, frame->gpu.size());
+    EXPECT_STREQ("Pass", frame->gpu[0].name);
+    EXPECT_EQ(0, frame->gpu[0].depth);
+    EXPECT_STREQ("Clear", frame->gpu[1].name);
+    EXPECT_EQ(1, frame->gpu[1].depth);
+    EXPECT_LE(frame->gpu[1].duration, frame->gpu[0].duration);
+    // The frame ends after its last scope does
+    EXPECT_LE(frame->gpu[0].start + frame->gpu[0].duration, frame->gpuDuration);
+    EXPECT_EQ(2, frame->cpu.size());
+}
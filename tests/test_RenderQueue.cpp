@@ -0,0 +1,216 @@
+#include <gtest/gtest.h>
+
+#include "AppleSauceTest.h"
+#include "GLCallRecorder.h"
+#include <applesauce/InstancedRenderer.h>
+#include <applesauce/Mesh.h>
+#include <applesauce/RenderQueue.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+using applesauce::RenderQueue;
+
+TEST(RenderQueue, CanOrderKeysByFieldSignificance)
+{
+    // Each field outranks everything after it
+    EXPECT_LT(RenderQueue::makeKey(0, 255, 65535, 4095, 4095, 4095), RenderQueue::makeKey(1, 0, 0, 0, 0, 0));
+    EXPECT_LT(RenderQueue::makeKey(1, 0, 65535, 4095, 4095, 4095), RenderQueue::makeKey(1, 1, 0, 0, 0, 0));
+    EXPECT_LT(RenderQueue::makeKey(1, 1, 0, 4095, 4095, 4095), RenderQueue::makeKey(1, 1, 1, 0, 0, 0));
+    EXPECT_LT(RenderQueue::makeKey(1, 1, 1, 0, 4095, 4095), RenderQueue::makeKey(1, 1, 1, 1, 0, 0));
+    EXPECT_LT(RenderQueue::makeKey(1, 1, 1, 1, 0, 4095), RenderQueue::makeKey(1, 1, 1, 1, 1, 0));
+    EXPECT_LT(RenderQueue::makeKey(1, 1, 1, 1, 1, 0), RenderQueue::makeKey(1, 1, 1, 1, 1, 1));
+
+    // Values wider than their field don't leak into the next one
+    EXPECT_EQ(RenderQueue::makeKey(0, 0, 0, 0, 0, 4096), RenderQueue::makeKey(0, 0, 0, 0, 0, 0));
+    EXPECT_EQ(15u, RenderQueue::makeKey(15, 0, 0, 0, 0, 0) >> 60);
+}
+
+TEST(RenderQueue, CanRadixSortLikeStableSort)
+{
+    std::mt19937_64 rng(5);
+    std::vector<RenderQueue::SortEntry> entries;
+    for (uint32_t i = 0; i < 5000; i++)
+    {
+        // Few distinct high bits so that there are plenty of ties to keep stable
+        entries.push_back({(rng() % 4) << 60 | (rng() % 16) << 12, i});
+    }
+
+    auto expected = entries;
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](const auto &a, const auto &b)
+                     { return a.key < b.key; });
+
+    std::vector<RenderQueue::SortEntry> scratch;
+    RenderQueue::radixSort(entries, scratch);
+
+    ASSERT_EQ(expected.size(), entries.size());
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        EXPECT_EQ(expected[i].key, entries[i].key);
+        EXPECT_EQ(expected[i].index, entries[i].index);
+    }
+}
+
+TEST(RenderQueue, CanSortDrawItemsByPassFirst)
+{
+    RenderQueue queue;
+    queue.begin();
+    const RenderQueue::DrawItem item{};
+    queue.add(1, item, 0.0f);
+    queue.add(0, item, 1.0f);
+    queue.add(1, item, 0.5f);
+    queue.add(0, item, 0.25f);
+    queue.sort();
+
+    std::vector<uint32_t> order;
+    for (const auto &entry : queue.order())
+        order.push_back(entry.index);
+    EXPECT_EQ((std::vector<uint32_t>{3, 1, 0, 2}), order);
+}
+
+// Sorting cost for a frame's worth of items against std::sort, which has to
+// put the keys in the same order
+TEST(RenderQueue, BenchmarkRadixSortAgainstComparisonSort)
+{
+    std::mt19937_64 rng(11);
+    std::vector<RenderQueue::SortEntry> entries(100000);
+    for (uint32_t i = 0; i < entries.size(); i++)
+    {
+        entries[i] = {RenderQueue::makeKey(rng() % 2, rng() % 4, rng() % 200, rng() % 20, rng() % 300, rng() % 4096), i};
+    }
+
+    constexpr int iterations = 10;
+    std::vector<RenderQueue::SortEntry> scratch;
+    std::chrono::duration<double, std::milli> radixTime{0};
+    std::chrono::duration<double, std::milli> comparisonTime{0};
+    for (int i = 0; i < iterations; i++)
+    {
+        auto radix = entries;
+        const auto radixStart = std::chrono::steady_clock::now();
+        RenderQueue::radixSort(radix, scratch);
+        radixTime += std::chrono::steady_clock::now() - radixStart;
+
+        auto comparison = entries;
+        const auto comparisonStart = std::chrono::steady_clock::now();
+        std::sort(comparison.begin(), comparison.end(),
+                  [](const auto &a, const auto &b)
+                  { return a.key < b.key; });
+        comparisonTime += std::chrono::steady_clock::now() - comparisonStart;
+
+        ASSERT_EQ(comparison.size(), radix.size());
+        for (size_t j = 0; j < radix.size(); j++)
+        {
+            ASSERT_EQ(comparison[j].key, radix[j].key) << j;
+        }
+    }
+
+    std::cout << entries.size() << " items: radix sort " << radixTime.count() / iterations << " ms, std::sort "
+              << comparisonTime.count() / iterations << " ms" << std::endl;
+    RecordProperty("RadixSortMicroseconds", static_cast<int>(radixTime.count() * 1000.0 / iterations));
+    RecordProperty("ComparisonSortMicroseconds", static_cast<int>(comparisonTime.count() * 1000.0 / iterations));
+}
+
+class AppleSauceRenderQueue : public AppleSauceTest
+{
+protected:
+    void SetUp() override
+    {
+        shader.add_vertex_stage(R"(#version 330 core
+            layout(location = 0) in vec4 vPosition;
+            void main() {
+                gl_Position = vPosition;
+            })");
+        shader.add_fragment_stage(R"(#version 330 core
+            uniform vec3 Color;
+            out vec4 fColor;
+            void main() {
+                fColor = vec4(Color, 1.0);
+            })");
+        ASSERT_TRUE(shader.compile_and_link()) << shader.error_log();
+    }
+
+    Shader shader;
+    std::shared_ptr<applesauce::Material> material = std::make_shared<applesauce::Material>(applesauce::Material{{1.0f, 1.0f, 1.0f}, 0.5f, 0.5f});
+    std::shared_ptr<applesauce::Material> otherMaterial = std::make_shared<applesauce::Material>(applesauce::Material{{1.0f, 0.0f, 0.0f}, 0.5f, 0.5f});
+};
+
+TEST_F(AppleSauceRenderQueue, CanSkipRedundantBinds)
+{
+    const auto box = makeBoxMesh(1.0f, material);
+    const auto &primitive = box.primitives.front();
+
+    RenderQueue queue;
+    queue.begin();
+    // Interleaved materials, sorting groups them
+    for (int i = 0; i < 10; i++)
+    {
+        const auto itemMaterial = i % 2 ? otherMaterial.get() : material.get();
+        queue.add(0,
+                  {0, &shader, itemMaterial, nullptr, primitive.vertexArray.get(), primitive.indexBuffer.get(),
+                   primitive.elementCount, nullptr, 0, 0},
+                  static_cast<float>(i) / 10.0f);
+    }
+    queue.sort();
+
+    GLCallRecorder recorder;
+    size_t materialChanges = 0;
+    queue.dispatch(0, [&](const applesauce::Material *)
+                   { materialChanges++; });
+
+    EXPECT_EQ(10, recorder.count("glDrawElements"));
+    EXPECT_EQ(1, recorder.count("glUseProgram"));
+    EXPECT_EQ(1, recorder.count("glBindTexture"));
+    EXPECT_EQ(1, recorder.count("glBindVertexArray"));
+    EXPECT_EQ(1, recorder.count("glBindBuffer"));
+    EXPECT_EQ(2, materialChanges);
+
+    const auto &stats = queue.stats();
+    EXPECT_EQ(10, stats.drawCalls);
+    EXPECT_EQ(2, stats.materialBinds);
+    // 5 state binds per item naively, 6 made
+    EXPECT_EQ(10 * 5 - 6, stats.bindsSaved);
+}
+
+TEST_F(AppleSauceRenderQueue, CanDispatchOnePassAtATime)
+{
+    const auto box = makeBoxMesh(1.0f, material);
+    const auto tinyBox = makeBoxMesh(0.25f, otherMaterial);
+
+    applesauce::InstancedRenderer renderer;
+    renderer.begin();
+    for (int i = 0; i < 50; i++)
+    {
+        renderer.add(box, glm::translate(glm::mat4{1.0f}, glm::vec3{0, 0, -static_cast<float>(i)}));
+        renderer.add(tinyBox, glm::translate(glm::mat4{1.0f}, glm::vec3{0, 0, -static_cast<float>(i)}));
+    }
+    renderer.end();
+
+    RenderQueue queue;
+    queue.begin();
+    renderer.submit(queue, 1, shader, glm::mat4{1.0f}, 100.0f);
+    renderer.submit(queue, 0, shader, glm::mat4{1.0f}, 100.0f, false);
+    queue.sort();
+    ASSERT_EQ(4, queue.items().size());
+
+    GLCallRecorder recorder;
+    size_t materialChanges = 0;
+    queue.dispatch(0, [&](const applesauce::Material *material)
+                   { EXPECT_EQ(nullptr, material); materialChanges++; });
+    EXPECT_EQ(2, recorder.count("glDrawElementsInstanced"));
+    EXPECT_EQ(1, materialChanges);
+
+    recorder.reset();
+    materialChanges = 0;
+    queue.dispatch(1, [&](const applesauce::Material *)
+                   { materialChanges++; });
+    EXPECT_EQ(2, recorder.count("glDrawElementsInstanced"));
+    EXPECT_EQ(2, materialChanges);
+    EXPECT_EQ(4, queue.stats().drawCalls);
+}
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+
+#include <applesauce/Entity.h>
+#include <applesauce/EntityStore.h>
+#include <applesauce/RenderSnapshot.h>
+#include <applesauce/RollingStats.h>
+#include <applesauce/TripleBuffer.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(TripleBuffer, CanHandOverLatestValue)
+{
+    applesauce::TripleBuffer<int> buffer;
+    EXPECT_FALSE(buffer.acquire());
+
+    buffer.back() = 1;
+    buffer.publish();
+    buffer.back() = 2;
+    buffer.publish();
+    EXPECT_TRUE(buffer.hasNew());
+    ASSERT_TRUE(buffer.acquire());
+    EXPECT_EQ(2, buffer.front());
+    EXPECT_FALSE(buffer.acquire());
+    EXPECT_EQ(2, buffer.front());
+
+    // The writer never gets the slot the reader holds
+    buffer.back() = 3;
+    EXPECT_EQ(2, buffer.front());
+    buffer.publish();
+    ASSERT_TRUE(buffer.acquire());
+    EXPECT_EQ(3, buffer.front());
+}
+
+TEST(TripleBuffer, CanHandOverBetweenThreads)
+{
+    struct Value
+    {
+        uint64_t sequence = 0;
+        uint64_t copy = 0;
+    };
+    applesauce::TripleBuffer<Value> buffer;
+    constexpr uint64_t count = 200000;
+
+    std::thread writer([&buffer]()
+                       {
+                           for (uint64_t i = 1; i <= count; i++)
+                           {
+                               buffer.back() = {i, i};
+                               buffer.publish();
+                           }
+                       });
+
+    // Every value seen is whole and newer than the last
+    uint64_t last = 0;
+    while (last < count)
+    {
+        if (buffer.acquire())
+        {
+            const auto value = buffer.front();
+            ASSERT_EQ(value.sequence, value.copy);
+            ASSERT_GT(value.sequence, last);
+            last = value.sequence;
+        }
+    }
+    writer.join();
+}
+
+TEST(RenderSnapshot, CanCaptureMeshSlotsOnly)
+{
+    applesauce::EntityStore store;
+    auto mesh = std::make_shared<applesauce::Mesh>();
+    store.add(nullptr);
+    store.add(nullptr);
+    store.meshes[1] = mesh;
+    store.positions[1] = glm::vec3{1.0f, 2.0f, 3.0f};
+
+    applesauce::RenderSnapshot snapshot;
+    snapshot.instances.resize(5);
+    applesauce::captureInstances(store, snapshot);
+    ASSERT_EQ(1, snapshot.instances.size());
+    EXPECT_EQ(store.ids[1], snapshot.instances[0].id);
+    EXPECT_EQ(mesh.get(), snapshot.instances[0].mesh);
+    EXPECT_EQ((glm::vec3{1.0f, 2.0f, 3.0f}), snapshot.instances[0].position);
+}
+
+TEST(RenderSnapshot, CanInterpolateMatchingInstances)
+{
+    struct Marker : public applesauce::Entity
+    {
+    };
+
+    applesauce::EntityStore store;
+    auto mesh = std::make_shared<applesauce::Mesh>();
+    std::vector<std::shared_ptr<Marker>> markers;
+    for (int i = 0; i < 3; i++)
+    {
+        markers.push_back(std::make_shared<Marker>());
+        store.add(markers.back());
+        markers.back()->mesh() = mesh;
+        markers.back()->position() = glm::vec3{static_cast<float>(i), 0, 0};
+    }
+    applesauce::RenderSnapshot previous;
+    applesauce::captureInstances(store, previous);
+
+    // The first goes away, the rest move, and one turns up
+    markers[0]->destroy();
+    store.removeDestroyed();
+    markers[1]->position().z = 2.0f;
+    markers[2]->position().z = 4.0f;
+    store.add(nullptr);
+    store.meshes.back() = mesh;
+    store.positions.back() = glm::vec3{10.0f, 0, 0};
+    applesauce::RenderSnapshot current;
+    applesauce::captureInstances(store, current);
+
+    std::vector<glm::mat4> matrices;
+    applesauce::interpolateInstances(previous, current, 0.25f, matrices);
+    ASSERT_EQ(3, matrices.size());
+    EXPECT_EQ((glm::vec4{1.0f, 0, 0.5f, 1.0f}), matrices[0][3]);
+    EXPECT_EQ((glm::vec4{2.0f, 0, 1.0f, 1.0f}), matrices[1][3]);
+    EXPECT_EQ((glm::vec4{10.0f, 0, 0, 1.0f}), matrices[2][3]);
+
+    applesauce::interpolateInstances(previous, current, 1.0f, matrices);
+    EXPECT_EQ((glm::vec4{2.0f, 0, 4.0f, 1.0f}), matrices[1][3]);
+}
+
+TEST(RollingStats, CanSummarizeRecentSamples)
+{
+    applesauce::RollingStats stats(4);
+    EXPECT_EQ(0.0, stats.mean());
+
+    for (double sample : {100.0, 1.0, 3.0, 1.0, 3.0})
+        stats.add(sample);
+
+    // The first sample has rolled off
+    EXPECT_EQ(4, stats.count());
+    EXPECT_DOUBLE_EQ(3.0, stats.latest());
+    EXPECT_DOUBLE_EQ(2.0, stats.mean());
+    EXPECT_DOUBLE_EQ(1.0, stats.deviation());
+    EXPECT_DOUBLE_EQ(3.0, stats.max());
+}
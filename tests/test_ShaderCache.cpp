@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+
+#include "AppleSauceTest.h"
+#include <applesauce/Shader.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+class AppleSauceShaderCache : public AppleSauceTest
+{
+protected:
+    void SetUp() override
+    {
+        if (!Shader::binariesSupported())
+        {
+            GTEST_SKIP() << "No program binary formats on this driver";
+        }
+        std::filesystem::remove_all(cacheDirectory);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(cacheDirectory);
+    }
+
+    const std::filesystem::path cacheDirectory = std::filesystem::temp_directory_path() / "combat_gl_shader_cache_test";
+
+    const std::string vertexSource = R"(#version 330 core
+        layout(location = 0) in vec4 vPosition;
+        void main() {
+            gl_Position = vPosition;
+        })";
+    const std::string fragmentSource = R"(#version 330 core
+        uniform vec3 Color;
+        out vec4 fColor;
+        void main() {
+            fColor = vec4(Color, 1.0);
+        })";
+};
+
+static std::string readFileText(const std::filesystem::path &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+TEST_F(AppleSauceShaderCache, CanLinkFromCachedBinary)
+{
+    const auto before = shaderCacheStats();
+    const auto compiled = buildShader("flat", vertexSource, fragmentSource, cacheDirectory);
+    ASSERT_NE(nullptr, compiled);
+    EXPECT_EQ(before.misses + 1, shaderCacheStats().misses);
+    EXPECT_EQ(before.writes + 1, shaderCacheStats().writes);
+    EXPECT_TRUE(std::filesystem::exists(cacheDirectory / "flat.bin"));
+
+    const auto cached = buildShader("flat", vertexSource, fragmentSource, cacheDirectory);
+    ASSERT_NE(nullptr, cached);
+    EXPECT_EQ(before.hits + 1, shaderCacheStats().hits);
+    EXPECT_EQ(before.programs + 2, shaderCacheStats().programs);
+
+    // Linked and ready to use like the compiled one
+    EXPECT_TRUE(cached->uniformHandle("Color").isValid());
+    cached->use();
+    cached->set("Color", glm::vec3{0.25f, 0.5f, 1.0f});
+    GLfloat color[3] = {};
+    glGetUniformfv(cached->glId(), glGetUniformLocation(cached->glId(), "Color"), color);
+    EXPECT_FLOAT_EQ(0.5f, color[1]);
+}
+
+TEST_F(AppleSauceShaderCache, CanMissWhenSourcesChange)
+{
+    ASSERT_NE(nullptr, buildShader("flat", vertexSource, fragmentSource, cacheDirectory));
+
+    const auto before = shaderCacheStats();
+    const auto changed = fragmentSource + "\n// changed\n";
+    ASSERT_NE(nullptr, buildShader("flat", vertexSource, changed, cacheDirectory));
+    EXPECT_EQ(before.misses + 1, shaderCacheStats().misses);
+    EXPECT_EQ(before.hits, shaderCacheStats().hits);
+
+    // The binary for the new sources replaced the old one
+    ASSERT_NE(nullptr, buildShader("flat", vertexSource, changed, cacheDirectory));
+    EXPECT_EQ(before.hits + 1, shaderCacheStats().hits);
+}
+
+// As after a driver update that keeps its version string: the binary is
+// read but doesn't link, so the program is compiled and cached again
+TEST_F(AppleSauceShaderCache, CanFallBackWhenDriverRejectsBinary)
+{
+    ASSERT_NE(nullptr, buildShader("flat", vertexSource, fragmentSource, cacheDirectory));
+    const auto path = cacheDirectory / "flat.bin";
+    auto file = readFileText(path);
+    // Past the header, the binary itself
+    for (size_t i = 24; i < file.size(); i++)
+    {
+        file[i] = static_cast<char>(~file[i]);
+    }
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << file;
+
+    const auto before = shaderCacheStats();
+    const auto shader = buildShader("flat", vertexSource, fragmentSource, cacheDirectory);
+    ASSERT_NE(nullptr, shader);
+    EXPECT_EQ(before.rejected + 1, shaderCacheStats().rejected);
+    EXPECT_EQ(before.writes + 1, shaderCacheStats().writes);
+    EXPECT_TRUE(shader->uniformHandle("Color").isValid());
+
+    ASSERT_NE(nullptr, buildShader("flat", vertexSource, fragmentSource, cacheDirectory));
+    EXPECT_EQ(before.hits + 1, shaderCacheStats().hits);
+
+    // Sources that don't compile still fail with a cache directory
+    EXPECT_EQ(nullptr, buildShader("broken", vertexSource, "#version 330 core\nnot glsl", cacheDirectory));
+}
+
+// Building the game's programs from source against from the cache, as on a
+// first and a later launch
+TEST_F(AppleSauceShaderCache, BenchmarkStartup)
+{
+    const std::filesystem::path shaderDirectory = std::filesystem::path(ASSET_DIR) / "shaders";
+    const auto build = [&](const std::filesystem::path &cache)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (const auto name : {"basic", "shadow", "quad"})
+        {
+            const auto shader = buildShader(name, readFileText(shaderDirectory / (std::string(name) + ".vs.glsl")),
+                                            readFileText(shaderDirectory / (std::string(name) + ".fs.glsl")), cache);
+            EXPECT_NE(nullptr, shader) << name;
+        }
+        glFinish();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1000.0;
+    };
+
+    // Drivers keep their own cache of compiled sources too, a first run
+    // without one warms that up so both sides are measured the same
+    build({});
+    const auto compiled = build({});
+    const auto firstLaunch = build(cacheDirectory);
+    const auto before = shaderCacheStats();
+    const auto laterLaunch = build(cacheDirectory);
+    EXPECT_EQ(before.hits + 3, shaderCacheStats().hits);
+
+    std::cout << "3 programs: " << compiled << " ms from source, " << firstLaunch << " ms filling the cache, "
+              << laterLaunch << " ms from the cache" << std::endl;
+    RecordProperty("CompileMicroseconds", static_cast<int>(compiled * 1000.0));
+    RecordProperty("CachedMicroseconds", static_cast<int>(laterLaunch * 1000.0));
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+
+#include "AppleSauceTest.h"
+#include "GLCallRecorder.h"
+#include <applesauce/Shader.h>
+
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <iostream>
+
+class AppleSauceShaderUniforms : public AppleSauceTest
+{
+protected:
+    void SetUp() override
+    {
+        shader.add_vertex_stage(R"(#version 330 core
+            in vec4 vPosition;
+            in vec3 vNormal;
+
+            uniform mat4 MVPMatrix;
+            uniform mat4 ModelViewMatrix;
+            uniform mat3 NormalMatrix;
+            uniform vec3 AmbientSky;
+
+            out vec3 normal;
+            out vec3 ambient;
+
+            void main() {
+                gl_Position = MVPMatrix * ModelViewMatrix * vPosition;
+                normal = NormalMatrix * vNormal;
+                ambient = AmbientSky;
+            })");
+        shader.add_fragment_stage(R"(#version 330 core
+            uniform vec3 Color;
+            uniform float RoughnessFactor;
+            uniform sampler2D albedo;
+            uniform float Weights[4];
+
+            in vec3 normal;
+            in vec3 ambient;
+            out vec4 fColor;
+
+            void main() {
+                fColor = vec4(Color * ambient * normal * RoughnessFactor * Weights[2], 1.0) * texture(albedo, vec2(0));
+            })");
+        ASSERT_TRUE(shader.compile_and_link()) << shader.error_log();
+        shader.use();
+    }
+
+    Shader shader;
+};
+
+TEST_F(AppleSauceShaderUniforms, CanResolveHandlesForActiveUniforms)
+{
+    EXPECT_TRUE(shader.uniformHandle("MVPMatrix").isValid());
+    EXPECT_TRUE(shader.uniformHandle("NormalMatrix").isValid());
+    EXPECT_TRUE(shader.uniformHandle("albedo").isValid());
+    EXPECT_TRUE(shader.uniformHandle("Weights").isValid());
+    EXPECT_TRUE(shader.uniformHandle("Weights[0]").isValid());
+    EXPECT_FALSE(shader.uniformHandle("NotAUniform").isValid());
+}
+
+TEST_F(AppleSauceShaderUniforms, CanSetUniformsThroughHandles)
+{
+    const glm::vec3 expected{0.25f, 0.5f, 0.75f};
+    shader.set(shader.uniformHandle("Color"), expected);
+    shader.set(shader.uniformHandle("RoughnessFactor"), 0.125f);
+
+    glm::vec3 color;
+    glGetUniformfv(shader.glId(), glGetUniformLocation(shader.glId(), "Color"), &color[0]);
+    GLfloat roughness = 0;
+    glGetUniformfv(shader.glId(), glGetUniformLocation(shader.glId(), "RoughnessFactor"), &roughness);
+
+    EXPECT_EQ(expected, color);
+    EXPECT_EQ(0.125f, roughness);
+}
+
+TEST_F(AppleSauceShaderUniforms, CanSkipRedundantUploads)
+{
+    const auto color = shader.uniformHandle("Color");
+    const auto albedo = shader.uniformHandle("albedo");
+
+    GLCallRecorder recorder;
+    shader.set(color, glm::vec3{1.0f, 0.0f, 0.0f});
+    shader.set(color, glm::vec3{1.0f, 0.0f, 0.0f});
+    shader.set(albedo, 0);
+    shader.set(albedo, 0);
+
+    EXPECT_EQ(1, recorder.count("glUniform3fv"));
+    EXPECT_EQ(1, recorder.count("glUniform1i"));
+
+    shader.set(color, glm::vec3{0.0f, 1.0f, 0.0f});
+    shader.set(albedo, 1);
+
+    EXPECT_EQ(2, recorder.count("glUniform3fv"));
+    EXPECT_EQ(2, recorder.count("glUniform1i"));
+    EXPECT_EQ(0, recorder.count("glGetUniformLocation"));
+}
+
+TEST_F(AppleSauceShaderUniforms, CanIgnoreInvalidHandles)
+{
+    GLCallRecorder recorder;
+    shader.set(Shader::UniformHandle{}, 1.0f);
+    shader.set("NotAUniform", glm::vec3{1.0f});
+
+    EXPECT_EQ(0, recorder.total());
+}
+
+// Microbenchmark: GL calls per frame for a scene of identical entities that
+// only differ by their matrices, as in Triangles::display().
+TEST_F(AppleSauceShaderUniforms, CanReduceGLCallsPerFrame)
+{
+    constexpr int entityCount = 500;
+    const glm::vec3 ambient{0.3f, 0.3f, 0.3f};
+    const glm::vec3 color{1.0f, 0.6f, 0.1f};
+
+    GLCallRecorder recorder;
+
+    // Before: a location lookup by name for every upload
+    const auto program = shader.glId();
+    for (int i = 0; i < entityCount; i++)
+    {
+        const glm::mat4 matrix{static_cast<float>(i)};
+        glUniformMatrix4fv(glGetUniformLocation(program, "MVPMatrix"), 1, GL_FALSE, &matrix[0][0]);
+        glUniformMatrix4fv(glGetUniformLocation(program, "ModelViewMatrix"), 1, GL_FALSE, &matrix[0][0]);
+        glUniformMatrix3fv(glGetUniformLocation(program, "NormalMatrix"), 1, GL_FALSE, &glm::mat3(matrix)[0][0]);
+        glUniform3fv(glGetUniformLocation(program, "AmbientSky"), 1, &ambient[0]);
+        glUniform3fv(glGetUniformLocation(program, "Color"), 1, &color[0]);
+        glUniform1f(glGetUniformLocation(program, "RoughnessFactor"), 0.5f);
+        glUniform1i(glGetUniformLocation(program, "albedo"), 0);
+    }
+    const auto callsBefore = recorder.total();
+
+    recorder.reset();
+
+    // After: handles resolved once, unchanged values skipped
+    const auto mvpMatrix = shader.uniformHandle("MVPMatrix");
+    const auto modelViewMatrix = shader.uniformHandle("ModelViewMatrix");
+    const auto normalMatrix = shader.uniformHandle("NormalMatrix");
+    const auto ambientSky = shader.uniformHandle("AmbientSky");
+    const auto colorHandle = shader.uniformHandle("Color");
+    const auto roughnessFactor = shader.uniformHandle("RoughnessFactor");
+    const auto albedo = shader.uniformHandle("albedo");
+    for (int i = 0; i < entityCount; i++)
+    {
+        const glm::mat4 matrix{static_cast<float>(i)};
+        shader.set(mvpMatrix, matrix);
+        shader.set(modelViewMatrix, matrix);
+        shader.set(normalMatrix, glm::mat3(matrix));
+        shader.set(ambientSky, ambient);
+        shader.set(colorHandle, color);
+        shader.set(roughnessFactor, 0.5f);
+        shader.set(albedo, 0);
+    }
+    const auto callsAfter = recorder.total();
+
+    std::cout << "GL calls per frame for " << entityCount << " entities: "
+              << callsBefore << " before, " << callsAfter << " after" << std::endl;
+    RecordProperty("GLCallsBefore", static_cast<int>(callsBefore));
+    RecordProperty("GLCallsAfter", static_cast<int>(callsAfter));
+
+    EXPECT_EQ(entityCount * 14, callsBefore);
+    EXPECT_EQ(0, recorder.count("glGetUniformLocation"));
+    EXPECT_EQ(entityCount * 3 + 4, callsAfter);
+}
@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+
+#include <applesauce/ShadowFrustum.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+
+using namespace applesauce;
+
+static const Bounds scene{{-12.0f, -0.5f, -9.0f}, {12.0f, 2.5f, 9.0f}};
+static const glm::vec3 lightDirection = glm::normalize(glm::vec3{0.5f, 1.0f, 0.25f});
+
+static glm::mat4 cameraMatrix(const glm::vec3 &eye, const glm::vec3 &target)
+{
+    return glm::perspectiveFov(glm::radians(45.0f), 640.0f, 480.0f, 0.1f, 100.0f) * glm::lookAt(eye, target, glm::vec3{0, 1, 0});
+}
+
+static glm::vec3 project(const glm::mat4 &matrix, const glm::vec3 &point)
+{
+    const auto clip = matrix * glm::vec4(point, 1.0f);
+    return glm::vec3(clip) / clip.w;
+}
+
+TEST(ShadowFrustum, CanFindFrustumCorners)
+{
+    const auto viewProjection = cameraMatrix(glm::vec3{0, 10, 20}, glm::vec3{0});
+    const auto corners = frustumCorners(viewProjection);
+
+    for (int i = 0; i < 8; i++)
+    {
+        const auto ndc = project(viewProjection, corners[i]);
+        EXPECT_NEAR(i & 1 ? 1.0f : -1.0f, ndc.x, 1e-3f);
+        EXPECT_NEAR(i & 2 ? 1.0f : -1.0f, ndc.y, 1e-3f);
+        EXPECT_NEAR(i < 4 ? -1.0f : 1.0f, ndc.z, 1e-3f);
+    }
+}
+
+TEST(ShadowFrustum, CanSliceFrustumByDepth)
+{
+    const auto view = glm::lookAt(glm::vec3{0, 10, 20}, glm::vec3{0}, glm::vec3{0, 1, 0});
+    const auto corners = frustumCorners(glm::perspectiveFov(glm::radians(45.0f), 640.0f, 480.0f, 0.1f, 100.0f) * view);
+    const auto slice = frustumSlice(corners, 0.1f, 100.0f, 5.0f, 20.0f);
+
+    for (int i = 0; i < 8; i++)
+    {
+        const auto depth = -(view * glm::vec4(slice[i], 1.0f)).z;
+        EXPECT_NEAR(i < 4 ? 5.0f : 20.0f, depth, 1e-2f);
+    }
+}
+
+TEST(ShadowFrustum, CanSplitCascades)
+{
+    float splits[4];
+    cascadeSplits(0.1f, 40.0f, 4, 0.5f, splits);
+    for (int i = 1; i < 4; i++)
+    {
+        EXPECT_LT(splits[i - 1], splits[i]);
+    }
+    EXPECT_FLOAT_EQ(40.0f, splits[3]);
+
+    // Logarithmic splits put the first cascade closer to the camera
+    float uniform[4];
+    float logarithmic[4];
+    cascadeSplits(0.1f, 40.0f, 4, 0.0f, uniform);
+    cascadeSplits(0.1f, 40.0f, 4, 1.0f, logarithmic);
+    EXPECT_FLOAT_EQ(10.075f, uniform[0]);
+    EXPECT_LT(logarithmic[0], splits[0]);
+    EXPECT_LT(splits[0], uniform[0]);
+}
+
+TEST(ShadowFrustum, CanFitSliceInScene)
+{
+    const auto corners = frustumCorners(cameraMatrix(glm::vec3{0, 10, 20}, glm::vec3{0}));
+    const auto slice = frustumSlice(corners, 0.1f, 100.0f, 10.0f, 25.0f);
+    const auto cascade = fitShadowCascade(slice, lightDirection, scene, 1024);
+
+    // Every point of the slice that is in the scene is in the box, and so
+    // is the whole depth of the scene along the light
+    for (const auto &point : slice)
+    {
+        const auto clamped = glm::min(glm::max(point, scene.min), scene.max);
+        const auto inLight = project(cascade.lightSpaceMatrix, clamped);
+        EXPECT_GE(inLight.x, -1.0f - 1e-3f);
+        EXPECT_LE(inLight.x, 1.0f + 1e-3f);
+        EXPECT_GE(inLight.y, -1.0f - 1e-3f);
+        EXPECT_LE(inLight.y, 1.0f + 1e-3f);
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        const glm::vec3 corner{i & 1 ? scene.max.x : scene.min.x, i & 2 ? scene.max.y : scene.min.y, i & 4 ? scene.max.z : scene.min.z};
+        const auto z = project(cascade.lightSpaceMatrix, corner).z;
+        EXPECT_GE(z, -1.0f - 1e-3f);
+        EXPECT_LE(z, 1.0f + 1e-3f);
+    }
+}
+
+TEST(ShadowFrustum, CanSnapToTexels)
+{
+    constexpr int resolution = 1024;
+    const auto fit = [](const glm::vec3 &eye)
+    {
+        const auto corners = frustumCorners(cameraMatrix(eye, eye + glm::vec3{0, -10, -20}));
+        return fitShadowCascade(frustumSlice(corners, 0.1f, 100.0f, 0.1f, 15.0f), lightDirection, scene, resolution);
+    };
+
+    const auto before = fit(glm::vec3{0, 10, 20});
+    const auto after = fit(glm::vec3{0.013f, 10, 19.993f});
+
+    // The box keeps its size and only slides by whole texels, so a point
+    // lands on the same spot within its texel
+    ASSERT_EQ(before.texelsPerUnit, after.texelsPerUnit);
+    const glm::vec3 point{1.3f, 0.0f, -2.7f};
+    const auto texelsBefore = (project(before.lightSpaceMatrix, point) * 0.5f + 0.5f) * static_cast<float>(resolution);
+    const auto texelsAfter = (project(after.lightSpaceMatrix, point) * 0.5f + 0.5f) * static_cast<float>(resolution);
+    const auto shift = texelsAfter - texelsBefore;
+    EXPECT_NEAR(std::round(shift.x), shift.x, 1e-2f);
+    EXPECT_NEAR(std::round(shift.y), shift.y, 1e-2f);
+}
+
+TEST(ShadowFrustum, CanHoldBoxWhileSliceStaysInside)
+{
+    constexpr int resolution = 1024;
+    const auto fit = [](const glm::vec3 &eye, const ShadowCascade *previous)
+    {
+        const auto corners = frustumCorners(cameraMatrix(eye, eye + glm::vec3{0, -10, -20}));
+        return fitShadowCascade(frustumSlice(corners, 0.1f, 100.0f, 0.1f, 15.0f), lightDirection, scene, resolution, previous, 0.1f);
+    };
+
+    const auto first = fit(glm::vec3{0, 10, 20}, nullptr);
+    const auto nudged = fit(glm::vec3{0.2f, 10, 19.9f}, &first);
+    EXPECT_EQ(first.lightSpaceMatrix, nudged.lightSpaceMatrix);
+    EXPECT_EQ(first.box, nudged.box);
+
+    // Far enough for the slice to leave the box
+    const auto moved = fit(glm::vec3{6.0f, 10, 16.0f}, &nudged);
+    EXPECT_NE(first.box, moved.box);
+    EXPECT_NE(first.lightSpaceMatrix, moved.lightSpaceMatrix);
+
+    // A camera panning along: each new box is a new shadow cache
+    const auto refits = [&](bool hold)
+    {
+        ShadowCascade cascade;
+        size_t count = 0;
+        for (int frame = 0; frame < 240; frame++)
+        {
+            const glm::vec3 eye{-6.0f + static_cast<float>(frame) * 0.05f, 10, 20};
+            const auto corners = frustumCorners(cameraMatrix(eye, eye + glm::vec3{0, -10, -20}));
+            const auto next = fitShadowCascade(frustumSlice(corners, 0.1f, 100.0f, 0.1f, 15.0f), lightDirection, scene, resolution,
+                                               hold ? &cascade : nullptr, hold ? 0.1f : 0.0f);
+            count += next.lightSpaceMatrix != cascade.lightSpaceMatrix;
+            cascade = next;
+        }
+        return count;
+    };
+    const auto everyTexel = refits(false);
+    const auto held = refits(true);
+    EXPECT_LT(held * 10, everyTexel);
+}
+
+TEST(ShadowFrustum, CanConcentrateTexelsNearCamera)
+{
+    const auto corners = frustumCorners(cameraMatrix(glm::vec3{0, 10, 20}, glm::vec3{0}));
+    const auto nearest = fitShadowCascade(frustumSlice(corners, 0.1f, 100.0f, 0.1f, 18.0f), lightDirection, scene, 2048);
+    const auto whole = fitShadowCascade(corners, lightDirection, scene, 2048);
+
+    EXPECT_GT(nearest.texelsPerUnit, whole.texelsPerUnit);
+    // Far more than a fixed box of 34 units for the same map
+    EXPECT_GT(whole.texelsPerUnit, 2048.0f / 34.0f);
+}
+
+TEST(ShadowFrustum, CanShareMapBetweenCascades)
+{
+    EXPECT_EQ(glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), cascadeRegion(0, 1));
+    EXPECT_EQ(glm::vec4(0.0f, 0.0f, 0.5f, 0.5f), cascadeRegion(0, 4));
+    EXPECT_EQ(glm::vec4(0.5f, 0.0f, 0.5f, 0.5f), cascadeRegion(1, 4));
+    EXPECT_EQ(glm::vec4(0.0f, 0.5f, 0.5f, 0.5f), cascadeRegion(2, 3));
+    EXPECT_EQ(glm::vec4(0.5f, 0.5f, 0.5f, 0.5f), cascadeRegion(3, 4));
+}
@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+
+#include "AppleSauceTest.h"
+#include <applesauce/InstancedRenderer.h>
+#include <applesauce/Mesh.h>
+#include <applesauce/Shader.h>
+#include <applesauce/ShadowMap.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <iostream>
+#include <memory>
+
+class AppleSauceShadowMap : public AppleSauceTest
+{
+protected:
+    static float depthAt(const applesauce::ShadowMap &map, int x, int y)
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, map.framebuffer());
+        float depth = -1.0f;
+        glReadPixels(x, y, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &depth);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        return depth;
+    }
+
+    std::shared_ptr<applesauce::Material> material = std::make_shared<applesauce::Material>(applesauce::Material{{1.0f, 1.0f, 1.0f}, 0.5f, 0.5f});
+};
+
+TEST_F(AppleSauceShadowMap, CanTrackWhatTheCacheHolds)
+{
+    applesauce::ShadowCache cache(64, 64);
+    EXPECT_TRUE(cache.isStale(1));
+
+    cache.beginUpdate();
+    cache.endUpdate(1);
+    EXPECT_FALSE(cache.isStale(1));
+    EXPECT_TRUE(cache.isStale(2));
+
+    cache.invalidate();
+    EXPECT_TRUE(cache.isStale(1));
+    EXPECT_EQ(1, cache.stats().rebuilds);
+}
+
+TEST_F(AppleSauceShadowMap, CanRestoreCachedDepth)
+{
+    applesauce::ShadowMap map(64, 64);
+    applesauce::ShadowCache cache(64, 64);
+
+    glClearDepth(0.25);
+    cache.beginUpdate();
+    cache.endUpdate(1);
+    glClearDepth(1.0);
+
+    map.bind();
+    glClear(GL_DEPTH_BUFFER_BIT);
+    EXPECT_FLOAT_EQ(1.0f, depthAt(map, 10, 10));
+
+    cache.restore(map);
+    EXPECT_FLOAT_EQ(0.25f, depthAt(map, 10, 10));
+    EXPECT_FLOAT_EQ(0.25f, depthAt(map, 63, 63));
+    EXPECT_EQ(1, cache.stats().restores);
+
+    GLint bound = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &bound);
+    EXPECT_EQ(map.framebuffer(), static_cast<GLuint>(bound));
+}
+
+// GPU time of a shadow pass over a field of stationary boxes and a few
+// moving ones, drawing everything against restoring the cache and drawing
+// only what moves.
+TEST_F(AppleSauceShadowMap, CanCutShadowPassTime)
+{
+    constexpr int size = 2048;
+    constexpr int stationaryCount = 20000;
+    constexpr int movingCount = 20;
+    constexpr int frameCount = 20;
+
+    Shader depth;
+    depth.add_vertex_stage(R"(#version 330 core
+        layout (location = 0) in vec3 vPosition;
+        layout (location = 3) in mat4 vModelMatrix;
+        uniform mat4 LightSpaceMatrix;
+        void main() {
+            gl_Position = LightSpaceMatrix * vModelMatrix * vec4(vPosition, 1);
+        })");
+    depth.add_fragment_stage(R"(#version 330 core
+        void main() {
+        })");
+    ASSERT_TRUE(depth.compile_and_link()) << depth.error_log();
+    depth.use();
+    const auto lightView = glm::lookAt(glm::vec3{0, 10, 0}, glm::vec3{0}, glm::vec3{0, 0, 1});
+    depth.set(depth.uniformHandle("LightSpaceMatrix"), glm::ortho(-80.0f, 80.0f, -80.0f, 80.0f, 0.1f, 20.0f) * lightView);
+
+    const auto box = makeBoxMesh(1.0f, material);
+    applesauce::InstancedRenderer stationary;
+    stationary.begin();
+    for (int i = 0; i < stationaryCount; i++)
+    {
+        stationary.add(box, glm::translate(glm::mat4{1.0f}, glm::vec3{static_cast<float>(i % 150 - 75), 0, static_cast<float>(i / 150 - 75)}));
+    }
+    stationary.end();
+    applesauce::InstancedRenderer moving;
+    moving.begin();
+    for (int i = 0; i < movingCount; i++)
+    {
+        moving.add(box, glm::translate(glm::mat4{1.0f}, glm::vec3{static_cast<float>(i), 1.0f, 0}));
+    }
+    moving.end();
+
+    applesauce::ShadowMap map(size, size);
+    applesauce::ShadowCache cache(size, size);
+    glEnable(GL_DEPTH_TEST);
+
+    GLuint query;
+    glGenQueries(1, &query);
+    const auto timeFrames = [&](bool cached)
+    {
+        GLuint64 total = 0;
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            glBeginQuery(GL_TIME_ELAPSED, query);
+            if (cached)
+            {
+                if (cache.isStale(1))
+                {
+                    cache.beginUpdate();
+                    stationary.draw([](const applesauce::Material *) {});
+                    cache.endUpdate(1);
+                }
+                cache.restore(map);
+            }
+            else
+            {
+                map.bind();
+                glClear(GL_DEPTH_BUFFER_BIT);
+                stationary.draw([](const applesauce::Material *) {});
+            }
+            moving.draw([](const applesauce::Material *) {});
+            glEndQuery(GL_TIME_ELAPSED);
+
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            total += elapsed;
+        }
+        return static_cast<double>(total) / frameCount / 1e6;
+    };
+
+    const auto uncachedMs = timeFrames(false);
+    const auto uncachedDepth = depthAt(map, size / 2, size / 2);
+    const auto cachedMs = timeFrames(true);
+    glDeleteQueries(1, &query);
+
+    std::cout << "Shadow pass GPU ms/frame with " << stationaryCount << " stationary and " << movingCount
+              << " moving casters: " << uncachedMs << " redrawn, " << cachedMs << " cached" << std::endl;
+    RecordProperty("ShadowPassUncachedMicroseconds", static_cast<int>(uncachedMs * 1000.0));
+    RecordProperty("ShadowPassCachedMicroseconds", static_cast<int>(cachedMs * 1000.0));
+
+    // The same depth either way, and the stationary boxes were drawn just once
+    EXPECT_FLOAT_EQ(uncachedDepth, depthAt(map, size / 2, size / 2));
+    EXPECT_EQ(1, cache.stats().rebuilds);
+    EXPECT_EQ(frameCount, cache.stats().restores);
+}
@@ -2,6 +2,8 @@
 
 #include "AppleSauceTest.h"
 #include <applesauce/Texture.h>
+#include <util/CompressedImage.h>
+#include <util/Image.h>
 
 #include <vector>
 
@@ -166,4 +168,85 @@ TEST_F(AppleSauceTexture, CanCreateDepthTexture)
     EXPECT_EQ(GL_DEPTH_COMPONENT24, internalFormat);
     EXPECT_EQ(GL_COMPARE_REF_TO_TEXTURE, compareMode);
     EXPECT_EQ(GL_LEQUAL, compareFunc);
-}
\ No newline at end of file
+}
+
+TEST_F(AppleSauceTexture, CanUploadCompressedTexture)
+{
+    Image image{16, 8, std::vector<uint8_t>(16 * 8 * 4)};
+    for (size_t i = 0; i < image.pixels.size(); i++)
+    {
+        image.pixels[i] = static_cast<uint8_t>(i % 4 == 3 ? 255 : i * 7);
+    }
+    const auto mips = generateMipChain(image);
+    const auto compressed = compressMipChain(mips, CompressedImage::Format::bc1);
+
+    size_t rgbaBytes = 0;
+    size_t blockBytes = 0;
+    for (size_t level = 0; level < mips.size(); level++)
+    {
+        rgbaBytes += mips[level].pixels.size();
+        blockBytes += compressed.levels[level].blocks.size();
+    }
+
+    const auto before = Texture2D::memory();
+    {
+        Texture2D tex;
+        ASSERT_TRUE(setTextureCompressed(tex, compressed));
+        EXPECT_EQ(before.textures + 1, Texture2D::memory().textures);
+        EXPECT_EQ(before.uncompressedBytes + rgbaBytes, Texture2D::memory().uncompressedBytes);
+
+        tex.bind();
+        GLint width = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+        EXPECT_EQ(16, width);
+
+        // Drivers without S3TC get RGBA decoded from the blocks
+        if (Texture2D::isSupported(Texture2D::Format::bc1))
+        {
+            GLint isCompressed = GL_FALSE;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &isCompressed);
+            EXPECT_EQ(GL_TRUE, isCompressed);
+            EXPECT_EQ(Texture2D::Format::bc1, tex.format());
+            EXPECT_EQ(blockBytes, tex.memoryBytes());
+            EXPECT_EQ(before.bytes + blockBytes, Texture2D::memory().bytes);
+        }
+        else
+        {
+            EXPECT_EQ(rgbaBytes, tex.memoryBytes());
+        }
+        tex.unbind();
+
+        // Replacing a level takes the old one out of the count
+        tex.setImage(0, 16, 8, Texture2D::Format::rgba, image.pixels.data());
+        EXPECT_EQ(Texture2D::Format::rgba, tex.format());
+        EXPECT_EQ(before.uncompressedBytes + rgbaBytes, Texture2D::memory().uncompressedBytes);
+    }
+    EXPECT_EQ(before.textures, Texture2D::memory().textures);
+    EXPECT_EQ(before.bytes, Texture2D::memory().bytes);
+    EXPECT_EQ(before.uncompressedBytes, Texture2D::memory().uncompressedBytes);
+}
+
+TEST_F(AppleSauceTexture, CanCountGeneratedMipmaps)
+{
+    const Image image{16, 8, std::vector<uint8_t>(16 * 8 * 4, 255)};
+    // 16x8, 8x4, 4x2, 2x1 and 1x1
+    const size_t chainBytes = (128 + 32 + 8 + 2 + 1) * 4;
+
+    const auto before = Texture2D::memory();
+    {
+        Texture2D tex;
+        ASSERT_TRUE(setTextureImage(tex, image));
+        EXPECT_EQ(chainBytes, tex.memoryBytes());
+        EXPECT_EQ(before.bytes + chainBytes, Texture2D::memory().bytes);
+        EXPECT_EQ(before.uncompressedBytes + chainBytes, Texture2D::memory().uncompressedBytes);
+
+        // A new level 0 leaves the old chain behind until it is generated again
+        tex.setImage(0, 4, 4, Texture2D::Format::rgba, image.pixels.data());
+        EXPECT_EQ(size_t{4 * 4 * 4}, tex.memoryBytes());
+        tex.generateMipmaps();
+        EXPECT_EQ(size_t{(16 + 4 + 1) * 4}, tex.memoryBytes());
+        EXPECT_EQ(before.bytes + (16 + 4 + 1) * 4, Texture2D::memory().bytes);
+    }
+    EXPECT_EQ(before.bytes, Texture2D::memory().bytes);
+    EXPECT_EQ(before.uncompressedBytes, Texture2D::memory().uncompressedBytes);
+}
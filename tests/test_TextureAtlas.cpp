@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+
+#include "AppleSauceTest.h"
+#include <applesauce/InstancedRenderer.h>
+#include <applesauce/Mesh.h>
+#include <applesauce/RenderQueue.h>
+#include <applesauce/Shader.h>
+#include <applesauce/TextureAtlas.h>
+#include <util/Image.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using applesauce::TextureAtlas;
+
+class AppleSauceTextureAtlas : public AppleSauceTest
+{
+};
+
+static Image solidImage(uint32_t width, uint32_t height, uint8_t shade)
+{
+    return Image{width, height, std::vector<uint8_t>(static_cast<size_t>(width) * height * 4, shade)};
+}
+
+// Every layer of one level
+static std::vector<uint8_t> texels(const TextureAtlas &atlas, int level, size_t layerCount)
+{
+    const auto size = static_cast<size_t>(atlas.layerSize() >> level);
+    std::vector<uint8_t> result(size * size * layerCount * 4);
+    atlas.bind();
+    glGetTexImage(GL_TEXTURE_2D_ARRAY, level, GL_RGBA, GL_UNSIGNED_BYTE, result.data());
+    atlas.unbind();
+    return result;
+}
+
+// The red channel under a texcoord of the entry, as the shader would map it
+static uint8_t sample(const TextureAtlas &atlas, const std::vector<uint8_t> &level0, const TextureAtlas::Entry &entry,
+                      float u, float v)
+{
+    const auto size = atlas.layerSize();
+    const auto x = static_cast<size_t>((entry.rect.x + u * entry.rect.z) * size);
+    const auto y = static_cast<size_t>((entry.rect.y + v * entry.rect.w) * size);
+    return level0[((entry.layer * size + std::min<size_t>(y, size - 1)) * size + std::min<size_t>(x, size - 1)) * 4];
+}
+
+TEST_F(AppleSauceTextureAtlas, CanPackSmallTexturesIntoOneLayer)
+{
+    TextureAtlas atlas(64, 2, 4);
+    const auto white = atlas.add("White", solidImage(1, 1, 0xFF));
+    const auto square = atlas.add("Square", solidImage(16, 16, 0x40));
+    const auto strip = atlas.add("Strip", solidImage(24, 4, 0x80));
+
+    EXPECT_EQ(0, white.layer);
+    EXPECT_EQ(0, square.layer);
+    EXPECT_EQ(0, strip.layer);
+    EXPECT_FLOAT_EQ(16.0f / 64.0f, square.rect.z);
+    EXPECT_FLOAT_EQ(4.0f / 64.0f, strip.rect.w);
+    EXPECT_EQ(1, atlas.stats().layersUsed);
+    EXPECT_EQ(3, atlas.stats().entries);
+    EXPECT_EQ(1 + 16 * 16 + 24 * 4, atlas.stats().usedTexels);
+
+    const auto level0 = texels(atlas, 0, 2);
+    for (const float t : {0.0f, 0.5f, 0.99f})
+    {
+        EXPECT_EQ(0xFF, sample(atlas, level0, white, t, t));
+        EXPECT_EQ(0x40, sample(atlas, level0, square, t, t));
+        EXPECT_EQ(0x80, sample(atlas, level0, strip, t, t));
+    }
+    // Just outside an entry is its border, a copy of its edge
+    EXPECT_EQ(0x40, sample(atlas, level0, square, -0.2f, 1.2f));
+
+    // The same name again is the same entry
+    const auto again = atlas.add("Square", solidImage(16, 16, 0x00));
+    EXPECT_EQ(square.rect, again.rect);
+    EXPECT_EQ(3, atlas.stats().entries);
+    ASSERT_NE(nullptr, atlas.find("Strip"));
+    EXPECT_EQ(nullptr, atlas.find("Missing"));
+}
+
+TEST_F(AppleSauceTextureAtlas, CanGiveRepeatingTexturesALayerEach)
+{
+    TextureAtlas atlas(32, 3, 4);
+    atlas.add("White", solidImage(1, 1, 0xFF));
+
+    // 2x2 texels, each scaled up to a 16x16 quarter of the layer
+    Image checker = solidImage(2, 2, 0x20);
+    checker.pixels[4] = checker.pixels[8] = 0xE0;
+    const auto entry = atlas.add("Checker", checker, true);
+    EXPECT_EQ(1, entry.layer);
+    EXPECT_EQ(glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), entry.rect);
+    EXPECT_EQ(2, atlas.stats().layersUsed);
+
+    const auto level0 = texels(atlas, 0, 3);
+    EXPECT_EQ(0x20, sample(atlas, level0, entry, 0.1f, 0.1f));
+    EXPECT_EQ(0xE0, sample(atlas, level0, entry, 0.9f, 0.1f));
+    EXPECT_EQ(0xE0, sample(atlas, level0, entry, 0.1f, 0.9f));
+    EXPECT_EQ(0x20, sample(atlas, level0, entry, 0.9f, 0.9f));
+
+    // Its smallest level is the average of the whole texture
+    const auto level5 = texels(atlas, 5, 3);
+    EXPECT_EQ(0x80, level5[entry.layer * 4]);
+
+    // Another packed texture doesn't go in the repeating texture's layer
+    const auto square = atlas.add("Square", solidImage(16, 16, 0x40));
+    EXPECT_NE(entry.layer, square.layer);
+}
+
+TEST_F(AppleSauceTextureAtlas, CanRefuseTexturesThatDontFit)
+{
+    EXPECT_THROW(TextureAtlas(48, 1, 4), std::runtime_error);
+
+    TextureAtlas atlas(32, 1, 4);
+    EXPECT_THROW(atlas.add("Large", solidImage(64, 8, 0x10)), std::runtime_error);
+    // The border pushes it past the layer
+    EXPECT_THROW(atlas.add("Edge", solidImage(32, 8, 0x10)), std::runtime_error);
+
+    atlas.add("Square", solidImage(20, 20, 0x10));
+    EXPECT_THROW(atlas.add("Second", solidImage(20, 20, 0x10)), std::runtime_error);
+    EXPECT_THROW(atlas.add("Checker", solidImage(4, 4, 0x10), true), std::runtime_error);
+    EXPECT_EQ(1, atlas.stats().entries);
+}
+
+// Texture binds in a pass over many materials, each with its own texture or
+// all of them sampling the atlas
+TEST_F(AppleSauceTextureAtlas, BenchmarkTextureBinds)
+{
+    Shader shader;
+    shader.add_vertex_stage(R"(#version 330 core
+        layout(location = 0) in vec4 vPosition;
+        void main() {
+            gl_Position = vPosition;
+        })");
+    shader.add_fragment_stage(R"(#version 330 core
+        out vec4 fColor;
+        void main() {
+            fColor = vec4(1.0);
+        })");
+    ASSERT_TRUE(shader.compile_and_link()) << shader.error_log();
+
+    constexpr int materialCount = 32;
+    TextureAtlas atlas(256, 1, 4);
+    std::vector<applesauce::Mesh> boxes;
+    for (int i = 0; i < materialCount; i++)
+    {
+        const auto shade = static_cast<uint8_t>(i * 8);
+        auto material = std::make_shared<applesauce::Material>(applesauce::Material{{1.0f, 1.0f, 1.0f}, 0.5f, 0.5f});
+        material->baseTexture = std::make_shared<applesauce::Texture>();
+        material->baseTexture->setImage(0, 16, 16, applesauce::Texture::Format::rgba, solidImage(16, 16, shade).pixels.data());
+        const auto entry = atlas.add("Texture " + std::to_string(i), solidImage(16, 16, shade));
+        material->atlasRect = entry.rect;
+        boxes.push_back(makeBoxMesh(1.0f, material));
+    }
+
+    const auto textureBinds = [&](bool inAtlas)
+    {
+        for (auto &box : boxes)
+        {
+            box.primitives.front().material->atlasLayer = inAtlas ? 0 : -1;
+        }
+
+        applesauce::InstancedRenderer renderer;
+        renderer.begin();
+        for (int i = 0; i < materialCount * 4; i++)
+        {
+            renderer.add(boxes[i % materialCount], glm::translate(glm::mat4{1.0f}, glm::vec3{0, 0, -static_cast<float>(i)}));
+        }
+        renderer.end();
+
+        applesauce::RenderQueue queue;
+        queue.begin();
+        renderer.submit(queue, 0, shader, glm::mat4{1.0f}, 1000.0f);
+        queue.sort();
+        queue.dispatch(0, [](const applesauce::Material *) {});
+        return queue.stats().textureBinds;
+    };
+
+    const auto separate = textureBinds(false);
+    const auto atlased = textureBinds(true);
+    std::cout << materialCount << " materials: " << separate << " texture binds, " << atlased
+              << " with the atlas (" << atlas.stats().entries << " textures in " << atlas.stats().layersUsed
+              << " layer, " << atlas.stats().occupancy() * 100.0 << "% occupied)" << std::endl;
+    RecordProperty("TextureBinds", static_cast<int>(separate));
+    RecordProperty("AtlasTextureBinds", static_cast<int>(atlased));
+    EXPECT_EQ(materialCount, separate);
+    EXPECT_EQ(1, atlased);
+}
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+
+#include "AppleSauceTest.h"
+#include <applesauce/TextureUploadRing.h>
+#include <util/Image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace applesauce;
+
+class AppleSauceTextureUploadRing : public AppleSauceTest
+{
+};
+
+static Image solidImage(uint32_t width, uint32_t height, uint8_t shade)
+{
+    Image image{width, height, std::vector<uint8_t>(static_cast<size_t>(width) * height * 4)};
+    for (size_t i = 0; i < image.pixels.size(); i++)
+    {
+        image.pixels[i] = static_cast<uint8_t>(shade + i % 4);
+    }
+    return image;
+}
+
+static std::vector<uint8_t> texels(const Texture2D &texture, int level, size_t size)
+{
+    std::vector<uint8_t> result(size);
+    texture.bind();
+    glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, result.data());
+    texture.unbind();
+    return result;
+}
+
+TEST_F(AppleSauceTextureUploadRing, CanUploadMipChain)
+{
+    TextureUploadRing ring(64 * 1024);
+    EXPECT_NE(0, ring.glId());
+
+    auto image = solidImage(8, 4, 0x10);
+    image.pixels[0] = 0xF0;
+    const auto mips = generateMipChain(image);
+    ASSERT_EQ(4, mips.size());
+
+    Texture2D texture;
+    ring.upload(texture, mips);
+
+    for (size_t level = 0; level < mips.size(); level++)
+    {
+        EXPECT_EQ(mips[level].pixels, texels(texture, static_cast<int>(level), mips[level].pixels.size()));
+    }
+    EXPECT_EQ(1, ring.stats().textures);
+    EXPECT_EQ(4, ring.stats().levels);
+    EXPECT_EQ((32 + 8 + 2 + 1) * 4, ring.stats().bytes);
+    EXPECT_EQ(0, ring.stats().direct);
+
+    // Other uploads read from client memory again
+    GLint unpackBuffer = -1;
+    glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &unpackBuffer);
+    EXPECT_EQ(0, unpackBuffer);
+}
+
+// Many more textures than fit in the ring at once, each must keep its own
+// texels as the ring comes round over them
+TEST_F(AppleSauceTextureUploadRing, CanWrapAroundRing)
+{
+    TextureUploadRing ring(4 * 1024);
+
+    std::vector<Image> images;
+    std::vector<std::unique_ptr<Texture2D>> textures;
+    for (uint8_t i = 0; i < 12; i++)
+    {
+        images.push_back(solidImage(16, 12, static_cast<uint8_t>(i * 16)));
+        textures.push_back(std::make_unique<Texture2D>());
+        ring.upload(*textures.back(), {images.back()});
+    }
+
+    for (size_t i = 0; i < textures.size(); i++)
+    {
+        EXPECT_EQ(images[i].pixels, texels(*textures[i], 0, images[i].pixels.size())) << "Texture " << i;
+    }
+    EXPECT_EQ(12, ring.stats().textures);
+    EXPECT_EQ(0, ring.stats().direct);
+}
+
+TEST_F(AppleSauceTextureUploadRing, CanUploadTexturesLargerThanRing)
+{
+    const auto image = solidImage(32, 32, 0x40);
+    for (size_t capacity : {0, 1024})
+    {
+        TextureUploadRing ring(capacity);
+        Texture2D texture;
+        ring.upload(texture, {image});
+
+        EXPECT_EQ(image.pixels, texels(texture, 0, image.pixels.size()));
+        EXPECT_EQ(1, ring.stats().direct);
+    }
+}
+
+// Upload throughput and how long each upload holds up the frame that issues
+// it: glTexImage2D straight from client memory against through the ring.
+// One 1024x1024 texture with CPU made mips per frame.
+TEST_F(AppleSauceTextureUploadRing, BenchmarkStreamingUploads)
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr size_t frameCount = 32;
+
+    std::vector<std::vector<Image>> chains;
+    for (size_t i = 0; i < 4; i++)
+    {
+        chains.push_back(generateMipChain(solidImage(1024, 1024, static_cast<uint8_t>(i * 32))));
+    }
+
+    struct Result
+    {
+        double megabytesPerSecond;
+        double meanFrameMilliseconds;
+        double worstFrameMilliseconds;
+        size_t waits;
+    };
+
+    const auto run = [&](size_t capacity)
+    {
+        TextureUploadRing ring(capacity);
+        std::vector<std::unique_ptr<Texture2D>> textures;
+        for (size_t i = 0; i < frameCount; i++)
+        {
+            textures.push_back(std::make_unique<Texture2D>());
+        }
+        glFinish();
+
+        double worst = 0;
+        const auto start = Clock::now();
+        for (size_t i = 0; i < frameCount; i++)
+        {
+            const auto frameStart = Clock::now();
+            ring.upload(*textures[i], chains[i % chains.size()]);
+            glFlush();
+            worst = std::max(worst, std::chrono::duration<double>(Clock::now() - frameStart).count());
+        }
+        const std::chrono::duration<double> issued = Clock::now() - start;
+        glFinish();
+        const std::chrono::duration<double> total = Clock::now() - start;
+
+        return Result{ring.stats().bytes / total.count() / (1024.0 * 1024.0), issued.count() / frameCount * 1000.0,
+                      worst * 1000.0, ring.stats().waits};
+    };
+
+    // Once each first, so neither pays for the driver warming up
+    run(0);
+    run(32 << 20);
+
+    const auto direct = run(0);
+    const auto ring = run(32 << 20);
+
+    const auto print = [](const char *name, const Result &result)
+    {
+        std::cout << name << ": " << result.megabytesPerSecond << " MB/s, " << result.meanFrameMilliseconds
+                  << " ms a frame, worst " << result.worstFrameMilliseconds << " ms";
+        if (result.waits > 0)
+            std::cout << ", waited on the GPU " << result.waits << " times";
+        std::cout << std::endl;
+    };
+    print("Client memory", direct);
+    print("Upload ring", ring);
+    RecordProperty("DirectMegabytesPerSecond", static_cast<int>(direct.megabytesPerSecond));
+    RecordProperty("RingMegabytesPerSecond", static_cast<int>(ring.megabytesPerSecond));
+    RecordProperty("DirectWorstFrameMicroseconds", static_cast<int>(direct.worstFrameMilliseconds * 1000.0));
+    RecordProperty("RingWorstFrameMicroseconds", static_cast<int>(ring.worstFrameMilliseconds * 1000.0));
+}
@@ -0,0 +1,433 @@
+#include <gtest/gtest.h>
+
+#include <game/LevelFile.h>
+#include <game/TileMap.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The tile map as it was before chunks, a vector of rows of bools, to
+// check and time the bitset against
+struct NestedTileMap
+{
+    struct Tile
+    {
+        bool isCollidable = false;
+    };
+
+    bool isCollidable(size_t x, size_t y) const
+    {
+        return tiles[y][x].isCollidable;
+    }
+
+    AABB tileAABB(size_t x, size_t y) const
+    {
+        y = (tiles.size() - 1) - y;
+        glm::vec2 min = glm::vec2{static_cast<float>(x * tileSize) - tileSize * 0.5f, static_cast<float>(y * tileSize) - tileSize * 0.5f} - center;
+        glm::vec2 max = glm::vec2{min.x + tileSize, min.y + tileSize};
+        return {min, max};
+    }
+
+    std::pair<size_t, size_t> pointToTileCoordinates(glm::vec2 point) const
+    {
+        glm::vec2 adjustedPoint = point + center + glm::vec2{0.5f, 0.5f};
+        return {static_cast<size_t>(adjustedPoint.x), static_cast<size_t>(tiles.size() - adjustedPoint.y)};
+    }
+
+    bool checkCollision(const Quad &boxQuad, glm::vec2 &ejectionVector) const
+    {
+        glm::vec2 minExtents = boxQuad.points[0];
+        glm::vec2 maxExtents = boxQuad.points[0];
+        for (size_t i = 1; i < 4; i++)
+        {
+            minExtents = glm::min(minExtents, boxQuad.points[i]);
+            maxExtents = glm::max(maxExtents, boxQuad.points[i]);
+        }
+        glm::vec2 boxCenter = (minExtents + maxExtents) / 2.0f;
+
+        auto minCoords = pointToTileCoordinates(minExtents);
+        auto maxCoords = pointToTileCoordinates(maxExtents);
+
+        ejectionVector = glm::vec2{0};
+        bool collisionDetected = false;
+        for (size_t i = maxCoords.second; i <= minCoords.second; i++)
+        {
+            for (size_t j = minCoords.first; j <= maxCoords.first; j++)
+            {
+                if (!isCollidable(j, i))
+                    continue;
+
+                const auto tile = tileAABB(j, i);
+                float overlapAmount = 0;
+                glm::vec2 ejectionNormal;
+                if (!::checkCollision(tile, boxQuad, ejectionNormal, overlapAmount))
+                    continue;
+                ejectionVector += glm::normalize(boxCenter - tile.center()) * overlapAmount;
+                collisionDetected = true;
+            }
+        }
+        return collisionDetected;
+    }
+
+    std::vector<std::vector<Tile>> tiles;
+    glm::vec2 center;
+    int tileSize = 1;
+};
+
+class TileMapTest : public ::testing::Test
+{
+protected:
+    void TearDown() override
+    {
+        std::filesystem::remove(path);
+    }
+
+    // A level of the given size with only a border, and one wall tile
+    static LevelData borderLevel(uint32_t columns, uint32_t rows)
+    {
+        LevelData level;
+        level.resize(columns, rows);
+        for (uint32_t column = 0; column < columns; column++)
+        {
+            level.at(column, 0) = LevelFile::wall;
+            level.at(column, rows - 1) = LevelFile::wall;
+        }
+        for (uint32_t row = 0; row < rows; row++)
+        {
+            level.at(0, row) = LevelFile::wall;
+            level.at(columns - 1, row) = LevelFile::wall;
+        }
+        return level;
+    }
+
+    // The middle of a tile, in the map's coordinates
+    static glm::vec2 tileCenter(const TileMap &map, uint32_t column, uint32_t row)
+    {
+        return map.tileAABB(column, row).center();
+    }
+
+    const std::string path = (std::filesystem::temp_directory_path() / "combat_gl_tile_map_test.level").string();
+};
+
+TEST_F(TileMapTest, CanRoundTripLevelFile)
+{
+    auto level = parsePlayField("****\n"
+                                "*T \n"
+                                "****");
+    writeLevelFile(path, level, 2);
+
+    LevelFile file(path);
+    EXPECT_EQ(4, file.columns());
+    EXPECT_EQ(3, file.rows());
+    EXPECT_EQ(2, file.chunkColumns());
+    EXPECT_EQ(2, file.chunkRows());
+    ASSERT_EQ(1, file.spawns().size());
+    EXPECT_EQ(1, file.spawns()[0].column);
+    EXPECT_EQ(1, file.spawns()[0].row);
+
+    // Top right chunk: the top wall, then the open end of the middle row
+    uint8_t tiles[4];
+    EXPECT_TRUE(file.readChunk(1, tiles));
+    EXPECT_EQ(LevelFile::wall, tiles[0]);
+    EXPECT_EQ(LevelFile::wall, tiles[1]);
+    EXPECT_EQ(LevelFile::empty, tiles[2]);
+    EXPECT_EQ(LevelFile::empty, tiles[3]);
+
+    // Bottom left chunk: the bottom wall, and past the last row
+    EXPECT_TRUE(file.readChunk(2, tiles));
+    EXPECT_EQ(LevelFile::wall, tiles[0]);
+    EXPECT_EQ(LevelFile::wall, tiles[1]);
+    EXPECT_EQ(LevelFile::empty, tiles[2]);
+}
+
+TEST_F(TileMapTest, CanSkipEmptyChunks)
+{
+    LevelData level;
+    level.resize(8, 8);
+    level.at(7, 7) = LevelFile::wall;
+    writeLevelFile(path, level, 4);
+
+    LevelFile file(path);
+    uint8_t tiles[16];
+    EXPECT_FALSE(file.readChunk(0, tiles));
+    EXPECT_EQ(LevelFile::empty, tiles[0]);
+    EXPECT_TRUE(file.readChunk(3, tiles));
+    EXPECT_EQ(LevelFile::wall, tiles[15]);
+
+    // Header, an empty spawn list, the table and one chunk
+    EXPECT_EQ(sizeof(LevelFile::Header) + 4 * sizeof(uint64_t) + 16, std::filesystem::file_size(path));
+}
+
+TEST_F(TileMapTest, CanRejectOtherFiles)
+{
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "not a level at all";
+    }
+    EXPECT_THROW(LevelFile file(path), std::runtime_error);
+    EXPECT_THROW(LevelFile file(path + ".missing"), std::runtime_error);
+}
+
+TEST_F(TileMapTest, CanRejectHeaderLargerThanFile)
+{
+    const auto patchHeader = [this](size_t offset, uint32_t value)
+    {
+        writeLevelFile(path, parsePlayField("****\n*T *\n****"), 2);
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(static_cast<std::streamoff>(offset));
+        file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    };
+
+    patchHeader(offsetof(LevelFile::Header, spawnCount), 0xFFFFFFFF);
+    EXPECT_THROW(LevelFile file(path), std::runtime_error);
+    patchHeader(offsetof(LevelFile::Header, columns), 0x10000000);
+    EXPECT_THROW(LevelFile file(path), std::runtime_error);
+    patchHeader(offsetof(LevelFile::Header, spawnCount), 2);
+    EXPECT_THROW(LevelFile file(path), std::runtime_error);
+}
+
+TEST_F(TileMapTest, CanBuildFromPlayField)
+{
+    TileMap map;
+    prepareTileMap("***\n"
+                   "* *\n"
+                   "***",
+                   map);
+
+    EXPECT_EQ(3, map.columns());
+    EXPECT_EQ(3, map.rows());
+    EXPECT_TRUE(map.isCollidable(0, 0));
+    EXPECT_FALSE(map.isCollidable(1, 1));
+    EXPECT_FALSE(map.isCollidable(3, 1));
+    EXPECT_FALSE(map.isCollidable(1, 100));
+    EXPECT_THROW(map.setCollidable(3, 0, true), std::out_of_range);
+    EXPECT_THROW(map.resize(10, 10, 48), std::runtime_error);
+
+    // Where the walls are put, with the first row on top
+    EXPECT_EQ(glm::vec2(-1.5f, 0.5f), tileCenter(map, 0, 0));
+    EXPECT_EQ(glm::vec2(-0.5f, -0.5f), tileCenter(map, 1, 1));
+}
+
+TEST_F(TileMapTest, CanCollideAcrossChunks)
+{
+    auto level = borderLevel(10, 10);
+    level.at(3, 4) = LevelFile::wall;
+    level.at(4, 4) = LevelFile::wall;
+    writeLevelFile(path, level, 4);
+
+    TileMap map;
+    map.stream(std::make_unique<LevelFile>(path));
+    const auto point = tileCenter(map, 4, 4);
+    map.streamAround(&point, 1);
+    map.waitForLoads();
+
+    // The two tiles are in neighbouring chunks, a box over both is pushed
+    // straight down and not to either side
+    const glm::vec2 middle = (tileCenter(map, 3, 4) + tileCenter(map, 4, 4)) * 0.5f - glm::vec2{0.0f, 0.6f};
+    const Quad box{{middle + glm::vec2{-0.25f, -0.25f}, middle + glm::vec2{-0.25f, 0.25f},
+                    middle + glm::vec2{0.25f, 0.25f}, middle + glm::vec2{0.25f, -0.25f}}};
+    glm::vec2 ejection;
+    ASSERT_TRUE(map.checkCollision(box, ejection));
+    EXPECT_NEAR(0.0f, ejection.x, 1e-4f);
+    EXPECT_LT(ejection.y, 0.0f);
+}
+
+TEST_F(TileMapTest, CanWallOffMissingChunks)
+{
+    writeLevelFile(path, borderLevel(64, 64), 8);
+
+    TileMap map;
+    map.stream(std::make_unique<LevelFile>(path), 1, 2);
+    EXPECT_TRUE(map.isCollidable(20, 20));
+
+    const auto point = tileCenter(map, 20, 20);
+    map.streamAround(&point, 1);
+    map.waitForLoads();
+
+    // The three by three chunks around the point are in, nothing else
+    EXPECT_EQ(9, map.loadedChunks().size());
+    EXPECT_EQ(9, map.stats().residentChunks);
+    EXPECT_EQ(9 * 64, map.stats().residentBytes);
+    EXPECT_FALSE(map.isCollidable(20, 20));
+    EXPECT_FALSE(map.isCollidable(8, 8));
+    EXPECT_TRUE(map.isCollidable(40, 40));
+
+    glm::vec2 ejection;
+    const auto far = tileCenter(map, 40, 40);
+    const Quad box{{far + glm::vec2{-0.25f, -0.25f}, far + glm::vec2{-0.25f, 0.25f},
+                    far + glm::vec2{0.25f, 0.25f}, far + glm::vec2{0.25f, -0.25f}}};
+    EXPECT_TRUE(map.checkCollision(box, ejection));
+}
+
+TEST_F(TileMapTest, CanEvictDistantChunks)
+{
+    writeLevelFile(path, borderLevel(64, 64), 8);
+
+    TileMap map;
+    map.stream(std::make_unique<LevelFile>(path), 0, 1);
+    auto point = tileCenter(map, 4, 4);
+    map.streamAround(&point, 1);
+    map.waitForLoads();
+    EXPECT_EQ(1, map.stats().residentChunks);
+
+    // Still within reach of the next chunk over, so kept
+    point = tileCenter(map, 12, 4);
+    map.streamAround(&point, 1);
+    map.waitForLoads();
+    EXPECT_EQ(2, map.stats().residentChunks);
+    EXPECT_EQ(0, map.stats().chunksEvicted);
+
+    point = tileCenter(map, 60, 60);
+    map.streamAround(&point, 1);
+    EXPECT_EQ(2, map.evictedChunks().size());
+    map.waitForLoads();
+    EXPECT_EQ(1, map.stats().residentChunks);
+    EXPECT_EQ(3, map.stats().chunksLoaded);
+    EXPECT_FALSE(map.isCollidable(60, 60 - 1));
+    EXPECT_TRUE(map.isCollidable(4, 4));
+}
+
+// Memory and load latency while a point crosses a 4096 x 4096 map, which
+// would take 16 MiB with every tile in memory
+TEST_F(TileMapTest, BenchmarkStreamingHugeMap)
+{
+    constexpr uint32_t size = 4096;
+    constexpr int steps = 512;
+    constexpr int stride = 8;
+
+    auto level = borderLevel(size, size);
+    for (uint32_t row = 4; row < size; row += 8)
+    {
+        for (uint32_t column = 4; column < size; column += 8)
+        {
+            level.at(column, row) = LevelFile::wall;
+        }
+    }
+    const auto writeStart = std::chrono::steady_clock::now();
+    writeLevelFile(path, level, TileMap::defaultChunkSize);
+    const std::chrono::duration<double> writeTime = std::chrono::steady_clock::now() - writeStart;
+    level = {};
+
+    TileMap map;
+    const auto openStart = std::chrono::steady_clock::now();
+    map.stream(std::make_unique<LevelFile>(path));
+    auto point = tileCenter(map, 8, 8);
+    map.streamAround(&point, 1);
+    map.waitForLoads();
+    const std::chrono::duration<double> firstLoad = std::chrono::steady_clock::now() - openStart;
+
+    // Along the diagonal, a few tiles a millisecond, never waiting on a load
+    size_t peakBytes = 0;
+    for (int step = 0; step < steps; step++)
+    {
+        point = tileCenter(map, 8 + step * stride, 8 + step * stride);
+        map.streamAround(&point, 1);
+        peakBytes = std::max(peakBytes, map.stats().residentBytes);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    map.waitForLoads();
+    peakBytes = std::max(peakBytes, map.stats().residentBytes);
+    const auto &stats = map.stats();
+
+    std::cout << "Streaming a " << size << "x" << size << " map (" << std::filesystem::file_size(path) / 1024 << " KiB, written in "
+              << writeTime.count() * 1000.0 << " ms):\n"
+              << "\tFirst chunks resident after " << firstLoad.count() * 1000.0 << " ms\n"
+              << "\tChunk load ms: " << stats.loadSeconds * 1000.0 / stats.chunksLoaded << " mean, " << stats.maxLoadSeconds * 1000.0 << " max\n"
+              << "\tPeak resident " << peakBytes / 1024 << " KiB of " << static_cast<size_t>(size) * size / 1024 << " KiB, "
+              << stats.chunksLoaded << " chunks loaded, " << stats.chunksEvicted << " evicted" << std::endl;
+    RecordProperty("FirstLoadMicroseconds", static_cast<int>(firstLoad.count() * 1e6));
+    RecordProperty("MeanChunkLoadMicroseconds", static_cast<int>(stats.loadSeconds * 1e6 / stats.chunksLoaded));
+    RecordProperty("PeakResidentKiB", static_cast<int>(peakBytes / 1024));
+
+    EXPECT_LT(peakBytes, static_cast<size_t>(size) * size / 64);
+    EXPECT_GT(stats.chunksEvicted, 0);
+    EXPECT_FALSE(map.isCollidable(8 + (steps - 1) * stride, 8 + (steps - 1) * stride + 1));
+}
+
+// Queries per second of the bitset against rows of bools, at a few sizes.
+// The boxes are up to tank sized and turned every which way, one tile in
+// twenty is a wall.
+TEST_F(TileMapTest, BenchmarkCollisionQueries)
+{
+    constexpr size_t queryCount = 200000;
+
+    for (const uint32_t size : {64u, 512u, 4096u})
+    {
+        std::mt19937 rng(size);
+        std::bernoulli_distribution isWall(0.05);
+        TileMap map;
+        map.resize(size, size);
+        NestedTileMap nested;
+        nested.tiles.assign(size, std::vector<NestedTileMap::Tile>(size));
+        nested.center = map.center;
+        for (uint32_t row = 0; row < size; row++)
+        {
+            for (uint32_t column = 0; column < size; column++)
+            {
+                const bool wall = isWall(rng);
+                map.setCollidable(column, row, wall);
+                nested.tiles[row][column].isCollidable = wall;
+            }
+        }
+
+        std::uniform_real_distribution<float> coordinate(-static_cast<float>(size) / 2.0f + 2.0f, static_cast<float>(size) / 2.0f - 2.0f);
+        std::uniform_real_distribution<float> boxSize(0.25f, 1.0f);
+        std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+        std::vector<Quad> queries(queryCount);
+        for (auto &quad : queries)
+        {
+            const glm::vec2 middle{coordinate(rng), coordinate(rng)};
+            const auto half = boxSize(rng) * 0.5f;
+            const auto turn = angle(rng);
+            const glm::vec2 across = glm::vec2{std::cos(turn), std::sin(turn)} * half;
+            const glm::vec2 up{-across.y, across.x};
+            quad.points[0] = middle - across - up;
+            quad.points[1] = middle - across + up;
+            quad.points[2] = middle + across + up;
+            quad.points[3] = middle + across - up;
+        }
+
+        const auto time = [&queries](const auto &tileMap, std::vector<glm::vec2> &ejections)
+        {
+            ejections.assign(queries.size(), glm::vec2{0});
+            const auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < queries.size(); i++)
+            {
+                tileMap.checkCollision(queries[i], ejections[i]);
+            }
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            return static_cast<double>(queries.size()) / elapsed.count();
+        };
+        // Best of a few turns each, taken in alternation so neither gets the
+        // warmer caches
+        std::vector<glm::vec2> nestedEjections;
+        std::vector<glm::vec2> bitsetEjections;
+        double nestedRate = 0;
+        double bitsetRate = 0;
+        for (int turn = 0; turn < 3; turn++)
+        {
+            nestedRate = std::max(nestedRate, time(nested, nestedEjections));
+            bitsetRate = std::max(bitsetRate, time(map, bitsetEjections));
+        }
+
+        std::cout << size << "x" << size << " tiles: " << nestedRate << " queries/sec nested, " << bitsetRate << " bitset ("
+                  << size * (sizeof(std::vector<NestedTileMap::Tile>) + size * sizeof(NestedTileMap::Tile)) << " bytes against "
+                  << map.stats().residentBytes << ")" << std::endl;
+        RecordProperty("NestedQueriesPerSecond" + std::to_string(size), static_cast<int>(nestedRate));
+        RecordProperty("BitsetQueriesPerSecond" + std::to_string(size), static_cast<int>(bitsetRate));
+
+        // Exactly the same answers
+        EXPECT_TRUE(std::equal(nestedEjections.begin(), nestedEjections.end(), bitsetEjections.begin()));
+    }
+}
@@ -0,0 +1,281 @@
+#include <gtest/gtest.h>
+
+#include "AppleSauceTest.h"
+#include "GLCallRecorder.h"
+#include <applesauce/Shader.h>
+#include <applesauce/UniformBuffer.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstring>
+#include <iostream>
+#include <set>
+
+namespace
+{
+    struct FrameBlock
+    {
+        glm::mat4 viewMatrix;
+        glm::vec4 ambientSky;
+        glm::vec4 lightDirection;
+    };
+
+    struct MaterialBlock
+    {
+        glm::vec4 color;
+        float metallicFactor;
+        float roughnessFactor;
+        float padding[2];
+    };
+}
+
+class AppleSauceUniformBuffer : public AppleSauceTest
+{
+protected:
+    void SetUp() override
+    {
+        shader.add_vertex_stage(R"(#version 330 core
+            in vec4 vPosition;
+
+            layout (std140) uniform Frame {
+                mat4 ViewMatrix;
+                vec4 AmbientSky;
+                vec4 LightDirection;
+            };
+
+            out vec3 ambient;
+
+            void main() {
+                gl_Position = ViewMatrix * vPosition;
+                ambient = AmbientSky.rgb * LightDirection.y;
+            })");
+        shader.add_fragment_stage(R"(#version 330 core
+            layout (std140) uniform Material {
+                vec4 Color;
+                float MetallicFactor;
+                float RoughnessFactor;
+            };
+
+            in vec3 ambient;
+            out vec4 fColor;
+
+            void main() {
+                fColor = vec4(Color.rgb * ambient * MetallicFactor * RoughnessFactor, 1.0);
+            })");
+        ASSERT_TRUE(shader.compile_and_link()) << shader.error_log();
+        shader.use();
+    }
+
+    Shader shader;
+};
+
+TEST_F(AppleSauceUniformBuffer, CanBindUniformBlocks)
+{
+    EXPECT_TRUE(shader.bindUniformBlock("Frame", 0));
+    EXPECT_TRUE(shader.bindUniformBlock("Material", 3));
+    EXPECT_FALSE(shader.bindUniformBlock("NotABlock", 1));
+
+    GLint binding = -1;
+    glGetActiveUniformBlockiv(shader.glId(), glGetUniformBlockIndex(shader.glId(), "Material"), GL_UNIFORM_BLOCK_BINDING, &binding);
+    EXPECT_EQ(3, binding);
+
+    GLint size = 0;
+    glGetActiveUniformBlockiv(shader.glId(), glGetUniformBlockIndex(shader.glId(), "Frame"), GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+    EXPECT_EQ(sizeof(FrameBlock), size);
+}
+
+TEST_F(AppleSauceUniformBuffer, CanUploadWholeBlock)
+{
+    applesauce::UniformBuffer<FrameBlock> uniforms(2);
+    const FrameBlock block{glm::mat4{2.0f}, {0.1f, 0.2f, 0.3f, 0.0f}, {0.0f, 1.0f, 0.0f, 0.0f}};
+    uniforms.set(block);
+
+    FrameBlock readBack{};
+    glGetBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(readBack), &readBack);
+    EXPECT_EQ(0, std::memcmp(&block, &readBack, sizeof(block)));
+
+    GLint bound = 0;
+    glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, 2, &bound);
+    EXPECT_EQ(uniforms.glId(), static_cast<GLuint>(bound));
+}
+
+TEST_F(AppleSauceUniformBuffer, CanStreamBlocksThroughRing)
+{
+    applesauce::UniformRing ring(4 * 1024, 1);
+    ASSERT_GT(ring.alignment(), 0);
+    EXPECT_EQ(0, ring.regionSize() % ring.alignment());
+
+    std::set<size_t> regions;
+    for (size_t frame = 0; frame < applesauce::UniformRing::framesInFlight + 1; frame++)
+    {
+        ring.beginFrame();
+        size_t previous = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            const MaterialBlock block{glm::vec4{static_cast<float>(i)}, 0.5f, 0.25f, {}};
+            const auto offset = ring.push(block);
+            EXPECT_EQ(0, offset % ring.alignment());
+            if (i > 0)
+            {
+                EXPECT_GE(offset, previous + sizeof(MaterialBlock));
+            }
+            previous = offset;
+            if (i == 0)
+            {
+                regions.insert(offset / ring.regionSize());
+            }
+        }
+        EXPECT_EQ(4, ring.stats().blocks);
+        ring.endFrame();
+    }
+    // Each frame in flight gets its own region, then the first one comes around again
+    EXPECT_EQ(applesauce::UniformRing::framesInFlight, regions.size());
+
+    glFinish();
+    ring.beginFrame();
+    const MaterialBlock block{{1.0f, 0.5f, 0.25f, 1.0f}, 0.75f, 0.125f, {}};
+    const auto offset = ring.push(block);
+    MaterialBlock readBack{};
+    glBindBuffer(GL_UNIFORM_BUFFER, ring.glId());
+    glGetBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(readBack), &readBack);
+    EXPECT_EQ(block.color, readBack.color);
+    EXPECT_EQ(block.roughnessFactor, readBack.roughnessFactor);
+    EXPECT_EQ(0, ring.stats().waits);
+
+    GLint64 boundOffset = -1;
+    glGetInteger64i_v(GL_UNIFORM_BUFFER_START, 1, &boundOffset);
+    EXPECT_EQ(offset, static_cast<size_t>(boundOffset));
+
+    ring.endFrame();
+}
+
+TEST_F(AppleSauceUniformBuffer, CanGrowRingWhenRegionIsFull)
+{
+    applesauce::UniformRing ring(1024, 1);
+    const auto regionSize = ring.regionSize();
+    const auto oldBuffer = ring.glId();
+
+    ring.beginFrame();
+    MaterialBlock block{{1.0f, 0.5f, 0.25f, 1.0f}, 0.75f, 0.125f, {}};
+    size_t offset = 0;
+    for (size_t i = 0; i < regionSize / ring.alignment() + 1; i++)
+    {
+        block.color.w = static_cast<float>(i);
+        offset = ring.push(block);
+    }
+    EXPECT_EQ(1, ring.stats().grows);
+    EXPECT_EQ(regionSize * 2, ring.regionSize());
+    EXPECT_NE(oldBuffer, ring.glId());
+
+    // The block that didn't fit went to the new buffer, and is bound from it
+    MaterialBlock readBack{};
+    glBindBuffer(GL_UNIFORM_BUFFER, ring.glId());
+    glGetBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(readBack), &readBack);
+    EXPECT_EQ(block.color, readBack.color);
+    GLint bound = 0;
+    glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, 1, &bound);
+    EXPECT_EQ(ring.glId(), static_cast<GLuint>(bound));
+    ring.endFrame();
+
+    // And stays that size
+    ring.beginFrame();
+    for (size_t i = 0; i < regionSize / ring.alignment() + 1; i++)
+        ring.push(block);
+    EXPECT_EQ(0, ring.stats().grows);
+    ring.endFrame();
+}
+
+// GL calls per frame for the lighting constants and material switches of
+// Triangles::display(), loose uniforms against uniform blocks.
+TEST_F(AppleSauceUniformBuffer, CanReduceGLCallsPerFrame)
+{
+    constexpr int frameCount = 100;
+    constexpr int materialChanges = 12;
+
+    Shader loose;
+    loose.add_vertex_stage(R"(#version 330 core
+        in vec4 vPosition;
+        uniform mat4 ViewMatrix;
+        uniform mat4 ProjectionMatrix;
+        uniform mat4 ShadowMatrix;
+        uniform vec3 AmbientSky;
+        uniform vec3 AmbientEquator;
+        uniform vec3 AmbientGround;
+        out vec3 ambient;
+        out vec4 shadowPosition;
+        void main() {
+            gl_Position = ProjectionMatrix * ViewMatrix * vPosition;
+            shadowPosition = ShadowMatrix * vPosition;
+            ambient = AmbientSky + AmbientEquator + AmbientGround;
+        })");
+    loose.add_fragment_stage(R"(#version 330 core
+        uniform vec3 LightColor;
+        uniform vec3 LightDirection;
+        uniform vec3 Color;
+        uniform float MetallicFactor;
+        uniform float RoughnessFactor;
+        in vec3 ambient;
+        in vec4 shadowPosition;
+        out vec4 fColor;
+        void main() {
+            fColor = vec4(Color * ambient * LightColor * LightDirection * MetallicFactor * RoughnessFactor, shadowPosition.w);
+        })");
+    ASSERT_TRUE(loose.compile_and_link()) << loose.error_log();
+    loose.use();
+
+    const char *frameUniforms[] = {"ViewMatrix", "ProjectionMatrix", "ShadowMatrix"};
+    const char *lightingUniforms[] = {"AmbientSky", "AmbientEquator", "AmbientGround", "LightColor", "LightDirection"};
+
+    GLCallRecorder recorder;
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        // The camera and lighting change every frame, so the cache does not help
+        const auto value = static_cast<float>(frame);
+        for (const auto name : frameUniforms)
+            loose.set(loose.uniformHandle(name), glm::mat4{value});
+        for (const auto name : lightingUniforms)
+            loose.set(loose.uniformHandle(name), glm::vec3{value});
+        for (int i = 0; i < materialChanges; i++)
+        {
+            loose.set(loose.uniformHandle("Color"), glm::vec3{static_cast<float>(i)});
+            loose.set(loose.uniformHandle("MetallicFactor"), static_cast<float>(i));
+            loose.set(loose.uniformHandle("RoughnessFactor"), static_cast<float>(i));
+        }
+    }
+    const auto callsBefore = recorder.total();
+
+    shader.use();
+    shader.bindUniformBlock("Frame", 0);
+    shader.bindUniformBlock("Material", 1);
+    applesauce::UniformBuffer<FrameBlock> frameBlock(0);
+    applesauce::UniformRing materialRing(4 * 1024, 1);
+
+    recorder.reset();
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        const auto value = static_cast<float>(frame);
+        frameBlock.set({glm::mat4{value}, glm::vec4{value}, glm::vec4{value}});
+        materialRing.beginFrame();
+        for (int i = 0; i < materialChanges; i++)
+        {
+            materialRing.push(MaterialBlock{glm::vec4{static_cast<float>(i)}, static_cast<float>(i), static_cast<float>(i), {}});
+        }
+        materialRing.endFrame();
+    }
+    const auto callsAfter = recorder.total();
+
+    std::cout << "GL calls for " << frameCount << " frames of " << materialChanges << " materials: "
+              << callsBefore << " loose, " << callsAfter << " blocks ("
+              << (materialRing.isPersistent() ? "persistent" : "copied") << " ring)" << std::endl;
+    RecordProperty("GLCallsLoose", static_cast<int>(callsBefore));
+    RecordProperty("GLCallsBlocks", static_cast<int>(callsAfter));
+
+    EXPECT_EQ(frameCount * (8 + materialChanges * 3), callsBefore);
+    // One upload of the frame block, then a range bind per material, plus an
+    // upload per material without persistent mapping
+    const size_t perMaterial = materialRing.isPersistent() ? 1 : 3;
+    EXPECT_EQ(frameCount * (3 + materialChanges * perMaterial), callsAfter);
+    EXPECT_LT(callsAfter, callsBefore);
+}